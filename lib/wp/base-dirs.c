@@ -11,12 +11,219 @@
 #include "wpversion.h"
 #include "wpbuildbasedirs.h"
 
+#include <gio/gio.h>
+
 WP_DEFINE_LOCAL_LOG_TOPIC ("wp-base-dirs")
 
 /*!
  * \defgroup wpbasedirs Base Directories File Lookup
  */
 
+/*
+ * Optional cache of directory contents, see wp_base_dirs_set_cache_enabled().
+ * Maps a canonical directory path to a struct dir_cache_entry; the entry
+ * holds the names of the regular files in this directory and a monitor
+ * that drops the entry when the directory changes.
+ */
+struct dir_cache_entry
+{
+  GHashTable *files;        /* set of filenames; NULL if the dir is missing */
+  GFileMonitor *monitor;
+};
+
+static GMutex dir_cache_lock;
+static GHashTable *dir_cache = NULL;
+
+static void
+dir_cache_entry_free (struct dir_cache_entry *entry)
+{
+  g_clear_pointer (&entry->files, g_hash_table_unref);
+  if (entry->monitor) {
+    g_signal_handlers_disconnect_by_data (entry->monitor, entry);
+    g_file_monitor_cancel (entry->monitor);
+    g_clear_object (&entry->monitor);
+  }
+  g_slice_free (struct dir_cache_entry, entry);
+}
+
+static void
+on_cached_dir_changed (GFileMonitor *monitor, GFile *file, GFile *other,
+    GFileMonitorEvent event_type, gpointer data)
+{
+  g_autofree gchar *dirpath = NULL;
+
+  if (event_type == G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
+    return;
+
+  g_mutex_lock (&dir_cache_lock);
+  /* the entry may have already been dropped and replaced by a new one */
+  if (dir_cache) {
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init (&iter, dir_cache);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+      if (value == data) {
+        dirpath = g_strdup (key);
+        g_hash_table_iter_remove (&iter);
+        break;
+      }
+    }
+  }
+  g_mutex_unlock (&dir_cache_lock);
+
+  if (dirpath)
+    wp_debug ("dir changed, dropped from the cache: %s", dirpath);
+}
+
+/* Returns the cache entry of the given directory, scanning the directory
+ * if it is not in the cache already, or NULL if the directory cannot be
+ * cached. Must be called with dir_cache_lock held and the cache enabled */
+static struct dir_cache_entry *
+dir_cache_get_entry (const gchar *dirpath)
+{
+  struct dir_cache_entry *entry = g_hash_table_lookup (dir_cache, dirpath);
+  g_autoptr (GFile) gfile = NULL;
+  g_autoptr (GFileMonitor) monitor = NULL;
+  g_autoptr (GDir) dir = NULL;
+
+  if (entry)
+    return entry;
+
+  /* start monitoring before scanning, so that no change can be missed;
+     without a monitor the entry could go stale, so it is not cached */
+  gfile = g_file_new_for_path (dirpath);
+  monitor = g_file_monitor_directory (gfile, G_FILE_MONITOR_NONE, NULL, NULL);
+  if (!monitor)
+    return NULL;
+
+  entry = g_slice_new0 (struct dir_cache_entry);
+  entry->monitor = g_steal_pointer (&monitor);
+  g_signal_connect (entry->monitor, "changed",
+      G_CALLBACK (on_cached_dir_changed), entry);
+
+  wp_trace ("scanning dir: %s", dirpath);
+
+  dir = g_dir_open (dirpath, 0, NULL);
+  if (dir) {
+    const gchar *filename;
+
+    entry->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    while ((filename = g_dir_read_name (dir))) {
+      g_autofree gchar *path = g_build_filename (dirpath, filename, NULL);
+      if (g_file_test (path, G_FILE_TEST_IS_REGULAR))
+        g_hash_table_add (entry->files, g_strdup (filename));
+    }
+  }
+
+  g_hash_table_insert (dir_cache, g_strdup (dirpath), entry);
+  return entry;
+}
+
+/* Equivalent to g_file_test (path, G_FILE_TEST_IS_REGULAR), but served
+ * from the cache when it is enabled; path must be canonical */
+static gboolean
+is_regular_file (const gchar *path)
+{
+  gboolean ret = FALSE, cached = FALSE;
+
+  g_mutex_lock (&dir_cache_lock);
+  if (dir_cache) {
+    g_autofree gchar *dirpath = g_path_get_dirname (path);
+    g_autofree gchar *filename = g_path_get_basename (path);
+    struct dir_cache_entry *entry = dir_cache_get_entry (dirpath);
+    if (entry) {
+      ret = entry->files && g_hash_table_contains (entry->files, filename);
+      cached = TRUE;
+    }
+  }
+  g_mutex_unlock (&dir_cache_lock);
+
+  return cached ? ret : g_file_test (path, G_FILE_TEST_IS_REGULAR);
+}
+
+/* Returns the names of the entries of the given directory that are not
+ * hidden and, if the cache is enabled, are regular files, or NULL if the
+ * directory cannot be opened */
+static GPtrArray *
+list_dir (const gchar *dirpath)
+{
+  g_autoptr (GPtrArray) names = NULL;
+  g_autoptr (GDir) dir = NULL;
+  const gchar *filename;
+
+  g_mutex_lock (&dir_cache_lock);
+  if (dir_cache) {
+    struct dir_cache_entry *entry = dir_cache_get_entry (dirpath);
+    if (entry) {
+      if (entry->files) {
+        GHashTableIter iter;
+        gpointer key;
+
+        names = g_ptr_array_new_with_free_func (g_free);
+        g_hash_table_iter_init (&iter, entry->files);
+        while (g_hash_table_iter_next (&iter, &key, NULL)) {
+          if (((const gchar *) key)[0] != '.')
+            g_ptr_array_add (names, g_strdup (key));
+        }
+      }
+      g_mutex_unlock (&dir_cache_lock);
+      return g_steal_pointer (&names);
+    }
+  }
+  g_mutex_unlock (&dir_cache_lock);
+
+  dir = g_dir_open (dirpath, 0, NULL);
+  if (!dir)
+    return NULL;
+
+  wp_trace ("searching dir: %s", dirpath);
+
+  names = g_ptr_array_new_with_free_func (g_free);
+  while ((filename = g_dir_read_name (dir))) {
+    if (filename[0] != '.')
+      g_ptr_array_add (names, g_strdup (filename));
+  }
+  return g_steal_pointer (&names);
+}
+
+/*!
+ * \brief Enables or disables caching of the contents of the lookup
+ * directories
+ *
+ * When enabled, the first lookup in a directory scans it and keeps the names
+ * of the regular files that it contains in memory. Subsequent lookups with
+ * wp_base_dirs_find_file() and wp_base_dirs_new_files_iterator() are then
+ * served from memory, without any filesystem access. This is mostly useful
+ * when the lookup directories are on a slow filesystem, such as an NFS home.
+ *
+ * Each cached directory is watched with a GFileMonitor, which drops it from
+ * the cache when its contents change. The monitors deliver their events on
+ * the thread-default GMainContext of the thread that first looks up in each
+ * directory, so that context needs to be running for changes to be noticed.
+ * Until the change event is dispatched, lookups may return stale results.
+ *
+ * Disabling the cache also clears it. The cache is disabled by default.
+ *
+ * \ingroup wpbasedirs
+ * \param enabled whether to enable the cache
+ * \since 0.5.9
+ */
+void
+wp_base_dirs_set_cache_enabled (gboolean enabled)
+{
+  g_autoptr (GHashTable) old_cache = NULL;
+
+  g_mutex_lock (&dir_cache_lock);
+  if (enabled && !dir_cache) {
+    dir_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify) dir_cache_entry_free);
+  } else if (!enabled) {
+    old_cache = g_steal_pointer (&dir_cache);
+  }
+  g_mutex_unlock (&dir_cache_lock);
+}
+
 /* Returns /basedir/subdir/filename, with filename treated as a module
  * if WP_BASE_DIRS_FLAG_MODULE is set.
  * The basedir is assumed to be either an absolute path or NULL.
@@ -169,7 +376,7 @@ wp_base_dirs_find_file (WpBaseDirsFlags flags, const gchar * subdir,
     g_autofree gchar *path = make_path (flags, g_ptr_array_index (dir_paths, i),
                                         subdir, filename);
     wp_trace ("test file: %s", path);
-    if (g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+    if (is_regular_file (path)) {
       ret = g_steal_pointer (&path);
       break;
     }
@@ -310,26 +517,22 @@ wp_base_dirs_new_files_iterator (WpBaseDirsFlags flags,
   for (guint i = dir_paths->len; i > 0; i--) {
     g_autofree gchar *dirpath =
         g_canonicalize_filename (subdir, g_ptr_array_index (dir_paths, i - 1));
-    g_autoptr (GDir) dir = g_dir_open (dirpath, 0, NULL);
+    g_autoptr (GPtrArray) names = list_dir (dirpath);
 
-    if (dir) {
+    if (names) {
       g_autoptr (GArray) dir_items = g_array_new (FALSE, FALSE,
           sizeof (struct conffile_iterator_item));
 
-      wp_trace ("searching dir: %s", dirpath);
-
       /* Store all filenames with their full path in the local array */
-      const gchar *filename;
-      while ((filename = g_dir_read_name (dir))) {
-        if (filename[0] == '.')
-          continue;
+      for (guint n = 0; n < names->len; n++) {
+        const gchar *filename = g_ptr_array_index (names, n);
 
         if (suffix && !g_str_has_suffix (filename, suffix))
           continue;
 
         /* verify the file is regular and canonicalize the path */
         g_autofree gchar *path = make_path (flags, dirpath, NULL, filename);
-        if (!g_file_test (path, G_FILE_TEST_IS_REGULAR))
+        if (!is_regular_file (path))
           continue;
 
         /* remove item with the same filename from the global items array,
@@ -84,6 +84,9 @@ WP_API
 WpIterator * wp_base_dirs_new_files_iterator (WpBaseDirsFlags flags,
     const gchar * subdir, const gchar * suffix);
 
+WP_API
+void wp_base_dirs_set_cache_enabled (gboolean enabled);
+
 G_END_DECLS
 
 #endif
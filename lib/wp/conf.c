@@ -44,6 +44,29 @@ wp_conf_section_clear (WpConfSection * section)
 }
 G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (WpConfSection, wp_conf_section_clear)
 
+typedef struct _WpConfSectionIndex WpConfSectionIndex;
+struct _WpConfSectionIndex
+{
+  GArray *fragments; /* element-type: guint, indices in conf_sections */
+  WpSpaJson *merged; /* the cached result of merging the fragments */
+};
+
+static WpConfSectionIndex *
+wp_conf_section_index_new (void)
+{
+  WpConfSectionIndex *self = g_new0 (WpConfSectionIndex, 1);
+  self->fragments = g_array_new (FALSE, FALSE, sizeof (guint));
+  return self;
+}
+
+static void
+wp_conf_section_index_free (WpConfSectionIndex * self)
+{
+  g_array_unref (self->fragments);
+  g_clear_pointer (&self->merged, wp_spa_json_unref);
+  g_free (self);
+}
+
 struct _WpConf
 {
   GObject parent;
@@ -54,6 +77,7 @@ struct _WpConf
 
   /* Private */
   GArray *conf_sections; /* element-type: WpConfSection */
+  GHashTable *sections_index; /* name -> WpConfSectionIndex */
   GPtrArray *files; /* element-type: GMappedFile* */
 };
 
@@ -70,6 +94,8 @@ wp_conf_init (WpConf * self)
 {
   self->conf_sections = g_array_new (FALSE, FALSE, sizeof (WpConfSection));
   g_array_set_clear_func (self->conf_sections, (GDestroyNotify) wp_conf_section_clear);
+  self->sections_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) wp_conf_section_index_free);
   self->files = g_ptr_array_new_with_free_func ((GDestroyNotify) g_mapped_file_unref);
 }
 
@@ -119,6 +145,7 @@ wp_conf_finalize (GObject * object)
   wp_conf_close (self);
   g_clear_pointer (&self->properties, wp_properties_unref);
   g_clear_pointer (&self->conf_sections, g_array_unref);
+  g_clear_pointer (&self->sections_index, g_hash_table_unref);
   g_clear_pointer (&self->files, g_ptr_array_unref);
   g_clear_pointer (&self->name, g_free);
 
@@ -308,9 +335,27 @@ open_and_load_sections (WpConf * self, const gchar *path, GError ** error)
      still point to the data in the GMappedFile, so this is why we keep the
      GMappedFile alive */
   g_ptr_array_add (self->files, g_steal_pointer (&file));
+  guint first = self->conf_sections->len;
   g_array_append_vals (self->conf_sections, sections->data, sections->len);
   g_array_set_clear_func (sections, NULL);
 
+  /* index the new sections by name, without the "override." prefix */
+  for (guint i = first; i < self->conf_sections->len; i++) {
+    WpConfSection *s = &g_array_index (self->conf_sections, WpConfSection, i);
+    const gchar *s_name = s->name;
+    WpConfSectionIndex *index;
+
+    if (g_str_has_prefix (s_name, OVERRIDE_SECTION_PREFIX))
+      s_name += strlen (OVERRIDE_SECTION_PREFIX);
+
+    index = g_hash_table_lookup (self->sections_index, s_name);
+    if (!index) {
+      index = wp_conf_section_index_new ();
+      g_hash_table_insert (self->sections_index, g_strdup (s_name), index);
+    }
+    g_array_append_val (index->fragments, i);
+  }
+
   return TRUE;
 }
 
@@ -389,6 +434,7 @@ wp_conf_close (WpConf * self)
 {
   g_return_if_fail (WP_IS_CONF (self));
 
+  g_hash_table_remove_all (self->sections_index);
   g_array_set_size (self->conf_sections, 0);
   g_ptr_array_set_size (self->files, 0);
 }
@@ -421,78 +467,92 @@ wp_conf_get_name (WpConf * self)
   return self->name;
 }
 
-static WpSpaJson *
-ensure_merged_section (WpConf * self, const gchar *section)
+/*!
+ * \brief Creates an iterator over the names of all the sections that are
+ *   defined in the configuration file and its fragments
+ *
+ * Each name is listed only once, even if the section is defined in multiple
+ * locations, and without any "override." prefix. The configuration needs to
+ * be open for this to return anything.
+ *
+ * \ingroup wpconf
+ * \since 0.5.9
+ * \param self the configuration
+ * \returns (transfer full): an iterator over the section names (strings)
+ */
+WpIterator *
+wp_conf_new_section_names_iterator (WpConf * self)
 {
-  g_autoptr (WpSpaJson) merged = NULL;
-  WpConfSection *merged_section = NULL;
+  g_return_val_if_fail (WP_IS_CONF (self), NULL);
 
-  /* check if the section is already merged */
-  for (guint i = 0; i < self->conf_sections->len; i++) {
-    WpConfSection *s = &g_array_index (self->conf_sections, WpConfSection, i);
-    if (g_str_equal (s->name, section)) {
-      if (!s->location) {
-        wp_debug_object (self, "section %s is already merged", section);
-        return wp_spa_json_ref (s->value);
-      }
-    }
-  }
+  GPtrArray *names = g_ptr_array_new_with_free_func (g_free);
 
-  /* Iterate over the sections and merge them */
+  /* list the names in the order in which they first appear */
   for (guint i = 0; i < self->conf_sections->len; i++) {
     WpConfSection *s = &g_array_index (self->conf_sections, WpConfSection, i);
     const gchar *s_name = s->name;
+    WpConfSectionIndex *index;
 
-    /* skip the "override." prefix and take a note */
-    gboolean override = g_str_has_prefix (s_name, OVERRIDE_SECTION_PREFIX);
-    if (override)
+    if (g_str_has_prefix (s_name, OVERRIDE_SECTION_PREFIX))
       s_name += strlen (OVERRIDE_SECTION_PREFIX);
 
-    if (g_str_equal (s_name, section)) {
-      /* Merge sections if a previous value exists and
-         the 'override.' prefix is not present */
-      if (!override && merged) {
-        g_autoptr (WpSpaJson) new_merged =
-            wp_json_utils_merge_containers (merged, s->value);
-        if (!merged) {
-          wp_warning_object (self,
-              "skipping merge of '%s' from '%s' as JSON containers are not compatible",
-              section, s->location);
-          continue;
-        }
-
-        g_clear_pointer (&merged, wp_spa_json_unref);
-        merged = g_steal_pointer (&new_merged);
-        merged_section = NULL;
-      }
-      /* Otherwise always replace */
-      else {
-        g_clear_pointer (&merged, wp_spa_json_unref);
-        merged = wp_spa_json_ref (s->value);
-        merged_section = s;
-      }
+    index = g_hash_table_lookup (self->sections_index, s_name);
+    if (g_array_index (index->fragments, guint, 0) == i)
+      g_ptr_array_add (names, g_strdup (s_name));
+  }
+
+  return wp_iterator_new_ptr_array (names, G_TYPE_STRING);
+}
+
+static WpSpaJson *
+ensure_merged_section (WpConf * self, const gchar *section)
+{
+  WpConfSectionIndex *index =
+      g_hash_table_lookup (self->sections_index, section);
+  g_autoptr (GPtrArray) values = NULL;
+  guint start = 0;
+
+  if (!index) {
+    wp_info_object (self, "section '%s' is not defined", section);
+    return NULL;
+  }
+
+  /* check if the section is already merged */
+  if (index->merged) {
+    wp_debug_object (self, "section %s is already merged", section);
+    return wp_spa_json_ref (index->merged);
+  }
+
+  /* a fragment with the 'override.' prefix replaces all the previous ones */
+  for (guint i = index->fragments->len; i > 0; i--) {
+    guint idx = g_array_index (index->fragments, guint, i - 1);
+    WpConfSection *s = &g_array_index (self->conf_sections, WpConfSection, idx);
+    if (g_str_has_prefix (s->name, OVERRIDE_SECTION_PREFIX)) {
+      start = i - 1;
+      break;
     }
   }
 
-  /* cache the result */
-  if (merged_section) {
-    /* if the merged json came from a single location, just clear
-       the location from that WpConfSection to mark it as the result */
+  values = g_ptr_array_sized_new (index->fragments->len - start);
+  for (guint i = start; i < index->fragments->len; i++) {
+    guint idx = g_array_index (index->fragments, guint, i);
+    WpConfSection *s = &g_array_index (self->conf_sections, WpConfSection, idx);
+    g_ptr_array_add (values, s->value);
+  }
+
+  if (values->len == 1) {
+    guint idx = g_array_index (index->fragments, guint, start);
     wp_info_object (self, "section '%s' is used as-is from '%s'", section,
-        merged_section->location);
-    g_clear_pointer (&merged_section->location, g_free);
-  } else if (merged) {
-    /* if the merged json came from multiple locations, create a new
-       WpConfSection to store it */
-    WpConfSection s = { g_strdup (section), wp_spa_json_ref (merged), NULL };
-    g_array_append_val (self->conf_sections, s);
-    wp_info_object (self, "section '%s' is merged from multiple locations",
-        section);
+        g_array_index (self->conf_sections, WpConfSection, idx).location);
   } else {
-    wp_info_object (self, "section '%s' is not defined", section);
+    wp_info_object (self, "section '%s' is merged from %u locations",
+        section, values->len);
   }
 
-  return g_steal_pointer (&merged);
+  /* merge all the fragments in one pass and cache the result */
+  index->merged = wp_json_utils_merge_values (
+      (WpSpaJson * const *) values->pdata, values->len, section);
+  return index->merged ? wp_spa_json_ref (index->merged) : NULL;
 }
 
 /*!
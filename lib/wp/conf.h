@@ -11,6 +11,7 @@
 
 #include "spa-json.h"
 #include "properties.h"
+#include "iterator.h"
 
 G_BEGIN_DECLS
 
@@ -44,6 +45,9 @@ gboolean wp_conf_is_open (WpConf * self);
 WP_API
 const gchar * wp_conf_get_name (WpConf * self);
 
+WP_API
+WpIterator * wp_conf_new_section_names_iterator (WpConf * self);
+
 WP_API
 WpSpaJson * wp_conf_get_section (WpConf *self, const gchar *section);
 
@@ -877,6 +877,8 @@ wp_core_connect_internal (WpCore *self, int fd)
       &self->proxy_core_listener, &proxy_core_events, self);
 
   /* Add the registry listener */
+  self->registry.intern_properties = self->properties && spa_atob (
+      wp_properties_get (self->properties, "wireplumber.intern-properties"));
   wp_registry_attach (&self->registry, self->pw_core);
 
   return TRUE;
@@ -1481,6 +1483,60 @@ wp_core_test_feature (WpCore * self, const gchar * feature)
       g_str_equal, NULL);
 }
 
+/*!
+ * \brief Gets statistics about the objects that are known to the core
+ *
+ * \ingroup wpcore
+ * \since 0.5.9
+ * \param self the core
+ * \param n_globals (out)(optional): the number of globals announced by the
+ *   PipeWire registry
+ * \param n_objects (out)(optional): the number of local objects, registered
+ *   with wp_core_register_object()
+ * \param n_object_managers (out)(optional): the number of installed object
+ *   managers
+ * \param n_managed_objects (out)(optional): the sum of the number of objects
+ *   of all the installed object managers
+ * \param max_managed_objects (out)(optional): the number of objects of the
+ *   largest object manager
+ */
+void
+wp_core_get_registry_stats (WpCore * self, guint * n_globals,
+    guint * n_objects, guint * n_object_managers, guint * n_managed_objects,
+    guint * max_managed_objects)
+{
+  WpRegistry *reg;
+  guint globals = 0, managed = 0, max_managed = 0;
+
+  g_return_if_fail (WP_IS_CORE (self));
+  reg = &self->registry;
+
+  /* the globals array is indexed by id, so it has holes */
+  for (guint i = 0; i < reg->globals->len; i++) {
+    WpGlobal *g = g_ptr_array_index (reg->globals, i);
+    if (g && (g->flags & WP_GLOBAL_FLAG_APPEARS_ON_REGISTRY))
+      globals++;
+  }
+
+  for (guint i = 0; i < reg->object_managers->len; i++) {
+    WpObjectManager *om = g_ptr_array_index (reg->object_managers, i);
+    guint n = wp_object_manager_get_n_objects (om);
+    managed += n;
+    max_managed = MAX (max_managed, n);
+  }
+
+  if (n_globals)
+    *n_globals = globals;
+  if (n_objects)
+    *n_objects = reg->objects->len;
+  if (n_object_managers)
+    *n_object_managers = reg->object_managers->len;
+  if (n_managed_objects)
+    *n_managed_objects = managed;
+  if (max_managed_objects)
+    *max_managed_objects = max_managed;
+}
+
 WpRegistry *
 wp_core_get_registry (WpCore * self)
 {
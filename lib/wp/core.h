@@ -161,6 +161,13 @@ void wp_core_install_object_manager (WpCore * self, WpObjectManager * om);
 WP_API
 gboolean wp_core_test_feature (WpCore * self, const gchar * feature);
 
+/* Statistics */
+
+WP_API
+void wp_core_get_registry_stats (WpCore * self, guint * n_globals,
+    guint * n_objects, guint * n_object_managers, guint * n_managed_objects,
+    guint * max_managed_objects);
+
 G_END_DECLS
 
 #endif
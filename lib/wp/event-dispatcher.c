@@ -22,6 +22,9 @@ struct _EventData
   WpIterator *hooks_iter;
   WpEventHook *current_hook_in_async;
   gint64 seq;
+  gint64 queued_at; /* monotonic time, or 0 once dispatching has started */
+  gint64 hook_started_at; /* only set when statistics are enabled */
+  gboolean coalescable; /* still registered in the coalesce table */
 };
 
 static inline EventData *
@@ -32,6 +35,7 @@ event_data_new (WpEvent * event)
   event_data->event = wp_event_ref (event);
   event_data->hooks_iter = wp_event_new_hooks_iterator (event);
   event_data->seq = seqn++;
+  event_data->queued_at = g_get_monotonic_time ();
   return event_data;
 }
 
@@ -52,8 +56,39 @@ struct _WpEventDispatcher
   GPtrArray *hooks; /* registered hooks */
   GSource *source;  /* the event loop source */
   GList *events;    /* the events stack */
+  GHashTable *coalescable_events; /* coalesce key -> queued EventData */
+  guint64 n_coalesced;
   struct spa_system *system;
   int eventfd;
+
+  /* dispatch budget; 0 means unlimited */
+  guint max_hooks;
+  gint64 max_usec;
+
+  /* statistics */
+  guint64 n_yields;
+  guint64 n_events;
+  gint64 queue_wait_max;
+  gint64 queue_wait_total;
+
+  /* per event type and per hook statistics; NULL unless enabled */
+  GHashTable *event_stats; /* interned event type -> EventStats */
+  GHashTable *hook_stats;  /* interned hook name -> HookStats */
+};
+
+typedef struct _EventStats EventStats;
+struct _EventStats
+{
+  guint64 n_pushed;
+  guint64 n_dispatched;
+};
+
+typedef struct _HookStats HookStats;
+struct _HookStats
+{
+  guint64 n_runs;
+  gint64 total_usec;
+  gint64 max_usec;
 };
 
 G_DEFINE_TYPE (WpEventDispatcher, wp_event_dispatcher, G_TYPE_OBJECT)
@@ -68,6 +103,50 @@ struct _WpEventSource
   WpEventDispatcher *dispatcher;
 };
 
+/* stops other events from being merged into this one; called as soon as
+   the event starts being dispatched, or when it is discarded */
+static inline void
+event_data_stop_coalescing (WpEventDispatcher * self, EventData * event_data)
+{
+  if (event_data->coalescable) {
+    g_hash_table_remove (self->coalescable_events,
+        wp_event_get_coalesce_key (event_data->event));
+    event_data->coalescable = FALSE;
+  }
+}
+
+static EventStats *
+event_stats_lookup (WpEventDispatcher * self, WpEvent * event)
+{
+  g_autoptr (WpProperties) props = wp_event_get_properties (event);
+  const gchar *type =
+      g_intern_string (wp_properties_get (props, "event.type"));
+  EventStats *stats = g_hash_table_lookup (self->event_stats, type);
+
+  if (G_UNLIKELY (!stats)) {
+    stats = g_new0 (EventStats, 1);
+    g_hash_table_insert (self->event_stats, (gpointer) type, stats);
+  }
+  return stats;
+}
+
+static void
+hook_stats_record (WpEventDispatcher * self, WpEventHook * hook,
+    gint64 duration)
+{
+  const gchar *name = g_intern_string (wp_event_hook_get_name (hook));
+  HookStats *stats = g_hash_table_lookup (self->hook_stats, name);
+
+  if (G_UNLIKELY (!stats)) {
+    stats = g_new0 (HookStats, 1);
+    g_hash_table_insert (self->hook_stats, (gpointer) name, stats);
+  }
+  stats->n_runs++;
+  stats->total_usec += duration;
+  if (duration > stats->max_usec)
+    stats->max_usec = duration;
+}
+
 static gboolean
 wp_event_source_check (GSource * s)
 {
@@ -89,14 +168,44 @@ on_event_hook_done (WpEventHook * hook, GAsyncResult * res, EventData * data)
       error->domain != G_IO_ERROR && error->code != G_IO_ERROR_CANCELLED)
     wp_notice_object (hook, "failed: %s", error->message);
 
+  if (dispatcher->hook_stats && data->hook_started_at) {
+    hook_stats_record (dispatcher, hook,
+        g_get_monotonic_time () - data->hook_started_at);
+    data->hook_started_at = 0;
+  }
+
   g_clear_object (&data->current_hook_in_async);
   spa_system_eventfd_write (dispatcher->system, dispatcher->eventfd, 1);
 }
 
+/* records how long the event waited in the queue before its first hook ran */
+static inline void
+event_data_start_dispatching (WpEventDispatcher * self, EventData * event_data,
+    gint64 now)
+{
+  if (event_data->queued_at) {
+    gint64 wait = now - event_data->queued_at;
+
+    self->n_events++;
+    self->queue_wait_total += wait;
+    if (wait > self->queue_wait_max)
+      self->queue_wait_max = wait;
+    event_data->queued_at = 0;
+
+    if (self->event_stats)
+      event_stats_lookup (self, event_data->event)->n_dispatched++;
+
+    wp_trace_object (self, "event (%s) waited %" G_GINT64_FORMAT " us",
+        wp_event_get_name (event_data->event), wait);
+  }
+}
+
 static gboolean
 wp_event_source_dispatch (GSource * s, GSourceFunc callback, gpointer user_data)
 {
   WpEventDispatcher *d = WP_EVENT_SOURCE_DISPATCHER (s);
+  gint64 start = (d->max_usec) ? g_get_monotonic_time () : 0;
+  guint n_hooks = 0;
   uint64_t count;
 
   /* clear the eventfd */
@@ -115,6 +224,24 @@ wp_event_source_dispatch (GSource * s, GSourceFunc callback, gpointer user_data)
     if (event_data->current_hook_in_async)
       return G_SOURCE_CONTINUE;
 
+    /* the budget of this dispatch is spent; give the other sources of the
+       main context (the PipeWire socket, timers) a chance to run and
+       continue from here on the next iteration */
+    if (n_hooks > 0 && (d->max_hooks || d->max_usec)) {
+      gint64 elapsed = g_get_monotonic_time () - start;
+
+      if ((d->max_hooks && n_hooks >= d->max_hooks) ||
+          (d->max_usec && elapsed >= d->max_usec)) {
+        d->n_yields++;
+        wp_trace_object (d, "yielding after %u hooks, %" G_GINT64_FORMAT " us",
+            n_hooks, elapsed);
+        spa_system_eventfd_write (d->system, d->eventfd, 1);
+        return G_SOURCE_CONTINUE;
+      }
+    }
+
+    event_data_stop_coalescing (d, event_data);
+
     /* check if the event was cancelled */
     if (g_cancellable_is_cancelled (cancellable)) {
       wp_debug_object (d, "event(%p) cancelled remove it", event);
@@ -128,7 +255,12 @@ wp_event_source_dispatch (GSource * s, GSourceFunc callback, gpointer user_data)
       WpEventHook *hook = g_value_get_object (&value);
       const gchar *name = wp_event_hook_get_name (hook);
 
+      event_data_start_dispatching (d, event_data, g_get_monotonic_time ());
+      n_hooks++;
+
       event_data->current_hook_in_async = g_object_ref (hook);
+      if (d->hook_stats)
+        event_data->hook_started_at = g_get_monotonic_time ();
 
       wp_trace_object(d, "dispatching event (%s) running hook <%p>(%s)",
           wp_event_get_name(event), hook, name);
@@ -161,6 +293,7 @@ wp_event_dispatcher_init (WpEventDispatcher * self)
 {
   g_weak_ref_init (&self->core, NULL);
   self->hooks = g_ptr_array_new_with_free_func (g_object_unref);
+  self->coalescable_events = g_hash_table_new (g_str_hash, g_str_equal);
 
   self->source = g_source_new (&source_funcs, sizeof (WpEventSource));
   ((WpEventSource *) self->source)->dispatcher = self;
@@ -175,6 +308,14 @@ wp_event_dispatcher_finalize (GObject * object)
 {
   WpEventDispatcher *self = WP_EVENT_DISPATCHER (object);
 
+  wp_debug_object (self, "dispatched %" G_GUINT64_FORMAT " events, "
+      "queue wait max %" G_GINT64_FORMAT " us, total %" G_GINT64_FORMAT " us, "
+      "%" G_GUINT64_FORMAT " yields", self->n_events, self->queue_wait_max,
+      self->queue_wait_total, self->n_yields);
+
+  g_clear_pointer (&self->coalescable_events, g_hash_table_unref);
+  g_clear_pointer (&self->event_stats, g_hash_table_unref);
+  g_clear_pointer (&self->hook_stats, g_hash_table_unref);
   g_list_free_full (g_steal_pointer (&self->events),
       (GDestroyNotify) event_data_free);
 
@@ -226,6 +367,17 @@ wp_event_dispatcher_get_instance (WpCore * core)
     dispatcher->system =
         spa_support_find (support, n_support, SPA_TYPE_INTERFACE_System);
 
+    {
+      g_autoptr (WpProperties) props = wp_core_get_properties (core);
+      uint32_t max_hooks = 0, max_usec = 0;
+
+      spa_atou32 (wp_properties_get (props,
+          "wireplumber.event-dispatch.max-hooks"), &max_hooks, 0);
+      spa_atou32 (wp_properties_get (props,
+          "wireplumber.event-dispatch.max-usec"), &max_usec, 0);
+      wp_event_dispatcher_set_dispatch_budget (dispatcher, max_hooks, max_usec);
+    }
+
     dispatcher->eventfd = spa_system_eventfd_create (dispatcher->system, 0);
     g_source_add_unix_fd (dispatcher->source, dispatcher->eventfd, G_IO_IN);
 
@@ -248,6 +400,11 @@ event_cmp_func (const EventData *a, const EventData *b)
 /*!
  * \brief Pushes a new event onto the event stack for dispatching only if there
  * are any hooks are available for it.
+ *
+ * If the event has a coalesce key (see wp_event_set_coalesce_key()) and
+ * another event with the same key is still queued and not being dispatched
+ * yet, the new event is merged into the queued one and dropped.
+ *
  * \ingroup wpeventdispatcher
  *
  * \param self the dispatcher
@@ -259,6 +416,28 @@ wp_event_dispatcher_push_event (WpEventDispatcher * self, WpEvent * event)
   g_return_if_fail (WP_IS_EVENT_DISPATCHER (self));
   g_return_if_fail (event != NULL);
 
+  const gchar *coalesce_key = wp_event_get_coalesce_key (event);
+
+  if (self->event_stats)
+    event_stats_lookup (self, event)->n_pushed++;
+
+  if (coalesce_key) {
+    EventData *queued =
+        g_hash_table_lookup (self->coalescable_events, coalesce_key);
+
+    /* a cancelled event will not run its hooks; queue the new one instead */
+    if (queued && !g_cancellable_is_cancelled (
+            wp_event_get_cancellable (queued->event))) {
+      self->n_coalesced++;
+      wp_debug_object (self, "event (%s) coalesced into (%s)",
+          wp_event_get_name (event), wp_event_get_name (queued->event));
+      wp_event_unref (event);
+      return;
+    } else if (queued) {
+      event_data_stop_coalescing (self, queued);
+    }
+  }
+
   if (wp_event_collect_hooks (event, self)) {
     EventData *event_data = event_data_new (event);
 
@@ -266,6 +445,13 @@ wp_event_dispatcher_push_event (WpEventDispatcher * self, WpEvent * event)
         (GCompareFunc) event_cmp_func);
     wp_debug_object (self, "pushed event (%s)", wp_event_get_name (event));
 
+    if (coalesce_key) {
+      /* the key is owned by the event, which outlives the table entry */
+      g_hash_table_insert (self->coalescable_events,
+          (gpointer) coalesce_key, event_data);
+      event_data->coalescable = TRUE;
+    }
+
     /* wakeup the GSource */
     spa_system_eventfd_write (self->system, self->eventfd, 1);
   }
@@ -273,6 +459,191 @@ wp_event_dispatcher_push_event (WpEventDispatcher * self, WpEvent * event)
   wp_event_unref (event);
 }
 
+/*!
+ * \brief Gets the number of events that were merged into an equivalent
+ *   queued event, instead of being dispatched on their own
+ * \ingroup wpeventdispatcher
+ * \since 0.5.9
+ *
+ * \param self the event dispatcher
+ * \return the number of coalesced events since the dispatcher was created
+ */
+guint64
+wp_event_dispatcher_get_n_coalesced_events (WpEventDispatcher * self)
+{
+  g_return_val_if_fail (WP_IS_EVENT_DISPATCHER (self), 0);
+  return self->n_coalesced;
+}
+
+/*!
+ * \brief Limits how much work the dispatcher does in one iteration of the
+ *   main loop
+ *
+ * Normally, the dispatcher runs hooks until the event queue is empty or
+ * until a hook needs to wait for some asynchronous operation. With a
+ * budget, it stops after having run \a max_hooks hooks, or after having
+ * spent \a max_usec microseconds, and continues on the next iteration of
+ * the main loop, letting other sources with a higher priority (the
+ * PipeWire socket, timers) run in between. At least one hook is always run.
+ *
+ * The initial budget is taken from the "wireplumber.event-dispatch.max-hooks"
+ * and "wireplumber.event-dispatch.max-usec" properties of the core.
+ *
+ * \ingroup wpeventdispatcher
+ * \since 0.5.9
+ *
+ * \param self the event dispatcher
+ * \param max_hooks the maximum number of hooks to run, or 0 for no limit
+ * \param max_usec the maximum time to spend, or 0 for no limit
+ */
+void
+wp_event_dispatcher_set_dispatch_budget (WpEventDispatcher * self,
+    guint max_hooks, guint max_usec)
+{
+  g_return_if_fail (WP_IS_EVENT_DISPATCHER (self));
+  self->max_hooks = max_hooks;
+  self->max_usec = max_usec;
+}
+
+/*!
+ * \brief Gets the number of times that the dispatcher stopped because its
+ *   budget was spent, while events were still waiting to be dispatched
+ * \ingroup wpeventdispatcher
+ * \since 0.5.9
+ *
+ * \param self the event dispatcher
+ * \return the number of yields since the dispatcher was created
+ */
+guint64
+wp_event_dispatcher_get_n_yields (WpEventDispatcher * self)
+{
+  g_return_val_if_fail (WP_IS_EVENT_DISPATCHER (self), 0);
+  return self->n_yields;
+}
+
+/*!
+ * \brief Gets statistics about the time that events spend in the queue,
+ *   from being pushed until their first hook runs
+ * \ingroup wpeventdispatcher
+ * \since 0.5.9
+ *
+ * \param self the event dispatcher
+ * \param n_events (out) (optional): the number of events that have started
+ *   being dispatched
+ * \param max_usec (out) (optional): the longest time that an event waited,
+ *   in microseconds
+ * \param total_usec (out) (optional): the sum of the waiting times of all
+ *   the events, in microseconds
+ */
+void
+wp_event_dispatcher_get_queue_wait_stats (WpEventDispatcher * self,
+    guint64 * n_events, gint64 * max_usec, gint64 * total_usec)
+{
+  g_return_if_fail (WP_IS_EVENT_DISPATCHER (self));
+
+  if (n_events)
+    *n_events = self->n_events;
+  if (max_usec)
+    *max_usec = self->queue_wait_max;
+  if (total_usec)
+    *total_usec = self->queue_wait_total;
+}
+
+/*!
+ * \brief Enables or disables the collection of per event type and per hook
+ *   statistics
+ *
+ * The statistics are disabled by default, as collecting them costs a hash
+ * table lookup for every event and two clock reads for every hook.
+ * Disabling them discards the statistics that were collected so far.
+ *
+ * \ingroup wpeventdispatcher
+ * \since 0.5.9
+ *
+ * \param self the event dispatcher
+ * \param enabled whether to collect statistics
+ */
+void
+wp_event_dispatcher_set_stats_enabled (WpEventDispatcher * self,
+    gboolean enabled)
+{
+  g_return_if_fail (WP_IS_EVENT_DISPATCHER (self));
+
+  if (enabled && !self->event_stats) {
+    self->event_stats = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, g_free);
+    self->hook_stats = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, g_free);
+  } else if (!enabled) {
+    g_clear_pointer (&self->event_stats, g_hash_table_unref);
+    g_clear_pointer (&self->hook_stats, g_hash_table_unref);
+  }
+}
+
+/*!
+ * \brief Calls \a func for every event type that was pushed since the
+ *   statistics were enabled with wp_event_dispatcher_set_stats_enabled()
+ *
+ * \ingroup wpeventdispatcher
+ * \since 0.5.9
+ *
+ * \param self the event dispatcher
+ * \param func (scope call): the function to call
+ * \param data data to pass to \a func
+ */
+void
+wp_event_dispatcher_foreach_event_stats (WpEventDispatcher * self,
+    WpEventStatsFunc func, gpointer data)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_return_if_fail (WP_IS_EVENT_DISPATCHER (self));
+
+  if (!self->event_stats)
+    return;
+
+  g_hash_table_iter_init (&iter, self->event_stats);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    EventStats *stats = value;
+    func (key, stats->n_pushed, stats->n_dispatched, data);
+  }
+}
+
+/*!
+ * \brief Calls \a func for every hook that ran since the statistics were
+ *   enabled with wp_event_dispatcher_set_stats_enabled()
+ *
+ * The time of a hook is measured from the moment it is started until it
+ * finishes, so for asynchronous hooks it includes the time spent waiting.
+ * Hooks with the same name share the same statistics.
+ *
+ * \ingroup wpeventdispatcher
+ * \since 0.5.9
+ *
+ * \param self the event dispatcher
+ * \param func (scope call): the function to call
+ * \param data data to pass to \a func
+ */
+void
+wp_event_dispatcher_foreach_hook_stats (WpEventDispatcher * self,
+    WpHookStatsFunc func, gpointer data)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_return_if_fail (WP_IS_EVENT_DISPATCHER (self));
+
+  if (!self->hook_stats)
+    return;
+
+  g_hash_table_iter_init (&iter, self->hook_stats);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    HookStats *stats = value;
+    func (key, stats->n_runs, stats->total_usec, stats->max_usec, data);
+  }
+}
+
 /*!
  * \brief Registers an event hook
  * \ingroup wpeventdispatcher
@@ -32,6 +32,56 @@ WpEventDispatcher * wp_event_dispatcher_get_instance (WpCore * core);
 WP_API
 void wp_event_dispatcher_push_event (WpEventDispatcher * self, WpEvent * event);
 
+WP_API
+guint64 wp_event_dispatcher_get_n_coalesced_events (WpEventDispatcher * self);
+
+WP_API
+void wp_event_dispatcher_set_dispatch_budget (WpEventDispatcher * self,
+    guint max_hooks, guint max_usec);
+
+WP_API
+guint64 wp_event_dispatcher_get_n_yields (WpEventDispatcher * self);
+
+WP_API
+void wp_event_dispatcher_get_queue_wait_stats (WpEventDispatcher * self,
+    guint64 * n_events, gint64 * max_usec, gint64 * total_usec);
+
+/*!
+ * \brief A function that is called by wp_event_dispatcher_foreach_event_stats()
+ * \param event_type the value of the "event.type" property of the events
+ * \param n_pushed the number of events of this type that were pushed
+ * \param n_dispatched the number of events of this type that started running
+ *   their hooks
+ * \param data the data passed to wp_event_dispatcher_foreach_event_stats()
+ * \ingroup wpeventdispatcher
+ */
+typedef void (*WpEventStatsFunc) (const gchar * event_type, guint64 n_pushed,
+    guint64 n_dispatched, gpointer data);
+
+/*!
+ * \brief A function that is called by wp_event_dispatcher_foreach_hook_stats()
+ * \param hook_name the name of the hook
+ * \param n_runs the number of times that the hook ran to completion
+ * \param total_usec the total time that the hook took, in microseconds
+ * \param max_usec the longest time that the hook took, in microseconds
+ * \param data the data passed to wp_event_dispatcher_foreach_hook_stats()
+ * \ingroup wpeventdispatcher
+ */
+typedef void (*WpHookStatsFunc) (const gchar * hook_name, guint64 n_runs,
+    gint64 total_usec, gint64 max_usec, gpointer data);
+
+WP_API
+void wp_event_dispatcher_set_stats_enabled (WpEventDispatcher * self,
+    gboolean enabled);
+
+WP_API
+void wp_event_dispatcher_foreach_event_stats (WpEventDispatcher * self,
+    WpEventStatsFunc func, gpointer data);
+
+WP_API
+void wp_event_dispatcher_foreach_hook_stats (WpEventDispatcher * self,
+    WpHookStatsFunc func, gpointer data);
+
 WP_API
 void wp_event_dispatcher_register_hook (WpEventDispatcher * self,
     WpEventHook * hook);
@@ -56,6 +56,7 @@ struct _WpEvent
   GObject *subject;
   GCancellable *cancellable;
   gchar *name;
+  gchar *coalesce_key;
 };
 
 G_DEFINE_BOXED_TYPE (WpEvent, wp_event, wp_event_ref, wp_event_unref)
@@ -167,6 +168,7 @@ wp_event_free (WpEvent * self)
   g_cancellable_cancel (self->cancellable);
   g_clear_object (&self->cancellable);
   g_free (self->name);
+  g_free (self->coalesce_key);
   g_free (self);
 }
 
@@ -263,6 +265,48 @@ wp_event_stop_processing (WpEvent * self)
   g_cancellable_cancel (self->cancellable);
 }
 
+/*!
+ * \brief Sets the key that is used to coalesce this event with other
+ *   equivalent events
+ *
+ * When an event with a coalesce key is pushed on the dispatcher while another
+ * event with the same key is still waiting to be dispatched (i.e. none of its
+ * hooks has run yet), the new event is merged into the queued one instead of
+ * being queued as well. This is meant for events that only notify about a
+ * change of state that the hooks read from the subject, where running the
+ * hooks once is enough. The key should therefore identify the event type,
+ * the subject and any other detail that distinguishes the change.
+ *
+ * This must be called before the event is pushed to the dispatcher.
+ *
+ * \ingroup wpevent
+ * \since 0.5.9
+ * \param self the event
+ * \param key (nullable): the coalesce key, or \c NULL to disable coalescing
+ */
+void
+wp_event_set_coalesce_key (WpEvent * self, const gchar * key)
+{
+  g_return_if_fail (self != NULL);
+  g_free (self->coalesce_key);
+  self->coalesce_key = g_strdup (key);
+}
+
+/*!
+ * \brief Gets the coalesce key of the event
+ * \ingroup wpevent
+ * \since 0.5.9
+ * \param self the event
+ * \return (transfer none)(nullable): the key set with
+ *   wp_event_set_coalesce_key() or \c NULL
+ */
+const gchar *
+wp_event_get_coalesce_key (WpEvent * self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  return self->coalesce_key;
+}
+
 static void
 destroy_event_data (gpointer data)
 {
@@ -67,6 +67,12 @@ void wp_event_set_data (WpEvent * self, const gchar * key, const GValue * data);
 WP_API
 const GValue * wp_event_get_data (WpEvent * self, const gchar * key);
 
+WP_API
+void wp_event_set_coalesce_key (WpEvent * self, const gchar * key);
+
+WP_API
+const gchar * wp_event_get_coalesce_key (WpEvent * self);
+
 WP_API
 gboolean wp_event_collect_hooks (WpEvent * event,
     WpEventDispatcher * dispatcher);
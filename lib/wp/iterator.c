@@ -21,10 +21,59 @@ struct _WpIterator
 {
   const WpIteratorMethods *methods;
   gpointer user_data;
+
+  /* values backing the items returned by the generic next_batch() */
+  GArray *batch;
 };
 
 G_DEFINE_BOXED_TYPE (WpIterator, wp_iterator, wp_iterator_ref, wp_iterator_unref)
 
+static void
+batch_value_clear (GValue *value)
+{
+  if (G_IS_VALUE (value))
+    g_value_unset (value);
+}
+
+static void
+wp_iterator_clear_batch (WpIterator *self)
+{
+  if (self->batch)
+    g_array_set_size (self->batch, 0);
+}
+
+static guint
+wp_iterator_default_next_batch (WpIterator *self, gpointer *items,
+    guint max_items)
+{
+  guint n = 0;
+
+  if (!self->batch) {
+    self->batch = g_array_sized_new (FALSE, TRUE, sizeof (GValue), max_items);
+    g_array_set_clear_func (self->batch, (GDestroyNotify) batch_value_clear);
+  }
+  g_array_set_size (self->batch, max_items);
+
+  while (n < max_items) {
+    GValue *value = &g_array_index (self->batch, GValue, n);
+
+    if (!self->methods->next (self, value))
+      break;
+
+    if (G_UNLIKELY (!g_value_fits_pointer (value))) {
+      wp_critical ("iterator item of type %s cannot be returned in a batch",
+          G_VALUE_TYPE_NAME (value));
+      g_value_unset (value);
+      break;
+    }
+    items[n++] = g_value_peek_pointer (value);
+  }
+
+  /* drop the unused slots; the used ones stay alive until the next call */
+  g_array_set_size (self->batch, n);
+  return n;
+}
+
 static gboolean
 wp_iterator_default_fold (WpIterator *self, WpIteratorFoldFunc func,
     GValue *item, gpointer data)
@@ -122,6 +171,7 @@ wp_iterator_ref (WpIterator *self)
 static void
 wp_iterator_free (WpIterator *self)
 {
+  g_clear_pointer (&self->batch, g_array_unref);
   if (self->methods->finalize)
     self->methods->finalize (self);
 }
@@ -151,6 +201,7 @@ wp_iterator_reset (WpIterator *self)
   g_return_if_fail (self);
   g_return_if_fail (self->methods->reset);
 
+  wp_iterator_clear_batch (self);
   self->methods->reset (self);
 }
 
@@ -173,6 +224,49 @@ wp_iterator_next (WpIterator *self, GValue *item)
   return self->methods->next (self, item);
 }
 
+/*!
+ * \brief Gets up to \a max_items next items of the iterator at once.
+ *
+ * Unlike wp_iterator_next(), the items are not boxed in a GValue; instead,
+ * \a items is filled with borrowed pointers to the items themselves (the
+ * GObject instance, the boxed structure, the string, etc, depending on the
+ * item type of the iterator). These pointers remain valid until the next call
+ * to this function, wp_iterator_reset() or until the iterator is destroyed,
+ * as long as the underlying collection is not modified in the meantime.
+ * Take a reference on the items that need to outlive that.
+ *
+ * Iterators that implement this natively (object manager, pointer array,
+ * properties, metadata and spa-json iterators) avoid the per-item GValue
+ * setup and reference counting overhead of wp_iterator_next(). Other
+ * iterators fall back to calling wp_iterator_next() internally.
+ *
+ * \ingroup wpiterator
+ * \param self the iterator
+ * \param items (out caller-allocates) (array length=max_items) (transfer none):
+ *   an array of at least \a max_items pointers to fill in
+ * \param max_items the maximum number of items to return
+ * \returns the number of items stored in \a items; less than \a max_items
+ *   means that the iterator has no more items to iterate through
+ * \since 0.5.9
+ */
+guint
+wp_iterator_next_batch (WpIterator *self, gpointer *items, guint max_items)
+{
+  g_return_val_if_fail (self, 0);
+  g_return_val_if_fail (items || max_items == 0, 0);
+
+  wp_iterator_clear_batch (self);
+
+  if (max_items == 0)
+    return 0;
+
+  if (self->methods->version >= 1 && self->methods->next_batch)
+    return self->methods->next_batch (self, items, max_items);
+
+  g_return_val_if_fail (self->methods->next, 0);
+  return wp_iterator_default_next_batch (self, items, max_items);
+}
+
 /*!
  * \brief Fold a function over the items of the iterator.
  *
@@ -247,6 +341,21 @@ ptr_array_iterator_next (WpIterator *it, GValue *item)
   return FALSE;
 }
 
+static guint
+ptr_array_iterator_next_batch (WpIterator *it, gpointer *items,
+    guint max_items)
+{
+  struct ptr_array_iterator_data *it_data = wp_iterator_get_user_data (it);
+  guint n = 0;
+
+  while (n < max_items && it_data->index < it_data->array->len) {
+    gpointer ptr = g_ptr_array_index (it_data->array, it_data->index++);
+    if (ptr)
+      items[n++] = ptr;
+  }
+  return n;
+}
+
 static gboolean
 ptr_array_iterator_fold (WpIterator *it, WpIteratorFoldFunc func, GValue *ret,
     gpointer data)
@@ -284,6 +393,7 @@ static const WpIteratorMethods ptr_array_iterator_methods = {
   .next = ptr_array_iterator_next,
   .fold = ptr_array_iterator_fold,
   .finalize = ptr_array_iterator_finalize,
+  .next_batch = ptr_array_iterator_next_batch,
 };
 
 /*!
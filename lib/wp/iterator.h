@@ -49,7 +49,7 @@ typedef struct _WpIteratorMethods WpIteratorMethods;
  * This allows future expansion of the struct
  * \ingroup wpiterator
  */
-#define  WP_ITERATOR_METHODS_VERSION 0U
+#define  WP_ITERATOR_METHODS_VERSION 1U
 
 struct _WpIteratorMethods
 {
@@ -62,6 +62,9 @@ struct _WpIteratorMethods
   gboolean (*foreach) (WpIterator *self, WpIteratorForeachFunc func,
       gpointer data);
   void (*finalize) (WpIterator *self);
+
+  /* since version 1 */
+  guint (*next_batch) (WpIterator *self, gpointer *items, guint max_items);
 };
 
 /* ref count */
@@ -80,6 +83,10 @@ void wp_iterator_reset (WpIterator *self);
 WP_API
 gboolean wp_iterator_next (WpIterator *self, GValue *item);
 
+WP_API
+guint wp_iterator_next_batch (WpIterator *self, gpointer *items,
+    guint max_items);
+
 WP_API
 gboolean wp_iterator_fold (WpIterator *self, WpIteratorFoldFunc func,
     GValue *ret, gpointer data);
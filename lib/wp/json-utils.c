@@ -13,6 +13,8 @@
 #include <pipewire/pipewire.h>
 #include <spa/utils/result.h>
 
+#include <regex.h>
+
 WP_DEFINE_LOCAL_LOG_TOPIC ("wp-json-utils")
 
 /*! \defgroup wpjsonutils Json Utilities */
@@ -141,107 +143,495 @@ wp_json_utils_match_rules_update_properties (WpSpaJson *json, WpProperties *prop
   return cb_data.count;
 }
 
+/*!
+ * \struct WpRuleSet
+ *
+ * A WpRuleSet is a set of rules, in the format accepted by
+ * wp_json_utils_match_rules(), that has been parsed once in advance.
+ *
+ * Matching properties against a WpRuleSet yields the same results as calling
+ * wp_json_utils_match_rules() with the JSON that the set was constructed
+ * from, but it does not need to tokenize the JSON, parse the match values
+ * or compile the regular expressions on every call. This makes it the
+ * preferred way of matching rules that are loaded once from the configuration
+ * and are then matched against every new object.
+ *
+ * \ingroup wpjsonutils
+ */
 
-#define OVERRIDE_SECTION_PREFIX "override."
+struct rule_condition
+{
+  gchar *key;
+  gchar *value;         /* interned; NULL if matching against null */
+  gboolean negate;
+  gboolean is_regex;
+  gboolean never_matches; /* the regex is invalid; negation still applies */
+  regex_t regex;
+};
 
-static WpSpaJson *
-merge_json_objects (WpSpaJson *a, WpSpaJson *b)
+struct rule_action
 {
-  g_autoptr (WpSpaJsonBuilder) builder = NULL;
+  gchar *name;
+  WpSpaJson *value;
+};
 
-  builder = wp_spa_json_builder_new_object ();
+struct rule
+{
+  /* array of GArray of struct rule_condition; any of them needs to match */
+  GPtrArray *matches;
+  /* array of struct rule_action */
+  GArray *actions;
+};
 
-  /* Add all properties from 'a' that don't exist in 'b' */
-  {
-    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (a);
-    g_auto (GValue) item = G_VALUE_INIT;
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      g_autoptr (WpSpaJson) key = NULL;
-      g_autoptr (WpSpaJson) val = NULL;
-      g_autoptr (WpSpaJson) j = NULL;
-      g_autofree gchar *str = NULL;
-      const gchar *key_str;
-      g_autofree gchar *override_key_str = NULL;
-      gboolean override;
+struct _WpRuleSet
+{
+  grefcount ref;
+  GArray *rules;
+};
 
-      key = g_value_dup_boxed (&item);
-      key_str = str = wp_spa_json_parse_string (key);
-      g_return_val_if_fail (key_str, NULL);
-      override = g_str_has_prefix (str, OVERRIDE_SECTION_PREFIX);
-      if (override)
-        key_str += strlen (OVERRIDE_SECTION_PREFIX);
-      override_key_str = g_strdup_printf (OVERRIDE_SECTION_PREFIX "%s", key_str);
+G_DEFINE_BOXED_TYPE (WpRuleSet, wp_rule_set, wp_rule_set_ref, wp_rule_set_unref)
 
-      g_value_unset (&item);
-      g_return_val_if_fail (wp_iterator_next (it, &item), NULL);
-      val = g_value_dup_boxed (&item);
+static void
+rule_condition_clear (struct rule_condition *c)
+{
+  g_clear_pointer (&c->key, g_free);
+  g_clear_pointer (&c->value, g_ref_string_release);
+  if (c->is_regex) {
+    regfree (&c->regex);
+    c->is_regex = FALSE;
+  }
+}
+
+static void
+rule_action_clear (struct rule_action *a)
+{
+  g_clear_pointer (&a->name, g_free);
+  g_clear_pointer (&a->value, wp_spa_json_unref);
+}
+
+static void
+rule_clear (struct rule *r)
+{
+  g_clear_pointer (&r->matches, g_ptr_array_unref);
+  g_clear_pointer (&r->actions, g_array_unref);
+}
+
+/* Parses a single "key = value" condition of a "matches" object, following
+ * the same rules as pw_conf_match_rules(): a string value may be prefixed
+ * with '!' to negate the match and with '~' to match it as a regular
+ * expression; a null value matches a key that is not present */
+static gboolean
+rule_condition_init (struct rule_condition *c, const gchar *key,
+    const gchar *value, gint len)
+{
+  g_autofree gchar *str = NULL;
+  const gchar *v;
+  gboolean parse_string = TRUE;
+  gboolean is_null = FALSE;
+  gint skip = 0;
+
+  c->key = g_strdup (key);
+
+  if (spa_json_is_null (value, len)) {
+    return TRUE;
+  }
+
+  /* a quoted string is never null, unless there is a modifier */
+  str = g_malloc (len + 1);
+  if (spa_json_parse_stringn (value, len, str, len + 1) < 0)
+    return FALSE;
+  if (spa_json_is_string (value, len))
+    parse_string = FALSE;
+
+  if (strlen (str) > 1 && str[0] == '!') {
+    c->negate = TRUE;
+    skip++;
+  }
+  if (str[skip] == '~') {
+    c->is_regex = TRUE;
+    skip++;
+  }
+  v = str + skip;
+
+  if ((parse_string || skip > 0) && spa_json_is_null (v, strlen (v)))
+    is_null = TRUE;
+
+  if (is_null) {
+    c->is_regex = FALSE;
+    return TRUE;
+  }
 
-      if (!wp_spa_json_object_get (b, key_str, "J", &j, NULL) &&
-          !wp_spa_json_object_get (b, override_key_str, "J", &j, NULL)) {
-        wp_spa_json_builder_add_property (builder, key_str);
-        wp_spa_json_builder_add_json (builder, val);
+  /* like in pw_conf_match_rules(), an invalid regex never matches */
+  if (c->is_regex && regcomp (&c->regex, v, REG_EXTENDED | REG_NOSUB) != 0) {
+    wp_warning ("invalid regex '%s' for key '%s'; it will never match", v, key);
+    c->is_regex = FALSE;
+    c->never_matches = TRUE;
+  }
+
+  c->value = g_ref_string_new_intern (v);
+  return TRUE;
+}
+
+static GArray *
+parse_match_object (struct spa_json *it)
+{
+  g_autoptr (GArray) conds = g_array_new (FALSE, TRUE,
+      sizeof (struct rule_condition));
+  char key[256];
+
+  g_array_set_clear_func (conds, (GDestroyNotify) rule_condition_clear);
+
+  while (spa_json_get_string (it, key, sizeof (key)) > 0) {
+    struct rule_condition c = {0};
+    const char *value;
+    int len;
+
+    if ((len = spa_json_next (it, &value)) <= 0)
+      break;
+
+    if (rule_condition_init (&c, key, value, len))
+      g_array_append_val (conds, c);
+    else
+      rule_condition_clear (&c);
+  }
+
+  return g_steal_pointer (&conds);
+}
+
+/*!
+ * \brief Parses the given JSON rules into a new WpRuleSet
+ *
+ * \ingroup wpjsonutils
+ * \param json a JSON array containing rules in the format accepted by
+ *    wp_json_utils_match_rules()
+ * \param error (out)(optional): the error that occurred, if any
+ * \returns (transfer full)(nullable): a new rule set, or NULL if \a json is
+ *    not an array
+ * \since 0.5.9
+ */
+WpRuleSet *
+wp_rule_set_new (WpSpaJson * json, GError ** error)
+{
+  g_autoptr (WpRuleSet) self = NULL;
+  struct spa_json it[4];
+
+  g_return_val_if_fail (json != NULL, NULL);
+
+  spa_json_init (&it[0], wp_spa_json_get_data (json),
+      wp_spa_json_get_size (json));
+  if (spa_json_enter_array (&it[0], &it[1]) < 0) {
+    g_set_error (error, WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_INVALID_ARGUMENT,
+        "match rules error: expected an array of rules");
+    return NULL;
+  }
+
+  self = g_slice_new0 (WpRuleSet);
+  g_ref_count_init (&self->ref);
+  self->rules = g_array_new (FALSE, TRUE, sizeof (struct rule));
+  g_array_set_clear_func (self->rules, (GDestroyNotify) rule_clear);
+
+  while (spa_json_enter_object (&it[1], &it[2]) > 0) {
+    struct rule r = {0};
+    struct spa_json actions;
+    gboolean have_matches = FALSE, have_actions = FALSE;
+    char key[64];
+    const char *val;
+
+    r.matches = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+    r.actions = g_array_new (FALSE, TRUE, sizeof (struct rule_action));
+    g_array_set_clear_func (r.actions, (GDestroyNotify) rule_action_clear);
+
+    while (spa_json_get_string (&it[2], key, sizeof (key)) > 0) {
+      if (g_str_equal (key, "matches")) {
+        if (spa_json_enter_array (&it[2], &it[3]) < 0)
+          break;
+        /* as in pw_conf_match_rules(), the last "matches" wins */
+        g_ptr_array_set_size (r.matches, 0);
+        while (spa_json_enter_object (&it[3], &it[0]) > 0)
+          g_ptr_array_add (r.matches, parse_match_object (&it[0]));
+        have_matches = TRUE;
+      }
+      else if (g_str_equal (key, "actions")) {
+        if (spa_json_enter_object (&it[2], &actions) > 0)
+          have_actions = TRUE;
+      }
+      else if (spa_json_next (&it[2], &val) <= 0)
+        break;
+    }
+
+    if (have_actions) {
+      while (spa_json_get_string (&actions, key, sizeof (key)) > 0) {
+        struct rule_action a = {0};
+        int len;
+
+        if ((len = spa_json_next (&actions, &val)) <= 0)
+          break;
+        if (spa_json_is_container (val, len))
+          len = spa_json_container_len (&actions, val, len);
+
+        a.name = g_strdup (key);
+        a.value = wp_spa_json_new_from_stringn (val, len);
+        g_array_append_val (r.actions, a);
       }
     }
+
+    /* rules that can never emit an action are not worth keeping */
+    if (have_matches && r.matches->len > 0 && r.actions->len > 0)
+      g_array_append_val (self->rules, r);
+    else
+      rule_clear (&r);
   }
 
-  /* Add properties from 'b' that don't exist in 'a'. If a property
-   * exists in 'a' and does not have the 'override.' prefix, recursively
-   * merge it before adding it. Otherwise override it. */
-  {
-    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (b);
+  return g_steal_pointer (&self);
+}
+
+/*!
+ * \brief Increases the reference count of a rule set
+ * \ingroup wpjsonutils
+ * \param self a rule set
+ * \returns (transfer full): \a self with an additional reference count on it
+ * \since 0.5.9
+ */
+WpRuleSet *
+wp_rule_set_ref (WpRuleSet * self)
+{
+  g_ref_count_inc (&self->ref);
+  return self;
+}
+
+/*!
+ * \brief Decreases the reference count on \a self and frees it when the ref
+ * count reaches zero.
+ * \ingroup wpjsonutils
+ * \param self (transfer full): a rule set
+ * \since 0.5.9
+ */
+void
+wp_rule_set_unref (WpRuleSet * self)
+{
+  if (g_ref_count_dec (&self->ref)) {
+    g_clear_pointer (&self->rules, g_array_unref);
+    g_slice_free (WpRuleSet, self);
+  }
+}
+
+static gboolean
+rule_condition_matches (const struct rule_condition *c, WpProperties *props,
+    gboolean interned)
+{
+  const gchar *str = wp_properties_get (props, c->key);
+  gboolean matched;
+
+  if (!c->value)
+    matched = (str == NULL);
+  else if (!str || c->never_matches)
+    matched = FALSE;
+  else if (c->is_regex)
+    matched = (regexec (&c->regex, str, 0, NULL, 0) == 0);
+  else if (interned)
+    /* both strings are interned, so they are equal only if they are the same */
+    matched = (str == c->value);
+  else
+    matched = g_str_equal (str, c->value);
+
+  return c->negate ? !matched : matched;
+}
+
+static gboolean
+rule_matches (const struct rule *r, WpProperties *props)
+{
+  gboolean interned = wp_properties_is_interned (props);
+
+  for (guint i = 0; i < r->matches->len; i++) {
+    GArray *conds = g_ptr_array_index (r->matches, i);
+    guint j;
+
+    for (j = 0; j < conds->len; j++) {
+      if (!rule_condition_matches (
+              &g_array_index (conds, struct rule_condition, j), props,
+              interned))
+        break;
+    }
+    /* all conditions must match and there must be at least one */
+    if (conds->len > 0 && j == conds->len)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/*!
+ * \brief Matches the given properties against the rules of this set and
+ * calls the given callback to perform actions on a successful match.
+ *
+ * This is equivalent to wp_json_utils_match_rules(), but it uses the
+ * pre-parsed rules. Like in wp_json_utils_match_rules(), each rule is
+ * matched against \a match_props as they are at the time the rule is
+ * checked, so actions of earlier rules may affect the matching of later
+ * ones if the \a callback modifies \a match_props.
+ *
+ * \ingroup wpjsonutils
+ * \param self a rule set
+ * \param match_props (transfer none): the properties to match against the rules
+ * \param callback (scope call): a function to call for each action on a successful match
+ * \param data (closure callback): data to be passed to \a callback
+ * \param error (out)(optional): the error that occurred, if any
+ * \returns FALSE if an error occurred, TRUE otherwise
+ * \since 0.5.9
+ */
+gboolean
+wp_rule_set_match (WpRuleSet * self, WpProperties * match_props,
+    WpRuleMatchCallback callback, gpointer data, GError ** error)
+{
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (match_props != NULL, FALSE);
+  g_return_val_if_fail (callback != NULL, FALSE);
+
+  for (guint i = 0; i < self->rules->len; i++) {
+    struct rule *r = &g_array_index (self->rules, struct rule, i);
+
+    if (!rule_matches (r, match_props))
+      continue;
+
+    for (guint j = 0; j < r->actions->len; j++) {
+      struct rule_action *a = &g_array_index (r->actions, struct rule_action, j);
+      g_autoptr (GError) cb_error = NULL;
+
+      if (!callback (data, a->name, a->value, &cb_error)) {
+        if (cb_error)
+          g_propagate_error (error, g_steal_pointer (&cb_error));
+        else
+          g_set_error (error, WP_DOMAIN_LIBRARY,
+              WP_LIBRARY_ERROR_OPERATION_FAILED, "match rules error: %s",
+              spa_strerror (-EPIPE));
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+/*!
+ * \brief Matches the given properties against the rules of this set and
+ * updates the properties if the rule actions include the "update-props"
+ * action.
+ *
+ * This is equivalent to wp_json_utils_match_rules_update_properties(), but
+ * it uses the pre-parsed rules.
+ *
+ * \ingroup wpjsonutils
+ * \param self a rule set
+ * \param props (transfer none): the properties to match against the rules
+ *    and also update, acting on the "update-props" action
+ * \returns the number of properties that were updated
+ * \since 0.5.9
+ */
+gint
+wp_rule_set_update_properties (WpRuleSet * self, WpProperties * props)
+{
+  g_autoptr (GError) cb_error = NULL;
+  struct update_props_cb_data cb_data = { props, 0 };
+
+  wp_rule_set_match (self, props, update_props_cb, &cb_data, &cb_error);
+  if (cb_error)
+    wp_notice ("%s", cb_error->message);
+
+  return cb_data.count;
+}
+
+
+#define OVERRIDE_SECTION_PREFIX "override."
+
+typedef struct _MergeEntry MergeEntry;
+struct _MergeEntry
+{
+  gchar *key;
+  GPtrArray *values; /* element-type: WpSpaJson; since the last override */
+};
+
+static void
+merge_entry_free (MergeEntry * self)
+{
+  g_free (self->key);
+  g_ptr_array_unref (self->values);
+  g_free (self);
+}
+
+static WpSpaJson *
+merge_json_objects (WpSpaJson * const * objects, guint n_objects)
+{
+  g_autoptr (WpSpaJsonBuilder) builder = wp_spa_json_builder_new_object ();
+  GHashTable *entries = g_hash_table_new (g_str_hash, g_str_equal);
+  GQueue order = G_QUEUE_INIT;
+
+  /* collect the values of each key from all the objects; keys are ordered
+     as if the objects were merged one after the other, i.e. the keys of
+     the last object that defines them come last */
+  for (guint i = 0; i < n_objects; i++) {
+    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (objects[i]);
     g_auto (GValue) item = G_VALUE_INIT;
     for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      g_autoptr (WpSpaJson) key = NULL;
-      g_autoptr (WpSpaJson) val = NULL;
-      g_autoptr (WpSpaJson) j = NULL;
-      g_autofree gchar *str = NULL;
-      const gchar *key_str;
-      g_autofree gchar *override_key_str = NULL;
+      WpSpaJson *key = g_value_get_boxed (&item);
+      g_autofree gchar *str = wp_spa_json_parse_string (key);
+      const gchar *key_str = str;
       gboolean override;
+      GList *link;
+      MergeEntry *e;
 
-      key = g_value_dup_boxed (&item);
-      key_str = str = wp_spa_json_parse_string (key);
-      g_return_val_if_fail (key_str, NULL);
-      override = g_str_has_prefix (str, OVERRIDE_SECTION_PREFIX);
+      if (!key_str)
+        break;
+      override = g_str_has_prefix (key_str, OVERRIDE_SECTION_PREFIX);
       if (override)
         key_str += strlen (OVERRIDE_SECTION_PREFIX);
-      override_key_str = g_strdup_printf (OVERRIDE_SECTION_PREFIX "%s", key_str);
 
       g_value_unset (&item);
-      g_return_val_if_fail (wp_iterator_next (it, &item), NULL);
-      val = g_value_dup_boxed (&item);
-
-      if (!override && wp_spa_json_is_container (val) &&
-          (wp_spa_json_object_get (a, key_str, "J", &j, NULL) ||
-           wp_spa_json_object_get (a, override_key_str, "J", &j, NULL))) {
-        g_autoptr (WpSpaJson) merged = wp_json_utils_merge_containers (j, val);
-        if (!merged) {
-          wp_warning ("skipping merge of %s as JSON values are not compatible containers",
-              key_str);
-          continue;
-        }
-        wp_spa_json_builder_add_property (builder, key_str);
-        wp_spa_json_builder_add_json (builder, merged);
+      if (!wp_iterator_next (it, &item))
+        break;
+
+      link = g_hash_table_lookup (entries, key_str);
+      if (!link) {
+        e = g_new0 (MergeEntry, 1);
+        e->key = g_strdup (key_str);
+        e->values = g_ptr_array_new_with_free_func (
+            (GDestroyNotify) wp_spa_json_unref);
+        g_queue_push_tail (&order, e);
+        g_hash_table_insert (entries, e->key, order.tail);
       } else {
-        wp_spa_json_builder_add_property (builder, key_str);
-        wp_spa_json_builder_add_json (builder, val);
+        e = link->data;
+        g_queue_unlink (&order, link);
+        g_queue_push_tail_link (&order, link);
       }
+
+      /* the 'override.' prefix discards the values of the previous objects */
+      if (override)
+        g_ptr_array_set_size (e->values, 0);
+      g_ptr_array_add (e->values, g_value_dup_boxed (&item));
     }
   }
 
+  for (GList *l = order.head; l; l = l->next) {
+    MergeEntry *e = l->data;
+    g_autoptr (WpSpaJson) merged = wp_json_utils_merge_values (
+        (WpSpaJson * const *) e->values->pdata, e->values->len, e->key);
+    if (merged) {
+      wp_spa_json_builder_add_property (builder, e->key);
+      wp_spa_json_builder_add_json (builder, merged);
+    }
+  }
+
+  g_hash_table_unref (entries);
+  g_queue_clear_full (&order, (GDestroyNotify) merge_entry_free);
+
   return wp_spa_json_builder_end (builder);
 }
 
 static WpSpaJson *
-merge_json_arrays (WpSpaJson * a, WpSpaJson * b)
+merge_json_arrays (WpSpaJson * const * arrays, guint n_arrays)
 {
-  g_autoptr (WpSpaJsonBuilder) builder = NULL;
+  g_autoptr (WpSpaJsonBuilder) builder = wp_spa_json_builder_new_array ();
 
-  builder = wp_spa_json_builder_new_array ();
-
-  /* Add all elements from 'a' */
-  {
-    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (a);
+  for (guint i = 0; i < n_arrays; i++) {
+    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (arrays[i]);
     g_auto (GValue) item = G_VALUE_INIT;
     for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
       WpSpaJson *j = g_value_get_boxed (&item);
@@ -249,17 +639,46 @@ merge_json_arrays (WpSpaJson * a, WpSpaJson * b)
     }
   }
 
-  /* Add all elements from 'b' */
-  {
-    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (b);
-    g_auto (GValue) item = G_VALUE_INIT;
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      WpSpaJson *j = g_value_get_boxed (&item);
-      wp_spa_json_builder_add_json (builder, j);
+  return wp_spa_json_builder_end (builder);
+}
+
+/*
+ * Merges a list of JSON values in a single pass, with the same result as
+ * merging them one after the other with wp_json_utils_merge_containers().
+ * A value that is not a container replaces all the previous values, while
+ * a container that cannot be merged with the previous values is skipped.
+ * Returns NULL only if \a n_values is 0.
+ */
+WpSpaJson *
+wp_json_utils_merge_values (WpSpaJson * const * values, guint n_values,
+    const gchar * name)
+{
+  g_autoptr (GPtrArray) run = g_ptr_array_new ();
+
+  for (guint i = 0; i < n_values; i++) {
+    WpSpaJson *v = values[i];
+    WpSpaJson *first = run->len > 0 ? g_ptr_array_index (run, 0) : NULL;
+
+    if (!first || !wp_spa_json_is_container (v)) {
+      g_ptr_array_set_size (run, 0);
+      g_ptr_array_add (run, v);
+    } else if ((wp_spa_json_is_array (first) && wp_spa_json_is_array (v)) ||
+        (wp_spa_json_is_object (first) && wp_spa_json_is_object (v))) {
+      g_ptr_array_add (run, v);
+    } else {
+      wp_warning ("skipping merge of %s as JSON values are not compatible "
+          "containers", name);
     }
   }
 
-  return wp_spa_json_builder_end (builder);
+  if (run->len == 0)
+    return NULL;
+  else if (run->len == 1)
+    return wp_spa_json_ref (g_ptr_array_index (run, 0));
+  else if (wp_spa_json_is_array (g_ptr_array_index (run, 0)))
+    return merge_json_arrays ((WpSpaJson * const *) run->pdata, run->len);
+  else
+    return merge_json_objects ((WpSpaJson * const *) run->pdata, run->len);
 }
 
 /*!
@@ -286,9 +705,11 @@ merge_json_arrays (WpSpaJson * a, WpSpaJson * b)
 WpSpaJson *
 wp_json_utils_merge_containers (WpSpaJson * a, WpSpaJson * b)
 {
+  WpSpaJson *values[] = { a, b };
+
   if (wp_spa_json_is_array (a) && wp_spa_json_is_array (b))
-    return merge_json_arrays (a, b);
+    return merge_json_arrays (values, G_N_ELEMENTS (values));
   else if (wp_spa_json_is_object (a) && wp_spa_json_is_object (b))
-    return merge_json_objects (a, b);
+    return merge_json_objects (values, G_N_ELEMENTS (values));
   return NULL;
 }
@@ -33,9 +33,41 @@ gboolean wp_json_utils_match_rules (WpSpaJson * json, WpProperties * match_props
 WP_API
 gint wp_json_utils_match_rules_update_properties (WpSpaJson *json, WpProperties *props);
 
+/*!
+ * \brief The WpRuleSet GType
+ * \ingroup wpjsonutils
+ */
+#define WP_TYPE_RULE_SET (wp_rule_set_get_type ())
+WP_API
+GType wp_rule_set_get_type (void);
+
+typedef struct _WpRuleSet WpRuleSet;
+
+WP_API
+WpRuleSet * wp_rule_set_new (WpSpaJson * json, GError ** error);
+
+WP_API
+WpRuleSet * wp_rule_set_ref (WpRuleSet * self);
+
+WP_API
+void wp_rule_set_unref (WpRuleSet * self);
+
+WP_API
+gboolean wp_rule_set_match (WpRuleSet * self, WpProperties * match_props,
+    WpRuleMatchCallback callback, gpointer data, GError ** error);
+
+WP_API
+gint wp_rule_set_update_properties (WpRuleSet * self, WpProperties * props);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (WpRuleSet, wp_rule_set_unref)
+
 WP_API
 WpSpaJson * wp_json_utils_merge_containers (WpSpaJson * a, WpSpaJson * b);
 
+WP_PRIVATE_API
+WpSpaJson * wp_json_utils_merge_values (WpSpaJson * const * values,
+    guint n_values, const gchar * name);
+
 G_END_DECLS
 
 #endif
@@ -51,9 +51,31 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-metadata")
  *
  * Flags: G_SIGNAL_RUN_LAST
  * \endparblock
+ *
+ * \par changed-batch
+ * \parblock
+ * \code
+ * void
+ * changed_batch_callback (WpMetadata * self,
+ *                         GPtrArray * changes,
+ *                         gpointer user_data)
+ * \endcode
+ * Emitted once when a transaction that changed the metadata is committed,
+ * after the "changed" signal has been emitted for each of the changes.
+ * See wp_metadata_begin().
+ *
+ * Parameters:
+ * - `changes` - an array of WpMetadataItem, one for each subject and key
+ *   that was changed, holding its final value; the value is NULL for keys
+ *   that were removed and the key is NULL if all the metadata of the
+ *   subject were removed. The items are only valid during the emission.
+ *
+ * Flags: G_SIGNAL_RUN_LAST
+ * \endparblock
  */
 enum {
   SIGNAL_CHANGED,
+  SIGNAL_CHANGED_BATCH,
   N_SIGNALS,
 };
 
@@ -138,6 +160,11 @@ struct _WpMetadataPrivate
   struct spa_hook listener;
   struct pw_array metadata;
   gboolean remove_listener;
+
+  /* transactions */
+  guint transaction_depth;
+  guint pending_syncs;
+  GArray *pending_changes;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (WpMetadata, wp_metadata, WP_TYPE_GLOBAL_PROXY)
@@ -147,6 +174,8 @@ wp_metadata_init (WpMetadata * self)
 {
   WpMetadataPrivate *priv = wp_metadata_get_instance_private (self);
   pw_array_init (&priv->metadata, 4096);
+  priv->pending_changes = g_array_new (FALSE, TRUE, sizeof (struct item));
+  g_array_set_clear_func (priv->pending_changes, (GDestroyNotify) clear_item);
 }
 
 static void
@@ -156,6 +185,7 @@ wp_metadata_finalize (GObject * object)
       wp_metadata_get_instance_private (WP_METADATA (object));
 
   pw_array_clear (&priv->metadata);
+  g_clear_pointer (&priv->pending_changes, g_array_unref);
 
   G_OBJECT_CLASS (wp_metadata_parent_class)->finalize (object);
 }
@@ -203,6 +233,60 @@ wp_metadata_activate_execute_step (WpObject * object,
   }
 }
 
+static WpMetadataItem * wp_metadata_item_new (WpMetadata *metadata,
+    guint32 subject, const gchar *key, const gchar *type, const gchar *value);
+
+static void
+emit_changed (WpMetadata * self, uint32_t subject, const char *key,
+    const char *type, const char *value)
+{
+  WpMetadataPrivate *priv = wp_metadata_get_instance_private (self);
+  struct item change = {0};
+
+  if (priv->transaction_depth == 0 && priv->pending_syncs == 0) {
+    g_signal_emit (self, signals[SIGNAL_CHANGED], 0, subject, key, type, value);
+    return;
+  }
+
+  /* defer the notification until the transaction is committed; a newer change
+     of the same key, or the removal of the whole subject, replaces older ones */
+  for (guint i = priv->pending_changes->len; i > 0; i--) {
+    struct item *c = &g_array_index (priv->pending_changes, struct item, i - 1);
+    if (c->subject == subject && (key == NULL || !g_strcmp0 (c->key, key)))
+      g_array_remove_index (priv->pending_changes, i - 1);
+  }
+  set_item (&change, subject, key, type, value);
+  g_array_append_val (priv->pending_changes, change);
+}
+
+static void
+flush_changes (WpMetadata * self)
+{
+  WpMetadataPrivate *priv = wp_metadata_get_instance_private (self);
+  g_autoptr (GArray) changes = NULL;
+  g_autoptr (GPtrArray) items = NULL;
+
+  if (priv->pending_changes->len == 0)
+    return;
+
+  changes = g_steal_pointer (&priv->pending_changes);
+  priv->pending_changes = g_array_new (FALSE, TRUE, sizeof (struct item));
+  g_array_set_clear_func (priv->pending_changes, (GDestroyNotify) clear_item);
+
+  wp_debug_object (self, "committing %u changes", changes->len);
+
+  items = g_ptr_array_new_full (changes->len,
+      (GDestroyNotify) wp_metadata_item_unref);
+  for (guint i = 0; i < changes->len; i++) {
+    struct item *c = &g_array_index (changes, struct item, i);
+    g_signal_emit (self, signals[SIGNAL_CHANGED], 0, c->subject, c->key,
+        c->type, c->value);
+    g_ptr_array_add (items,
+        wp_metadata_item_new (self, c->subject, c->key, c->type, c->value));
+  }
+  g_signal_emit (self, signals[SIGNAL_CHANGED_BATCH], 0, items);
+}
+
 static int
 metadata_event_property (void *object, uint32_t subject, const char *key,
     const char *type, const char *value)
@@ -215,8 +299,7 @@ metadata_event_property (void *object, uint32_t subject, const char *key,
   if (key == NULL) {
     if (clear_subject (&priv->metadata, subject) > 0) {
       wp_debug_object (self, "remove id:%d", subject);
-      g_signal_emit (self, signals[SIGNAL_CHANGED], 0, subject, NULL, NULL,
-          NULL);
+      emit_changed (self, subject, NULL, NULL, NULL);
     }
     return 0;
   }
@@ -244,7 +327,7 @@ metadata_event_property (void *object, uint32_t subject, const char *key,
     wp_debug_object (self, "remove id:%d key:%s", subject, key);
   }
 
-  g_signal_emit (self, signals[SIGNAL_CHANGED], 0, subject, key, type, value);
+  emit_changed (self, subject, key, type, value);
   return 0;
 }
 
@@ -291,6 +374,7 @@ wp_metadata_pw_proxy_destroyed (WpProxy * proxy)
     priv->remove_listener = FALSE;
   }
   clear_items (&priv->metadata);
+  g_array_set_size (priv->pending_changes, 0);
   wp_object_update_features (WP_OBJECT (self), 0, WP_METADATA_FEATURE_DATA);
 
   WP_PROXY_CLASS (wp_metadata_parent_class)->pw_proxy_destroyed (proxy);
@@ -317,6 +401,10 @@ wp_metadata_class_init (WpMetadataClass * klass)
   signals[SIGNAL_CHANGED] = g_signal_new ("changed", G_TYPE_FROM_CLASS (klass),
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 4,
       G_TYPE_UINT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
+
+  signals[SIGNAL_CHANGED_BATCH] = g_signal_new ("changed-batch",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+      G_TYPE_NONE, 1, G_TYPE_PTR_ARRAY);
 }
 
 /*!
@@ -447,6 +535,7 @@ struct metadata_iterator_data
   WpMetadata *metadata;
   const struct item *item;
   guint32 subject;
+  GPtrArray *batch;
 };
 
 static void
@@ -482,6 +571,35 @@ metadata_iterator_next (WpIterator *it, GValue *item)
   return FALSE;
 }
 
+static guint
+metadata_iterator_next_batch (WpIterator *it, gpointer *items,
+    guint max_items)
+{
+  struct metadata_iterator_data *it_data = wp_iterator_get_user_data (it);
+  WpMetadataPrivate *priv =
+      wp_metadata_get_instance_private (it_data->metadata);
+  guint n = 0;
+
+  /* release the items of the previous batch */
+  if (!it_data->batch)
+    it_data->batch = g_ptr_array_new_full (max_items,
+        (GDestroyNotify) wp_metadata_item_unref);
+  g_ptr_array_set_size (it_data->batch, 0);
+
+  while (n < max_items && pw_array_check (&priv->metadata, it_data->item)) {
+    if ((it_data->subject == PW_ID_ANY ||
+            it_data->subject == it_data->item->subject)) {
+      WpMetadataItem *mi = wp_metadata_item_new (it_data->metadata,
+          it_data->item->subject, it_data->item->key, it_data->item->type,
+          it_data->item->value);
+      g_ptr_array_add (it_data->batch, mi);
+      items[n++] = mi;
+    }
+    it_data->item++;
+  }
+  return n;
+}
+
 static gboolean
 metadata_iterator_fold (WpIterator *it, WpIteratorFoldFunc func, GValue *ret,
     gpointer data)
@@ -511,6 +629,7 @@ static void
 metadata_iterator_finalize (WpIterator *it)
 {
   struct metadata_iterator_data *it_data = wp_iterator_get_user_data (it);
+  g_clear_pointer (&it_data->batch, g_ptr_array_unref);
   g_object_unref (it_data->metadata);
 }
 
@@ -520,6 +639,7 @@ static const WpIteratorMethods metadata_iterator_methods = {
   .next = metadata_iterator_next,
   .fold = metadata_iterator_fold,
   .finalize = metadata_iterator_finalize,
+  .next_batch = metadata_iterator_next_batch,
 };
 
 /*!
@@ -610,6 +730,94 @@ wp_metadata_set (WpMetadata * self, guint32 subject,
   pw_metadata_set_property (priv->iface, subject, key, type, value);
 }
 
+/*!
+ * \brief Starts a transaction on the metadata object
+ *
+ * While a transaction is open, changes done with wp_metadata_set() are
+ * still sent to PipeWire immediately, one after the other, but the "changed"
+ * signal is not emitted. When the transaction is committed with
+ * wp_metadata_commit(), the "changed" signal is emitted once for each key
+ * that was changed, with its final value, followed by a single
+ * "changed-batch" signal that lists all the changes. Changes that are done
+ * by other clients while the transaction is open are also included.
+ *
+ * Transactions may be nested; the changes are only notified when the
+ * outermost transaction is committed.
+ *
+ * \ingroup wpmetadata
+ * \param self the metadata object
+ * \since 0.5.9
+ */
+void
+wp_metadata_begin (WpMetadata * self)
+{
+  WpMetadataPrivate *priv;
+
+  g_return_if_fail (WP_IS_METADATA (self));
+
+  priv = wp_metadata_get_instance_private (self);
+  priv->transaction_depth++;
+}
+
+static void
+transaction_sync_done (WpCore * core, GAsyncResult * res, WpMetadata * self)
+{
+  WpMetadataPrivate *priv = wp_metadata_get_instance_private (self);
+  g_autoptr (GError) error = NULL;
+
+  if (!wp_core_sync_finish (core, res, &error))
+    wp_warning_object (self, "core sync error: %s", error->message);
+
+  if (priv->pending_syncs > 0 && --priv->pending_syncs == 0 &&
+      priv->transaction_depth == 0)
+    flush_changes (self);
+}
+
+/*!
+ * \brief Commits a transaction that was started with wp_metadata_begin()
+ *
+ * For metadata objects that live in another process, the changes are
+ * notified after PipeWire has sent all of them back, i.e. after a core
+ * sync. For WpImplMetadata, they are notified before this function returns.
+ *
+ * \ingroup wpmetadata
+ * \param self the metadata object
+ * \since 0.5.9
+ */
+void
+wp_metadata_commit (WpMetadata * self)
+{
+  WpMetadataPrivate *priv;
+  g_autoptr (WpCore) core = NULL;
+
+  g_return_if_fail (WP_IS_METADATA (self));
+
+  priv = wp_metadata_get_instance_private (self);
+  g_return_if_fail (priv->transaction_depth > 0);
+
+  if (--priv->transaction_depth > 0)
+    return;
+
+  /* the local implementation notifies synchronously */
+  if (WP_IS_IMPL_METADATA (self)) {
+    flush_changes (self);
+    return;
+  }
+
+  /* wait for the server to send back all the changes before notifying */
+  core = wp_object_get_core (WP_OBJECT (self));
+  if (!core) {
+    if (priv->pending_syncs == 0)
+      flush_changes (self);
+    return;
+  }
+
+  /* the closure is invoked also if the sync fails */
+  priv->pending_syncs++;
+  wp_core_sync_closure (core, NULL, g_cclosure_new_object (
+      (GCallback) transaction_sync_done, G_OBJECT (self)));
+}
+
 /*!
  * \brief Clears permanently all stored metadata.
  * \ingroup wpmetadata
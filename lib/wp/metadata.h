@@ -83,6 +83,12 @@ void wp_metadata_set (WpMetadata * self, guint32 subject,
 WP_API
 void wp_metadata_clear (WpMetadata * self);
 
+WP_API
+void wp_metadata_begin (WpMetadata * self);
+
+WP_API
+void wp_metadata_commit (WpMetadata * self);
+
 /*!
  * \brief The WpImplMetadata GType
  * \ingroup wpmetadata
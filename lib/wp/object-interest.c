@@ -38,6 +38,8 @@ struct constraint
   gchar subject_type; /* a basic GVariantType as a single char */
   gchar *subject;
   GVariant *value;
+  /* interned copy of a string value, to compare with interned properties */
+  gchar *interned_value;
 };
 
 struct _WpObjectInterest
@@ -268,6 +270,7 @@ wp_object_interest_free (WpObjectInterest * self)
   pw_array_for_each (c, &self->constraints) {
     g_clear_pointer (&c->subject, g_free);
     g_clear_pointer (&c->value, g_variant_unref);
+    g_clear_pointer (&c->interned_value, g_ref_string_release);
   }
   pw_array_clear (&self->constraints);
   g_slice_free (WpObjectInterest, self);
@@ -507,6 +510,12 @@ wp_object_interest_validate (WpObjectInterest * self, GError ** error)
     /* cache the type that the property must have */
     if (value_type)
       c->subject_type = *g_variant_type_peek_string (value_type);
+
+    if (c->type != WP_CONSTRAINT_TYPE_G_PROPERTY && c->subject_type == 's' &&
+        (c->verb == WP_CONSTRAINT_VERB_EQUALS ||
+         c->verb == WP_CONSTRAINT_VERB_NOT_EQUALS) && !c->interned_value)
+      c->interned_value =
+          g_ref_string_new_intern (g_variant_get_string (c->value, NULL));
   }
 
   return (self->valid = TRUE);
@@ -796,6 +805,16 @@ wp_object_interest_matches_full (WpObjectInterest * self,
         if (lookup_props)
           exists = !!(lookup_str = wp_properties_get (lookup_props, c->subject));
 
+        /* interned strings are unique, so comparing their addresses is
+           enough to tell whether they are equal */
+        if (exists && c->interned_value &&
+            wp_properties_is_interned (lookup_props)) {
+          gboolean equal = (lookup_str == c->interned_value);
+          if (equal != (c->verb == WP_CONSTRAINT_VERB_EQUALS))
+            result &= ~(1 << c->type);
+          continue;
+        }
+
         if (exists && c->subject_type)
           property_string_to_gvalue (c->subject_type, lookup_str, &value);
         break;
@@ -879,3 +898,38 @@ wp_object_interest_matches_full (WpObjectInterest * self,
   }
   return result;
 }
+
+/*!
+ * \brief Finds the first constraint of \a self that has the specified
+ * \a type, \a subject and \a verb and returns its value.
+ *
+ * This is used by WpObjectManager to look up candidate objects in its
+ * indexes before evaluating the full interest on them.
+ *
+ * \private
+ * \ingroup wpobjectinterest
+ * \param self the object interest
+ * \param type the constraint type
+ * \param subject the subject of the constraint
+ * \param verb the verb of the constraint
+ * \returns (transfer none)(nullable): the value of the constraint, or NULL
+ *   if there is no such constraint or if \a self is not valid
+ */
+GVariant *
+wp_object_interest_find_constraint_value (WpObjectInterest * self,
+    WpConstraintType type, const gchar * subject, WpConstraintVerb verb)
+{
+  struct constraint *c;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  if (!self->valid)
+    return NULL;
+
+  pw_array_for_each (c, &self->constraints) {
+    if (c->type == type && c->verb == verb && c->value &&
+        g_str_equal (c->subject, subject))
+      return c->value;
+  }
+  return NULL;
+}
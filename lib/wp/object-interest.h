@@ -130,6 +130,12 @@ WpInterestMatch wp_object_interest_matches_full (WpObjectInterest * self,
     WpInterestMatchFlags flags, GType object_type, gpointer object,
     WpProperties * pw_props, WpProperties * pw_global_props);
 
+/* private */
+
+WP_PRIVATE_API
+GVariant * wp_object_interest_find_constraint_value (WpObjectInterest * self,
+    WpConstraintType type, const gchar * subject, WpConstraintVerb verb);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (WpObjectInterest, wp_object_interest_unref)
 
 G_END_DECLS
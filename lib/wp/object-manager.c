@@ -9,6 +9,8 @@
 #include "object-manager.h"
 #include "log.h"
 #include "proxy-interfaces.h"
+#include "global-proxy.h"
+#include "session-item.h"
 #include "private/registry.h"
 
 #include <pipewire/pipewire.h>
@@ -52,6 +54,14 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-object-manager")
  * \c installed signal has been emitted. That signal is emitted asynchronously
  * after all the initial objects have been prepared.
  *
+ * Lookups and filtered iterations are accelerated by indexes. Objects are
+ * always indexed by their "bound-id", so interests that contain an equality
+ * constraint on the "bound-id" GObject property only need to evaluate the
+ * object with that id. Additional indexes on PipeWire global properties can
+ * be enabled with wp_object_manager_add_index(), in which case interests that
+ * contain a string equality constraint on such a property are also resolved
+ * through the index.
+ *
  * \gproperties
  *
  * \gproperty{core, WpCore *, G_PARAM_READABLE, The core}
@@ -140,12 +150,43 @@ struct _WpObjectManager
   /* objects that we are interested in, without a ref */
   GPtrArray *objects;
 
+  /* element-type: <guint32 bound-id, GPtrArray of objects without a ref> */
+  GHashTable *id_index;
+  /* global property keys that are indexed; element-type: gchar* */
+  GPtrArray *prop_keys;
+  /* one index per prop_keys entry;
+     element-type: GHashTable <gchar* value, GPtrArray of objects> */
+  GPtrArray *prop_indexes;
+  /* objects that may match but could not be indexed when they were added */
+  GPtrArray *id_unindexed;
+  GPtrArray *props_unindexed;
+  /* element-type: <object, struct index_record> */
+  GHashTable *index_records;
+
   gboolean installed;
   gboolean changed;
   guint pending_objects;
   GSource *idle_source;
 };
 
+/* remembers under which keys an object was indexed, so that it can be
+   removed from the indexes even if its properties have changed since */
+struct index_record
+{
+  guint32 bound_id;
+  guint n_values;
+  gchar **values;
+};
+
+static void
+index_record_free (struct index_record * rec)
+{
+  for (guint i = 0; i < rec->n_values; i++)
+    g_free (rec->values[i]);
+  g_free (rec->values);
+  g_free (rec);
+}
+
 enum {
   PROP_0,
   PROP_CORE,
@@ -171,6 +212,15 @@ wp_object_manager_init (WpObjectManager * self)
       (GDestroyNotify) wp_object_interest_unref);
   self->features = g_hash_table_new (g_direct_hash, g_direct_equal);
   self->objects = g_ptr_array_new ();
+  self->id_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) g_ptr_array_unref);
+  self->prop_keys = g_ptr_array_new_with_free_func (g_free);
+  self->prop_indexes = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) g_hash_table_unref);
+  self->id_unindexed = g_ptr_array_new ();
+  self->props_unindexed = g_ptr_array_new ();
+  self->index_records = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) index_record_free);
   self->installed = FALSE;
   self->changed = FALSE;
   self->pending_objects = 0;
@@ -185,6 +235,12 @@ wp_object_manager_finalize (GObject * object)
     g_source_destroy (self->idle_source);
     g_clear_pointer (&self->idle_source, g_source_unref);
   }
+  g_clear_pointer (&self->index_records, g_hash_table_unref);
+  g_clear_pointer (&self->props_unindexed, g_ptr_array_unref);
+  g_clear_pointer (&self->id_unindexed, g_ptr_array_unref);
+  g_clear_pointer (&self->prop_indexes, g_ptr_array_unref);
+  g_clear_pointer (&self->prop_keys, g_ptr_array_unref);
+  g_clear_pointer (&self->id_index, g_hash_table_unref);
   g_clear_pointer (&self->objects, g_ptr_array_unref);
   g_clear_pointer (&self->features, g_hash_table_unref);
   g_clear_pointer (&self->interests, g_ptr_array_unref);
@@ -365,6 +421,215 @@ wp_object_manager_request_object_features (WpObjectManager *self,
   store_children_object_features (self->features, object_type, wanted_features);
 }
 
+/*!
+ * \brief Requests the object manager to maintain an index on the PipeWire
+ * global property \a key.
+ *
+ * Interests that contain a WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY constraint
+ * with the WP_CONSTRAINT_VERB_EQUALS verb and a string value on \a key are
+ * then resolved through this index in wp_object_manager_lookup_full() and
+ * wp_object_manager_new_filtered_iterator_full(), instead of being evaluated
+ * on every managed object. This is useful for properties that are commonly
+ * used to identify objects, such as "node.name" or "object.serial".
+ *
+ * This must be called before installing the object manager.
+ *
+ * \ingroup wpobjectmanager
+ * \param self the object manager
+ * \param key the global property key to index
+ */
+void
+wp_object_manager_add_index (WpObjectManager * self, const gchar * key)
+{
+  g_return_if_fail (WP_IS_OBJECT_MANAGER (self));
+  g_return_if_fail (key != NULL);
+  g_return_if_fail (self->objects->len == 0);
+
+  for (guint i = 0; i < self->prop_keys->len; i++) {
+    if (g_str_equal (g_ptr_array_index (self->prop_keys, i), key))
+      return;
+  }
+
+  g_ptr_array_add (self->prop_keys, g_strdup (key));
+  g_ptr_array_add (self->prop_indexes, g_hash_table_new_full (g_str_hash,
+      g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref));
+}
+
+static void
+index_add (GHashTable * index, gpointer key, gboolean dup_key, gpointer object)
+{
+  GPtrArray *bucket = g_hash_table_lookup (index, key);
+
+  if (!bucket) {
+    bucket = g_ptr_array_new ();
+    g_hash_table_insert (index, dup_key ? g_strdup (key) : key, bucket);
+  }
+  g_ptr_array_add (bucket, object);
+}
+
+static void
+index_remove (GHashTable * index, gconstpointer key, gpointer object)
+{
+  GPtrArray *bucket = g_hash_table_lookup (index, key);
+
+  if (bucket) {
+    g_ptr_array_remove_fast (bucket, object);
+    if (bucket->len == 0)
+      g_hash_table_remove (index, key);
+  }
+}
+
+static void
+wp_object_manager_index_object (WpObjectManager * self, gpointer object)
+{
+  struct index_record *rec = g_new0 (struct index_record, 1);
+
+  /* bound-id is stable for as long as the proxy is bound, which is normally
+     the case while the proxy is managed by us; proxies that are not bound
+     yet are always considered by lookups, as they may bind later */
+  rec->bound_id = SPA_ID_INVALID;
+  if (WP_IS_PROXY (object) &&
+      (wp_object_get_active_features (WP_OBJECT (object)) &
+          WP_PROXY_FEATURE_BOUND))
+    rec->bound_id = wp_proxy_get_bound_id (WP_PROXY (object));
+
+  if (rec->bound_id != SPA_ID_INVALID)
+    index_add (self->id_index, GUINT_TO_POINTER (rec->bound_id), FALSE, object);
+  else if (g_object_class_find_property (G_OBJECT_GET_CLASS (object),
+               "bound-id"))
+    g_ptr_array_add (self->id_unindexed, object);
+
+  /* global properties of a WpGlobal never change, but session item
+     properties and proxies that are not associated with a global yet
+     cannot be indexed reliably */
+  if (self->prop_keys->len > 0) {
+    g_autoptr (WpProperties) props = WP_IS_GLOBAL_PROXY (object) ?
+        wp_global_proxy_get_global_properties (WP_GLOBAL_PROXY (object)) : NULL;
+
+    if (props) {
+      rec->n_values = self->prop_keys->len;
+      rec->values = g_new0 (gchar *, rec->n_values);
+
+      for (guint i = 0; i < rec->n_values; i++) {
+        const gchar *key = g_ptr_array_index (self->prop_keys, i);
+        const gchar *value = wp_properties_get (props, key);
+
+        if (value) {
+          rec->values[i] = g_strdup (value);
+          index_add (g_ptr_array_index (self->prop_indexes, i),
+              rec->values[i], TRUE, object);
+        }
+      }
+    }
+    else if (WP_IS_GLOBAL_PROXY (object) || WP_IS_SESSION_ITEM (object)) {
+      g_ptr_array_add (self->props_unindexed, object);
+    }
+  }
+
+  g_hash_table_insert (self->index_records, object, rec);
+}
+
+static void
+wp_object_manager_unindex_object (WpObjectManager * self, gpointer object)
+{
+  struct index_record *rec = g_hash_table_lookup (self->index_records, object);
+
+  if (!rec)
+    return;
+
+  if (rec->bound_id != SPA_ID_INVALID)
+    index_remove (self->id_index, GUINT_TO_POINTER (rec->bound_id), object);
+  else
+    g_ptr_array_remove_fast (self->id_unindexed, object);
+
+  if (rec->values) {
+    for (guint i = 0; i < rec->n_values; i++) {
+      if (rec->values[i])
+        index_remove (g_ptr_array_index (self->prop_indexes, i),
+            rec->values[i], object);
+    }
+  }
+  else {
+    g_ptr_array_remove_fast (self->props_unindexed, object);
+  }
+
+  g_hash_table_remove (self->index_records, object);
+}
+
+static gboolean
+variant_to_bound_id (GVariant * value, guint32 * id)
+{
+  switch (g_variant_classify (value)) {
+    case G_VARIANT_CLASS_UINT32:
+      *id = g_variant_get_uint32 (value);
+      return TRUE;
+    case G_VARIANT_CLASS_INT32: {
+      gint32 v = g_variant_get_int32 (value);
+      *id = (guint32) v;
+      return v >= 0;
+    }
+    case G_VARIANT_CLASS_INT64: {
+      gint64 v = g_variant_get_int64 (value);
+      *id = (guint32) v;
+      return v >= 0 && v <= G_MAXUINT32;
+    }
+    case G_VARIANT_CLASS_UINT64: {
+      guint64 v = g_variant_get_uint64 (value);
+      *id = (guint32) v;
+      return v <= G_MAXUINT32;
+    }
+    case G_VARIANT_CLASS_STRING: {
+      guint64 v = 0;
+      gboolean ret = g_ascii_string_to_unsigned (
+          g_variant_get_string (value, NULL), 10, 0, G_MAXUINT32, &v, NULL);
+      *id = (guint32) v;
+      return ret;
+    }
+    default:
+      return FALSE;
+  }
+}
+
+/* returns the objects that may match the interest; if the interest has a
+   constraint that can be resolved through an index, this is only the objects
+   found in the index plus the ones that could not be indexed, otherwise it is
+   all the managed objects; the interest must still be checked on each one */
+static GPtrArray *
+wp_object_manager_find_candidates (WpObjectManager * self,
+    WpObjectInterest * interest)
+{
+  GPtrArray *bucket = NULL, *unindexed = NULL, *ret;
+  GVariant *value;
+  guint32 id;
+
+  value = wp_object_interest_find_constraint_value (interest,
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id", WP_CONSTRAINT_VERB_EQUALS);
+  if (value && variant_to_bound_id (value, &id)) {
+    bucket = g_hash_table_lookup (self->id_index, GUINT_TO_POINTER (id));
+    unindexed = self->id_unindexed;
+  }
+
+  for (guint i = 0; !unindexed && i < self->prop_keys->len; i++) {
+    value = wp_object_interest_find_constraint_value (interest,
+        WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+        g_ptr_array_index (self->prop_keys, i), WP_CONSTRAINT_VERB_EQUALS);
+    if (value && g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)) {
+      bucket = g_hash_table_lookup (g_ptr_array_index (self->prop_indexes, i),
+          g_variant_get_string (value, NULL));
+      unindexed = self->props_unindexed;
+    }
+  }
+
+  if (!unindexed)
+    return g_ptr_array_copy (self->objects, NULL, NULL);
+
+  ret = g_ptr_array_sized_new ((bucket ? bucket->len : 0) + unindexed->len);
+  if (bucket)
+    g_ptr_array_extend (ret, bucket, NULL, NULL);
+  g_ptr_array_extend (ret, unindexed, NULL, NULL);
+  return ret;
+}
+
 /*!
  * \brief Gets the number of objects managed by the object manager.
  * \ingroup wpobjectmanager
@@ -411,6 +676,22 @@ om_iterator_next (WpIterator *it, GValue *item)
   return FALSE;
 }
 
+static guint
+om_iterator_next_batch (WpIterator *it, gpointer *items, guint max_items)
+{
+  struct om_iterator_data *it_data = wp_iterator_get_user_data (it);
+  guint n = 0;
+
+  while (n < max_items && it_data->index < it_data->objects->len) {
+    gpointer obj = g_ptr_array_index (it_data->objects, it_data->index++);
+
+    if (!it_data->interest ||
+        wp_object_interest_matches (it_data->interest, obj))
+      items[n++] = obj;
+  }
+  return n;
+}
+
 static gboolean
 om_iterator_fold (WpIterator *it, WpIteratorFoldFunc func, GValue *ret,
     gpointer data)
@@ -451,6 +732,7 @@ static const WpIteratorMethods om_iterator_methods = {
   .next = om_iterator_next,
   .fold = om_iterator_fold,
   .finalize = om_iterator_finalize,
+  .next_batch = om_iterator_next_batch,
 };
 
 /*!
@@ -539,7 +821,7 @@ wp_object_manager_new_filtered_iterator_full (WpObjectManager * self,
   it = wp_iterator_new (&om_iterator_methods, sizeof (struct om_iterator_data));
   it_data = wp_iterator_get_user_data (it);
   it_data->om = g_object_ref (self);
-  it_data->objects = g_ptr_array_copy (self->objects, NULL, NULL);
+  it_data->objects = wp_object_manager_find_candidates (self, interest);
   it_data->interest = interest;
   it_data->index = 0;
   return it;
@@ -744,6 +1026,7 @@ wp_object_manager_add_object (WpObjectManager * self, gpointer object)
   if (wp_object_manager_is_interested_in_object (self, object)) {
     wp_trace_object (self, "added: " WP_OBJECT_FORMAT, WP_OBJECT_ARGS (object));
     g_ptr_array_add (self->objects, object);
+    wp_object_manager_index_object (self, object);
     g_signal_emit (self, signals[SIGNAL_OBJECT_ADDED], 0, object);
     self->changed = TRUE;
   }
@@ -763,6 +1046,7 @@ wp_object_manager_rm_object (WpObjectManager * self, gpointer object)
   guint index;
   if (g_ptr_array_find (self->objects, object, &index)) {
     g_ptr_array_remove_index_fast (self->objects, index);
+    wp_object_manager_unindex_object (self, object);
     g_signal_emit (self, signals[SIGNAL_OBJECT_REMOVED], 0, object);
     self->changed = TRUE;
   }
@@ -822,6 +1106,182 @@ wp_object_manager_add_global (WpObjectManager * self, WpGlobal * global)
   }
 }
 
+/* A batch of globals that are exposed together to a set of object managers.
+   Each object is added to each manager as soon as the features that this
+   manager wants are active, like wp_object_manager_add_global() does; only
+   the evaluation of "objects-changed" / "installed" is deferred, once per
+   manager, until all the objects of the batch that it is interested in are
+   done */
+struct bulk_add
+{
+  GPtrArray *object_managers;
+  /* per manager: activations of this batch that are still in flight */
+  guint *pending;
+  /* all managers: activations in flight, plus one while the batch is set up */
+  guint n_pending;
+};
+
+struct bulk_activation
+{
+  struct bulk_add *batch;
+  guint om_index;
+  WpObjectFeatures features;
+  WpGlobal *global;
+};
+
+static void
+bulk_add_unref (struct bulk_add * batch)
+{
+  if (--batch->n_pending > 0)
+    return;
+
+  g_ptr_array_unref (batch->object_managers);
+  g_free (batch->pending);
+  g_slice_free (struct bulk_add, batch);
+}
+
+static void
+bulk_add_om_done (struct bulk_add * batch, guint om_index)
+{
+  if (--batch->pending[om_index] == 0)
+    wp_object_manager_maybe_objects_changed (
+        g_ptr_array_index (batch->object_managers, om_index));
+}
+
+static void
+on_bulk_proxy_ready (GObject * proxy, GAsyncResult * res, gpointer data)
+{
+  struct bulk_activation *act = data;
+  WpObjectManager *om =
+      g_ptr_array_index (act->batch->object_managers, act->om_index);
+  g_autoptr (GError) error = NULL;
+
+  om->pending_objects--;
+
+  if (!wp_object_activate_finish (WP_OBJECT (proxy), res, &error)) {
+    wp_debug_object (om, "proxy activation failed: %s", error->message);
+  }
+  /* the global may have been removed while the proxy was activating */
+  else if (act->global->id != SPA_ID_INVALID &&
+      act->global->proxy == (gpointer) proxy) {
+    wp_object_manager_add_object (om, proxy);
+  }
+
+  bulk_add_om_done (act->batch, act->om_index);
+  bulk_add_unref (act->batch);
+  wp_global_unref (act->global);
+  g_slice_free (struct bulk_activation, act);
+}
+
+static gint
+bulk_activation_cmp (gconstpointer a, gconstpointer b)
+{
+  const struct bulk_activation *aa = *(struct bulk_activation **) a;
+  const struct bulk_activation *ab = *(struct bulk_activation **) b;
+  gint diff =
+      __builtin_popcount (aa->features) - __builtin_popcount (ab->features);
+  /* keep the order of the managers otherwise */
+  return diff ? diff : (gint) aa->om_index - (gint) ab->om_index;
+}
+
+/*!
+ * \brief Adds a batch of new globals to all the given object managers.
+ *
+ * This is equivalent to calling wp_object_manager_add_global() for every
+ * combination of object manager and global, followed by
+ * wp_object_manager_maybe_objects_changed() on each object manager. Each
+ * object is added to each manager as soon as the features that this manager
+ * wants are active, but "objects-changed" and "installed" are evaluated only
+ * once per manager, after all the objects of the batch are added to it.
+ *
+ * The activations of a proxy run one after the other, so the managers that
+ * want fewer features are served first and do not wait for the features
+ * (e.g. params) that other managers want.
+ *
+ * \private
+ * \ingroup wpobjectmanager
+ * \param object_managers (element-type WpObjectManager): the object managers
+ * \param globals (element-type WpGlobal): the new globals, in the order that
+ *   they should be added
+ */
+void
+wp_object_manager_add_globals (GPtrArray * object_managers, GPtrArray * globals)
+{
+  struct bulk_add *batch = g_slice_new0 (struct bulk_add);
+  g_autoptr (GPtrArray) acts = g_ptr_array_new ();
+
+  batch->object_managers = g_ptr_array_copy (object_managers,
+      (GCopyFunc) g_object_ref, NULL);
+  g_ptr_array_set_free_func (batch->object_managers, g_object_unref);
+  batch->pending = g_new (guint, object_managers->len);
+  /* hold every manager and the batch until all the activations have been
+     started, in case some of them complete synchronously */
+  for (guint j = 0; j < object_managers->len; j++)
+    batch->pending[j] = 1;
+  batch->n_pending = 1;
+
+  for (guint i = 0; i < globals->len; i++) {
+    WpGlobal *global = g_ptr_array_index (globals, i);
+
+    /* if global was already removed, drop it */
+    if (global->flags == 0 || global->id == SPA_ID_INVALID)
+      continue;
+
+    /* see wp_object_manager_add_global() */
+    if (global->type == WP_TYPE_GLOBAL_PROXY)
+      continue;
+
+    g_ptr_array_set_size (acts, 0);
+
+    for (guint j = 0; j < object_managers->len; j++) {
+      WpObjectManager *om = g_ptr_array_index (object_managers, j);
+      WpObjectFeatures features = 0;
+      struct bulk_activation *act;
+
+      if (!wp_object_manager_is_interested_in_global (om, global, &features))
+        continue;
+
+      act = g_slice_new0 (struct bulk_activation);
+      act->batch = batch;
+      act->om_index = j;
+      act->features = features;
+      act->global = wp_global_ref (global);
+      g_ptr_array_add (acts, act);
+
+      om->pending_objects++;
+      batch->pending[j]++;
+      batch->n_pending++;
+    }
+
+    if (acts->len == 0)
+      continue;
+
+    if (!global->proxy) {
+      WpObjectManager *om = g_ptr_array_index (object_managers,
+          ((struct bulk_activation *) g_ptr_array_index (acts, 0))->om_index);
+      g_autoptr (WpCore) core = g_weak_ref_get (&om->core);
+      global->proxy = g_object_new (global->type,
+          "core", core,
+          "global", global,
+          NULL);
+    }
+
+    wp_trace ("adding global:%u -> " WP_OBJECT_FORMAT " to %u managers",
+        global->id, WP_OBJECT_ARGS (global->proxy), acts->len);
+
+    g_ptr_array_sort (acts, bulk_activation_cmp);
+    for (guint k = 0; k < acts->len; k++) {
+      struct bulk_activation *act = g_ptr_array_index (acts, k);
+      wp_object_activate (WP_OBJECT (global->proxy), act->features, NULL,
+          on_bulk_proxy_ready, act);
+    }
+  }
+
+  for (guint j = 0; j < object_managers->len; j++)
+    bulk_add_om_done (batch, j);
+  bulk_add_unref (batch);
+}
+
 /*!
  * \brief Installs the object manager on this core, activating its internal
  * management engine.
@@ -48,6 +48,11 @@ WP_API
 void wp_object_manager_request_object_features (WpObjectManager *self,
     GType object_type, WpObjectFeatures wanted_features);
 
+/* indexes */
+
+WP_API
+void wp_object_manager_add_index (WpObjectManager * self, const gchar * key);
+
 /* object inspection */
 
 WP_API
@@ -88,6 +93,10 @@ void wp_object_manager_rm_object (WpObjectManager * self, gpointer object);
 WP_PRIVATE_API
 void wp_object_manager_add_global (WpObjectManager * self, WpGlobal * global);
 
+WP_PRIVATE_API
+void wp_object_manager_add_globals (GPtrArray * object_managers,
+    GPtrArray * globals);
+
 G_END_DECLS
 
 #endif
@@ -782,8 +782,11 @@ wp_pw_object_mixin_handle_event_info (gpointer instance, gconstpointer update)
     const struct spa_dict * props =
         G_STRUCT_MEMBER (const struct spa_dict *, d->info, iface->props_offset);
 
+    /* update_info() replaces the props dict on every change, it never
+       modifies it in place, so the wrapper (and its lookup index) stays
+       valid until it is replaced here */
     g_clear_pointer (&d->properties, wp_properties_unref);
-    d->properties = wp_properties_new_wrap_dict (props);
+    d->properties = wp_properties_new_wrap_const_dict (props);
 
     g_object_notify (G_OBJECT (instance), "properties");
   }
@@ -292,25 +292,26 @@ expose_tmp_globals (WpCore *core)
       (GCopyFunc) g_object_ref, NULL);
   g_ptr_array_set_free_func (object_managers, g_object_unref);
 
-  /* notify object managers */
-  for (guint i = 0; i < object_managers->len; i++) {
-    WpObjectManager *om = g_ptr_array_index (object_managers, i);
-
-    for (guint i = 0; i < tmp_globals->len; i++) {
-      WpGlobal *g = g_ptr_array_index (tmp_globals, i);
-
-      /* if global was already removed, drop it */
-      if (g->flags == 0 || g->id == SPA_ID_INVALID)
-        continue;
-
-      wp_object_manager_add_global (om, g);
-    }
-    wp_object_manager_maybe_objects_changed (om);
-  }
+  /* notify object managers; all the globals of this flush are bound and
+     handed to the managers as one batch */
+  wp_object_manager_add_globals (object_managers, tmp_globals);
 
   return G_SOURCE_REMOVE;
 }
 
+/*
+ * Interned global properties are immutable, so they are replaced with a
+ * modifiable copy before being updated; returns TRUE if that was necessary
+ */
+static gboolean
+wp_global_make_properties_writable (WpGlobal * global)
+{
+  if (!wp_properties_is_interned (global->properties))
+    return FALSE;
+  global->properties = wp_properties_ensure_unique_owner (global->properties);
+  return TRUE;
+}
+
 /*
  * \param new_global (out) (transfer full) (optional): the new global
  *
@@ -357,6 +358,9 @@ wp_registry_prepare_new_global (WpRegistry * self, guint32 id,
     /* ensure we have 'object.id' so that we can filter by id on object managers */
     wp_properties_setf (global->properties, PW_KEY_OBJECT_ID, "%u", global->id);
 
+    if (self->intern_properties)
+      global->properties = wp_properties_intern (global->properties);
+
     /* schedule exposing when adding the first global */
     if (self->tmp_globals->len == 1) {
       wp_core_idle_add_closure (core, NULL,
@@ -380,8 +384,12 @@ wp_registry_prepare_new_global (WpRegistry * self, guint32 id,
       global->proxy = proxy;
     }
 
-    if (props)
+    if (props) {
+      gboolean interned = wp_global_make_properties_writable (global);
       wp_properties_update_from_dict (global->properties, props);
+      if (interned)
+        global->properties = wp_properties_intern (global->properties);
+    }
   }
 
   if (new_global)
@@ -494,6 +502,7 @@ wp_global_rm_flag (WpGlobal *global, guint rm_flag)
      * this WpGlobal is not used in reference to objects added later.
      */
     global->id = SPA_ID_INVALID;
+    wp_global_make_properties_writable (global);
     wp_properties_setf (global->properties, PW_KEY_OBJECT_ID, NULL);
   }
 
@@ -31,6 +31,9 @@ struct _WpRegistry
   GPtrArray *objects; // element-type: GObject*
   GPtrArray *object_managers; // element-type: WpObjectManager*
   GPtrArray *features; // element-type: gchar*
+
+  /* share property strings between globals; see wp_properties_intern() */
+  gboolean intern_properties;
 };
 
 void wp_registry_init (WpRegistry *self);
@@ -43,11 +43,43 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-properties")
  *
  * WpProperties is reference-counted with wp_properties_ref() and
  * wp_properties_unref().
+ *
+ * Lookups with wp_properties_get() on large, unsorted property sets that are
+ * owned by the WpProperties object are accelerated by a hash index that is
+ * built lazily on the first lookup and dropped when the properties are
+ * modified. Properties that wrap externally owned structures are not
+ * indexed, since these may be modified behind the object's back, unless the
+ * owner guarantees that they are not (see the info properties of
+ * WpPipewireObject).
  */
 
 enum {
   FLAG_IS_DICT = (1<<1),
   FLAG_NO_OWNERSHIP = (1<<2),
+  FLAG_INTERNED = (1<<3),
+  /* wraps a dict that is never modified while wrapped; it may be indexed */
+  FLAG_CONST_DICT = (1<<4),
+};
+
+/* an immutable dict whose keys and values are interned GRefStrings */
+typedef struct _WpInternedDict WpInternedDict;
+struct _WpInternedDict
+{
+  struct spa_dict dict;
+  struct spa_dict_item items[];
+};
+
+/* below this size, a linear scan is as fast as hashing the key */
+#define INDEX_MIN_ITEMS 16
+
+typedef struct _WpPropertiesIndex WpPropertiesIndex;
+struct _WpPropertiesIndex
+{
+  /* the dict layout that the index was built for */
+  const struct spa_dict_item *items;
+  guint32 n_items;
+  /* key -> const struct spa_dict_item * */
+  GHashTable *table;
 };
 
 struct _WpProperties
@@ -58,10 +90,94 @@ struct _WpProperties
     struct pw_properties *props;
     const struct spa_dict *dict;
   };
+  WpPropertiesIndex *index;
 };
 
 G_DEFINE_BOXED_TYPE(WpProperties, wp_properties, wp_properties_ref, wp_properties_unref)
 
+static void
+wp_properties_index_free (WpPropertiesIndex * index)
+{
+  g_hash_table_unref (index->table);
+  g_slice_free (WpPropertiesIndex, index);
+}
+
+static inline void
+wp_properties_invalidate_index (WpProperties * self)
+{
+  g_clear_pointer (&self->index, wp_properties_index_free);
+}
+
+static inline gint
+wp_properties_changed (WpProperties * self, gint n_changed)
+{
+  if (n_changed > 0)
+    wp_properties_invalidate_index (self);
+  return n_changed;
+}
+
+static WpPropertiesIndex *
+wp_properties_ensure_index (WpProperties * self, const struct spa_dict * dict)
+{
+  WpPropertiesIndex *index = g_atomic_pointer_get (&self->index);
+  const struct spa_dict_item *item;
+
+  if (index && index->items == dict->items && index->n_items == dict->n_items)
+    return index;
+
+  /* the index is never modified after it is published, so that concurrent
+     lookups on a properties set that is not being modified stay safe;
+     a stale index is only possible if the owner modified the dict without
+     going through the WpProperties API and is simply not used */
+  if (index)
+    return NULL;
+
+  index = g_slice_new0 (WpPropertiesIndex);
+  index->table = g_hash_table_new (g_str_hash, g_str_equal);
+  index->items = dict->items;
+  index->n_items = dict->n_items;
+
+  /* insert in reverse, so that the first item wins in case of duplicate keys,
+     just like spa_dict_lookup() */
+  for (item = dict->items + dict->n_items; item-- > dict->items;)
+    g_hash_table_insert (index->table, (gpointer) item->key, (gpointer) item);
+
+  if (!g_atomic_pointer_compare_and_exchange (&self->index, NULL, index)) {
+    /* another thread was faster */
+    wp_properties_index_free (index);
+    index = g_atomic_pointer_get (&self->index);
+  }
+  return index;
+}
+
+static const gchar *
+wp_properties_lookup (WpProperties * self, const gchar * key)
+{
+  const struct spa_dict *dict = wp_properties_peek_dict (self);
+  const struct spa_dict_item *item;
+  WpPropertiesIndex *index;
+
+  /* small and sorted dicts are already efficient to search; wrapped dicts
+     may change behind our back, so they are only indexed if their owner
+     promised that they do not */
+  if (dict->n_items < INDEX_MIN_ITEMS || (dict->flags & SPA_DICT_FLAG_SORTED) ||
+      ((self->flags & FLAG_NO_OWNERSHIP) && !(self->flags & FLAG_CONST_DICT)))
+    return spa_dict_lookup (dict, key);
+
+  index = wp_properties_ensure_index (self, dict);
+  if (!index)
+    return spa_dict_lookup (dict, key);
+
+  item = g_hash_table_lookup (index->table, key);
+
+  /* be defensive against in-place modifications that kept the same layout */
+  if (item && (item < dict->items || item >= dict->items + dict->n_items ||
+          !g_str_equal (item->key, key)))
+    return spa_dict_lookup (dict, key);
+
+  return item ? item->value : NULL;
+}
+
 /*!
  * \brief Creates a new empty properties set
  * \ingroup wpproperties
@@ -276,6 +392,29 @@ wp_properties_new_wrap_dict (const struct spa_dict * dict)
   return self;
 }
 
+/*!
+ * \brief Same as wp_properties_new_wrap_dict(), but the caller guarantees
+ * that \a dict is not modified for as long as the returned properties set
+ * is in use, so lookups on it can be accelerated with an index.
+ *
+ * This is meant for the info properties of PipeWire objects, which are
+ * replaced (and wrapped again) on every change, instead of being modified
+ * in place.
+ *
+ * \private
+ * \ingroup wpproperties
+ * \param dict a native `spa_dict` structure to wrap
+ * \returns (transfer full): the newly constructed properties set
+ */
+WpProperties *
+wp_properties_new_wrap_const_dict (const struct spa_dict * dict)
+{
+  WpProperties * self = wp_properties_new_wrap_dict (dict);
+  if (self)
+    self->flags |= FLAG_CONST_DICT;
+  return self;
+}
+
 /*!
  * \brief Constructs a new WpProperties that contains a copy of all the
  * properties contained in the given \a dict structure.
@@ -313,10 +452,23 @@ wp_properties_copy (WpProperties * other)
   return wp_properties_new_copy_dict (wp_properties_peek_dict (other));
 }
 
+static void
+wp_interned_dict_free (WpInternedDict * self)
+{
+  for (guint32 i = 0; i < self->dict.n_items; i++) {
+    g_ref_string_release ((gchar *) self->items[i].key);
+    g_ref_string_release ((gchar *) self->items[i].value);
+  }
+  g_free (self);
+}
+
 static void
 wp_properties_free (WpProperties * self)
 {
-  if (!(self->flags & FLAG_NO_OWNERSHIP))
+  wp_properties_invalidate_index (self);
+  if (self->flags & FLAG_INTERNED)
+    wp_interned_dict_free ((WpInternedDict *) self->dict);
+  else if (!(self->flags & FLAG_NO_OWNERSHIP))
     pw_properties_free (self->props);
   g_slice_free (WpProperties, self);
 }
@@ -393,7 +545,8 @@ wp_properties_update (WpProperties * self, WpProperties * props)
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_update (self->props, wp_properties_peek_dict (props));
+  return wp_properties_changed (self,
+      pw_properties_update (self->props, wp_properties_peek_dict (props)));
 }
 
 /*!
@@ -415,7 +568,8 @@ wp_properties_update_from_dict (WpProperties * self,
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_update (self->props, dict);
+  return wp_properties_changed (self,
+      pw_properties_update (self->props, dict));
 }
 
 /*!
@@ -436,8 +590,9 @@ wp_properties_update_from_json (WpProperties * self, const WpSpaJson * json)
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_update_string (self->props, wp_spa_json_get_data (json),
-      wp_spa_json_get_size (json));
+  return wp_properties_changed (self,
+      pw_properties_update_string (self->props, wp_spa_json_get_data (json),
+          wp_spa_json_get_size (json)));
 }
 
 /*!
@@ -459,7 +614,8 @@ wp_properties_add (WpProperties * self, WpProperties * props)
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_add (self->props, wp_properties_peek_dict (props));
+  return wp_properties_changed (self,
+      pw_properties_add (self->props, wp_properties_peek_dict (props)));
 }
 
 /*!
@@ -482,7 +638,8 @@ wp_properties_add_from_dict (WpProperties * self,
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_add (self->props, dict);
+  return wp_properties_changed (self,
+      pw_properties_add (self->props, dict));
 }
 
 /*!
@@ -573,8 +730,9 @@ wp_properties_update_keys_array (WpProperties * self, WpProperties * props,
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_update_keys (self->props,
-      wp_properties_peek_dict (props), keys);
+  return wp_properties_changed (self,
+      pw_properties_update_keys (self->props,
+          wp_properties_peek_dict (props), keys));
 }
 
 /*!
@@ -667,8 +825,9 @@ wp_properties_add_keys_array (WpProperties * self, WpProperties * props,
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_add_keys (self->props,
-      wp_properties_peek_dict (props), keys);
+  return wp_properties_changed (self,
+      pw_properties_add_keys (self->props,
+          wp_properties_peek_dict (props), keys));
 }
 
 /*!
@@ -686,7 +845,7 @@ wp_properties_get (WpProperties * self, const gchar * key)
   g_return_val_if_fail (self != NULL, NULL);
   g_return_val_if_fail (key != NULL, NULL);
 
-  return spa_dict_lookup (wp_properties_peek_dict (self), key);
+  return wp_properties_lookup (self, key);
 }
 
 /*!
@@ -712,7 +871,8 @@ wp_properties_set (WpProperties * self, const gchar * key,
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_set (self->props, key, value);
+  return wp_properties_changed (self,
+      pw_properties_set (self->props, key, value));
 }
 
 /*!
@@ -762,7 +922,8 @@ wp_properties_setf_valist (WpProperties * self, const gchar * key,
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
 
-  return pw_properties_setva (self->props, key, format, args);
+  return wp_properties_changed (self,
+      pw_properties_setva (self->props, key, format, args));
 }
 
 struct _WpPropertiesItem
@@ -850,6 +1011,7 @@ struct dict_iterator_data
 {
   WpProperties *properties;
   const struct spa_dict_item *item;
+  GPtrArray *batch;
 };
 
 static void
@@ -876,6 +1038,28 @@ dict_iterator_next (WpIterator *it, GValue *item)
   return FALSE;
 }
 
+static guint
+dict_iterator_next_batch (WpIterator *it, gpointer *items, guint max_items)
+{
+  struct dict_iterator_data *it_data = wp_iterator_get_user_data (it);
+  const struct spa_dict *dict = wp_properties_peek_dict (it_data->properties);
+  guint n = 0;
+
+  /* release the items of the previous batch */
+  if (!it_data->batch)
+    it_data->batch = g_ptr_array_new_full (max_items,
+        (GDestroyNotify) wp_properties_item_unref);
+  g_ptr_array_set_size (it_data->batch, 0);
+
+  while (n < max_items && (it_data->item - dict->items) < dict->n_items) {
+    WpPropertiesItem *pi = wp_properties_item_new (it_data->properties,
+        it_data->item++);
+    g_ptr_array_add (it_data->batch, pi);
+    items[n++] = pi;
+  }
+  return n;
+}
+
 static gboolean
 dict_iterator_fold (WpIterator *it, WpIteratorFoldFunc func, GValue *ret,
     gpointer data)
@@ -900,6 +1084,7 @@ static void
 dict_iterator_finalize (WpIterator *it)
 {
   struct dict_iterator_data *it_data = wp_iterator_get_user_data (it);
+  g_clear_pointer (&it_data->batch, g_ptr_array_unref);
   wp_properties_unref (it_data->properties);
 }
 
@@ -909,6 +1094,7 @@ static const WpIteratorMethods dict_iterator_methods = {
   .next = dict_iterator_next,
   .fold = dict_iterator_fold,
   .finalize = dict_iterator_finalize,
+  .next_batch = dict_iterator_next_batch,
 };
 
 /*!
@@ -965,7 +1151,8 @@ wp_properties_sort (WpProperties * self)
   g_return_if_fail (!(self->flags & FLAG_IS_DICT));
   g_return_if_fail (!(self->flags & FLAG_NO_OWNERSHIP));
 
-  return spa_dict_qsort (&self->props->dict);
+  wp_properties_invalidate_index (self);
+  spa_dict_qsort (&self->props->dict);
 }
 
 /*!
@@ -1058,3 +1245,74 @@ wp_properties_matches (WpProperties * self, WpProperties *other)
 
   return TRUE;
 }
+
+/*!
+ * \brief Converts \a self to an immutable properties set whose keys and
+ * values are shared with all other interned properties sets.
+ *
+ * Strings are stored in a global, reference-counted string table, so that
+ * identical keys and values (such as "media.class" or "Audio/Sink") are kept
+ * in memory only once, no matter how many properties sets contain them. This
+ * is meant for long-lived properties sets that are seldom modified, such as
+ * the properties of registry globals.
+ *
+ * Like the ones created with wp_properties_new_wrap_dict(), the returned
+ * properties set is immutable; use wp_properties_ensure_unique_owner()
+ * to get a modifiable copy.
+ *
+ * \ingroup wpproperties
+ * \param self (transfer full): a properties object
+ * \returns (transfer full): the interned properties set; this may be \a self
+ *   if it was already interned
+ * \since 0.5.9
+ */
+WpProperties *
+wp_properties_intern (WpProperties * self)
+{
+  g_autoptr (WpProperties) other = self;
+  const struct spa_dict *dict;
+  const struct spa_dict_item *item;
+  WpInternedDict *idict;
+  WpProperties *interned;
+  guint32 n = 0;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  if (self->flags & FLAG_INTERNED)
+    return g_steal_pointer (&other);
+
+  dict = wp_properties_peek_dict (self);
+  idict = g_malloc (sizeof (WpInternedDict) +
+      dict->n_items * sizeof (struct spa_dict_item));
+
+  spa_dict_for_each (item, dict) {
+    if (!item->key || !item->value)
+      continue;
+    idict->items[n].key = g_ref_string_new_intern (item->key);
+    idict->items[n].value = g_ref_string_new_intern (item->value);
+    n++;
+  }
+  idict->dict = SPA_DICT_INIT (idict->items, n);
+  idict->dict.flags = dict->flags & SPA_DICT_FLAG_SORTED;
+
+  interned = g_slice_new0 (WpProperties);
+  g_ref_count_init (&interned->ref);
+  interned->flags = FLAG_IS_DICT | FLAG_INTERNED;
+  interned->dict = &idict->dict;
+  return interned;
+}
+
+/*!
+ * \brief Checks whether \a self was created with wp_properties_intern()
+ *
+ * \ingroup wpproperties
+ * \param self a properties object
+ * \returns TRUE if the keys and values of \a self are interned
+ * \since 0.5.9
+ */
+gboolean
+wp_properties_is_interned (WpProperties * self)
+{
+  g_return_val_if_fail (self != NULL, FALSE);
+  return (self->flags & FLAG_INTERNED) != 0;
+}
@@ -59,6 +59,9 @@ WpProperties * wp_properties_new_wrap_dict (const struct spa_dict * dict);
 WP_API
 WpProperties * wp_properties_new_copy_dict (const struct spa_dict * dict);
 
+WP_PRIVATE_API
+WpProperties * wp_properties_new_wrap_const_dict (const struct spa_dict * dict);
+
 WP_API
 WpProperties * wp_properties_copy (WpProperties * other);
 
@@ -192,6 +195,14 @@ struct pw_properties * wp_properties_unref_and_take_pw_properties (
 WP_API
 gboolean wp_properties_matches (WpProperties * self, WpProperties *other);
 
+/* interning */
+
+WP_API
+WpProperties * wp_properties_intern (WpProperties * self);
+
+WP_API
+gboolean wp_properties_is_interned (WpProperties * self);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (WpProperties, wp_properties_unref)
 
 G_END_DECLS
@@ -1623,6 +1623,7 @@ struct _WpSpaJsonIterator
 {
   WpSpaJson *json;
   WpSpaJsonParser *parser;
+  GPtrArray *batch;
 };
 typedef struct _WpSpaJsonIterator WpSpaJsonIterator;
 
@@ -1634,10 +1635,8 @@ wp_spa_json_iterator_reset (WpIterator *iterator)
 }
 
 static gboolean
-wp_spa_json_iterator_next (WpIterator *iterator, GValue *item)
+wp_spa_json_iterator_advance (WpSpaJsonIterator *self)
 {
-  WpSpaJsonIterator *self = wp_iterator_get_user_data (iterator);
-
   /* init iterator if first time */
   if (!self->parser) {
     switch (self->json->json->cur[0]) {
@@ -1652,8 +1651,15 @@ wp_spa_json_iterator_next (WpIterator *iterator, GValue *item)
     }
   }
 
-  /* advance */
-  if (!wp_spa_json_parser_advance (self->parser))
+  return wp_spa_json_parser_advance (self->parser);
+}
+
+static gboolean
+wp_spa_json_iterator_next (WpIterator *iterator, GValue *item)
+{
+  WpSpaJsonIterator *self = wp_iterator_get_user_data (iterator);
+
+  if (!wp_spa_json_iterator_advance (self))
     return FALSE;
 
   if (item) {
@@ -1664,10 +1670,40 @@ wp_spa_json_iterator_next (WpIterator *iterator, GValue *item)
   return TRUE;
 }
 
+static guint
+wp_spa_json_iterator_next_batch (WpIterator *iterator, gpointer *items,
+    guint max_items)
+{
+  WpSpaJsonIterator *self = wp_iterator_get_user_data (iterator);
+  guint n = 0;
+
+  /* release the items of the previous batch */
+  if (!self->batch)
+    self->batch = g_ptr_array_new_full (max_items,
+        (GDestroyNotify) wp_spa_json_unref);
+  g_ptr_array_set_size (self->batch, 0);
+
+  while (n < max_items && wp_spa_json_iterator_advance (self)) {
+    /* unlike wp_spa_json_new_wrap(), keep a private copy of the parser
+       position, since the parser advances before the batch is consumed */
+    WpSpaJson *json = g_slice_new0 (WpSpaJson);
+    g_ref_count_init (&json->ref);
+    json->flags = FLAG_NO_OWNERSHIP;
+    json->json_data = self->parser->curr;
+    json->data = (gchar *) json->json_data.cur;
+    json->size = json->json_data.end - json->json_data.cur;
+    json->json = &json->json_data;
+    g_ptr_array_add (self->batch, json);
+    items[n++] = json;
+  }
+  return n;
+}
+
 static void
 wp_spa_json_iterator_finalize (WpIterator *iterator)
 {
   WpSpaJsonIterator *self = wp_iterator_get_user_data (iterator);
+  g_clear_pointer (&self->batch, g_ptr_array_unref);
   g_clear_pointer (&self->parser, wp_spa_json_parser_unref);
   g_clear_pointer (&self->json, wp_spa_json_unref);
 }
@@ -1688,13 +1724,15 @@ wp_spa_json_new_iterator (WpSpaJson *self)
     .next = wp_spa_json_iterator_next,
     .fold = NULL,
     .foreach = NULL,
-    .finalize = wp_spa_json_iterator_finalize
+    .finalize = wp_spa_json_iterator_finalize,
+    .next_batch = wp_spa_json_iterator_next_batch,
   };
   WpIterator *it = wp_iterator_new (&methods, sizeof (WpSpaJsonIterator));
   WpSpaJsonIterator *jit = wp_iterator_get_user_data (it);
 
   jit->json = wp_spa_json_ref (self);
   jit->parser = NULL;
+  jit->batch = NULL;
 
   return it;
 }
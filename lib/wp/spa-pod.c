@@ -30,6 +30,27 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-spa-pod")
 /*!
  * \struct WpSpaPodParser
  */
+/*!
+ * \struct WpSpaPodTemplate
+ *
+ * A WpSpaPodTemplate describes the shape of an object pod (its type, id and
+ * the keys and value types of its properties), resolved once from the type
+ * system, so that pods of that shape can be built repeatedly from new values
+ * without looking up names and, in the common case, without allocating.
+ *
+ * This is meant for parameters that are set at high rates, such as volumes
+ * that follow a UI slider:
+ * \code
+ * static const gchar *keys[] = { "mute", "channelVolumes", NULL };
+ * WpSpaPodTemplate *t = wp_spa_pod_template_new (
+ *     "Spa:Pod:Object:Param:Props", "Props", keys);
+ * ...
+ * wp_spa_pod_template_set_array (t, 1, n_channels, volumes);
+ * wp_pipewire_object_set_param (node, "Props", 0,
+ *     wp_spa_pod_template_build (t));
+ * \endcode
+ * \since 0.5.9
+ */
 
 enum {
   FLAG_NO_OWNERSHIP = (1 << 0),
@@ -3104,3 +3125,632 @@ wp_spa_pod_new_iterator (WpSpaPod *pod)
 
   return it;
 }
+
+typedef struct {
+  WpSpaIdValue idval;
+  const gchar *name;
+  guint32 key;
+  WpSpaType type;
+  WpSpaType item_type;
+  guint32 item_size;
+  gboolean is_set;
+  /* the value is a complete pod in data, set with _set_pod() */
+  gboolean is_raw;
+  union {
+    gboolean b;
+    guint32 id;
+    gint32 i;
+    gint64 l;
+    float f;
+    double d;
+  } value;
+  guint32 n_items;
+  /* array items, string or pod data; kept allocated between values */
+  GByteArray *data;
+} WpSpaPodTemplateField;
+
+struct _WpSpaPodTemplate
+{
+  WpSpaType type;
+  guint32 id;
+  GArray *fields;
+  /* the last built pod; its buffer is reused if nobody else holds it */
+  WpSpaPod *pod;
+};
+
+G_DEFINE_BOXED_TYPE (WpSpaPodTemplate, wp_spa_pod_template,
+    wp_spa_pod_template_ref, wp_spa_pod_template_unref)
+
+static void
+wp_spa_pod_template_field_clear (WpSpaPodTemplateField * field)
+{
+  g_clear_pointer (&field->data, g_byte_array_unref);
+}
+
+static guint32
+array_item_size (WpSpaType item_type)
+{
+  switch (item_type) {
+    case SPA_TYPE_Bool:
+    case SPA_TYPE_Id:
+    case SPA_TYPE_Int:
+    case SPA_TYPE_Float:
+      return 4;
+    case SPA_TYPE_Long:
+    case SPA_TYPE_Double:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+/*!
+ * \brief Compiles a template for object pods of the given type and id, with
+ * the given property keys
+ *
+ * \ingroup wpspapod
+ * \param type_name the type name of the object type
+ * \param id_name the Id name of the object
+ * \param keys (array zero-terminated=1): the short names of the properties
+ *   of the object, in the order that they will appear in the pod
+ * \returns (transfer full) (nullable): the new template, or NULL if the type,
+ *   id or any of the keys are not known
+ * \since 0.5.9
+ */
+WpSpaPodTemplate *
+wp_spa_pod_template_new (const gchar * type_name, const gchar * id_name,
+    const gchar * const * keys)
+{
+  g_autoptr (WpSpaPodTemplate) self = NULL;
+  WpSpaType type;
+  WpSpaIdTable table;
+  WpSpaIdValue id;
+
+  g_return_val_if_fail (type_name != NULL, NULL);
+  g_return_val_if_fail (id_name != NULL, NULL);
+  g_return_val_if_fail (keys != NULL, NULL);
+
+  /* the names may come from scripts, so unknown ones are not programming
+     errors; they are reported with a NULL return value */
+  type = wp_spa_type_from_name (type_name);
+  if (!wp_spa_type_is_object (type)) {
+    wp_debug ("'%s' is not an object type", type_name);
+    return NULL;
+  }
+
+  table = wp_spa_type_get_object_id_values_table (type);
+  id = table ? wp_spa_id_table_find_value_from_short_name (table, id_name) :
+      NULL;
+  if (!id) {
+    wp_debug ("unknown id '%s' for type '%s'", id_name, type_name);
+    return NULL;
+  }
+
+  self = g_rc_box_new0 (WpSpaPodTemplate);
+  self->type = type;
+  self->id = wp_spa_id_value_number (id);
+  self->fields = g_array_new (FALSE, TRUE, sizeof (WpSpaPodTemplateField));
+  g_array_set_clear_func (self->fields,
+      (GDestroyNotify) wp_spa_pod_template_field_clear);
+
+  table = wp_spa_type_get_values_table (type);
+  for (; *keys; keys++) {
+    WpSpaPodTemplateField field = {0};
+    WpSpaIdValue key = table ?
+        wp_spa_id_table_find_value_from_short_name (table, *keys) : NULL;
+
+    if (!key) {
+      wp_debug ("unknown property '%s' for type '%s'", *keys, type_name);
+      return NULL;
+    }
+
+    field.idval = key;
+    field.name = wp_spa_id_value_short_name (key);
+    field.key = wp_spa_id_value_number (key);
+    field.type = wp_spa_id_value_get_value_type (key, NULL);
+    if (field.type == SPA_TYPE_Array) {
+      field.item_type = wp_spa_id_value_array_get_item_type (key, NULL);
+      field.item_size = array_item_size (field.item_type);
+    }
+    g_array_append_val (self->fields, field);
+  }
+
+  return g_steal_pointer (&self);
+}
+
+/*!
+ * \brief Increases the reference count of a pod template
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \returns (transfer full): \a self with an additional reference count on it
+ * \since 0.5.9
+ */
+WpSpaPodTemplate *
+wp_spa_pod_template_ref (WpSpaPodTemplate * self)
+{
+  return (WpSpaPodTemplate *) g_rc_box_acquire ((gpointer) self);
+}
+
+static void
+wp_spa_pod_template_free (WpSpaPodTemplate * self)
+{
+  g_clear_pointer (&self->fields, g_array_unref);
+  g_clear_pointer (&self->pod, wp_spa_pod_unref);
+}
+
+/*!
+ * \brief Decreases the reference count on \a self and frees it when the ref
+ * count reaches zero.
+ *
+ * \ingroup wpspapod
+ * \param self (transfer full): a pod template
+ * \since 0.5.9
+ */
+void
+wp_spa_pod_template_unref (WpSpaPodTemplate * self)
+{
+  g_rc_box_release_full (self, (GDestroyNotify) wp_spa_pod_template_free);
+}
+
+/*!
+ * \brief Gets the number of properties (fields) of the template
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \returns the number of fields, as given by the keys in
+ *   wp_spa_pod_template_new()
+ * \since 0.5.9
+ */
+guint
+wp_spa_pod_template_get_n_fields (WpSpaPodTemplate * self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+  return self->fields->len;
+}
+
+/*!
+ * \brief Finds the index of the field with the given key
+ *
+ * Callers that set values at high rates should look up the indexes once and
+ * keep them, or rely on the order of the keys given to
+ * wp_spa_pod_template_new().
+ *
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param key the short name of a property of the template
+ * \returns the index of the field, or -1 if there is no such field
+ * \since 0.5.9
+ */
+gint
+wp_spa_pod_template_find_field (WpSpaPodTemplate * self, const gchar * key)
+{
+  g_return_val_if_fail (self != NULL, -1);
+  g_return_val_if_fail (key != NULL, -1);
+
+  for (guint i = 0; i < self->fields->len; i++) {
+    WpSpaPodTemplateField *f =
+        &g_array_index (self->fields, WpSpaPodTemplateField, i);
+    if (g_str_equal (f->name, key))
+      return i;
+  }
+  return -1;
+}
+
+/*!
+ * \brief Gets the value type of a field of the template
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \returns (transfer none): the type of the values that the field accepts
+ * \since 0.5.9
+ */
+WpSpaType
+wp_spa_pod_template_get_field_type (WpSpaPodTemplate * self, guint field)
+{
+  g_return_val_if_fail (self != NULL, WP_SPA_TYPE_INVALID);
+  g_return_val_if_fail (field < self->fields->len, WP_SPA_TYPE_INVALID);
+
+  return g_array_index (self->fields, WpSpaPodTemplateField, field).type;
+}
+
+/*!
+ * \brief Gets the key of a field of the template
+ *
+ * This can be used to find the table of the values of Id fields, with
+ * wp_spa_id_value_get_value_type() and wp_spa_id_value_array_get_item_type()
+ *
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \returns (transfer none): the key of the field
+ * \since 0.5.9
+ */
+WpSpaIdValue
+wp_spa_pod_template_get_field_key (WpSpaPodTemplate * self, guint field)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (field < self->fields->len, NULL);
+
+  return g_array_index (self->fields, WpSpaPodTemplateField, field).idval;
+}
+
+static WpSpaPodTemplateField *
+wp_spa_pod_template_get_field (WpSpaPodTemplate * self, guint field,
+    WpSpaType type)
+{
+  WpSpaPodTemplateField *f;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (field < self->fields->len, NULL);
+
+  f = &g_array_index (self->fields, WpSpaPodTemplateField, field);
+  if (type != WP_SPA_TYPE_INVALID && f->type != type) {
+    wp_critical ("field '%s' has type '%s', not '%s'", f->name,
+        wp_spa_type_name (f->type), wp_spa_type_name (type));
+    return NULL;
+  }
+  return f;
+}
+
+static void
+wp_spa_pod_template_field_set_data (WpSpaPodTemplateField * f,
+    gconstpointer data, guint size)
+{
+  if (!f->data)
+    f->data = g_byte_array_sized_new (size);
+  g_byte_array_set_size (f->data, 0);
+  g_byte_array_append (f->data, data, size);
+}
+
+/*!
+ * \brief Unsets the value of a field, so that it is omitted from the pods
+ * built afterwards
+ *
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \since 0.5.9
+ */
+void
+wp_spa_pod_template_unset (WpSpaPodTemplate * self, guint field)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, WP_SPA_TYPE_INVALID);
+  if (f)
+    f->is_set = FALSE;
+}
+
+/*!
+ * \brief Unsets the values of all fields
+ *
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \since 0.5.9
+ */
+void
+wp_spa_pod_template_clear (WpSpaPodTemplate * self)
+{
+  g_return_if_fail (self != NULL);
+
+  for (guint i = 0; i < self->fields->len; i++)
+    g_array_index (self->fields, WpSpaPodTemplateField, i).is_set = FALSE;
+}
+
+/*!
+ * \brief Sets the value of a boolean field
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param value the value
+ * \returns TRUE on success, FALSE if the field is not of type Bool
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_boolean (WpSpaPodTemplate * self, guint field,
+    gboolean value)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, SPA_TYPE_Bool);
+  if (!f)
+    return FALSE;
+  f->value.b = value;
+  f->is_raw = FALSE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Sets the value of an Id field
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param value the value
+ * \returns TRUE on success, FALSE if the field is not of type Id
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_id (WpSpaPodTemplate * self, guint field,
+    guint32 value)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, SPA_TYPE_Id);
+  if (!f)
+    return FALSE;
+  f->value.id = value;
+  f->is_raw = FALSE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Sets the value of an Int field
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param value the value
+ * \returns TRUE on success, FALSE if the field is not of type Int
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_int (WpSpaPodTemplate * self, guint field,
+    gint32 value)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, SPA_TYPE_Int);
+  if (!f)
+    return FALSE;
+  f->value.i = value;
+  f->is_raw = FALSE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Sets the value of a Long field
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param value the value
+ * \returns TRUE on success, FALSE if the field is not of type Long
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_long (WpSpaPodTemplate * self, guint field,
+    gint64 value)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, SPA_TYPE_Long);
+  if (!f)
+    return FALSE;
+  f->value.l = value;
+  f->is_raw = FALSE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Sets the value of a Float field
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param value the value
+ * \returns TRUE on success, FALSE if the field is not of type Float
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_float (WpSpaPodTemplate * self, guint field,
+    float value)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, SPA_TYPE_Float);
+  if (!f)
+    return FALSE;
+  f->value.f = value;
+  f->is_raw = FALSE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Sets the value of a Double field
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param value the value
+ * \returns TRUE on success, FALSE if the field is not of type Double
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_double (WpSpaPodTemplate * self, guint field,
+    double value)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, SPA_TYPE_Double);
+  if (!f)
+    return FALSE;
+  f->value.d = value;
+  f->is_raw = FALSE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Sets the value of a String field
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param value the value, which is copied
+ * \returns TRUE on success, FALSE if the field is not of type String
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_string (WpSpaPodTemplate * self, guint field,
+    const gchar * value)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, SPA_TYPE_String);
+  g_return_val_if_fail (value != NULL, FALSE);
+  if (!f)
+    return FALSE;
+  wp_spa_pod_template_field_set_data (f, value, strlen (value) + 1);
+  f->is_raw = FALSE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Sets the value of an Array field
+ *
+ * The items must be of the item type of the array, as defined by the type
+ * system (for instance, `float` for "channelVolumes" or `guint32` for
+ * "channelMap").
+ *
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param n_items the number of items in \a items
+ * \param items (array length=n_items): the items, which are copied
+ * \returns TRUE on success, FALSE if the field is not of type Array or its
+ *   item type is not known
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_array (WpSpaPodTemplate * self, guint field,
+    guint n_items, gconstpointer items)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, SPA_TYPE_Array);
+  g_return_val_if_fail (items != NULL || n_items == 0, FALSE);
+  if (!f)
+    return FALSE;
+  if (!f->item_size) {
+    wp_critical ("array field '%s' has an unsupported item type", f->name);
+    return FALSE;
+  }
+  wp_spa_pod_template_field_set_data (f, items, n_items * f->item_size);
+  f->n_items = n_items;
+  f->is_raw = FALSE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Sets the value of a field from an arbitrary pod
+ *
+ * This is mainly meant for fields that take an object or struct, such as the
+ * "props" of a Route, but it works with fields of any type. The pod is
+ * inserted as-is, without checking its type.
+ *
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \param field the index of the field
+ * \param pod the value, which is copied
+ * \returns TRUE on success
+ * \since 0.5.9
+ */
+gboolean
+wp_spa_pod_template_set_pod (WpSpaPodTemplate * self, guint field,
+    WpSpaPod * pod)
+{
+  WpSpaPodTemplateField *f =
+      wp_spa_pod_template_get_field (self, field, WP_SPA_TYPE_INVALID);
+  g_return_val_if_fail (pod != NULL, FALSE);
+  g_return_val_if_fail (pod->type == WP_SPA_POD_REGULAR, FALSE);
+  if (!f)
+    return FALSE;
+  wp_spa_pod_template_field_set_data (f, pod->pod, SPA_POD_SIZE (pod->pod));
+  f->is_raw = TRUE;
+  f->is_set = TRUE;
+  return TRUE;
+}
+
+/*!
+ * \brief Builds an object pod with the values that are currently set
+ *
+ * Fields that have no value are omitted. The pod's buffer is reused on the
+ * next call if the pod returned by the previous call has been released by
+ * then, which is the case when it is passed to
+ * wp_pipewire_object_set_param(), so there is no allocation in steady state.
+ *
+ * \ingroup wpspapod
+ * \param self a pod template
+ * \returns (transfer full): the object pod
+ * \since 0.5.9
+ */
+WpSpaPod *
+wp_spa_pod_template_build (WpSpaPodTemplate * self)
+{
+  WpSpaPodBuilder *builder;
+  struct spa_pod_builder_state state = {0};
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  /* the previous pod is still in use; build into a new buffer */
+  if (self->pod && !wp_spa_pod_is_unique_owner (self->pod))
+    g_clear_pointer (&self->pod, wp_spa_pod_unref);
+
+  if (!self->pod) {
+    self->pod = g_slice_new0 (WpSpaPod);
+    g_ref_count_init (&self->pod->ref);
+    self->pod->type = WP_SPA_POD_REGULAR;
+    self->pod->builder = wp_spa_pod_builder_new (
+        WP_SPA_POD_BUILDER_REALLOC_STEP_SIZE, self->type);
+    self->pod->static_pod.data_property.table =
+        wp_spa_type_get_values_table (self->type);
+  }
+
+  builder = self->pod->builder;
+  spa_pod_builder_reset (&builder->builder, &state);
+  spa_pod_builder_push_object (&builder->builder, &builder->frame, self->type,
+      self->id);
+
+  for (guint i = 0; i < self->fields->len; i++) {
+    WpSpaPodTemplateField *f =
+        &g_array_index (self->fields, WpSpaPodTemplateField, i);
+    struct spa_pod_builder *b = &builder->builder;
+
+    if (!f->is_set)
+      continue;
+
+    spa_pod_builder_prop (b, f->key, 0);
+
+    if (f->is_raw) {
+      spa_pod_builder_primitive (b, (const struct spa_pod *) f->data->data);
+      continue;
+    }
+
+    switch (f->type) {
+      case SPA_TYPE_Bool:
+        spa_pod_builder_bool (b, f->value.b);
+        break;
+      case SPA_TYPE_Id:
+        spa_pod_builder_id (b, f->value.id);
+        break;
+      case SPA_TYPE_Int:
+        spa_pod_builder_int (b, f->value.i);
+        break;
+      case SPA_TYPE_Long:
+        spa_pod_builder_long (b, f->value.l);
+        break;
+      case SPA_TYPE_Float:
+        spa_pod_builder_float (b, f->value.f);
+        break;
+      case SPA_TYPE_Double:
+        spa_pod_builder_double (b, f->value.d);
+        break;
+      case SPA_TYPE_String:
+        spa_pod_builder_string (b, (const gchar *) f->data->data);
+        break;
+      case SPA_TYPE_Array:
+        spa_pod_builder_array (b, f->item_size, f->item_type, f->n_items,
+            f->data->data);
+        break;
+      default:
+        g_warn_if_reached ();
+        spa_pod_builder_none (b);
+        break;
+    }
+  }
+
+  self->pod->pod = spa_pod_builder_pop (&builder->builder, &builder->frame);
+  return wp_spa_pod_ref (self->pod);
+}
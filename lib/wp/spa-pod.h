@@ -475,6 +475,90 @@ void wp_spa_pod_parser_end (WpSpaPodParser *self);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (WpSpaPodParser, wp_spa_pod_parser_unref)
 
+/* templates */
+
+/*!
+ * \brief The WpSpaPodTemplate GType
+ * \ingroup wpspapod
+ */
+#define WP_TYPE_SPA_POD_TEMPLATE (wp_spa_pod_template_get_type ())
+WP_API
+GType wp_spa_pod_template_get_type (void);
+
+typedef struct _WpSpaPodTemplate WpSpaPodTemplate;
+
+WP_API
+WpSpaPodTemplate *wp_spa_pod_template_new (const gchar * type_name,
+    const gchar * id_name, const gchar * const * keys);
+
+WP_API
+WpSpaPodTemplate *wp_spa_pod_template_ref (WpSpaPodTemplate *self);
+
+WP_API
+void wp_spa_pod_template_unref (WpSpaPodTemplate *self);
+
+WP_API
+guint wp_spa_pod_template_get_n_fields (WpSpaPodTemplate *self);
+
+WP_API
+gint wp_spa_pod_template_find_field (WpSpaPodTemplate *self,
+    const gchar * key);
+
+WP_API
+WpSpaType wp_spa_pod_template_get_field_type (WpSpaPodTemplate *self,
+    guint field);
+
+WP_API
+WpSpaIdValue wp_spa_pod_template_get_field_key (WpSpaPodTemplate *self,
+    guint field);
+
+WP_API
+void wp_spa_pod_template_unset (WpSpaPodTemplate *self, guint field);
+
+WP_API
+void wp_spa_pod_template_clear (WpSpaPodTemplate *self);
+
+WP_API
+gboolean wp_spa_pod_template_set_boolean (WpSpaPodTemplate *self, guint field,
+    gboolean value);
+
+WP_API
+gboolean wp_spa_pod_template_set_id (WpSpaPodTemplate *self, guint field,
+    guint32 value);
+
+WP_API
+gboolean wp_spa_pod_template_set_int (WpSpaPodTemplate *self, guint field,
+    gint32 value);
+
+WP_API
+gboolean wp_spa_pod_template_set_long (WpSpaPodTemplate *self, guint field,
+    gint64 value);
+
+WP_API
+gboolean wp_spa_pod_template_set_float (WpSpaPodTemplate *self, guint field,
+    float value);
+
+WP_API
+gboolean wp_spa_pod_template_set_double (WpSpaPodTemplate *self, guint field,
+    double value);
+
+WP_API
+gboolean wp_spa_pod_template_set_string (WpSpaPodTemplate *self, guint field,
+    const gchar * value);
+
+WP_API
+gboolean wp_spa_pod_template_set_array (WpSpaPodTemplate *self, guint field,
+    guint n_items, gconstpointer items);
+
+WP_API
+gboolean wp_spa_pod_template_set_pod (WpSpaPodTemplate *self, guint field,
+    WpSpaPod *pod);
+
+WP_API
+WpSpaPod *wp_spa_pod_template_build (WpSpaPodTemplate *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (WpSpaPodTemplate, wp_spa_pod_template_unref)
+
 
 G_END_DECLS
 
@@ -57,6 +57,21 @@ typedef struct {
   const struct spa_type_info *values;
 } WpSpaIdTableInfo;
 
+typedef struct {
+  GHashTable *by_number;
+  GHashTable *by_name;
+  GHashTable *by_short_name;
+} WpSpaIdTableIndex;
+
+/* Hash indexes over the type tree and the id tables, so that lookups do not
+   need to walk the tables with strcmp(). They are built lazily, the types and
+   id table names ones are dropped when new types or tables are registered */
+static GMutex index_lock;
+static GHashTable *types_by_number = NULL;
+static GHashTable *types_by_name = NULL;
+static GHashTable *id_tables_by_name = NULL;
+static GHashTable *id_table_indexes = NULL;
+
 static const WpSpaIdTableInfo static_id_tables[] = {
   { SPA_TYPE_INFO_Choice, spa_type_choice },
   { SPA_TYPE_INFO_Direction, spa_type_direction },
@@ -97,6 +112,50 @@ G_DEFINE_POINTER_TYPE (WpSpaIdTable, wp_spa_id_table)
 G_DEFINE_POINTER_TYPE (WpSpaIdValue, wp_spa_id_value)
 
 
+static inline void
+index_insert (GHashTable *index, gconstpointer key, gconstpointer value)
+{
+  /* the first match wins, like when walking the tables */
+  if (!g_hash_table_contains (index, key))
+    g_hash_table_insert (index, (gpointer) key, (gpointer) value);
+}
+
+/* indexes the types in the same order that spa_debug_type_find() walks them;
+   entries with an invalid type are not types, but lists of more types */
+static void
+index_types (const struct spa_type_info * info)
+{
+  for (; info && info->name; info++) {
+    if (info->type == SPA_ID_INVALID) {
+      if (info->values)
+        index_types (info->values);
+    } else {
+      index_insert (types_by_number, GUINT_TO_POINTER (info->type), info);
+    }
+    index_insert (types_by_name, info->name, info);
+  }
+}
+
+static void
+ensure_types_index_unlocked (void)
+{
+  if (types_by_number)
+    return;
+
+  types_by_number = g_hash_table_new (g_direct_hash, g_direct_equal);
+  types_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+  index_types (extra_types ?
+      (const struct spa_type_info *) extra_types->data : SPA_TYPE_ROOT);
+}
+
+static void
+clear_types_index_unlocked (void)
+{
+  g_clear_pointer (&types_by_number, g_hash_table_unref);
+  g_clear_pointer (&types_by_name, g_hash_table_unref);
+  g_clear_pointer (&id_tables_by_name, g_hash_table_unref);
+}
+
 static const struct spa_type_info *
 wp_spa_type_info_find_by_type (WpSpaType type)
 {
@@ -105,46 +164,25 @@ wp_spa_type_info_find_by_type (WpSpaType type)
   g_return_val_if_fail (type != WP_SPA_TYPE_INVALID, NULL);
   g_return_val_if_fail (type != 0, NULL);
 
-  if (extra_types)
-    info = spa_debug_type_find (
-        (const struct spa_type_info *) extra_types->data, type);
-  else
-    info = spa_debug_type_find (SPA_TYPE_ROOT, type);
+  g_mutex_lock (&index_lock);
+  ensure_types_index_unlocked ();
+  info = g_hash_table_lookup (types_by_number, GUINT_TO_POINTER (type));
+  g_mutex_unlock (&index_lock);
 
   return info;
 }
 
-/* similar to spa_debug_type_find() and unlike spa_debug_type_find_type(),
-   which steps into id values / object fields */
-static const struct spa_type_info *
-_spa_type_find_by_name (const struct spa_type_info * info, const char * name)
-{
-  const struct spa_type_info * res;
-
-  while (info->name) {
-    if (info->type == SPA_ID_INVALID) {
-      if (info->values && (res = _spa_type_find_by_name (info->values, name)))
-        return res;
-    }
-    if (strcmp (info->name, name) == 0)
-      return info;
-    info++;
-  }
-  return NULL;
-}
-
 static const struct spa_type_info *
 wp_spa_type_info_find_by_name (const gchar *name)
 {
-  const struct spa_type_info *info = NULL;
+  const struct spa_type_info *info;
 
   g_return_val_if_fail (name != NULL, NULL);
 
-  if (extra_types)
-    info = _spa_type_find_by_name (
-        (const struct spa_type_info *) extra_types->data, name);
-  else
-    info = _spa_type_find_by_name (SPA_TYPE_ROOT, name);
+  g_mutex_lock (&index_lock);
+  ensure_types_index_unlocked ();
+  info = g_hash_table_lookup (types_by_name, name);
+  g_mutex_unlock (&index_lock);
 
   return info;
 }
@@ -350,30 +388,33 @@ static const WpIteratorMethods spa_type_info_iterator_methods = {
 WpSpaIdTable
 wp_spa_id_table_from_name (const gchar *name)
 {
+  const WpSpaIdTableInfo *info;
+  WpSpaIdTable table;
+
   g_return_val_if_fail (name != NULL, NULL);
-  const WpSpaIdTableInfo *info = NULL;
-
-  /* first look in dynamic id tables */
-  if (extra_id_tables) {
-    info = (const WpSpaIdTableInfo *) extra_id_tables->data;
-    while (info && info->name) {
-      if (strcmp (info->name, name) == 0)
-        return info->values;
-      info++;
-    }
-  }
 
-  /* then look at the well-known static ones */
-  info = static_id_tables;
-  while (info && info->name) {
-    if (strcmp (info->name, name) == 0)
-      return info->values;
-    info++;
+  g_mutex_lock (&index_lock);
+  if (!id_tables_by_name) {
+    id_tables_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+
+    /* dynamic id tables take precedence over the well-known static ones */
+    if (extra_id_tables) {
+      for (info = (const WpSpaIdTableInfo *) extra_id_tables->data;
+           info->name; info++)
+        index_insert (id_tables_by_name, info->name, info->values);
+    }
+    for (info = static_id_tables; info->name; info++)
+      index_insert (id_tables_by_name, info->name, info->values);
   }
+  table = g_hash_table_lookup (id_tables_by_name, name);
+  g_mutex_unlock (&index_lock);
 
   /* then look into types, hoping to find an object type */
-  const struct spa_type_info *tinfo = wp_spa_type_info_find_by_name (name);
-  return tinfo ? tinfo->values : NULL;
+  if (!table) {
+    const struct spa_type_info *tinfo = wp_spa_type_info_find_by_name (name);
+    table = tinfo ? tinfo->values : NULL;
+  }
+  return table;
 }
 
 /*!
@@ -399,6 +440,47 @@ wp_spa_id_table_new_iterator (WpSpaIdTable table)
   return it;
 }
 
+static void
+wp_spa_id_table_index_free (WpSpaIdTableIndex * self)
+{
+  g_hash_table_unref (self->by_number);
+  g_hash_table_unref (self->by_name);
+  g_hash_table_unref (self->by_short_name);
+  g_slice_free (WpSpaIdTableIndex, self);
+}
+
+/* id tables are static arrays that never change once they are known,
+   so their indexes are kept until wp_spa_dynamic_type_deinit() */
+static WpSpaIdTableIndex *
+ensure_id_table_index_unlocked (WpSpaIdTable table)
+{
+  WpSpaIdTableIndex *index;
+  const struct spa_type_info *info;
+
+  if (!id_table_indexes)
+    id_table_indexes = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify) wp_spa_id_table_index_free);
+
+  index = g_hash_table_lookup (id_table_indexes, table);
+  if (index)
+    return index;
+
+  index = g_slice_new0 (WpSpaIdTableIndex);
+  index->by_number = g_hash_table_new (g_direct_hash, g_direct_equal);
+  index->by_name = g_hash_table_new (g_str_hash, g_str_equal);
+  index->by_short_name = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (info = table; info->name; info++) {
+    index_insert (index->by_number, GUINT_TO_POINTER (info->type), info);
+    index_insert (index->by_name, info->name, info);
+    index_insert (index->by_short_name,
+        spa_debug_type_short_name (info->name), info);
+  }
+
+  g_hash_table_insert (id_table_indexes, (gpointer) table, index);
+  return index;
+}
+
 /*!
  * \brief Finds a value in an SPA Id table
  *
@@ -410,15 +492,15 @@ wp_spa_id_table_new_iterator (WpSpaIdTable table)
 WpSpaIdValue
 wp_spa_id_table_find_value (WpSpaIdTable table, guint value)
 {
+  WpSpaIdValue ret;
+
   g_return_val_if_fail (table != NULL, NULL);
 
-  const struct spa_type_info *info = table;
-  while (info && info->name) {
-    if (info->type == value)
-      return info;
-    info++;
-  }
-  return NULL;
+  g_mutex_lock (&index_lock);
+  ret = g_hash_table_lookup (ensure_id_table_index_unlocked (table)->by_number,
+      GUINT_TO_POINTER (value));
+  g_mutex_unlock (&index_lock);
+  return ret;
 }
 
 /*!
@@ -432,15 +514,15 @@ wp_spa_id_table_find_value (WpSpaIdTable table, guint value)
 WpSpaIdValue
 wp_spa_id_table_find_value_from_name (WpSpaIdTable table, const gchar * name)
 {
+  WpSpaIdValue ret;
+
   g_return_val_if_fail (table != NULL, NULL);
 
-  const struct spa_type_info *info = table;
-  while (info && info->name) {
-    if (!strcmp (info->name, name))
-      return info;
-    info++;
-  }
-  return NULL;
+  g_mutex_lock (&index_lock);
+  ret = g_hash_table_lookup (ensure_id_table_index_unlocked (table)->by_name,
+      name);
+  g_mutex_unlock (&index_lock);
+  return ret;
 }
 
 /*!
@@ -455,15 +537,15 @@ WpSpaIdValue
 wp_spa_id_table_find_value_from_short_name (WpSpaIdTable table,
     const gchar * short_name)
 {
+  WpSpaIdValue ret;
+
   g_return_val_if_fail (table != NULL, NULL);
 
-  const struct spa_type_info *info = table;
-  while (info && info->name) {
-    if (!strcmp (spa_debug_type_short_name (info->name), short_name))
-      return info;
-    info++;
-  }
-  return NULL;
+  g_mutex_lock (&index_lock);
+  ret = g_hash_table_lookup (
+      ensure_id_table_index_unlocked (table)->by_short_name, short_name);
+  g_mutex_unlock (&index_lock);
+  return ret;
 }
 
 static WpSpaIdTable
@@ -681,6 +763,11 @@ wp_spa_dynamic_type_init (void)
       SPA_ID_INVALID, SPA_ID_INVALID, "spa_types", SPA_TYPE_ROOT
   };
   g_array_append_val (extra_types, info);
+
+  g_mutex_lock (&index_lock);
+  clear_types_index_unlocked ();
+  ensure_types_index_unlocked ();
+  g_mutex_unlock (&index_lock);
 }
 
 /*!
@@ -695,6 +782,11 @@ wp_spa_dynamic_type_init (void)
 void
 wp_spa_dynamic_type_deinit (void)
 {
+  g_mutex_lock (&index_lock);
+  clear_types_index_unlocked ();
+  g_clear_pointer (&id_table_indexes, g_hash_table_unref);
+  g_mutex_unlock (&index_lock);
+
   g_clear_pointer (&extra_types, g_array_unref);
   g_clear_pointer (&extra_id_tables, g_array_unref);
 }
@@ -725,6 +817,12 @@ wp_spa_dynamic_type_register (const gchar *name, WpSpaType parent,
   info.parent = parent;
   info.values = values;
   g_array_append_val (extra_types, info);
+
+  /* the array may have been reallocated, so re-index everything */
+  g_mutex_lock (&index_lock);
+  clear_types_index_unlocked ();
+  g_mutex_unlock (&index_lock);
+
   return info.type;
 }
 
@@ -750,5 +848,10 @@ wp_spa_dynamic_id_table_register (const gchar *name,
   info.name = name;
   info.values = values;
   g_array_append_val (extra_id_tables, info);
+
+  g_mutex_lock (&index_lock);
+  g_clear_pointer (&id_tables_by_name, g_hash_table_unref);
+  g_mutex_unlock (&index_lock);
+
   return values;
 }
@@ -18,6 +18,11 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-state")
 #define DEFAULT_TIMEOUT_MS 1000
 #define ESCAPED_CHARACTER '\\'
 
+/* totals of all the state files; written from any thread */
+static GMutex total_save_lock;
+static guint64 total_n_saves;
+static guint64 total_n_bytes;
+
 static char *
 escape_string (const gchar *str)
 {
@@ -138,6 +143,16 @@ struct _WpState
   gchar *location;
   GSource *timeout_source;
   WpProperties *timeout_props;
+
+  /* writes may happen in a worker thread; the lock serializes them and
+     protects the fields below */
+  GMutex save_lock;
+  guint64 save_seq;  /* the last snapshot taken, only used in the caller */
+  guint64 saved_seq; /* the last snapshot written */
+  guint n_saves;
+  gsize last_save_size;
+  gint64 last_save_duration;
+  gint64 max_save_duration;
 };
 
 G_DEFINE_TYPE (WpState, wp_state, G_TYPE_OBJECT)
@@ -227,6 +242,7 @@ wp_state_finalize (GObject * object)
   g_clear_pointer (&self->location, g_free);
   g_clear_pointer (&self->timeout_source, g_source_unref);
   g_clear_pointer (&self->timeout_props, wp_properties_unref);
+  g_mutex_clear (&self->save_lock);
 
   G_OBJECT_CLASS (wp_state_parent_class)->finalize (object);
 }
@@ -235,6 +251,7 @@ static void
 wp_state_init (WpState * self)
 {
   self->timeout = DEFAULT_TIMEOUT_MS;
+  g_mutex_init (&self->save_lock);
 }
 
 static void
@@ -311,31 +328,36 @@ wp_state_clear (WpState *self)
 {
   g_return_if_fail (WP_IS_STATE (self));
   wp_state_ensure_location (self);
+
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&self->save_lock);
+
+  /* discard any snapshot that is still waiting to be written */
+  self->saved_seq = self->save_seq;
+
   if (remove (self->location) < 0)
     wp_warning ("failed to remove %s: %s", self->location, g_strerror (errno));
 }
 
-/*!
- * \brief Saves new properties in the state, overwriting all previous data.
- * \ingroup wpstate
- * \param self the state
- * \param props (transfer none): the properties to save
- * \param error (out)(optional): return location for a GError, or NULL
- * \returns TRUE if the properties could be saved, FALSE otherwise
- */
-gboolean
-wp_state_save (WpState *self, WpProperties *props, GError ** error)
+/* Writes a snapshot of the state; this can be called from any thread */
+static gboolean
+wp_state_write (WpState *self, WpProperties *props, guint64 seq,
+    GError ** error)
 {
-  g_autoptr (GKeyFile) keyfile = g_key_file_new ();
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&self->save_lock);
+  g_autoptr (GKeyFile) keyfile = NULL;
   g_autoptr (WpIterator) it = NULL;
   g_auto (GValue) item = G_VALUE_INIT;
+  g_autofree gchar *data = NULL;
+  gsize size = 0;
+  gint64 start, duration;
   GError *err = NULL;
 
-  g_return_val_if_fail (WP_IS_STATE (self), FALSE);
-  g_return_val_if_fail (props, FALSE);
-  wp_state_ensure_location (self);
+  /* a newer snapshot has already been written */
+  if (seq <= self->saved_seq)
+    return TRUE;
 
-  wp_info_object (self, "saving state into %s", self->location);
+  start = g_get_monotonic_time ();
+  keyfile = g_key_file_new ();
 
   /* Set the properties */
   for (it = wp_properties_new_iterator (props);
@@ -349,21 +371,200 @@ wp_state_save (WpState *self, WpProperties *props, GError ** error)
       g_key_file_set_string (keyfile, self->name, escaped_key, val);
   }
 
-  if (!g_key_file_save_to_file (keyfile, self->location, &err)) {
+  data = g_key_file_to_data (keyfile, &size, NULL);
+  if (!g_file_set_contents (self->location, data, size, &err)) {
     g_propagate_prefixed_error (error, err, "could not save %s: ", self->name);
     return FALSE;
   }
 
+  duration = g_get_monotonic_time () - start;
+  self->saved_seq = seq;
+  self->n_saves++;
+  self->last_save_size = size;
+  self->last_save_duration = duration;
+  self->max_save_duration = MAX (self->max_save_duration, duration);
+
+  g_mutex_lock (&total_save_lock);
+  total_n_saves++;
+  total_n_bytes += size;
+  g_mutex_unlock (&total_save_lock);
+
   return TRUE;
 }
 
-static gboolean
-timeout_save_state_callback (WpState *self)
+/*!
+ * \brief Saves new properties in the state, overwriting all previous data.
+ * \ingroup wpstate
+ * \param self the state
+ * \param props (transfer none): the properties to save
+ * \param error (out)(optional): return location for a GError, or NULL
+ * \returns TRUE if the properties could be saved, FALSE otherwise
+ */
+gboolean
+wp_state_save (WpState *self, WpProperties *props, GError ** error)
+{
+  g_return_val_if_fail (WP_IS_STATE (self), FALSE);
+  g_return_val_if_fail (props, FALSE);
+  wp_state_ensure_location (self);
+
+  wp_info_object (self, "saving state into %s", self->location);
+
+  return wp_state_write (self, props, ++self->save_seq, error);
+}
+
+typedef struct _SaveData SaveData;
+struct _SaveData
+{
+  WpProperties *props;
+  guint64 seq;
+};
+
+static void
+save_data_free (SaveData * data)
+{
+  g_clear_pointer (&data->props, wp_properties_unref);
+  g_free (data);
+}
+
+static void
+save_in_thread (GTask * task, WpState * self, SaveData * data,
+    GCancellable * cancellable)
+{
+  GError *error = NULL;
+
+  if (wp_state_write (self, data->props, data->seq, &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+}
+
+/*!
+ * \brief Saves new properties in the state, overwriting all previous data,
+ *   without blocking the caller
+ *
+ * The properties are copied before this function returns. The state file is
+ * then serialized and written in a worker thread, so that slow storage does
+ * not stall the main loop. \a callback is called in the thread-default main
+ * context of the caller when the write is done.
+ *
+ * Writes happen in the order of the calls. If a newer save has already been
+ * written when an older one gets its turn, the older one is skipped and
+ * reported as successful.
+ *
+ * \ingroup wpstate
+ * \since 0.5.9
+ * \param self the state
+ * \param props (transfer none): the properties to save
+ * \param cancellable (nullable): a GCancellable
+ * \param callback (scope async): a callback to call when the state is saved
+ * \param user_data data to pass to \a callback
+ */
+void
+wp_state_save_async (WpState *self, WpProperties *props,
+    GCancellable * cancellable, GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  g_autoptr (GTask) task = NULL;
+  SaveData *data;
+
+  g_return_if_fail (WP_IS_STATE (self));
+  g_return_if_fail (props);
+  wp_state_ensure_location (self);
+
+  wp_info_object (self, "saving state into %s", self->location);
+
+  /* take the snapshot in the caller's thread */
+  data = g_new0 (SaveData, 1);
+  data->props = wp_properties_copy (props);
+  data->seq = ++self->save_seq;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, wp_state_save_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) save_data_free);
+  g_task_run_in_thread (task, (GTaskThreadFunc) save_in_thread);
+}
+
+/*!
+ * \brief Finishes an operation started by wp_state_save_async()
+ * \ingroup wpstate
+ * \since 0.5.9
+ * \param self the state
+ * \param res the async result
+ * \param error (out)(optional): return location for a GError, or NULL
+ * \returns TRUE if the properties could be saved, FALSE otherwise
+ */
+gboolean
+wp_state_save_finish (WpState *self, GAsyncResult * res, GError ** error)
+{
+  g_return_val_if_fail (WP_IS_STATE (self), FALSE);
+  g_return_val_if_fail (g_task_is_valid (res, self), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/*!
+ * \brief Gets statistics about the writes of the state file
+ * \ingroup wpstate
+ * \since 0.5.9
+ * \param self the state
+ * \param n_saves (out)(optional): the number of times the file was written
+ * \param last_size (out)(optional): the size in bytes of the last write
+ * \param last_duration (out)(optional): the time in microseconds that it took
+ *   to serialize and write the file the last time
+ * \param max_duration (out)(optional): the longest time in microseconds that
+ *   it took to serialize and write the file
+ */
+void
+wp_state_get_save_stats (WpState *self, guint *n_saves, gsize *last_size,
+    gint64 *last_duration, gint64 *max_duration)
+{
+  g_return_if_fail (WP_IS_STATE (self));
+
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&self->save_lock);
+  if (n_saves)
+    *n_saves = self->n_saves;
+  if (last_size)
+    *last_size = self->last_save_size;
+  if (last_duration)
+    *last_duration = self->last_save_duration;
+  if (max_duration)
+    *max_duration = self->max_save_duration;
+}
+
+/*!
+ * \brief Gets statistics about the writes of all the state files of the
+ *   process
+ * \ingroup wpstate
+ * \since 0.5.9
+ * \param n_saves (out)(optional): the number of times any state file was
+ *   written
+ * \param n_bytes (out)(optional): the total number of bytes written
+ */
+void
+wp_state_get_total_save_stats (guint64 *n_saves, guint64 *n_bytes)
+{
+  g_mutex_lock (&total_save_lock);
+  if (n_saves)
+    *n_saves = total_n_saves;
+  if (n_bytes)
+    *n_bytes = total_n_bytes;
+  g_mutex_unlock (&total_save_lock);
+}
+
+static void
+on_timeout_save_done (WpState *self, GAsyncResult *res, gpointer data)
 {
   g_autoptr (GError) error = NULL;
 
-  if (!wp_state_save (self, self->timeout_props, &error))
+  if (!wp_state_save_finish (self, res, &error))
     wp_warning_object (self, "%s", error->message);
+}
+
+static gboolean
+timeout_save_state_callback (WpState *self)
+{
+  wp_state_save_async (self, self->timeout_props, NULL,
+      (GAsyncReadyCallback) on_timeout_save_done, NULL);
 
   g_clear_pointer (&self->timeout_source, g_source_unref);
   g_clear_pointer (&self->timeout_props, wp_properties_unref);
@@ -384,6 +585,9 @@ timeout_save_state_callback (WpState *self)
  * it will cancel the previous timer and start a new one, resulting in timing
  * out only after the last call.
  *
+ * Since 0.5.9, the file is written in a worker thread when the timeout
+ * elapses, as with wp_state_save_async().
+ *
  * \ingroup wpstate
  * \param self the state
  * \param core the core, used to add the timeout callback to the main loop
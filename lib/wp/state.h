@@ -39,10 +39,26 @@ void wp_state_clear (WpState *self);
 WP_API
 gboolean wp_state_save (WpState *self, WpProperties *props, GError ** error);
 
+WP_API
+void wp_state_save_async (WpState *self, WpProperties *props,
+    GCancellable * cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+
+WP_API
+gboolean wp_state_save_finish (WpState *self, GAsyncResult * res,
+    GError ** error);
+
 WP_API
 void wp_state_save_after_timeout (WpState *self, WpCore *core,
     WpProperties *props);
 
+WP_API
+void wp_state_get_save_stats (WpState *self, guint *n_saves, gsize *last_size,
+    gint64 *last_duration, gint64 *max_duration);
+
+WP_API
+void wp_state_get_total_save_stats (guint64 *n_saves, guint64 *n_bytes);
+
 WP_API
 WpProperties * wp_state_load (WpState *self);
 
@@ -0,0 +1,599 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <wp/wp.h>
+#include <spa/utils/defs.h>
+#include <pipewire/keys.h>
+
+WP_DEFINE_LOCAL_LOG_TOPIC ("m-graph-index")
+
+/*
+ * This module maintains an index of the session graph, so that the linking
+ * scripts can answer questions like "is this item linked?", "which items
+ * is it linked to?" or "which items are in this link group?" without
+ * iterating over all the session items and links and reading their
+ * properties.
+ *
+ * The index is updated incrementally from the object-added / object-removed
+ * signals of an object manager that watches:
+ *  - SiLink session items: item id -> links & peer items
+ *  - SiLinkable session items of the node factories: id -> direction &
+ *    link group, link group -> member items
+ *  - PipeWire links: node id -> peer node ids
+ *
+ * On top of that, it caches the result of the link-group check of canLink()
+ * per (link group, target item). The cache is invalidated as a whole with a
+ * version stamp that changes every time a SiLink or a linkable is added or
+ * removed, since these are the only inputs of the check.
+ */
+
+typedef struct _ItemEntry ItemEntry;
+struct _ItemEntry
+{
+  guint32 id;
+  gchar *direction;
+  gchar *link_group;
+  guint32 node_id;
+};
+
+typedef struct _LinkEntry LinkEntry;
+struct _LinkEntry
+{
+  guint32 id;
+  guint32 out_id;
+  guint32 in_id;
+  /* borrowed; the entry is removed before the link is destroyed */
+  WpSiLink *link;
+};
+
+typedef struct _ReachKey ReachKey;
+struct _ReachKey
+{
+  guint32 target_id;
+  gchar *link_group;
+};
+
+typedef struct _NodeLinkEntry NodeLinkEntry;
+struct _NodeLinkEntry
+{
+  guint32 out_node;
+  guint32 in_node;
+};
+
+struct _WpGraphIndex
+{
+  WpPlugin parent;
+  WpObjectManager *om;
+
+  /* si id -> ItemEntry, for the linkables of the node factories */
+  GHashTable *items;
+  /* link group -> GPtrArray of ItemEntry */
+  GHashTable *link_groups;
+  /* si link id -> LinkEntry */
+  GHashTable *links;
+  /* si id -> GPtrArray of LinkEntry, for both the out & in side */
+  GHashTable *item_links;
+  /* WpLink -> NodeLinkEntry */
+  GHashTable *node_links;
+  /* node id -> GArray of guint32 peer node ids, one for each pw link */
+  GHashTable *node_peers;
+
+  /* bumped on every change of the SiLinks or the linkables */
+  guint64 version;
+  /* ReachKey -> result of the link group check; valid for reach_version */
+  GHashTable *reach_cache;
+  guint64 reach_version;
+};
+
+enum {
+  ACTION_LOOKUP_LINK,
+  ACTION_GET_LINK,
+  ACTION_GET_LINK_PEERS,
+  ACTION_GET_ITEM_INFO,
+  ACTION_GET_LINK_GROUP_MEMBERS,
+  ACTION_GET_NODE_PEER,
+  ACTION_CAN_LINK_GROUP,
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = {0};
+
+G_DECLARE_FINAL_TYPE (WpGraphIndex, wp_graph_index, WP, GRAPH_INDEX, WpPlugin)
+G_DEFINE_TYPE (WpGraphIndex, wp_graph_index, WP_TYPE_PLUGIN)
+
+static void
+item_entry_free (ItemEntry * e)
+{
+  g_free (e->direction);
+  g_free (e->link_group);
+  g_slice_free (ItemEntry, e);
+}
+
+static void
+link_entry_free (LinkEntry * e)
+{
+  g_slice_free (LinkEntry, e);
+}
+
+static void
+node_link_entry_free (NodeLinkEntry * e)
+{
+  g_slice_free (NodeLinkEntry, e);
+}
+
+static guint
+reach_key_hash (gconstpointer p)
+{
+  const ReachKey *k = p;
+  return g_str_hash (k->link_group) * 31 + k->target_id;
+}
+
+static gboolean
+reach_key_equal (gconstpointer a, gconstpointer b)
+{
+  const ReachKey *ka = a, *kb = b;
+  return ka->target_id == kb->target_id &&
+      g_str_equal (ka->link_group, kb->link_group);
+}
+
+static void
+reach_key_free (ReachKey * k)
+{
+  g_free (k->link_group);
+  g_slice_free (ReachKey, k);
+}
+
+static guint32
+parse_id (const gchar * str)
+{
+  guint64 val;
+  if (!str || !g_ascii_string_to_unsigned (str, 10, 0, G_MAXUINT32, &val, NULL))
+    return SPA_ID_INVALID;
+  return val;
+}
+
+static void
+wp_graph_index_init (WpGraphIndex * self)
+{
+}
+
+/* multimap helpers: key -> GPtrArray */
+
+static void
+multimap_add (GHashTable * map, gpointer key, GBoxedCopyFunc key_copy,
+    gpointer value)
+{
+  GPtrArray *arr = g_hash_table_lookup (map, key);
+  if (!arr) {
+    arr = g_ptr_array_new ();
+    g_hash_table_insert (map, key_copy ? key_copy (key) : key, arr);
+  }
+  g_ptr_array_add (arr, value);
+}
+
+static void
+multimap_remove (GHashTable * map, gconstpointer key, gpointer value)
+{
+  GPtrArray *arr = g_hash_table_lookup (map, key);
+  if (arr) {
+    g_ptr_array_remove_fast (arr, value);
+    if (arr->len == 0)
+      g_hash_table_remove (map, key);
+  }
+}
+
+static void
+node_peers_add (WpGraphIndex * self, guint32 node, guint32 peer)
+{
+  GArray *arr = g_hash_table_lookup (self->node_peers, GUINT_TO_POINTER (node));
+  if (!arr) {
+    arr = g_array_new (FALSE, FALSE, sizeof (guint32));
+    g_hash_table_insert (self->node_peers, GUINT_TO_POINTER (node), arr);
+  }
+  g_array_append_val (arr, peer);
+}
+
+static void
+node_peers_remove (WpGraphIndex * self, guint32 node, guint32 peer)
+{
+  GArray *arr = g_hash_table_lookup (self->node_peers, GUINT_TO_POINTER (node));
+  if (!arr)
+    return;
+  for (guint i = 0; i < arr->len; i++) {
+    if (g_array_index (arr, guint32, i) == peer) {
+      g_array_remove_index_fast (arr, i);
+      break;
+    }
+  }
+  if (arr->len == 0)
+    g_hash_table_remove (self->node_peers, GUINT_TO_POINTER (node));
+}
+
+static void
+on_object_added (WpObjectManager * om, WpObject * object, WpGraphIndex * self)
+{
+  if (WP_IS_SI_LINK (object)) {
+    WpSessionItem *si = WP_SESSION_ITEM (object);
+    LinkEntry *e = g_slice_new0 (LinkEntry);
+
+    e->id = wp_object_get_id (object);
+    e->out_id = parse_id (wp_session_item_get_property (si, "out.item.id"));
+    e->in_id = parse_id (wp_session_item_get_property (si, "in.item.id"));
+    e->link = WP_SI_LINK (object);
+
+    g_hash_table_insert (self->links, GUINT_TO_POINTER (e->id), e);
+    multimap_add (self->item_links, GUINT_TO_POINTER (e->out_id), NULL, e);
+    multimap_add (self->item_links, GUINT_TO_POINTER (e->in_id), NULL, e);
+
+    wp_trace_object (self, "si-link %u: %u -> %u", e->id, e->out_id, e->in_id);
+    self->version++;
+  }
+  else if (WP_IS_SI_LINKABLE (object)) {
+    WpSessionItem *si = WP_SESSION_ITEM (object);
+    ItemEntry *e = g_slice_new0 (ItemEntry);
+
+    e->id = wp_object_get_id (object);
+    e->direction =
+        g_strdup (wp_session_item_get_property (si, "item.node.direction"));
+    e->link_group =
+        g_strdup (wp_session_item_get_property (si, PW_KEY_NODE_LINK_GROUP));
+    e->node_id = parse_id (wp_session_item_get_property (si, "node.id"));
+
+    g_hash_table_insert (self->items, GUINT_TO_POINTER (e->id), e);
+    if (e->link_group)
+      multimap_add (self->link_groups, e->link_group,
+          (GBoxedCopyFunc) g_strdup, e);
+    self->version++;
+  }
+  else if (WP_IS_LINK (object)) {
+    WpGlobalProxy *proxy = WP_GLOBAL_PROXY (object);
+    g_autoptr (WpProperties) props =
+        wp_global_proxy_get_global_properties (proxy);
+    NodeLinkEntry *e = g_slice_new0 (NodeLinkEntry);
+
+    e->out_node = parse_id (wp_properties_get (props, PW_KEY_LINK_OUTPUT_NODE));
+    e->in_node = parse_id (wp_properties_get (props, PW_KEY_LINK_INPUT_NODE));
+
+    g_hash_table_insert (self->node_links, object, e);
+    node_peers_add (self, e->out_node, e->in_node);
+    node_peers_add (self, e->in_node, e->out_node);
+  }
+}
+
+static void
+on_object_removed (WpObjectManager * om, WpObject * object,
+    WpGraphIndex * self)
+{
+  if (WP_IS_SI_LINK (object)) {
+    gpointer id = GUINT_TO_POINTER (wp_object_get_id (object));
+    LinkEntry *e = g_hash_table_lookup (self->links, id);
+    if (e) {
+      multimap_remove (self->item_links, GUINT_TO_POINTER (e->out_id), e);
+      multimap_remove (self->item_links, GUINT_TO_POINTER (e->in_id), e);
+      g_hash_table_remove (self->links, id);
+      self->version++;
+    }
+  }
+  else if (WP_IS_SI_LINKABLE (object)) {
+    gpointer id = GUINT_TO_POINTER (wp_object_get_id (object));
+    ItemEntry *e = g_hash_table_lookup (self->items, id);
+    if (e) {
+      if (e->link_group)
+        multimap_remove (self->link_groups, e->link_group, e);
+      g_hash_table_remove (self->items, id);
+      self->version++;
+    }
+  }
+  else if (WP_IS_LINK (object)) {
+    NodeLinkEntry *e = g_hash_table_lookup (self->node_links, object);
+    if (e) {
+      node_peers_remove (self, e->out_node, e->in_node);
+      node_peers_remove (self, e->in_node, e->out_node);
+      g_hash_table_remove (self->node_links, object);
+    }
+  }
+}
+
+static void
+on_om_installed (WpObjectManager * om, WpGraphIndex * self)
+{
+  wp_object_update_features (WP_OBJECT (self), WP_PLUGIN_FEATURE_ENABLED, 0);
+}
+
+static void
+wp_graph_index_enable (WpPlugin * plugin, WpTransition * transition)
+{
+  WpGraphIndex * self = WP_GRAPH_INDEX (plugin);
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (plugin));
+  g_return_if_fail (core);
+
+  self->items = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) item_entry_free);
+  self->link_groups = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) g_ptr_array_unref);
+  self->links = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) link_entry_free);
+  self->item_links = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) g_ptr_array_unref);
+  self->node_links = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) node_link_entry_free);
+  self->node_peers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) g_array_unref);
+  self->reach_cache = g_hash_table_new_full (reach_key_hash, reach_key_equal,
+      (GDestroyNotify) reach_key_free, NULL);
+
+  self->om = wp_object_manager_new ();
+  wp_object_manager_add_interest (self->om, WP_TYPE_SI_LINK, NULL);
+  wp_object_manager_add_interest (self->om, WP_TYPE_SI_LINKABLE,
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "item.factory.name", "c(ss)",
+      "si-audio-adapter", "si-node", NULL);
+  wp_object_manager_add_interest (self->om, WP_TYPE_LINK, NULL);
+  g_signal_connect_object (self->om, "object-added",
+      G_CALLBACK (on_object_added), self, 0);
+  g_signal_connect_object (self->om, "object-removed",
+      G_CALLBACK (on_object_removed), self, 0);
+  g_signal_connect_object (self->om, "installed",
+      G_CALLBACK (on_om_installed), self, 0);
+  wp_core_install_object_manager (core, self->om);
+}
+
+static void
+wp_graph_index_disable (WpPlugin * plugin)
+{
+  WpGraphIndex * self = WP_GRAPH_INDEX (plugin);
+
+  g_clear_object (&self->om);
+  g_clear_pointer (&self->link_groups, g_hash_table_unref);
+  g_clear_pointer (&self->items, g_hash_table_unref);
+  g_clear_pointer (&self->item_links, g_hash_table_unref);
+  g_clear_pointer (&self->links, g_hash_table_unref);
+  g_clear_pointer (&self->node_peers, g_hash_table_unref);
+  g_clear_pointer (&self->node_links, g_hash_table_unref);
+  g_clear_pointer (&self->reach_cache, g_hash_table_unref);
+}
+
+static GPtrArray *
+wp_graph_index_get_item_links (WpGraphIndex * self, guint32 si_id)
+{
+  return self->item_links ?
+      g_hash_table_lookup (self->item_links, GUINT_TO_POINTER (si_id)) : NULL;
+}
+
+static WpSiLink *
+wp_graph_index_lookup_link (WpGraphIndex * self, guint32 si_id,
+    guint32 peer_id)
+{
+  GPtrArray *links = wp_graph_index_get_item_links (self, si_id);
+  for (guint i = 0; links && i < links->len; i++) {
+    LinkEntry *e = g_ptr_array_index (links, i);
+    if ((e->out_id == si_id && e->in_id == peer_id) ||
+        (e->in_id == si_id && e->out_id == peer_id))
+      return g_object_ref (e->link);
+  }
+  return NULL;
+}
+
+static WpSiLink *
+wp_graph_index_get_link (WpGraphIndex * self, guint32 si_id)
+{
+  GPtrArray *links = wp_graph_index_get_item_links (self, si_id);
+  return (links && links->len > 0) ?
+      g_object_ref (((LinkEntry *) g_ptr_array_index (links, 0))->link) : NULL;
+}
+
+static GVariant *
+wp_graph_index_get_link_peers (WpGraphIndex * self, guint32 si_id)
+{
+  GPtrArray *links = wp_graph_index_get_item_links (self, si_id);
+  g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("au"));
+
+  for (guint i = 0; links && i < links->len; i++) {
+    LinkEntry *e = g_ptr_array_index (links, i);
+    g_variant_builder_add (&b, "u", (e->out_id == si_id) ? e->in_id : e->out_id);
+  }
+  return g_variant_builder_end (&b);
+}
+
+static GVariant *
+wp_graph_index_get_item_info (WpGraphIndex * self, guint32 si_id)
+{
+  ItemEntry *e = self->items ?
+      g_hash_table_lookup (self->items, GUINT_TO_POINTER (si_id)) : NULL;
+  g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
+
+  if (!e)
+    return NULL;
+
+  if (e->direction)
+    g_variant_builder_add (&b, "{sv}", "direction",
+        g_variant_new_string (e->direction));
+  if (e->link_group)
+    g_variant_builder_add (&b, "{sv}", "link-group",
+        g_variant_new_string (e->link_group));
+  if (e->node_id != SPA_ID_INVALID)
+    g_variant_builder_add (&b, "{sv}", "node-id",
+        g_variant_new_uint32 (e->node_id));
+  return g_variant_builder_end (&b);
+}
+
+static GVariant *
+wp_graph_index_get_link_group_members (WpGraphIndex * self,
+    const gchar * link_group, const gchar * exclude_direction)
+{
+  GPtrArray *members = (self->link_groups && link_group) ?
+      g_hash_table_lookup (self->link_groups, link_group) : NULL;
+  g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("au"));
+
+  for (guint i = 0; members && i < members->len; i++) {
+    ItemEntry *e = g_ptr_array_index (members, i);
+    if (!exclude_direction || g_strcmp0 (e->direction, exclude_direction) != 0)
+      g_variant_builder_add (&b, "u", e->id);
+  }
+  return g_variant_builder_end (&b);
+}
+
+static guint
+wp_graph_index_get_node_peer (WpGraphIndex * self, guint node_id)
+{
+  GArray *peers = self->node_peers ?
+      g_hash_table_lookup (self->node_peers, GUINT_TO_POINTER (node_id)) : NULL;
+  return (peers && peers->len > 0) ?
+      g_array_index (peers, guint32, 0) : SPA_ID_INVALID;
+}
+
+/* the link group check of canLink() in linking-utils.lua: linking an item of
+   \a link_group to \a target is not allowed if \a target is in the same
+   link group, or if any item that is linked to the other side of \a target's
+   link group is (recursively, up to 8 hops) */
+static gboolean
+can_link_group_check (WpGraphIndex * self, const gchar * link_group,
+    ItemEntry * target, guint hops)
+{
+  GPtrArray *members;
+
+  if (hops == 8)
+    return FALSE;
+  if (!target->link_group)
+    return TRUE;
+  if (g_str_equal (link_group, target->link_group))
+    return FALSE;
+
+  members = g_hash_table_lookup (self->link_groups, target->link_group);
+  for (guint i = 0; members && i < members->len; i++) {
+    ItemEntry *n = g_ptr_array_index (members, i);
+    GPtrArray *links;
+
+    if (n == target || !g_strcmp0 (n->direction, target->direction))
+      continue;
+
+    links = wp_graph_index_get_item_links (self, n->id);
+    for (guint j = 0; links && j < links->len; j++) {
+      LinkEntry *l = g_ptr_array_index (links, j);
+      guint32 peer_id = (l->out_id == n->id) ? l->in_id : l->out_id;
+      ItemEntry *peer =
+          g_hash_table_lookup (self->items, GUINT_TO_POINTER (peer_id));
+
+      if (peer && !can_link_group_check (self, link_group, peer, hops + 1))
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static GVariant *
+wp_graph_index_can_link_group (WpGraphIndex * self, const gchar * link_group,
+    guint target_id)
+{
+  ReachKey key = { target_id, (gchar *) link_group };
+  ItemEntry *target;
+  gpointer cached;
+  gboolean res;
+
+  g_return_val_if_fail (link_group, NULL);
+
+  target = self->items ?
+      g_hash_table_lookup (self->items, GUINT_TO_POINTER (target_id)) : NULL;
+  if (!target)
+    return NULL;
+
+  if (self->reach_version != self->version) {
+    g_hash_table_remove_all (self->reach_cache);
+    self->reach_version = self->version;
+  }
+
+  if (g_hash_table_lookup_extended (self->reach_cache, &key, NULL, &cached))
+    return g_variant_new_boolean (GPOINTER_TO_INT (cached));
+
+  res = can_link_group_check (self, link_group, target, 0);
+
+  {
+    ReachKey *k = g_slice_new (ReachKey);
+    k->target_id = target_id;
+    k->link_group = g_strdup (link_group);
+    g_hash_table_insert (self->reach_cache, k, GINT_TO_POINTER (res));
+  }
+
+  wp_trace_object (self, "link group '%s' %s link to %u", link_group,
+      res ? "can" : "cannot", target_id);
+  return g_variant_new_boolean (res);
+}
+
+static void
+wp_graph_index_class_init (WpGraphIndexClass * klass)
+{
+  WpPluginClass *plugin_class = (WpPluginClass *) klass;
+
+  plugin_class->enable = wp_graph_index_enable;
+  plugin_class->disable = wp_graph_index_disable;
+
+  /* (si id, peer si id) -> the SiLink between them, in either direction */
+  signals[ACTION_LOOKUP_LINK] = g_signal_new_class_handler (
+      "lookup-link", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_graph_index_lookup_link,
+      NULL, NULL, NULL,
+      WP_TYPE_SI_LINK, 2, G_TYPE_UINT, G_TYPE_UINT);
+
+  /* si id -> any SiLink that has this item on either side */
+  signals[ACTION_GET_LINK] = g_signal_new_class_handler (
+      "get-link", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_graph_index_get_link,
+      NULL, NULL, NULL,
+      WP_TYPE_SI_LINK, 1, G_TYPE_UINT);
+
+  /* si id -> "au", the ids of the items on the other side of its links */
+  signals[ACTION_GET_LINK_PEERS] = g_signal_new_class_handler (
+      "get-link-peers", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_graph_index_get_link_peers,
+      NULL, NULL, NULL,
+      G_TYPE_VARIANT, 1, G_TYPE_UINT);
+
+  /* si id -> "a{sv}" with direction, link-group and node-id, or NULL if the
+     item is not a linkable of the si-audio-adapter or si-node factories */
+  signals[ACTION_GET_ITEM_INFO] = g_signal_new_class_handler (
+      "get-item-info", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_graph_index_get_item_info,
+      NULL, NULL, NULL,
+      G_TYPE_VARIANT, 1, G_TYPE_UINT);
+
+  /* (link group, direction to exclude or NULL) -> "au" of member si ids */
+  signals[ACTION_GET_LINK_GROUP_MEMBERS] = g_signal_new_class_handler (
+      "get-link-group-members", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_graph_index_get_link_group_members,
+      NULL, NULL, NULL,
+      G_TYPE_VARIANT, 2, G_TYPE_STRING, G_TYPE_STRING);
+
+  /* node id -> the id of a node that it is linked to, or SPA_ID_INVALID */
+  signals[ACTION_GET_NODE_PEER] = g_signal_new_class_handler (
+      "get-node-peer", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_graph_index_get_node_peer,
+      NULL, NULL, NULL,
+      G_TYPE_UINT, 1, G_TYPE_UINT);
+
+  /* (link group, target si id) -> boolean, whether an item of the link group
+     may link to the target, or NULL if the target is not indexed */
+  signals[ACTION_CAN_LINK_GROUP] = g_signal_new_class_handler (
+      "can-link-group", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_graph_index_can_link_group,
+      NULL, NULL, NULL,
+      G_TYPE_VARIANT, 2, G_TYPE_STRING, G_TYPE_UINT);
+}
+
+WP_PLUGIN_EXPORT GObject *
+wireplumber__module_init (WpCore * core, WpSpaJson * args, GError ** error)
+{
+  return G_OBJECT (g_object_new (wp_graph_index_get_type (),
+      "name", "graph-index",
+      "core", core,
+      NULL));
+}
@@ -0,0 +1,691 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <wp/wp.h>
+#include <spa/utils/defs.h>
+#include <spa/utils/string.h>
+#include <pipewire/keys.h>
+
+WP_DEFINE_LOCAL_LOG_TOPIC ("m-graph-snapshot")
+
+/*
+ * This module maintains a JSON snapshot of the session state (defaults,
+ * devices, nodes with their volumes and links) and publishes it in the
+ * "snapshot" key of the "sm-snapshot" metadata object, so that clients such
+ * as `wpctl status --snapshot` can read the whole state by binding a single
+ * object, instead of binding every global and enumerating its params.
+ *
+ * The snapshot is maintained incrementally: every object has a cached JSON
+ * fragment that is regenerated only when that object changes, and the
+ * document is re-assembled from the fragments on a short timeout after a
+ * fragment actually changed, so that bursts of changes are published once.
+ */
+
+#define DEFAULT_METADATA_NAME "sm-snapshot"
+#define DEFAULT_UPDATE_DELAY_MS 50
+#define SNAPSHOT_KEY "snapshot"
+
+struct _WpGraphSnapshot
+{
+  WpPlugin parent;
+
+  /* Props */
+  gchar *metadata_name;
+  guint update_delay_ms;
+
+  WpImplMetadata *metadata;
+  WpObjectManager *om;
+  WpPlugin *mixer_api;
+
+  /* id -> JSON fragment, kept sorted by id so that the output is stable */
+  GTree *devices;
+  GTree *nodes;
+  GTree *links;
+  /* key -> JSON value, the "default.*" keys of the "default" metadata */
+  GTree *defaults;
+
+  GSource *publish_source;
+  gint generation;
+};
+
+enum {
+  PROP_0,
+  PROP_METADATA_NAME,
+  PROP_UPDATE_DELAY_MS,
+};
+
+G_DECLARE_FINAL_TYPE (WpGraphSnapshot, wp_graph_snapshot,
+                      WP, GRAPH_SNAPSHOT, WpPlugin)
+G_DEFINE_TYPE (WpGraphSnapshot, wp_graph_snapshot, WP_TYPE_PLUGIN)
+
+static gint
+id_compare (gconstpointer a, gconstpointer b, gpointer data)
+{
+  guint32 ia = GPOINTER_TO_UINT (a), ib = GPOINTER_TO_UINT (b);
+  return (ia > ib) - (ia < ib);
+}
+
+static gint
+key_compare (gconstpointer a, gconstpointer b, gpointer data)
+{
+  return g_strcmp0 (a, b);
+}
+
+static void
+wp_graph_snapshot_init (WpGraphSnapshot * self)
+{
+}
+
+static gboolean
+publish_snapshot (WpGraphSnapshot * self)
+{
+  g_autoptr (WpSpaJsonBuilder) b = NULL;
+  g_autoptr (WpSpaJson) json = NULL;
+  g_autofree gchar *str = NULL;
+
+  g_clear_pointer (&self->publish_source, g_source_unref);
+
+  if (!self->metadata || !self->devices)
+    return G_SOURCE_REMOVE;
+
+  b = wp_spa_json_builder_new_object ();
+  wp_spa_json_builder_add_property (b, "generation");
+  wp_spa_json_builder_add_int (b, ++self->generation);
+
+  {
+    g_autoptr (WpSpaJsonBuilder) d = wp_spa_json_builder_new_object ();
+    g_autoptr (WpSpaJson) d_json = NULL;
+    GTreeNode *n;
+
+    for (n = g_tree_node_first (self->defaults); n; n = g_tree_node_next (n)) {
+      wp_spa_json_builder_add_property (d, g_tree_node_key (n));
+      wp_spa_json_builder_add_from_string (d, g_tree_node_value (n));
+    }
+    d_json = wp_spa_json_builder_end (d);
+    wp_spa_json_builder_add_property (b, "defaults");
+    wp_spa_json_builder_add_json (b, d_json);
+  }
+
+  {
+    const struct {
+      const gchar *name;
+      GTree *tree;
+    } sections[] = {
+      { "devices", self->devices },
+      { "nodes", self->nodes },
+      { "links", self->links },
+    };
+
+    for (guint i = 0; i < G_N_ELEMENTS (sections); i++) {
+      g_autoptr (WpSpaJsonBuilder) a = wp_spa_json_builder_new_array ();
+      g_autoptr (WpSpaJson) a_json = NULL;
+      GTreeNode *n;
+
+      for (n = g_tree_node_first (sections[i].tree); n; n = g_tree_node_next (n))
+        wp_spa_json_builder_add_from_string (a, g_tree_node_value (n));
+      a_json = wp_spa_json_builder_end (a);
+      wp_spa_json_builder_add_property (b, sections[i].name);
+      wp_spa_json_builder_add_json (b, a_json);
+    }
+  }
+
+  json = wp_spa_json_builder_end (b);
+  str = wp_spa_json_to_string (json);
+
+  wp_debug_object (self, "publishing snapshot generation %d (%zu bytes)",
+      self->generation, strlen (str));
+  wp_metadata_set (WP_METADATA (self->metadata), 0, SNAPSHOT_KEY,
+      "Spa:String:JSON", str);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_publish (WpGraphSnapshot * self)
+{
+  g_autoptr (WpCore) core = NULL;
+
+  if (self->publish_source)
+    return;
+
+  core = wp_object_get_core (WP_OBJECT (self));
+  g_return_if_fail (core);
+
+  if (self->update_delay_ms > 0)
+    wp_core_timeout_add (core, &self->publish_source, self->update_delay_ms,
+        (GSourceFunc) publish_snapshot, self, NULL);
+  else
+    wp_core_idle_add (core, &self->publish_source,
+        (GSourceFunc) publish_snapshot, self, NULL);
+}
+
+/* takes ownership of the key and the fragment */
+static void
+update_fragment (WpGraphSnapshot * self, GTree * tree, gpointer key,
+    gchar * fragment)
+{
+  const gchar *old = g_tree_lookup (tree, key);
+
+  if (!g_strcmp0 (old, fragment)) {
+    g_free (fragment);
+    if (tree == self->defaults)
+      g_free (key);
+    return;
+  }
+
+  if (fragment)
+    g_tree_replace (tree, key, fragment);
+  else {
+    g_tree_remove (tree, key);
+    if (tree == self->defaults)
+      g_free (key);
+  }
+
+  schedule_publish (self);
+}
+
+static void
+add_string_prop (WpSpaJsonBuilder * b, const gchar * name,
+    WpPipewireObject * obj, const gchar * key)
+{
+  const gchar *value = wp_pipewire_object_get_property (obj, key);
+  if (value) {
+    wp_spa_json_builder_add_property (b, name);
+    wp_spa_json_builder_add_string (b, value);
+  }
+}
+
+static void
+add_int_prop (WpSpaJsonBuilder * b, const gchar * name,
+    WpPipewireObject * obj, const gchar * key)
+{
+  const gchar *value = wp_pipewire_object_get_property (obj, key);
+  gint32 v;
+  if (value && spa_atoi32 (value, &v, 10)) {
+    wp_spa_json_builder_add_property (b, name);
+    wp_spa_json_builder_add_int (b, v);
+  }
+}
+
+static void
+add_enum (WpSpaJsonBuilder * b, const gchar * name, GType type, gint value)
+{
+  g_autoptr (GEnumClass) klass = g_type_class_ref (type);
+  GEnumValue *v = g_enum_get_value (klass, value);
+
+  wp_spa_json_builder_add_property (b, name);
+  wp_spa_json_builder_add_string (b, v ? v->value_nick : "unknown");
+}
+
+static void
+add_volume (WpGraphSnapshot * self, WpSpaJsonBuilder * b, guint32 id)
+{
+  g_autoptr (GVariant) dict = NULL;
+  g_autoptr (GVariant) channels = NULL;
+  g_autoptr (WpSpaJsonBuilder) v = NULL;
+  g_autoptr (WpSpaJsonBuilder) a = NULL;
+  g_autoptr (WpSpaJson) a_json = NULL;
+  g_autoptr (WpSpaJson) v_json = NULL;
+  gboolean mute = FALSE;
+  gdouble volume = 1.0;
+
+  if (!self->mixer_api)
+    return;
+
+  g_signal_emit_by_name (self->mixer_api, "get-volume", id, &dict);
+  if (!dict || !g_variant_lookup (dict, "volume", "d", &volume))
+    return;
+  g_variant_lookup (dict, "mute", "b", &mute);
+
+  a = wp_spa_json_builder_new_array ();
+  channels = g_variant_lookup_value (dict, "channelVolumes",
+      G_VARIANT_TYPE_VARDICT);
+  for (guint i = 0; channels; i++) {
+    gchar index_str[10];
+    g_autoptr (GVariant) ch = NULL;
+    g_autoptr (WpSpaJsonBuilder) c = NULL;
+    g_autoptr (WpSpaJson) c_json = NULL;
+    const gchar *channel = NULL;
+    gdouble ch_volume = 1.0;
+
+    g_snprintf (index_str, sizeof (index_str), "%u", i);
+    ch = g_variant_lookup_value (channels, index_str, G_VARIANT_TYPE_VARDICT);
+    if (!ch)
+      break;
+
+    c = wp_spa_json_builder_new_object ();
+    if (g_variant_lookup (ch, "channel", "&s", &channel)) {
+      wp_spa_json_builder_add_property (c, "channel");
+      wp_spa_json_builder_add_string (c, channel);
+    }
+    g_variant_lookup (ch, "volume", "d", &ch_volume);
+    wp_spa_json_builder_add_property (c, "volume");
+    wp_spa_json_builder_add_float (c, ch_volume);
+    c_json = wp_spa_json_builder_end (c);
+    wp_spa_json_builder_add_json (a, c_json);
+  }
+  a_json = wp_spa_json_builder_end (a);
+
+  v = wp_spa_json_builder_new_object ();
+  wp_spa_json_builder_add_property (v, "volume");
+  wp_spa_json_builder_add_float (v, volume);
+  wp_spa_json_builder_add_property (v, "mute");
+  wp_spa_json_builder_add_boolean (v, mute);
+  wp_spa_json_builder_add_property (v, "channels");
+  wp_spa_json_builder_add_json (v, a_json);
+  v_json = wp_spa_json_builder_end (v);
+
+  wp_spa_json_builder_add_property (b, "volume");
+  wp_spa_json_builder_add_json (b, v_json);
+}
+
+static gchar *
+device_to_json (WpGraphSnapshot * self, WpPipewireObject * obj, guint32 id)
+{
+  g_autoptr (WpSpaJsonBuilder) b = wp_spa_json_builder_new_object ();
+  g_autoptr (WpSpaJson) json = NULL;
+
+  wp_spa_json_builder_add_property (b, "id");
+  wp_spa_json_builder_add_int (b, id);
+  add_string_prop (b, "name", obj, PW_KEY_DEVICE_NAME);
+  add_string_prop (b, "description", obj, PW_KEY_DEVICE_DESCRIPTION);
+  add_string_prop (b, "nick", obj, PW_KEY_DEVICE_NICK);
+  add_string_prop (b, "api", obj, PW_KEY_DEVICE_API);
+  add_string_prop (b, "media.class", obj, PW_KEY_MEDIA_CLASS);
+
+  json = wp_spa_json_builder_end (b);
+  return wp_spa_json_to_string (json);
+}
+
+static gchar *
+node_to_json (WpGraphSnapshot * self, WpPipewireObject * obj, guint32 id)
+{
+  g_autoptr (WpSpaJsonBuilder) b = wp_spa_json_builder_new_object ();
+  g_autoptr (WpSpaJson) json = NULL;
+
+  wp_spa_json_builder_add_property (b, "id");
+  wp_spa_json_builder_add_int (b, id);
+  add_int_prop (b, "serial", obj, PW_KEY_OBJECT_SERIAL);
+  add_string_prop (b, "name", obj, PW_KEY_NODE_NAME);
+  add_string_prop (b, "description", obj, PW_KEY_NODE_DESCRIPTION);
+  add_string_prop (b, "nick", obj, PW_KEY_NODE_NICK);
+  add_string_prop (b, "media.class", obj, PW_KEY_MEDIA_CLASS);
+  add_int_prop (b, "device.id", obj, PW_KEY_DEVICE_ID);
+  add_int_prop (b, "client.id", obj, PW_KEY_CLIENT_ID);
+  add_string_prop (b, "link.group", obj, PW_KEY_NODE_LINK_GROUP);
+  add_enum (b, "state", WP_TYPE_NODE_STATE,
+      wp_node_get_state (WP_NODE (obj), NULL));
+  add_volume (self, b, id);
+
+  json = wp_spa_json_builder_end (b);
+  return wp_spa_json_to_string (json);
+}
+
+static gchar *
+link_to_json (WpGraphSnapshot * self, WpPipewireObject * obj, guint32 id)
+{
+  g_autoptr (WpSpaJsonBuilder) b = wp_spa_json_builder_new_object ();
+  g_autoptr (WpSpaJson) json = NULL;
+  guint32 out_node = 0, out_port = 0, in_node = 0, in_port = 0;
+
+  wp_link_get_linked_object_ids (WP_LINK (obj), &out_node, &out_port,
+      &in_node, &in_port);
+
+  wp_spa_json_builder_add_property (b, "id");
+  wp_spa_json_builder_add_int (b, id);
+  wp_spa_json_builder_add_property (b, "output.node");
+  wp_spa_json_builder_add_int (b, out_node);
+  wp_spa_json_builder_add_property (b, "output.port");
+  wp_spa_json_builder_add_int (b, out_port);
+  wp_spa_json_builder_add_property (b, "input.node");
+  wp_spa_json_builder_add_int (b, in_node);
+  wp_spa_json_builder_add_property (b, "input.port");
+  wp_spa_json_builder_add_int (b, in_port);
+  add_enum (b, "state", WP_TYPE_LINK_STATE,
+      wp_link_get_state (WP_LINK (obj), NULL));
+
+  json = wp_spa_json_builder_end (b);
+  return wp_spa_json_to_string (json);
+}
+
+static void
+update_object (WpGraphSnapshot * self, WpObject * obj)
+{
+  guint32 id = wp_proxy_get_bound_id (WP_PROXY (obj));
+  WpPipewireObject *pwobj = WP_PIPEWIRE_OBJECT (obj);
+
+  if (WP_IS_NODE (obj))
+    update_fragment (self, self->nodes, GUINT_TO_POINTER (id),
+        node_to_json (self, pwobj, id));
+  else if (WP_IS_DEVICE (obj))
+    update_fragment (self, self->devices, GUINT_TO_POINTER (id),
+        device_to_json (self, pwobj, id));
+  else if (WP_IS_LINK (obj))
+    update_fragment (self, self->links, GUINT_TO_POINTER (id),
+        link_to_json (self, pwobj, id));
+}
+
+static void
+on_properties_changed (WpObject * obj, GParamSpec * spec,
+    WpGraphSnapshot * self)
+{
+  update_object (self, obj);
+}
+
+static void
+on_state_changed (WpObject * obj, gint old_state, gint new_state,
+    WpGraphSnapshot * self)
+{
+  update_object (self, obj);
+}
+
+static void
+on_volume_changed (WpPlugin * mixer_api, guint32 id, WpGraphSnapshot * self)
+{
+  g_autoptr (WpObject) node = NULL;
+
+  if (!self->om)
+    return;
+
+  node = wp_object_manager_lookup (self->om, WP_TYPE_NODE,
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id", "=u", id, NULL);
+  if (node)
+    update_object (self, node);
+}
+
+static void
+update_default (WpGraphSnapshot * self, const gchar * key, const gchar * type,
+    const gchar * value)
+{
+  gchar *fragment = NULL;
+
+  if (value) {
+    if (!g_strcmp0 (type, "Spa:String:JSON")) {
+      fragment = g_strdup (value);
+    } else {
+      g_autoptr (WpSpaJson) json = wp_spa_json_new_string (value);
+      fragment = wp_spa_json_to_string (json);
+    }
+  }
+
+  update_fragment (self, self->defaults, g_strdup (key), fragment);
+}
+
+static void
+clear_defaults (WpGraphSnapshot * self)
+{
+  if (g_tree_nnodes (self->defaults) == 0)
+    return;
+
+  /* g_tree_remove_all() needs GLib 2.70 */
+  g_tree_destroy (self->defaults);
+  self->defaults = g_tree_new_full (key_compare, NULL, g_free, g_free);
+  schedule_publish (self);
+}
+
+static void
+on_default_metadata_changed (WpMetadata * m, guint32 subject,
+    const gchar * key, const gchar * type, const gchar * value,
+    WpGraphSnapshot * self)
+{
+  if (subject != 0)
+    return;
+
+  if (!key) {
+    clear_defaults (self);
+  } else if (g_str_has_prefix (key, "default.")) {
+    update_default (self, key, type, value);
+  }
+}
+
+static void
+on_object_added (WpObjectManager * om, WpObject * object,
+    WpGraphSnapshot * self)
+{
+  if (WP_IS_METADATA (object)) {
+    g_autoptr (WpIterator) it = wp_metadata_new_iterator (
+        WP_METADATA (object), 0);
+    g_auto (GValue) val = G_VALUE_INIT;
+
+    for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
+      WpMetadataItem *mi = g_value_get_boxed (&val);
+      const gchar *key = wp_metadata_item_get_key (mi);
+      if (g_str_has_prefix (key, "default."))
+        update_default (self, key, wp_metadata_item_get_value_type (mi),
+            wp_metadata_item_get_value (mi));
+    }
+    g_signal_connect_object (object, "changed",
+        G_CALLBACK (on_default_metadata_changed), self, 0);
+    return;
+  }
+
+  g_signal_connect_object (object, "notify::properties",
+      G_CALLBACK (on_properties_changed), self, 0);
+  if (WP_IS_NODE (object) || WP_IS_LINK (object))
+    g_signal_connect_object (object, "state-changed",
+        G_CALLBACK (on_state_changed), self, 0);
+
+  update_object (self, object);
+}
+
+static void
+on_object_removed (WpObjectManager * om, WpObject * object,
+    WpGraphSnapshot * self)
+{
+  gpointer id;
+
+  g_signal_handlers_disconnect_by_data (object, self);
+
+  if (WP_IS_METADATA (object)) {
+    clear_defaults (self);
+    return;
+  }
+
+  id = GUINT_TO_POINTER (wp_proxy_get_bound_id (WP_PROXY (object)));
+  if (WP_IS_NODE (object))
+    update_fragment (self, self->nodes, id, NULL);
+  else if (WP_IS_DEVICE (object))
+    update_fragment (self, self->devices, id, NULL);
+  else if (WP_IS_LINK (object))
+    update_fragment (self, self->links, id, NULL);
+}
+
+static void
+on_om_installed (WpObjectManager * om, WpGraphSnapshot * self)
+{
+  /* publish the initial state right away */
+  if (self->publish_source) {
+    g_source_destroy (self->publish_source);
+    g_clear_pointer (&self->publish_source, g_source_unref);
+  }
+  publish_snapshot (self);
+
+  wp_object_update_features (WP_OBJECT (self), WP_PLUGIN_FEATURE_ENABLED, 0);
+}
+
+static void
+on_metadata_activated (WpMetadata * m, GAsyncResult * res,
+    gpointer user_data)
+{
+  WpTransition *transition = WP_TRANSITION (user_data);
+  WpGraphSnapshot *self = wp_transition_get_source_object (transition);
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (self));
+  g_autoptr (GError) error = NULL;
+
+  if (!wp_object_activate_finish (WP_OBJECT (m), res, &error)) {
+    g_clear_object (&self->metadata);
+    g_prefix_error (&error, "Failed to activate \"%s\": "
+        "Metadata object ", self->metadata_name);
+    wp_transition_return_error (transition, g_steal_pointer (&error));
+    return;
+  }
+
+  self->mixer_api = wp_plugin_find (core, "mixer-api");
+  if (self->mixer_api)
+    g_signal_connect_object (self->mixer_api, "changed",
+        G_CALLBACK (on_volume_changed), self, 0);
+  else
+    wp_info_object (self, "mixer-api is not loaded; "
+        "volumes will not be included in the snapshot");
+
+  self->om = wp_object_manager_new ();
+  wp_object_manager_add_interest (self->om, WP_TYPE_DEVICE, NULL);
+  wp_object_manager_add_interest (self->om, WP_TYPE_NODE, NULL);
+  wp_object_manager_add_interest (self->om, WP_TYPE_LINK, NULL);
+  wp_object_manager_add_interest (self->om, WP_TYPE_METADATA,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "metadata.name", "=s", "default",
+      NULL);
+  wp_object_manager_request_object_features (self->om, WP_TYPE_GLOBAL_PROXY,
+      WP_PIPEWIRE_OBJECT_FEATURES_MINIMAL);
+  wp_object_manager_request_object_features (self->om, WP_TYPE_METADATA,
+      WP_OBJECT_FEATURES_ALL);
+  g_signal_connect_object (self->om, "object-added",
+      G_CALLBACK (on_object_added), self, 0);
+  g_signal_connect_object (self->om, "object-removed",
+      G_CALLBACK (on_object_removed), self, 0);
+  g_signal_connect_object (self->om, "installed",
+      G_CALLBACK (on_om_installed), self, 0);
+  wp_core_install_object_manager (core, self->om);
+}
+
+static void
+wp_graph_snapshot_enable (WpPlugin * plugin, WpTransition * transition)
+{
+  WpGraphSnapshot * self = WP_GRAPH_SNAPSHOT (plugin);
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (plugin));
+  g_return_if_fail (core);
+
+  self->devices = g_tree_new_full (id_compare, NULL, NULL, g_free);
+  self->nodes = g_tree_new_full (id_compare, NULL, NULL, g_free);
+  self->links = g_tree_new_full (id_compare, NULL, NULL, g_free);
+  self->defaults = g_tree_new_full (key_compare, NULL, g_free, g_free);
+  self->generation = 0;
+
+  self->metadata = wp_impl_metadata_new_full (core, self->metadata_name,
+      NULL);
+  wp_object_activate (WP_OBJECT (self->metadata),
+      WP_OBJECT_FEATURES_ALL,
+      NULL,
+      (GAsyncReadyCallback) on_metadata_activated,
+      transition);
+}
+
+static void
+wp_graph_snapshot_disable (WpPlugin * plugin)
+{
+  WpGraphSnapshot * self = WP_GRAPH_SNAPSHOT (plugin);
+
+  if (self->publish_source) {
+    g_source_destroy (self->publish_source);
+    g_clear_pointer (&self->publish_source, g_source_unref);
+  }
+  if (self->mixer_api)
+    g_signal_handlers_disconnect_by_data (self->mixer_api, self);
+
+  g_clear_object (&self->om);
+  g_clear_object (&self->mixer_api);
+  g_clear_object (&self->metadata);
+  g_clear_pointer (&self->devices, g_tree_unref);
+  g_clear_pointer (&self->nodes, g_tree_unref);
+  g_clear_pointer (&self->links, g_tree_unref);
+  g_clear_pointer (&self->defaults, g_tree_unref);
+}
+
+static void
+wp_graph_snapshot_finalize (GObject * object)
+{
+  WpGraphSnapshot *self = WP_GRAPH_SNAPSHOT (object);
+
+  g_clear_pointer (&self->metadata_name, g_free);
+
+  G_OBJECT_CLASS (wp_graph_snapshot_parent_class)->finalize (object);
+}
+
+static void
+wp_graph_snapshot_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  WpGraphSnapshot *self = WP_GRAPH_SNAPSHOT (object);
+
+  switch (property_id) {
+  case PROP_METADATA_NAME:
+    g_clear_pointer (&self->metadata_name, g_free);
+    self->metadata_name = g_value_dup_string (value);
+    break;
+  case PROP_UPDATE_DELAY_MS:
+    self->update_delay_ms = g_value_get_uint (value);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+static void
+wp_graph_snapshot_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  WpGraphSnapshot *self = WP_GRAPH_SNAPSHOT (object);
+
+  switch (property_id) {
+  case PROP_METADATA_NAME:
+    g_value_set_string (value, self->metadata_name);
+    break;
+  case PROP_UPDATE_DELAY_MS:
+    g_value_set_uint (value, self->update_delay_ms);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+static void
+wp_graph_snapshot_class_init (WpGraphSnapshotClass * klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+  WpPluginClass *plugin_class = (WpPluginClass *) klass;
+
+  object_class->finalize = wp_graph_snapshot_finalize;
+  object_class->set_property = wp_graph_snapshot_set_property;
+  object_class->get_property = wp_graph_snapshot_get_property;
+
+  plugin_class->enable = wp_graph_snapshot_enable;
+  plugin_class->disable = wp_graph_snapshot_disable;
+
+  g_object_class_install_property (object_class, PROP_METADATA_NAME,
+      g_param_spec_string ("metadata-name", "metadata-name",
+          "The metadata object to publish the snapshot on",
+          DEFAULT_METADATA_NAME,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_UPDATE_DELAY_MS,
+      g_param_spec_uint ("update-delay-ms", "update-delay-ms",
+          "The time to wait for more changes before publishing, in ms",
+          0, G_MAXUINT, DEFAULT_UPDATE_DELAY_MS,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+}
+
+WP_PLUGIN_EXPORT GObject *
+wireplumber__module_init (WpCore * core, WpSpaJson * args, GError ** error)
+{
+  g_autofree gchar *metadata_name = NULL;
+  gint update_delay_ms = DEFAULT_UPDATE_DELAY_MS;
+
+  if (args) {
+    wp_spa_json_object_get (args, "metadata.name", "s", &metadata_name, NULL);
+    wp_spa_json_object_get (args, "update-delay-ms", "i", &update_delay_ms,
+        NULL);
+  }
+
+  return G_OBJECT (g_object_new (wp_graph_snapshot_get_type (),
+      "name", "graph-snapshot",
+      "core", core,
+      "metadata-name", metadata_name ? metadata_name : DEFAULT_METADATA_NAME,
+      "update-delay-ms", (guint) MAX (update_delay_ms, 0),
+      NULL));
+}
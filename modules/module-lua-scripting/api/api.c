@@ -20,6 +20,7 @@ WP_LOG_TOPIC_EXTERN (log_topic_lua_scripting)
 void wp_lua_scripting_pod_init (lua_State *L);
 void wp_lua_scripting_json_init (lua_State *L);
 void push_luajson (lua_State *L, WpSpaJson *json, gint n_recursions);
+void push_luapod_field (lua_State *L, WpSpaPod *pod, const gchar *key);
 
 /* helpers */
 
@@ -302,6 +303,55 @@ core_update_properties (lua_State *L)
   return 0;
 }
 
+static void
+push_memory_owner (const gchar * name, guint64 allocated, guint64 n_allocs,
+    gpointer data)
+{
+  lua_State *L = data;
+
+  lua_newtable (L);
+  lua_pushinteger (L, allocated);
+  lua_setfield (L, -2, "allocated");
+  lua_pushinteger (L, n_allocs);
+  lua_setfield (L, -2, "allocations");
+  lua_setfield (L, -2, name);
+}
+
+static int
+core_get_lua_memory_stats (lua_State *L)
+{
+  WpLuaMemoryStats stats;
+
+  wplua_get_memory_stats (L, &stats);
+
+  lua_newtable (L);
+  lua_pushinteger (L, stats.heap_size);
+  lua_setfield (L, -2, "heap_size");
+  lua_pushinteger (L, stats.heap_peak);
+  lua_setfield (L, -2, "heap_peak");
+  lua_pushinteger (L, stats.pool_size);
+  lua_setfield (L, -2, "pool_size");
+  lua_pushinteger (L, stats.n_allocs);
+  lua_setfield (L, -2, "allocations");
+  lua_pushinteger (L, stats.n_pool_allocs);
+  lua_setfield (L, -2, "pool_allocations");
+  lua_pushinteger (L, stats.gc_cycles);
+  lua_setfield (L, -2, "gc_cycles");
+  lua_pushinteger (L, stats.gc_collections);
+  lua_setfield (L, -2, "gc_collections");
+  lua_pushinteger (L, stats.gc_pause_last);
+  lua_setfield (L, -2, "gc_pause_last_us");
+  lua_pushinteger (L, stats.gc_pause_max);
+  lua_setfield (L, -2, "gc_pause_max_us");
+  lua_pushinteger (L, stats.gc_pause_total);
+  lua_setfield (L, -2, "gc_pause_total_us");
+
+  lua_newtable (L);
+  wplua_foreach_memory_owner (L, push_memory_owner, L);
+  lua_setfield (L, -2, "scripts");
+  return 1;
+}
+
 static const luaL_Reg core_funcs[] = {
   { "get_properties", core_get_properties },
   { "get_info", core_get_info },
@@ -314,6 +364,7 @@ static const luaL_Reg core_funcs[] = {
   { "require_api", core_require_api },
   { "test_feature", core_test_feature },
   { "update_properties", core_update_properties },
+  { "get_lua_memory_stats", core_get_lua_memory_stats },
   { NULL, NULL }
 };
 
@@ -599,6 +650,47 @@ push_wpiterator (lua_State *L, WpIterator *it)
   return 2;
 }
 
+/* Object WpIterator, consumed in batches to avoid boxing every item */
+
+#define OBJECT_ITERATOR_BATCH_SIZE 32
+
+struct object_iterator_batch
+{
+  guint n_items;
+  guint pos;
+  gpointer items[OBJECT_ITERATOR_BATCH_SIZE];
+};
+
+static int
+object_iterator_next (lua_State *L)
+{
+  WpIterator *it = wplua_checkboxed (L, 1, WP_TYPE_ITERATOR);
+  struct object_iterator_batch *b = lua_touserdata (L, lua_upvalueindex (1));
+
+  if (b->pos == b->n_items) {
+    b->n_items = it ? wp_iterator_next_batch (it, b->items,
+        OBJECT_ITERATOR_BATCH_SIZE) : 0;
+    b->pos = 0;
+  }
+  if (b->pos < b->n_items) {
+    wplua_pushobject (L, g_object_ref (b->items[b->pos++]));
+  } else {
+    lua_pushnil (L);
+  }
+  return 1;
+}
+
+static int
+push_object_wpiterator (lua_State *L, WpIterator *it)
+{
+  struct object_iterator_batch *b =
+      lua_newuserdata (L, sizeof (struct object_iterator_batch));
+  b->n_items = b->pos = 0;
+  lua_pushcclosure (L, object_iterator_next, 1);
+  wplua_pushboxed (L, WP_TYPE_ITERATOR, it);
+  return 2;
+}
+
 /* Settings WpIterator */
 
 static int
@@ -904,6 +996,15 @@ object_manager_activate (lua_State *L)
   return 0;
 }
 
+static int
+object_manager_add_index (lua_State *L)
+{
+  WpObjectManager *om = wplua_checkobject (L, 1, WP_TYPE_OBJECT_MANAGER);
+  const gchar *key = luaL_checkstring (L, 2);
+  wp_object_manager_add_index (om, key);
+  return 0;
+}
+
 static int
 object_manager_get_n_objects (lua_State *L)
 {
@@ -921,7 +1022,7 @@ object_manager_iterate (lua_State *L)
       wp_object_manager_new_filtered_iterator_full (om,
           wp_object_interest_ref (oi)) :
       wp_object_manager_new_iterator (om);
-  return push_wpiterator (L, it);
+  return push_object_wpiterator (L, it);
 }
 
 static int
@@ -941,6 +1042,7 @@ object_manager_lookup (lua_State *L)
 
 static const luaL_Reg object_manager_methods[] = {
   { "activate", object_manager_activate },
+  { "add_index", object_manager_add_index },
   { "get_n_objects", object_manager_get_n_objects },
   { "iterate", object_manager_iterate },
   { "lookup", object_manager_lookup },
@@ -982,10 +1084,31 @@ metadata_set (lua_State *L)
   return 0;
 }
 
+static int
+metadata_batch (lua_State *L)
+{
+  WpMetadata *metadata = wplua_checkobject (L, 1, WP_TYPE_METADATA);
+  int status;
+
+  luaL_checktype (L, 2, LUA_TFUNCTION);
+
+  /* call fn (metadata) within a transaction; commit even if it fails */
+  wp_metadata_begin (metadata);
+  lua_pushvalue (L, 2);
+  lua_pushvalue (L, 1);
+  status = lua_pcall (L, 1, 0, 0);
+  wp_metadata_commit (metadata);
+
+  if (status != LUA_OK)
+    return lua_error (L);
+  return 0;
+}
+
 static const luaL_Reg metadata_methods[] = {
   { "iterate", metadata_iterate },
   { "find", metadata_find },
   { "set", metadata_set },
+  { "batch", metadata_batch },
   { NULL, NULL }
 };
 
@@ -1522,13 +1645,60 @@ static const luaL_Reg si_adapter_methods[] = {
 
 /* WpPipewireObject */
 
+static gboolean
+param_matches_filter (lua_State *L, WpSpaPod *pod, int filter_idx)
+{
+  gboolean ret = TRUE;
+
+  lua_pushnil (L);
+  while (ret && lua_next (L, filter_idx)) {
+    if (lua_type (L, -2) != LUA_TSTRING) {
+      ret = FALSE;
+    } else {
+      push_luapod_field (L, pod, lua_tostring (L, -2));
+      ret = lua_compare (L, -1, -2, LUA_OPEQ);
+      lua_pop (L, 1);
+    }
+    lua_pop (L, 1);
+  }
+  /* lua_next() pops the key when it returns 0; pop it if we stopped early */
+  if (!ret)
+    lua_pop (L, 1);
+  return ret;
+}
+
+static int
+params_iterator_next (lua_State *L)
+{
+  WpIterator *it = wplua_checkboxed (L, 1, WP_TYPE_ITERATOR);
+  g_auto (GValue) v = G_VALUE_INIT;
+
+  while (wp_iterator_next (it, &v)) {
+    WpSpaPod *pod = g_value_get_boxed (&v);
+    if (pod && param_matches_filter (L, pod, lua_upvalueindex (1)))
+      return wplua_gvalue_to_lua (L, &v);
+    g_value_unset (&v);
+  }
+  lua_pushnil (L);
+  return 1;
+}
+
 static int
 pipewire_object_iterate_params (lua_State *L)
 {
   WpPipewireObject *pwobj = wplua_checkobject (L, 1, WP_TYPE_PIPEWIRE_OBJECT);
   const gchar *id = luaL_checkstring (L, 2);
   WpIterator *it = wp_pipewire_object_enum_params_sync (pwobj, id, NULL);
-  return push_wpiterator (L, it);
+
+  if (!it || lua_isnoneornil (L, 3))
+    return push_wpiterator (L, it);
+
+  /* filter params by their fields without converting them to Lua tables */
+  luaL_checktype (L, 3, LUA_TTABLE);
+  lua_pushvalue (L, 3);
+  lua_pushcclosure (L, params_iterator_next, 1);
+  wplua_pushboxed (L, WP_TYPE_ITERATOR, it);
+  return 2;
 }
 
 static int
@@ -1865,14 +2035,21 @@ json_utils_match_rules (lua_State *L)
   WpSpaJson *json;
   gboolean res;
 
-  json = wplua_checkboxed (L, 1, WP_TYPE_SPA_JSON);
   luaL_checktype (L, 2, LUA_TTABLE);
   luaL_checktype (L, 3, LUA_TFUNCTION);
 
   properties = wplua_table_to_properties (L, 2);
 
-  res = wp_json_utils_match_rules (json, properties, json_utils_match_rules_cb,
-      L, &error);
+  /* accept pre-parsed rules as well, so that scripts can cache them */
+  if (wplua_isboxed (L, 1, WP_TYPE_RULE_SET)) {
+    WpRuleSet *rules = wplua_toboxed (L, 1);
+    res = wp_rule_set_match (rules, properties, json_utils_match_rules_cb,
+        L, &error);
+  } else {
+    json = wplua_checkboxed (L, 1, WP_TYPE_SPA_JSON);
+    res = wp_json_utils_match_rules (json, properties,
+        json_utils_match_rules_cb, L, &error);
+  }
 
   lua_pushboolean (L, res);
   if (error)
@@ -1889,11 +2066,16 @@ json_utils_match_rules_update_properties (lua_State *L)
   WpSpaJson *json;
   int count;
 
-  json = wplua_checkboxed (L, 1, WP_TYPE_SPA_JSON);
   luaL_checktype (L, 2, LUA_TTABLE);
   properties = wplua_table_to_properties (L, 2);
 
-  count = wp_json_utils_match_rules_update_properties (json, properties);
+  if (wplua_isboxed (L, 1, WP_TYPE_RULE_SET)) {
+    WpRuleSet *rules = wplua_toboxed (L, 1);
+    count = wp_rule_set_update_properties (rules, properties);
+  } else {
+    json = wplua_checkboxed (L, 1, WP_TYPE_SPA_JSON);
+    count = wp_json_utils_match_rules_update_properties (json, properties);
+  }
 
   wplua_properties_to_table (L, properties);
   lua_pushinteger (L, count);
@@ -1906,6 +2088,73 @@ static const luaL_Reg json_utils_funcs[] = {
   { NULL, NULL }
 };
 
+/* WpRuleSet */
+
+static int
+rule_set_new (lua_State *L)
+{
+  WpSpaJson *json = wplua_checkboxed (L, 1, WP_TYPE_SPA_JSON);
+  GError *error = NULL;
+  WpRuleSet *rules = wp_rule_set_new (json, &error);
+
+  /* rules usually come from the configuration; a malformed section must not
+     abort loading the script, so it is reported and treated as empty */
+  if (!rules) {
+    g_autoptr (WpSpaJson) empty = wp_spa_json_new_wrap_string ("[]");
+    wp_warning ("%s; ignoring the rules", error->message);
+    g_error_free (error);
+    rules = wp_rule_set_new (empty, NULL);
+  }
+  wplua_pushboxed (L, WP_TYPE_RULE_SET, rules);
+  return 1;
+}
+
+static int
+rule_set_match (lua_State *L)
+{
+  g_autoptr (WpProperties) properties = NULL;
+  g_autoptr (GError) error = NULL;
+  WpRuleSet *rules = wplua_checkboxed (L, 1, WP_TYPE_RULE_SET);
+  gboolean res;
+
+  luaL_checktype (L, 2, LUA_TTABLE);
+  luaL_checktype (L, 3, LUA_TFUNCTION);
+  properties = wplua_table_to_properties (L, 2);
+
+  res = wp_rule_set_match (rules, properties, json_utils_match_rules_cb,
+      L, &error);
+
+  lua_pushboolean (L, res);
+  if (error)
+    lua_pushstring (L, error->message);
+  else
+    lua_pushnil (L);
+  return 2;
+}
+
+static int
+rule_set_update_properties (lua_State *L)
+{
+  g_autoptr (WpProperties) properties = NULL;
+  WpRuleSet *rules = wplua_checkboxed (L, 1, WP_TYPE_RULE_SET);
+  int count;
+
+  luaL_checktype (L, 2, LUA_TTABLE);
+  properties = wplua_table_to_properties (L, 2);
+
+  count = wp_rule_set_update_properties (rules, properties);
+
+  wplua_properties_to_table (L, properties);
+  lua_pushinteger (L, count);
+  return 2;
+}
+
+static const luaL_Reg rule_set_methods[] = {
+  { "match", rule_set_match },
+  { "update_properties", rule_set_update_properties },
+  { NULL, NULL }
+};
+
 /* WpSettings */
 
 static int
@@ -2873,6 +3122,8 @@ wp_lua_scripting_api_init (lua_State *L)
       NULL, transition_methods);
   wplua_register_type_methods (L, WP_TYPE_CONF,
       conf_new, conf_methods);
+  wplua_register_type_methods (L, WP_TYPE_RULE_SET,
+      rule_set_new, rule_set_methods);
 
   if (!wplua_load_uri (L, URI_API, &error) ||
       !wplua_pcall (L, 0, 0, &error)) {
@@ -216,6 +216,7 @@ SANDBOX_EXPORT = {
   Settings = WpSettings,
   Conf = WpConf,
   JsonUtils = JsonUtils,
+  RuleSet = WpRuleSet_new,
   SimpleEventHook = WpSimpleEventHook_new,
   AsyncEventHook = WpAsyncEventHook_new,
 }
@@ -10,6 +10,7 @@
 #include <wplua/wplua.h>
 
 #include <spa/utils/type.h>
+#include <spa/pod/iter.h>
 
 #define WP_LOCAL_LOG_TOPIC log_topic_lua_scripting
 WP_LOG_TOPIC_EXTERN (log_topic_lua_scripting)
@@ -1157,6 +1158,57 @@ spa_pod_parse (lua_State *L)
   return 1;
 }
 
+/* Pushes the value of the property \a key of the object \a pod, converted
+ * in the same way as in Pod:parse(), without converting the rest of the
+ * object. Pushes nil if \a pod is not an object or it does not have \a key */
+void
+push_luapod_field (lua_State *L, WpSpaPod *pod, const gchar *key)
+{
+  const struct spa_pod_prop *prop = NULL;
+  WpSpaIdValue idval = NULL;
+
+  if (wp_spa_pod_is_object (pod)) {
+    WpSpaIdTable values_table =
+        wp_spa_type_get_values_table (wp_spa_pod_get_spa_type (pod));
+    idval = wp_spa_id_table_find_value_from_short_name (values_table, key);
+  }
+  if (idval) {
+    prop = spa_pod_object_find_prop (
+        (const struct spa_pod_object *) wp_spa_pod_get_spa_pod (pod), NULL,
+        wp_spa_id_value_number (idval));
+  }
+
+  if (prop) {
+    g_autoptr (WpSpaPod) val = wp_spa_pod_new_wrap_const (&prop->value);
+    push_luapod (L, val, idval);
+  } else {
+    lua_pushnil (L);
+  }
+}
+
+static int
+spa_pod_get_field (lua_State *L)
+{
+  WpSpaPod *pod = wplua_checkboxed (L, 1, WP_TYPE_SPA_POD);
+  const gchar *key = luaL_checkstring (L, 2);
+  push_luapod_field (L, pod, key);
+  return 1;
+}
+
+static int
+spa_pod_get_object_id (lua_State *L)
+{
+  WpSpaPod *pod = wplua_checkboxed (L, 1, WP_TYPE_SPA_POD);
+  const gchar *id_name = NULL;
+
+  if (wp_spa_pod_is_object (pod) &&
+      wp_spa_pod_get_object (pod, &id_name, NULL))
+    lua_pushstring (L, id_name);
+  else
+    lua_pushnil (L);
+  return 1;
+}
+
 static int
 spa_pod_fixate (lua_State *L)
 {
@@ -1185,9 +1237,235 @@ spa_pod_filter (lua_State *L)
   return 0;
 }
 
+/* Template */
+
+static int
+spa_pod_template_new (lua_State *L)
+{
+  const gchar *type_name = luaL_checkstring (L, 1);
+  const gchar *id_name = luaL_checkstring (L, 2);
+  WpSpaPodTemplate *tmpl = NULL;
+  const gchar **keys;
+  guint n_keys;
+
+  luaL_checktype (L, 3, LUA_TTABLE);
+  n_keys = lua_rawlen (L, 3);
+
+  /* check the keys before allocating, as luaL_error() does not return */
+  for (guint i = 0; i < n_keys; i++) {
+    if (lua_rawgeti (L, 3, i + 1) != LUA_TSTRING)
+      luaL_error (L, "Pod template key %u is not a string", i + 1);
+    lua_pop (L, 1);
+  }
+
+  /* the key strings are referenced by the table, so they stay valid after
+     being popped */
+  keys = g_new (const gchar *, n_keys + 1);
+  for (guint i = 0; i < n_keys; i++) {
+    lua_rawgeti (L, 3, i + 1);
+    keys[i] = lua_tostring (L, -1);
+    lua_pop (L, 1);
+  }
+  keys[n_keys] = NULL;
+
+  tmpl = wp_spa_pod_template_new (type_name, id_name, keys);
+  g_free (keys);
+
+  if (!tmpl)
+    luaL_error (L, "Invalid pod template for '%s' (%s)", type_name, id_name);
+
+  wplua_pushboxed (L, WP_TYPE_SPA_POD_TEMPLATE, tmpl);
+  return 1;
+}
+
+static guint
+check_template_field (lua_State *L, WpSpaPodTemplate *tmpl, int idx)
+{
+  gint field;
+
+  if (lua_type (L, idx) == LUA_TNUMBER) {
+    field = lua_tointeger (L, idx) - 1;
+    if (field < 0 || (guint) field >= wp_spa_pod_template_get_n_fields (tmpl))
+      luaL_error (L, "Pod template field index out of range");
+  } else {
+    const gchar *key = luaL_checkstring (L, idx);
+    field = wp_spa_pod_template_find_field (tmpl, key);
+    if (field < 0)
+      luaL_error (L, "Pod template has no field '%s'", key);
+  }
+  return field;
+}
+
+static guint32
+check_template_id (lua_State *L, int idx, WpSpaIdTable table)
+{
+  if (lua_type (L, idx) == LUA_TSTRING) {
+    const gchar *name = lua_tostring (L, idx);
+    WpSpaIdValue idval = table ?
+        wp_spa_id_table_find_value_from_short_name (table, name) : NULL;
+    if (!idval)
+      luaL_error (L, "Unknown Id value '%s'", name);
+    return wp_spa_id_value_number (idval);
+  }
+  return luaL_checkinteger (L, idx);
+}
+
+static void
+template_set_array (lua_State *L, WpSpaPodTemplate *tmpl, guint field,
+    int idx)
+{
+  WpSpaIdValue key = wp_spa_pod_template_get_field_key (tmpl, field);
+  WpSpaIdTable table = NULL;
+  WpSpaType item_type = wp_spa_id_value_array_get_item_type (key, &table);
+  guint n_items;
+  union {
+    gboolean b;
+    guint32 id;
+    gint32 i;
+    gint64 l;
+    float f;
+    double d;
+  } static_items[64], *items = static_items;
+
+  luaL_checktype (L, idx, LUA_TTABLE);
+  switch (item_type) {
+    case SPA_TYPE_Bool:
+    case SPA_TYPE_Id:
+    case SPA_TYPE_Int:
+    case SPA_TYPE_Long:
+    case SPA_TYPE_Float:
+    case SPA_TYPE_Double:
+      break;
+    default:
+      luaL_error (L, "Unsupported array item type '%s'",
+          wp_spa_type_name (item_type));
+      break;
+  }
+
+  /* the luaL_check* functions below do not return on error, so larger
+     arrays are kept in a userdata that is collected by lua in any case */
+  n_items = lua_rawlen (L, idx);
+  if (n_items > G_N_ELEMENTS (static_items))
+    items = lua_newuserdata (L, n_items * sizeof (*items));
+
+  /* fill in the items packed, as they will appear in the pod */
+  for (guint i = 0; i < n_items; i++) {
+    lua_rawgeti (L, idx, i + 1);
+    switch (item_type) {
+      case SPA_TYPE_Bool:
+        ((gboolean *) items)[i] = lua_toboolean (L, -1);
+        break;
+      case SPA_TYPE_Id:
+        ((guint32 *) items)[i] = check_template_id (L, -1, table);
+        break;
+      case SPA_TYPE_Int:
+        ((gint32 *) items)[i] = luaL_checkinteger (L, -1);
+        break;
+      case SPA_TYPE_Long:
+        ((gint64 *) items)[i] = luaL_checkinteger (L, -1);
+        break;
+      case SPA_TYPE_Float:
+        ((float *) items)[i] = luaL_checknumber (L, -1);
+        break;
+      case SPA_TYPE_Double:
+        ((double *) items)[i] = luaL_checknumber (L, -1);
+        break;
+      default:
+        g_assert_not_reached ();
+    }
+    lua_pop (L, 1);
+  }
+
+  wp_spa_pod_template_set_array (tmpl, field, n_items, items);
+  if (items != static_items)
+    lua_pop (L, 1);
+}
+
+static int
+spa_pod_template_set (lua_State *L)
+{
+  WpSpaPodTemplate *tmpl = wplua_checkboxed (L, 1, WP_TYPE_SPA_POD_TEMPLATE);
+  guint field = check_template_field (L, tmpl, 2);
+  WpSpaType type;
+
+  if (lua_isnoneornil (L, 3)) {
+    wp_spa_pod_template_unset (tmpl, field);
+    return 0;
+  }
+
+  if (wplua_isboxed (L, 3, WP_TYPE_SPA_POD)) {
+    wp_spa_pod_template_set_pod (tmpl, field,
+        wplua_toboxed (L, 3));
+    return 0;
+  }
+
+  type = wp_spa_pod_template_get_field_type (tmpl, field);
+  switch (type) {
+    case SPA_TYPE_Bool:
+      wp_spa_pod_template_set_boolean (tmpl, field, lua_toboolean (L, 3));
+      break;
+    case SPA_TYPE_Id: {
+      WpSpaIdTable table = NULL;
+      wp_spa_id_value_get_value_type (
+          wp_spa_pod_template_get_field_key (tmpl, field), &table);
+      wp_spa_pod_template_set_id (tmpl, field,
+          check_template_id (L, 3, table));
+      break;
+    }
+    case SPA_TYPE_Int:
+      wp_spa_pod_template_set_int (tmpl, field, luaL_checkinteger (L, 3));
+      break;
+    case SPA_TYPE_Long:
+      wp_spa_pod_template_set_long (tmpl, field, luaL_checkinteger (L, 3));
+      break;
+    case SPA_TYPE_Float:
+      wp_spa_pod_template_set_float (tmpl, field, luaL_checknumber (L, 3));
+      break;
+    case SPA_TYPE_Double:
+      wp_spa_pod_template_set_double (tmpl, field, luaL_checknumber (L, 3));
+      break;
+    case SPA_TYPE_String:
+      wp_spa_pod_template_set_string (tmpl, field, luaL_checkstring (L, 3));
+      break;
+    case SPA_TYPE_Array:
+      template_set_array (L, tmpl, field, 3);
+      break;
+    default:
+      luaL_error (L, "Field of type '%s' can only be set from a Pod",
+          wp_spa_type_name (type));
+      break;
+  }
+  return 0;
+}
+
+static int
+spa_pod_template_clear (lua_State *L)
+{
+  WpSpaPodTemplate *tmpl = wplua_checkboxed (L, 1, WP_TYPE_SPA_POD_TEMPLATE);
+  wp_spa_pod_template_clear (tmpl);
+  return 0;
+}
+
+static int
+spa_pod_template_build (lua_State *L)
+{
+  WpSpaPodTemplate *tmpl = wplua_checkboxed (L, 1, WP_TYPE_SPA_POD_TEMPLATE);
+  wplua_pushboxed (L, WP_TYPE_SPA_POD, wp_spa_pod_template_build (tmpl));
+  return 1;
+}
+
+static const luaL_Reg spa_pod_template_methods[] = {
+  { "set", spa_pod_template_set },
+  { "clear", spa_pod_template_clear },
+  { "build", spa_pod_template_build },
+  { NULL, NULL }
+};
+
 static const luaL_Reg spa_pod_methods[] = {
   { "get_type_name", spa_pod_get_type_name },
   { "parse", spa_pod_parse },
+  { "get_field", spa_pod_get_field },
+  { "get_object_id", spa_pod_get_object_id },
   { "fixate", spa_pod_fixate },
   { "filter", spa_pod_filter },
   { NULL, NULL }
@@ -1211,6 +1489,7 @@ static const luaL_Reg spa_pod_constructors[] = {
   { "Struct", spa_pod_struct_new },
   { "Sequence", spa_pod_sequence_new },
   { "Array", spa_pod_array_new },
+  { "Template", spa_pod_template_new },
   { NULL, NULL }
 };
 
@@ -1234,4 +1513,6 @@ wp_lua_scripting_pod_init (lua_State *L)
   lua_setglobal (L, "WpSpaPod");
 
   wplua_register_type_methods (L, WP_TYPE_SPA_POD, NULL, spa_pod_methods);
+  wplua_register_type_methods (L, WP_TYPE_SPA_POD_TEMPLATE, NULL,
+      spa_pod_template_methods);
 }
@@ -21,8 +21,17 @@ struct _WpLuaScriptingPlugin
 {
   WpPlugin parent;
   lua_State *L;
+  WpSettings *settings;
+  guintptr gc_settings_sub;
 };
 
+enum {
+  ACTION_GET_MEMORY_STATS,
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = {0};
+
 static int
 wp_lua_scripting_package_loader (lua_State *L)
 {
@@ -78,6 +87,68 @@ wp_lua_scripting_enable_package_searcher (lua_State *L)
   lua_call (L, 3, 0);
 }
 
+static gint
+get_int_setting (WpSettings * settings, const gchar * name)
+{
+  g_autoptr (WpSpaJson) j = wp_settings_get (settings, name);
+  gint val = 0;
+  if (j)
+    wp_spa_json_parse_int (j, &val);
+  return val;
+}
+
+static gchar *
+get_string_setting (WpSettings * settings, const gchar * name)
+{
+  g_autoptr (WpSpaJson) j = wp_settings_get (settings, name);
+  return (j && wp_spa_json_is_string (j)) ? wp_spa_json_parse_string (j) : NULL;
+}
+
+static void
+wp_lua_scripting_apply_gc_settings (WpSettings * settings,
+    const gchar * setting, WpSpaJson * value, gpointer data)
+{
+  WpLuaScriptingPlugin * self = data;
+  g_autofree gchar *mode = get_string_setting (settings, "lua.gc.mode");
+  g_autofree gchar *collect =
+      get_string_setting (settings, "lua.gc.collect-after-callback");
+  WpLuaGcConfig config = {
+    .mode = !g_strcmp0 (mode, "generational") ?
+        WP_LUA_GC_MODE_GENERATIONAL : WP_LUA_GC_MODE_INCREMENTAL,
+    .pause = get_int_setting (settings, "lua.gc.pause"),
+    .step_multiplier = get_int_setting (settings, "lua.gc.step-multiplier"),
+    .minor_multiplier = get_int_setting (settings, "lua.gc.minor-multiplier"),
+    .major_multiplier = get_int_setting (settings, "lua.gc.major-multiplier"),
+    .full_collect_after_callback = g_strcmp0 (collect, "step") != 0,
+  };
+
+  if (!self->L)
+    return;
+
+  wp_info_object (self, "lua gc: %s mode, %s collection after callbacks",
+      config.mode == WP_LUA_GC_MODE_GENERATIONAL ? "generational" : "incremental",
+      config.full_collect_after_callback ? "full" : "step");
+
+  wplua_configure_gc (self->L, &config);
+}
+
+static void
+wp_lua_scripting_plugin_setup_gc (WpLuaScriptingPlugin * self, WpCore * core)
+{
+  if (self->settings)
+    return;
+
+  /* the settings instance may not be there yet when the plugin is enabled;
+     this is also retried when the first script is loaded */
+  self->settings = wp_settings_find (core, NULL);
+  if (!self->settings)
+    return;
+
+  self->gc_settings_sub = wp_settings_subscribe (self->settings, "lua.gc.*",
+      wp_lua_scripting_apply_gc_settings, self);
+  wp_lua_scripting_apply_gc_settings (self->settings, NULL, NULL, self);
+}
+
 static void wp_lua_scripting_component_loader_init (WpComponentLoaderInterface * iface);
 
 G_DECLARE_FINAL_TYPE (WpLuaScriptingPlugin, wp_lua_scripting_plugin,
@@ -108,6 +179,7 @@ wp_lua_scripting_plugin_enable (WpPlugin * plugin, WpTransition * transition)
   wp_lua_scripting_api_init (self->L);
   wp_lua_scripting_enable_package_searcher (self->L);
   wplua_enable_sandbox (self->L, WP_LUA_SANDBOX_ISOLATE_ENV);
+  wp_lua_scripting_plugin_setup_gc (self, core);
 
   wp_object_update_features (WP_OBJECT (self), WP_PLUGIN_FEATURE_ENABLED, 0);
 }
@@ -117,6 +189,11 @@ wp_lua_scripting_plugin_disable (WpPlugin * plugin)
 {
   WpLuaScriptingPlugin * self = WP_LUA_SCRIPTING_PLUGIN (plugin);
 
+  if (self->settings) {
+    wp_settings_unsubscribe (self->settings, self->gc_settings_sub);
+    self->gc_settings_sub = 0;
+    g_clear_object (&self->settings);
+  }
   g_clear_pointer (&self->L, wplua_unref);
 }
 
@@ -177,6 +254,8 @@ wp_lua_scripting_plugin_load (WpComponentLoader * cl, WpCore * core,
     return;
   }
 
+  wp_lua_scripting_plugin_setup_gc (self, core);
+
   pluginname = g_strdup_printf ("script:%s", component);
 
   script = g_object_new (WP_TYPE_LUA_SCRIPT,
@@ -200,6 +279,36 @@ wp_lua_scripting_plugin_load_finish (WpComponentLoader * self,
   return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+static GVariant *
+wp_lua_scripting_plugin_get_memory_stats (WpLuaScriptingPlugin * self)
+{
+  g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
+  WpLuaMemoryStats stats;
+
+  if (!self->L)
+    return NULL;
+
+  wplua_get_memory_stats (self->L, &stats);
+
+  g_variant_builder_add (&b, "{sv}", "heap-size",
+      g_variant_new_uint64 (stats.heap_size));
+  g_variant_builder_add (&b, "{sv}", "heap-peak",
+      g_variant_new_uint64 (stats.heap_peak));
+  g_variant_builder_add (&b, "{sv}", "pool-size",
+      g_variant_new_uint64 (stats.pool_size));
+  g_variant_builder_add (&b, "{sv}", "allocations",
+      g_variant_new_uint64 (stats.n_allocs));
+  g_variant_builder_add (&b, "{sv}", "gc-cycles",
+      g_variant_new_uint64 (stats.gc_cycles));
+  g_variant_builder_add (&b, "{sv}", "gc-collections",
+      g_variant_new_uint64 (stats.gc_collections));
+  g_variant_builder_add (&b, "{sv}", "gc-pause-max-us",
+      g_variant_new_int64 (stats.gc_pause_max));
+  g_variant_builder_add (&b, "{sv}", "gc-pause-total-us",
+      g_variant_new_int64 (stats.gc_pause_total));
+  return g_variant_builder_end (&b);
+}
+
 static void
 wp_lua_scripting_plugin_class_init (WpLuaScriptingPluginClass * klass)
 {
@@ -207,6 +316,15 @@ wp_lua_scripting_plugin_class_init (WpLuaScriptingPluginClass * klass)
 
   plugin_class->enable = wp_lua_scripting_plugin_enable;
   plugin_class->disable = wp_lua_scripting_plugin_disable;
+
+  /* -> "a{sv}" with the memory & gc statistics of the Lua engine,
+     or NULL if the engine is not running */
+  signals[ACTION_GET_MEMORY_STATS] = g_signal_new_class_handler (
+      "get-memory-stats", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_lua_scripting_plugin_get_memory_stats,
+      NULL, NULL, NULL,
+      G_TYPE_VARIANT, 0);
 }
 
 static void
@@ -208,6 +208,8 @@ wp_lua_script_enable (WpPlugin * plugin, WpTransition * transition)
 {
   WpLuaScript *self = WP_LUA_SCRIPT (plugin);
   g_autoptr (GError) error = NULL;
+  gpointer prev_owner;
+  gboolean ok;
   int top, nargs = 3;
 
   if (!self->L) {
@@ -235,8 +237,14 @@ wp_lua_script_enable (WpPlugin * plugin, WpTransition * transition)
     nargs++;
   }
 
-  /* execute script */
-  if (!wplua_pcall (self->L, nargs, 0, &error)) {
+  /* execute script; account its allocations, as well as the allocations
+     of any closures that it creates, to it */
+  prev_owner = wplua_memory_owner_enter (self->L,
+      wp_plugin_get_name (WP_PLUGIN (self)));
+  ok = wplua_pcall (self->L, nargs, 0, &error);
+  wplua_memory_owner_leave (self->L, prev_owner);
+
+  if (!ok) {
     lua_settop (self->L, top);
     wp_transition_return_error (transition, g_steal_pointer (&error));
     wp_lua_script_cleanup (self);
@@ -63,6 +63,7 @@ struct _WpLuaClosure
   GClosure closure;
   int func_ref;
   GPtrArray *closures;
+  gpointer memory_owner;
 };
 
 static void
@@ -73,6 +74,7 @@ _wplua_closure_marshal (GClosure *closure, GValue *return_value,
   static int reentrant = 0;
   lua_State *L = closure->data;
   int func_ref = ((WpLuaClosure *) closure)->func_ref;
+  gpointer prev_owner;
 
   /* invalid closure, skip it */
   if (func_ref == LUA_NOREF || func_ref == LUA_REFNIL)
@@ -82,6 +84,10 @@ _wplua_closure_marshal (GClosure *closure, GValue *return_value,
   if (reentrant == 0)
     lua_gc (L, LUA_GCSTOP, 0);
 
+  /* account allocations to whoever created the closure */
+  prev_owner = _wplua_memory_owner_swap (L,
+      ((WpLuaClosure *) closure)->memory_owner);
+
   /* push the function */
   lua_rawgeti (L, LUA_REGISTRYINDEX, func_ref);
 
@@ -100,8 +106,10 @@ _wplua_closure_marshal (GClosure *closure, GValue *return_value,
     lua_pop (L, 1);
   }
 
+  _wplua_memory_owner_swap (L, prev_owner);
+
   /* clean up */
-  lua_gc (L, LUA_GCCOLLECT, 0);
+  _wplua_gc_after_callback (L);
   if (reentrant == 0)
     lua_gc (L, LUA_GCRESTART, 0);
 }
@@ -146,6 +154,7 @@ wplua_function_to_closure (lua_State *L, int idx)
 
   lua_pushvalue (L, idx);
   wlc->func_ref = luaL_ref (L, LUA_REGISTRYINDEX);
+  wlc->memory_owner = _wplua_memory_owner_get (L);
 
   wp_trace_boxed (G_TYPE_CLOSURE, c, "created, func_ref = %d", wlc->func_ref);
 
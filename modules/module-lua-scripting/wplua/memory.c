@@ -0,0 +1,399 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "wplua.h"
+#include "private.h"
+#include <wp/wp.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Memory management of the lua_State.
+ *
+ * Scripts allocate lots of small objects (tables, closures, strings, userdata
+ * headers) and free them again shortly after, so all allocations up to
+ * POOL_MAX_SIZE bytes are served from per-size-class free lists that are
+ * refilled in chunks of POOL_CHUNK_SIZE bytes. Chunks are only released
+ * when the state is closed; the pool grows to the peak working set of small
+ * objects and stays there. Bigger allocations go straight to the system
+ * allocator.
+ *
+ * The allocator also keeps statistics about the heap, which are exposed
+ * together with statistics about garbage collection, and accounts
+ * allocations to an "owner" (a script), if one is set.
+ */
+
+#define POOL_GRANULARITY 16
+#define POOL_N_CLASSES 16
+#define POOL_MAX_SIZE (POOL_GRANULARITY * POOL_N_CLASSES)
+#define POOL_CHUNK_SIZE 8192
+
+#define SIZE_CLASS(s) \
+  (((s) == 0 || (s) > POOL_MAX_SIZE) ? -1 : (gint) (((s) - 1) / POOL_GRANULARITY))
+
+typedef struct _PoolBlock PoolBlock;
+struct _PoolBlock
+{
+  PoolBlock *next;
+};
+
+typedef struct _WpLuaMemoryOwner WpLuaMemoryOwner;
+struct _WpLuaMemoryOwner
+{
+  gchar *name;
+  guint64 allocated;
+  guint64 n_allocs;
+};
+
+typedef struct _WpLuaMemory WpLuaMemory;
+struct _WpLuaMemory
+{
+  PoolBlock *free_lists[POOL_N_CLASSES];
+  GPtrArray *chunks;
+
+  WpLuaMemoryStats stats;
+
+  GHashTable *owners;
+  WpLuaMemoryOwner *owner;
+
+  gboolean full_collect_after_callback;
+  gboolean closing;
+};
+
+static void
+_wplua_memory_owner_free (WpLuaMemoryOwner * owner)
+{
+  g_free (owner->name);
+  g_slice_free (WpLuaMemoryOwner, owner);
+}
+
+static gpointer
+_pool_alloc (WpLuaMemory * mem, gint cls)
+{
+  PoolBlock *b = mem->free_lists[cls];
+
+  if (G_UNLIKELY (!b)) {
+    gsize block_size = (cls + 1) * POOL_GRANULARITY;
+    guint8 *chunk = g_try_malloc (POOL_CHUNK_SIZE);
+    if (!chunk)
+      return NULL;
+
+    g_ptr_array_add (mem->chunks, chunk);
+    mem->stats.pool_size += POOL_CHUNK_SIZE;
+
+    /* carve the chunk into blocks, in reverse so that the free list
+       hands them out in address order */
+    for (gsize off = (POOL_CHUNK_SIZE / block_size) * block_size; off > 0;
+        off -= block_size) {
+      PoolBlock *nb = (PoolBlock *) (chunk + off - block_size);
+      nb->next = b;
+      b = nb;
+    }
+  }
+
+  mem->free_lists[cls] = b->next;
+  mem->stats.n_pool_allocs++;
+  return b;
+}
+
+static inline void
+_pool_free (WpLuaMemory * mem, gint cls, gpointer ptr)
+{
+  PoolBlock *b = ptr;
+  b->next = mem->free_lists[cls];
+  mem->free_lists[cls] = b;
+}
+
+static void *
+_wplua_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
+{
+  WpLuaMemory *mem = ud;
+  gint ocls, ncls;
+  void *nptr;
+
+  /* when ptr is NULL, osize encodes the type of the object */
+  if (!ptr)
+    osize = 0;
+
+  ocls = SIZE_CLASS (osize);
+
+  if (nsize == 0) {
+    if (ptr) {
+      if (ocls >= 0)
+        _pool_free (mem, ocls, ptr);
+      else
+        free (ptr);
+      mem->stats.heap_size -= osize;
+    }
+    return NULL;
+  }
+
+  ncls = SIZE_CLASS (nsize);
+
+  if (ptr && ocls >= 0 && ocls == ncls) {
+    /* the block is big enough already */
+    nptr = ptr;
+  } else if (ocls < 0 && ncls < 0) {
+    nptr = realloc (ptr, nsize);
+    if (!nptr)
+      return NULL;
+  } else {
+    nptr = (ncls >= 0) ? _pool_alloc (mem, ncls) : malloc (nsize);
+    if (!nptr)
+      return NULL;
+    if (ptr) {
+      memcpy (nptr, ptr, MIN (osize, nsize));
+      if (ocls >= 0)
+        _pool_free (mem, ocls, ptr);
+      else
+        free (ptr);
+    }
+  }
+
+  mem->stats.heap_size += nsize;
+  mem->stats.heap_size -= osize;
+  if (mem->stats.heap_size > mem->stats.heap_peak)
+    mem->stats.heap_peak = mem->stats.heap_size;
+
+  if (!ptr)
+    mem->stats.n_allocs++;
+
+  if (mem->owner && nsize > osize) {
+    mem->owner->allocated += nsize - osize;
+    if (!ptr)
+      mem->owner->n_allocs++;
+  }
+
+  return nptr;
+}
+
+static int
+_wplua_panic (lua_State *L)
+{
+  const gchar *msg = lua_tostring (L, -1);
+  wp_critical ("PANIC: unprotected error in call to Lua API (%s)",
+      msg ? msg : "error object is not a string");
+  return 0;
+}
+
+static WpLuaMemory *
+_wplua_memory_get (lua_State *L)
+{
+  void *ud = NULL;
+  lua_Alloc f = lua_getallocf (L, &ud);
+  g_return_val_if_fail (f == _wplua_alloc, NULL);
+  return ud;
+}
+
+lua_State *
+_wplua_newstate (void)
+{
+  WpLuaMemory *mem = g_slice_new0 (WpLuaMemory);
+  lua_State *L;
+
+  mem->chunks = g_ptr_array_new_with_free_func (g_free);
+  mem->owners = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) _wplua_memory_owner_free);
+  mem->full_collect_after_callback = TRUE;
+
+  L = lua_newstate (_wplua_alloc, mem);
+  if (G_UNLIKELY (!L)) {
+    g_hash_table_unref (mem->owners);
+    g_ptr_array_unref (mem->chunks);
+    g_slice_free (WpLuaMemory, mem);
+    return NULL;
+  }
+
+  lua_atpanic (L, _wplua_panic);
+  return L;
+}
+
+void
+_wplua_close (lua_State *L)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+
+  mem->closing = TRUE;
+  mem->owner = NULL;
+  lua_close (L);
+
+  wp_debug ("lua memory: peak heap %" G_GSIZE_FORMAT " bytes, "
+      "%" G_GUINT64_FORMAT " allocations (%" G_GUINT64_FORMAT " from the pool, "
+      "%" G_GSIZE_FORMAT " bytes), %" G_GUINT64_FORMAT " gc cycles, "
+      "gc pause max %.1f ms, total %.1f ms",
+      mem->stats.heap_peak, mem->stats.n_allocs, mem->stats.n_pool_allocs,
+      mem->stats.pool_size, mem->stats.gc_cycles,
+      mem->stats.gc_pause_max / 1000.0, mem->stats.gc_pause_total / 1000.0);
+
+  g_hash_table_unref (mem->owners);
+  g_ptr_array_unref (mem->chunks);
+  g_slice_free (WpLuaMemory, mem);
+}
+
+/* A table with a __gc metamethod that re-creates itself every time it is
+   collected; this counts the garbage collection cycles that have completed */
+static void
+_wplua_new_gc_sentinel (lua_State *L)
+{
+  lua_newtable (L);
+  luaL_setmetatable (L, "wplua_gc_sentinel");
+  lua_pop (L, 1);
+}
+
+static int
+_wplua_gc_sentinel___gc (lua_State *L)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+
+  mem->stats.gc_cycles++;
+  if (!mem->closing)
+    _wplua_new_gc_sentinel (L);
+  return 0;
+}
+
+void
+_wplua_init_memory (lua_State *L)
+{
+  luaL_newmetatable (L, "wplua_gc_sentinel");
+  lua_pushcfunction (L, _wplua_gc_sentinel___gc);
+  lua_setfield (L, -2, "__gc");
+  lua_pop (L, 1);
+
+  _wplua_new_gc_sentinel (L);
+}
+
+/* called after a Lua function has been called from C through a closure */
+void
+_wplua_gc_after_callback (lua_State *L)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+  gint64 start = g_get_monotonic_time ();
+  gint64 pause;
+
+  if (mem->full_collect_after_callback)
+    lua_gc (L, LUA_GCCOLLECT, 0);
+  else
+    lua_gc (L, LUA_GCSTEP, 0);
+
+  pause = g_get_monotonic_time () - start;
+  mem->stats.gc_collections++;
+  mem->stats.gc_pause_last = pause;
+  mem->stats.gc_pause_total += pause;
+  if (pause > mem->stats.gc_pause_max)
+    mem->stats.gc_pause_max = pause;
+
+  wp_trace ("lua gc after callback: %" G_GINT64_FORMAT " us, "
+      "heap %" G_GSIZE_FORMAT " bytes", pause, mem->stats.heap_size);
+}
+
+gpointer
+_wplua_memory_owner_get (lua_State *L)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+  return mem->owner;
+}
+
+gpointer
+_wplua_memory_owner_swap (lua_State *L, gpointer owner)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+  gpointer prev = mem->owner;
+  mem->owner = owner;
+  return prev;
+}
+
+/**
+ * wplua_memory_owner_enter:
+ *
+ * Accounts all subsequent allocations in @em L to the owner called @em name,
+ * until wplua_memory_owner_leave() is called. Closures that are created
+ * while an owner is set keep accounting their allocations to it when called.
+ *
+ * Returns: the previous owner, to be passed to wplua_memory_owner_leave()
+ */
+gpointer
+wplua_memory_owner_enter (lua_State *L, const gchar *name)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+  WpLuaMemoryOwner *owner;
+
+  g_return_val_if_fail (name != NULL, NULL);
+
+  owner = g_hash_table_lookup (mem->owners, name);
+  if (!owner) {
+    owner = g_slice_new0 (WpLuaMemoryOwner);
+    owner->name = g_strdup (name);
+    g_hash_table_insert (mem->owners, owner->name, owner);
+  }
+  return _wplua_memory_owner_swap (L, owner);
+}
+
+void
+wplua_memory_owner_leave (lua_State *L, gpointer previous)
+{
+  _wplua_memory_owner_swap (L, previous);
+}
+
+void
+wplua_foreach_memory_owner (lua_State *L, WpLuaMemoryOwnerFunc func,
+    gpointer data)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+  GHashTableIter iter;
+  WpLuaMemoryOwner *owner;
+
+  g_hash_table_iter_init (&iter, mem->owners);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &owner))
+    func (owner->name, owner->allocated, owner->n_allocs, data);
+}
+
+void
+wplua_get_memory_stats (lua_State *L, WpLuaMemoryStats *stats)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+  g_return_if_fail (stats != NULL);
+  *stats = mem->stats;
+}
+
+/**
+ * wplua_configure_gc:
+ *
+ * Configures the garbage collector of @em L. Parameters set to 0 leave
+ * the corresponding value of the collector unchanged.
+ *
+ * Returns: FALSE if the requested mode is not supported by this version
+ *   of Lua, in which case the incremental mode is configured instead
+ */
+gboolean
+wplua_configure_gc (lua_State *L, const WpLuaGcConfig *config)
+{
+  WpLuaMemory *mem = _wplua_memory_get (L);
+  gboolean ret = TRUE;
+
+  g_return_val_if_fail (config != NULL, FALSE);
+
+  mem->full_collect_after_callback = config->full_collect_after_callback;
+
+#if LUA_VERSION_NUM >= 504
+  if (config->mode == WP_LUA_GC_MODE_GENERATIONAL) {
+    lua_gc (L, LUA_GCGEN, config->minor_multiplier, config->major_multiplier);
+  } else {
+    lua_gc (L, LUA_GCINC, config->pause, config->step_multiplier, 0);
+  }
+#else
+  if (config->mode == WP_LUA_GC_MODE_GENERATIONAL) {
+    wp_info ("generational gc is not supported by this version of Lua");
+    ret = FALSE;
+  }
+  if (config->pause > 0)
+    lua_gc (L, LUA_GCSETPAUSE, config->pause);
+  if (config->step_multiplier > 0)
+    lua_gc (L, LUA_GCSETSTEPMUL, config->step_multiplier);
+#endif
+
+  return ret;
+}
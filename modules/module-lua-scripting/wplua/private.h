@@ -32,6 +32,14 @@ gboolean _wplua_isgvalue_userdata (lua_State *L, int idx, GType type);
 int _wplua_gvalue_userdata___gc (lua_State *L);
 int _wplua_gvalue_userdata___eq (lua_State *L);
 
+/* memory.c */
+lua_State * _wplua_newstate (void);
+void _wplua_close (lua_State *L);
+void _wplua_init_memory (lua_State *L);
+void _wplua_gc_after_callback (lua_State *L);
+gpointer _wplua_memory_owner_get (lua_State *L);
+gpointer _wplua_memory_owner_swap (lua_State *L, gpointer owner);
+
 /* wplua.c */
 int _wplua_pcall (lua_State *L, int nargs, int nret);
 
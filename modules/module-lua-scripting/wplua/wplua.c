@@ -82,7 +82,9 @@ lua_State *
 wplua_new (void)
 {
   static gboolean resource_registered = FALSE;
-  lua_State *L = luaL_newstate ();
+  lua_State *L = _wplua_newstate ();
+
+  g_return_val_if_fail (L != NULL, NULL);
 
   wp_debug ("initializing lua_State %p", L);
 
@@ -92,6 +94,7 @@ wplua_new (void)
   }
 
   _wplua_openlibs (L);
+  _wplua_init_memory (L);
   _wplua_init_gboxed (L);
   _wplua_init_gobject (L);
   _wplua_init_closure (L);
@@ -134,7 +137,7 @@ wplua_unref (lua_State * L)
     lua_pop (L, 1);
   } else {
     wp_debug ("closing lua_State %p", L);
-    lua_close (L);
+    _wplua_close (L);
   }
 }
 
@@ -51,6 +51,54 @@ lua_State * wplua_new (void);
 lua_State * wplua_ref (lua_State *L);
 void wplua_unref (lua_State * L);
 
+typedef enum {
+  WP_LUA_GC_MODE_INCREMENTAL,
+  WP_LUA_GC_MODE_GENERATIONAL,
+} WpLuaGcMode;
+
+typedef struct _WpLuaGcConfig WpLuaGcConfig;
+struct _WpLuaGcConfig
+{
+  WpLuaGcMode mode;
+  /* incremental mode */
+  gint pause;
+  gint step_multiplier;
+  /* generational mode */
+  gint minor_multiplier;
+  gint major_multiplier;
+  /* whether to run a full collection after every call into Lua from C,
+     or just a single step of the collector */
+  gboolean full_collect_after_callback;
+};
+
+gboolean wplua_configure_gc (lua_State *L, const WpLuaGcConfig *config);
+
+typedef struct _WpLuaMemoryStats WpLuaMemoryStats;
+struct _WpLuaMemoryStats
+{
+  gsize heap_size;
+  gsize heap_peak;
+  gsize pool_size;
+  guint64 n_allocs;
+  guint64 n_pool_allocs;
+  guint64 gc_cycles;
+  guint64 gc_collections;
+  /* in microseconds */
+  gint64 gc_pause_last;
+  gint64 gc_pause_max;
+  gint64 gc_pause_total;
+};
+
+typedef void (*WpLuaMemoryOwnerFunc) (const gchar *name, guint64 allocated,
+    guint64 n_allocs, gpointer data);
+
+void wplua_get_memory_stats (lua_State *L, WpLuaMemoryStats *stats);
+void wplua_foreach_memory_owner (lua_State *L, WpLuaMemoryOwnerFunc func,
+    gpointer data);
+
+gpointer wplua_memory_owner_enter (lua_State *L, const gchar *name);
+void wplua_memory_owner_leave (lua_State *L, gpointer previous);
+
 void wplua_enable_sandbox (lua_State * L, WpLuaSandboxFlags flags);
 int wplua_push_sandbox (lua_State * L);
 
@@ -0,0 +1,617 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <wp/wp.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+
+WP_DEFINE_LOCAL_LOG_TOPIC ("m-metrics")
+
+/*
+ * This module exports internal counters of the daemon in the Prometheus
+ * text exposition format, either on a local unix socket, which writes the
+ * current values to every client that connects and then closes the
+ * connection, or to a text file that is rewritten periodically (suitable for
+ * the textfile collector of node_exporter), or both.
+ *
+ * The counters are kept by the components that own them (event dispatcher,
+ * registry, state files, Lua engine, links) and are only read and formatted
+ * when a client connects or the text file is rewritten. The only cost while
+ * nobody is reading them is that of the per event type and per hook
+ * statistics of the event dispatcher, which are enabled by this module.
+ */
+
+#define DEFAULT_TEXTFILE_INTERVAL_MS 15000
+
+struct _WpMetrics
+{
+  WpPlugin parent;
+
+  /* Props */
+  gchar *socket_path;
+  gchar *textfile;
+  guint textfile_interval_ms;
+
+  WpEventDispatcher *dispatcher;
+  WpObjectManager *links_om;
+  GSocketService *service;
+  GSource *textfile_source;
+
+  guint64 n_link_errors;
+  guint64 n_link_activation_failures;
+};
+
+enum {
+  PROP_0,
+  PROP_SOCKET_PATH,
+  PROP_TEXTFILE,
+  PROP_TEXTFILE_INTERVAL_MS,
+};
+
+G_DECLARE_FINAL_TYPE (WpMetrics, wp_metrics, WP, METRICS, WpPlugin)
+G_DEFINE_TYPE (WpMetrics, wp_metrics, WP_TYPE_PLUGIN)
+
+static void
+wp_metrics_init (WpMetrics * self)
+{
+}
+
+/* formatting */
+
+typedef struct _Sample Sample;
+struct _Sample
+{
+  const gchar *label;
+  guint64 count;
+  gint64 total;
+  gint64 max;
+};
+
+static gint
+sample_compare (const Sample * a, const Sample * b)
+{
+  return g_strcmp0 (a->label, b->label);
+}
+
+static void
+append_header (GString * s, const gchar * name, const gchar * type,
+    const gchar * help)
+{
+  g_string_append_printf (s, "# HELP %s %s\n# TYPE %s %s\n",
+      name, help, name, type);
+}
+
+static void
+append_name (GString * s, const gchar * name, const gchar * label_name,
+    const gchar * label_value)
+{
+  g_string_append (s, name);
+  if (label_name) {
+    g_string_append_printf (s, "{%s=\"", label_name);
+    for (const gchar *c = label_value ? label_value : ""; *c; c++) {
+      switch (*c) {
+        case '\\': g_string_append (s, "\\\\"); break;
+        case '"': g_string_append (s, "\\\""); break;
+        case '\n': g_string_append (s, "\\n"); break;
+        default: g_string_append_c (s, *c); break;
+      }
+    }
+    g_string_append (s, "\"}");
+  }
+}
+
+static void
+append_uint (GString * s, const gchar * name, const gchar * label_name,
+    const gchar * label_value, guint64 value)
+{
+  append_name (s, name, label_name, label_value);
+  g_string_append_printf (s, " %" G_GUINT64_FORMAT "\n", value);
+}
+
+static void
+append_seconds (GString * s, const gchar * name, const gchar * label_name,
+    const gchar * label_value, gint64 usec)
+{
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  append_name (s, name, label_name, label_value);
+  g_string_append_printf (s, " %s\n",
+      g_ascii_formatd (buf, sizeof (buf), "%.6f", usec / 1e6));
+}
+
+static void
+collect_event_stats (const gchar * event_type, guint64 n_pushed,
+    guint64 n_dispatched, GArray * samples)
+{
+  Sample s = { event_type, n_pushed, n_dispatched, 0 };
+  g_array_append_val (samples, s);
+}
+
+static void
+collect_hook_stats (const gchar * hook_name, guint64 n_runs,
+    gint64 total_usec, gint64 max_usec, GArray * samples)
+{
+  Sample s = { hook_name, n_runs, total_usec, max_usec };
+  g_array_append_val (samples, s);
+}
+
+static void
+render_events (WpMetrics * self, GString * s)
+{
+  g_autoptr (GArray) samples = g_array_new (FALSE, FALSE, sizeof (Sample));
+  guint64 n_events = 0;
+  gint64 wait_max = 0, wait_total = 0;
+
+  wp_event_dispatcher_foreach_event_stats (self->dispatcher,
+      (WpEventStatsFunc) collect_event_stats, samples);
+  g_array_sort (samples, (GCompareFunc) sample_compare);
+
+  append_header (s, "wireplumber_events_pushed_total", "counter",
+      "Events pushed to the event dispatcher, by event type");
+  for (guint i = 0; i < samples->len; i++) {
+    Sample *e = &g_array_index (samples, Sample, i);
+    append_uint (s, "wireplumber_events_pushed_total", "type", e->label,
+        e->count);
+  }
+
+  append_header (s, "wireplumber_events_dispatched_total", "counter",
+      "Events that started running their hooks, by event type");
+  for (guint i = 0; i < samples->len; i++) {
+    Sample *e = &g_array_index (samples, Sample, i);
+    append_uint (s, "wireplumber_events_dispatched_total", "type", e->label,
+        (guint64) e->total);
+  }
+
+  append_header (s, "wireplumber_events_coalesced_total", "counter",
+      "Events merged into an equivalent queued event");
+  append_uint (s, "wireplumber_events_coalesced_total", NULL, NULL,
+      wp_event_dispatcher_get_n_coalesced_events (self->dispatcher));
+
+  append_header (s, "wireplumber_event_dispatch_yields_total", "counter",
+      "Times the event dispatcher stopped because its budget was spent");
+  append_uint (s, "wireplumber_event_dispatch_yields_total", NULL, NULL,
+      wp_event_dispatcher_get_n_yields (self->dispatcher));
+
+  wp_event_dispatcher_get_queue_wait_stats (self->dispatcher, &n_events,
+      &wait_max, &wait_total);
+  append_header (s, "wireplumber_event_queue_wait_seconds_total", "counter",
+      "Time that events waited in the queue before their first hook ran");
+  append_seconds (s, "wireplumber_event_queue_wait_seconds_total", NULL, NULL,
+      wait_total);
+  append_header (s, "wireplumber_event_queue_wait_seconds_max", "gauge",
+      "Longest time that an event waited in the queue");
+  append_seconds (s, "wireplumber_event_queue_wait_seconds_max", NULL, NULL,
+      wait_max);
+
+  g_array_set_size (samples, 0);
+  wp_event_dispatcher_foreach_hook_stats (self->dispatcher,
+      (WpHookStatsFunc) collect_hook_stats, samples);
+  g_array_sort (samples, (GCompareFunc) sample_compare);
+
+  append_header (s, "wireplumber_hook_runs_total", "counter",
+      "Completed runs of event hooks, by hook name");
+  for (guint i = 0; i < samples->len; i++) {
+    Sample *h = &g_array_index (samples, Sample, i);
+    append_uint (s, "wireplumber_hook_runs_total", "hook", h->label,
+        h->count);
+  }
+
+  append_header (s, "wireplumber_hook_duration_seconds_total", "counter",
+      "Time spent in event hooks, by hook name");
+  for (guint i = 0; i < samples->len; i++) {
+    Sample *h = &g_array_index (samples, Sample, i);
+    append_seconds (s, "wireplumber_hook_duration_seconds_total", "hook",
+        h->label, h->total);
+  }
+
+  append_header (s, "wireplumber_hook_duration_seconds_max", "gauge",
+      "Longest run of event hooks, by hook name");
+  for (guint i = 0; i < samples->len; i++) {
+    Sample *h = &g_array_index (samples, Sample, i);
+    append_seconds (s, "wireplumber_hook_duration_seconds_max", "hook",
+        h->label, h->max);
+  }
+}
+
+static void
+render_registry (WpMetrics * self, WpCore * core, GString * s)
+{
+  guint n_globals = 0, n_objects = 0, n_oms = 0, n_managed = 0, max_managed = 0;
+
+  wp_core_get_registry_stats (core, &n_globals, &n_objects, &n_oms,
+      &n_managed, &max_managed);
+
+  append_header (s, "wireplumber_registry_globals", "gauge",
+      "Globals announced by the PipeWire registry");
+  append_uint (s, "wireplumber_registry_globals", NULL, NULL, n_globals);
+  append_header (s, "wireplumber_local_objects", "gauge",
+      "Local objects registered with the core");
+  append_uint (s, "wireplumber_local_objects", NULL, NULL, n_objects);
+  append_header (s, "wireplumber_object_managers", "gauge",
+      "Installed object managers");
+  append_uint (s, "wireplumber_object_managers", NULL, NULL, n_oms);
+  append_header (s, "wireplumber_object_manager_objects", "gauge",
+      "Objects held by all the object managers together");
+  append_uint (s, "wireplumber_object_manager_objects", NULL, NULL, n_managed);
+  append_header (s, "wireplumber_object_manager_objects_max", "gauge",
+      "Objects held by the largest object manager");
+  append_uint (s, "wireplumber_object_manager_objects_max", NULL, NULL,
+      max_managed);
+}
+
+static void
+render_links_and_state (WpMetrics * self, GString * s)
+{
+  guint64 n_saves = 0, n_bytes = 0;
+
+  append_header (s, "wireplumber_link_failures_total", "counter",
+      "Failures of si-standard-link links, by reason");
+  append_uint (s, "wireplumber_link_failures_total", "reason", "activation",
+      self->n_link_activation_failures);
+  append_uint (s, "wireplumber_link_failures_total", "reason", "link-error",
+      self->n_link_errors);
+
+  wp_state_get_total_save_stats (&n_saves, &n_bytes);
+  append_header (s, "wireplumber_state_saves_total", "counter",
+      "Writes of state files");
+  append_uint (s, "wireplumber_state_saves_total", NULL, NULL, n_saves);
+  append_header (s, "wireplumber_state_written_bytes_total", "counter",
+      "Bytes written to state files");
+  append_uint (s, "wireplumber_state_written_bytes_total", NULL, NULL,
+      n_bytes);
+}
+
+static void
+render_lua (WpMetrics * self, WpCore * core, GString * s)
+{
+  g_autoptr (WpPlugin) lua = wp_plugin_find (core, "lua-scripting");
+  g_autoptr (GVariant) stats = NULL;
+  guint64 heap_size = 0, heap_peak = 0, n_collections = 0;
+  gint64 pause_max = 0, pause_total = 0;
+
+  if (lua)
+    g_signal_emit_by_name (lua, "get-memory-stats", &stats);
+  if (!stats)
+    return;
+
+  g_variant_lookup (stats, "heap-size", "t", &heap_size);
+  g_variant_lookup (stats, "heap-peak", "t", &heap_peak);
+  g_variant_lookup (stats, "gc-collections", "t", &n_collections);
+  g_variant_lookup (stats, "gc-pause-max-us", "x", &pause_max);
+  g_variant_lookup (stats, "gc-pause-total-us", "x", &pause_total);
+
+  append_header (s, "wireplumber_lua_heap_bytes", "gauge",
+      "Memory used by the Lua engine");
+  append_uint (s, "wireplumber_lua_heap_bytes", NULL, NULL, heap_size);
+  append_header (s, "wireplumber_lua_heap_peak_bytes", "gauge",
+      "Highest memory use of the Lua engine");
+  append_uint (s, "wireplumber_lua_heap_peak_bytes", NULL, NULL, heap_peak);
+  append_header (s, "wireplumber_lua_gc_collections_total", "counter",
+      "Garbage collections run by the Lua engine after callbacks");
+  append_uint (s, "wireplumber_lua_gc_collections_total", NULL, NULL,
+      n_collections);
+  append_header (s, "wireplumber_lua_gc_pause_seconds_total", "counter",
+      "Time spent in garbage collections of the Lua engine after callbacks");
+  append_seconds (s, "wireplumber_lua_gc_pause_seconds_total", NULL, NULL,
+      pause_total);
+  append_header (s, "wireplumber_lua_gc_pause_seconds_max", "gauge",
+      "Longest garbage collection of the Lua engine after a callback");
+  append_seconds (s, "wireplumber_lua_gc_pause_seconds_max", NULL, NULL,
+      pause_max);
+}
+
+static GString *
+wp_metrics_render (WpMetrics * self)
+{
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (self));
+  GString *s = g_string_sized_new (4096);
+
+  render_events (self, s);
+  render_registry (self, core, s);
+  render_links_and_state (self, s);
+  render_lua (self, core, s);
+  return s;
+}
+
+/* socket output */
+
+static void
+on_metrics_written (GOutputStream * out, GAsyncResult * res,
+    GSocketConnection * conn)
+{
+  g_autoptr (GError) error = NULL;
+
+  if (!g_output_stream_write_all_finish (out, res, NULL, &error))
+    wp_debug ("failed to write metrics: %s", error->message);
+
+  g_io_stream_close (G_IO_STREAM (conn), NULL, NULL);
+  g_object_unref (conn);
+}
+
+static gboolean
+on_incoming (GSocketService * service, GSocketConnection * conn,
+    GObject * source, WpMetrics * self)
+{
+  GString *text = wp_metrics_render (self);
+  GOutputStream *out = g_io_stream_get_output_stream (G_IO_STREAM (conn));
+  gsize len = text->len;
+
+  /* the text is kept alive by the connection until the write is done */
+  g_object_set_data_full (G_OBJECT (conn), "metrics-text",
+      g_string_free (text, FALSE), g_free);
+  g_output_stream_write_all_async (out,
+      g_object_get_data (G_OBJECT (conn), "metrics-text"), len,
+      G_PRIORITY_DEFAULT, NULL,
+      (GAsyncReadyCallback) on_metrics_written, g_object_ref (conn));
+  return TRUE;
+}
+
+static gboolean
+wp_metrics_start_socket (WpMetrics * self, WpCore * core, GError ** error)
+{
+  g_autoptr (GSocketAddress) address = NULL;
+  g_autofree gchar *path = NULL;
+
+  if (g_path_is_absolute (self->socket_path))
+    path = g_strdup (self->socket_path);
+  else
+    path = g_build_filename (g_get_user_runtime_dir (), self->socket_path,
+        NULL);
+
+  /* remove a stale socket of a previous instance */
+  g_unlink (path);
+
+  address = g_unix_socket_address_new (path);
+  self->service = g_socket_service_new ();
+  if (!g_socket_listener_add_address (G_SOCKET_LISTENER (self->service),
+          address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL,
+          error)) {
+    g_prefix_error (error, "failed to listen on %s: ", path);
+    g_clear_object (&self->service);
+    return FALSE;
+  }
+  g_chmod (path, 0600);
+
+  g_signal_connect_object (self->service, "incoming",
+      G_CALLBACK (on_incoming), self, 0);
+
+  /* accept connections in the context of the core */
+  g_main_context_push_thread_default (wp_core_get_g_main_context (core));
+  g_socket_service_start (self->service);
+  g_main_context_pop_thread_default (wp_core_get_g_main_context (core));
+
+  wp_info_object (self, "serving metrics on %s", path);
+  return TRUE;
+}
+
+/* textfile output */
+
+static gboolean
+wp_metrics_write_textfile (WpMetrics * self)
+{
+  g_autoptr (GString) text = wp_metrics_render (self);
+  g_autoptr (GError) error = NULL;
+
+  /* this writes to a temporary file and renames it, so that readers never
+     see a partially written file */
+  if (!g_file_set_contents (self->textfile, text->str, text->len, &error))
+    wp_warning_object (self, "failed to write metrics: %s", error->message);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* links */
+
+static void
+on_link_error (WpSessionItem * link, const gchar * msg, WpMetrics * self)
+{
+  self->n_link_errors++;
+}
+
+static void
+on_link_activation_failed (WpSessionItem * link, const gchar * msg,
+    WpMetrics * self)
+{
+  self->n_link_activation_failures++;
+}
+
+static void
+on_link_added (WpObjectManager * om, WpSessionItem * link, WpMetrics * self)
+{
+  /* these are only emitted by si-standard-link */
+  if (g_signal_lookup ("link-error", G_OBJECT_TYPE (link)))
+    g_signal_connect_object (link, "link-error",
+        G_CALLBACK (on_link_error), self, 0);
+  if (g_signal_lookup ("activation-failed", G_OBJECT_TYPE (link)))
+    g_signal_connect_object (link, "activation-failed",
+        G_CALLBACK (on_link_activation_failed), self, 0);
+}
+
+static void
+on_links_om_installed (WpObjectManager * om, WpTransition * transition)
+{
+  WpMetrics *self = wp_transition_get_source_object (transition);
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (self));
+  g_autoptr (GError) error = NULL;
+
+  if (self->socket_path && !wp_metrics_start_socket (self, core, &error)) {
+    wp_transition_return_error (transition, g_steal_pointer (&error));
+    return;
+  }
+
+  if (self->textfile) {
+    wp_metrics_write_textfile (self);
+    wp_core_timeout_add (core, &self->textfile_source,
+        self->textfile_interval_ms, (GSourceFunc) wp_metrics_write_textfile,
+        self, NULL);
+    wp_info_object (self, "writing metrics to %s every %u ms",
+        self->textfile, self->textfile_interval_ms);
+  }
+
+  wp_object_update_features (WP_OBJECT (self), WP_PLUGIN_FEATURE_ENABLED, 0);
+}
+
+static void
+wp_metrics_enable (WpPlugin * plugin, WpTransition * transition)
+{
+  WpMetrics * self = WP_METRICS (plugin);
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (plugin));
+  g_return_if_fail (core);
+
+  if (!self->socket_path && !self->textfile) {
+    wp_transition_return_error (transition, g_error_new (
+        WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_INVALID_ARGUMENT,
+        "metrics: neither 'socket' nor 'textfile' is configured"));
+    return;
+  }
+
+  self->dispatcher = wp_event_dispatcher_get_instance (core);
+  wp_event_dispatcher_set_stats_enabled (self->dispatcher, TRUE);
+
+  self->links_om = wp_object_manager_new ();
+  wp_object_manager_add_interest (self->links_om, WP_TYPE_SI_LINK, NULL);
+  g_signal_connect_object (self->links_om, "object-added",
+      G_CALLBACK (on_link_added), self, 0);
+  g_signal_connect_object (self->links_om, "installed",
+      G_CALLBACK (on_links_om_installed), transition, 0);
+  wp_core_install_object_manager (core, self->links_om);
+}
+
+static void
+wp_metrics_disable (WpPlugin * plugin)
+{
+  WpMetrics * self = WP_METRICS (plugin);
+
+  if (self->textfile_source) {
+    g_source_destroy (self->textfile_source);
+    g_clear_pointer (&self->textfile_source, g_source_unref);
+  }
+  if (self->service) {
+    g_socket_service_stop (self->service);
+    g_socket_listener_close (G_SOCKET_LISTENER (self->service));
+    g_clear_object (&self->service);
+  }
+  if (self->dispatcher) {
+    wp_event_dispatcher_set_stats_enabled (self->dispatcher, FALSE);
+    g_clear_object (&self->dispatcher);
+  }
+  g_clear_object (&self->links_om);
+}
+
+static void
+wp_metrics_finalize (GObject * object)
+{
+  WpMetrics *self = WP_METRICS (object);
+
+  g_clear_pointer (&self->socket_path, g_free);
+  g_clear_pointer (&self->textfile, g_free);
+
+  G_OBJECT_CLASS (wp_metrics_parent_class)->finalize (object);
+}
+
+static void
+wp_metrics_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  WpMetrics *self = WP_METRICS (object);
+
+  switch (property_id) {
+  case PROP_SOCKET_PATH:
+    g_clear_pointer (&self->socket_path, g_free);
+    self->socket_path = g_value_dup_string (value);
+    break;
+  case PROP_TEXTFILE:
+    g_clear_pointer (&self->textfile, g_free);
+    self->textfile = g_value_dup_string (value);
+    break;
+  case PROP_TEXTFILE_INTERVAL_MS:
+    self->textfile_interval_ms = g_value_get_uint (value);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+static void
+wp_metrics_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  WpMetrics *self = WP_METRICS (object);
+
+  switch (property_id) {
+  case PROP_SOCKET_PATH:
+    g_value_set_string (value, self->socket_path);
+    break;
+  case PROP_TEXTFILE:
+    g_value_set_string (value, self->textfile);
+    break;
+  case PROP_TEXTFILE_INTERVAL_MS:
+    g_value_set_uint (value, self->textfile_interval_ms);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+static void
+wp_metrics_class_init (WpMetricsClass * klass)
+{
+  GObjectClass *object_class = (GObjectClass *) klass;
+  WpPluginClass *plugin_class = (WpPluginClass *) klass;
+
+  object_class->finalize = wp_metrics_finalize;
+  object_class->set_property = wp_metrics_set_property;
+  object_class->get_property = wp_metrics_get_property;
+
+  plugin_class->enable = wp_metrics_enable;
+  plugin_class->disable = wp_metrics_disable;
+
+  g_object_class_install_property (object_class, PROP_SOCKET_PATH,
+      g_param_spec_string ("socket-path", "socket-path",
+          "The unix socket to serve the metrics on; relative paths are "
+          "relative to the user runtime directory", NULL,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_TEXTFILE,
+      g_param_spec_string ("textfile", "textfile",
+          "The file to write the metrics to periodically", NULL,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_TEXTFILE_INTERVAL_MS,
+      g_param_spec_uint ("textfile-interval-ms", "textfile-interval-ms",
+          "The interval between writes of the text file, in ms",
+          1, G_MAXUINT, DEFAULT_TEXTFILE_INTERVAL_MS,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+}
+
+WP_PLUGIN_EXPORT GObject *
+wireplumber__module_init (WpCore * core, WpSpaJson * args, GError ** error)
+{
+  g_autofree gchar *socket_path = NULL;
+  g_autofree gchar *textfile = NULL;
+  gint interval_ms = DEFAULT_TEXTFILE_INTERVAL_MS;
+
+  if (args) {
+    wp_spa_json_object_get (args, "socket", "s", &socket_path, NULL);
+    wp_spa_json_object_get (args, "textfile", "s", &textfile, NULL);
+    wp_spa_json_object_get (args, "textfile.interval-ms", "i", &interval_ms,
+        NULL);
+  }
+
+  if (!socket_path && !textfile)
+    socket_path = g_strdup ("wireplumber-metrics");
+
+  return G_OBJECT (g_object_new (wp_metrics_get_type (),
+      "name", "metrics",
+      "core", core,
+      "socket-path", socket_path,
+      "textfile", textfile,
+      "textfile-interval-ms", (guint) MAX (interval_ms, 1),
+      NULL));
+}
@@ -48,6 +48,10 @@ struct _WpMixerApi
   GHashTable *node_infos;
   guint32 seq;
 
+  /* pre-compiled params, see wp_mixer_api_set_volume() */
+  WpSpaPodTemplate *props_template;
+  WpSpaPodTemplate *route_template;
+
   /* properties */
   gint scale;
 };
@@ -66,6 +70,29 @@ enum {
 
 static guint signals[N_SIGNALS] = {0};
 
+/* field indexes in the props & route templates, in the order of their keys */
+enum {
+  PROPS_CHANNEL_VOLUMES,
+  PROPS_MONITOR_VOLUMES,
+  PROPS_MUTE,
+  PROPS_MONITOR_MUTE,
+};
+
+enum {
+  ROUTE_INDEX,
+  ROUTE_DEVICE,
+  ROUTE_PROPS,
+  ROUTE_SAVE,
+};
+
+static const gchar * const props_template_keys[] = {
+  "channelVolumes", "monitorVolumes", "mute", "monitorMute", NULL
+};
+
+static const gchar * const route_template_keys[] = {
+  "index", "device", "props", "save", NULL
+};
+
 G_DECLARE_FINAL_TYPE (WpMixerApi, wp_mixer_api, WP, MIXER_API, WpPlugin)
 G_DEFINE_TYPE (WpMixerApi, wp_mixer_api, WP_TYPE_PLUGIN)
 
@@ -332,6 +359,21 @@ wp_mixer_api_enable (WpPlugin * plugin, WpTransition * transition)
   self->node_infos = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, node_info_free);
 
+  self->props_template = wp_spa_pod_template_new ("Spa:Pod:Object:Param:Props",
+      "Props", props_template_keys);
+  self->route_template = wp_spa_pod_template_new ("Spa:Pod:Object:Param:Route",
+      "Route", route_template_keys);
+  if (!self->props_template || !self->route_template) {
+    g_clear_pointer (&self->node_infos, g_hash_table_unref);
+    g_clear_pointer (&self->props_template, wp_spa_pod_template_unref);
+    g_clear_pointer (&self->route_template, wp_spa_pod_template_unref);
+    wp_transition_return_error (transition, g_error_new (WP_DOMAIN_LIBRARY,
+            WP_LIBRARY_ERROR_OPERATION_FAILED,
+            "failed to create the Props & Route pod templates"));
+    return;
+  }
+  wp_spa_pod_template_set_boolean (self->route_template, ROUTE_SAVE, TRUE);
+
   self->om = wp_object_manager_new ();
   wp_object_manager_add_interest (self->om, WP_TYPE_NODE,
       WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "media.class", "#s", "*Audio*",
@@ -369,6 +411,8 @@ wp_mixer_api_disable (WpPlugin * plugin)
 
   g_clear_object (&self->om);
   g_clear_pointer (&self->node_infos, g_hash_table_unref);
+  g_clear_pointer (&self->props_template, wp_spa_pod_template_unref);
+  g_clear_pointer (&self->route_template, wp_spa_pod_template_unref);
 }
 
 static inline gdouble
@@ -480,25 +524,25 @@ wp_mixer_api_set_volume (WpMixerApi * self, guint32 id, GVariant * vvolume)
     return FALSE;
   }
 
-  /* set param */
+  /* set param; the templates reuse the pods they built on the previous call,
+     so this does not allocate or look up any names when a volume slider
+     is being dragged */
   g_autoptr (WpSpaPod) props = NULL;
-  g_autoptr (WpSpaPodBuilder) b =
-      wp_spa_pod_builder_new_object ("Spa:Pod:Object:Param:Props", "Props");
+  WpSpaPodTemplate *t = self->props_template;
 
+  wp_spa_pod_template_clear (t);
   if (new_volume.channels > 0)
-    wp_spa_pod_builder_add (b, "channelVolumes", "a",
-        sizeof(float), SPA_TYPE_Float,
-        new_volume.channels, new_volume.values, NULL);
+    wp_spa_pod_template_set_array (t, PROPS_CHANNEL_VOLUMES,
+        new_volume.channels, new_volume.values);
   if (new_monVolume.channels > 0)
-    wp_spa_pod_builder_add (b, "monitorVolumes", "a",
-        sizeof(float), SPA_TYPE_Float,
-        new_monVolume.channels, new_monVolume.values, NULL);
+    wp_spa_pod_template_set_array (t, PROPS_MONITOR_VOLUMES,
+        new_monVolume.channels, new_monVolume.values);
   if (has_mute)
-    wp_spa_pod_builder_add (b, "mute", "b", mute, NULL);
+    wp_spa_pod_template_set_boolean (t, PROPS_MUTE, mute);
   if (has_monitorMute)
-    wp_spa_pod_builder_add (b, "monitorMute", "b", monitorMute, NULL);
+    wp_spa_pod_template_set_boolean (t, PROPS_MONITOR_MUTE, monitorMute);
 
-  props = wp_spa_pod_builder_end (b);
+  props = wp_spa_pod_template_build (t);
 
   if (info->device_id != SPA_ID_INVALID) {
     g_autoptr (WpPipewireObject) device = wp_object_manager_lookup (self->om,
@@ -506,13 +550,14 @@ wp_mixer_api_set_volume (WpMixerApi * self, guint32 id, GVariant * vvolume)
         "bound-id", "=u", info->device_id, NULL);
     g_return_val_if_fail (device != NULL, FALSE);
 
-    wp_pipewire_object_set_param (device, "Route", 0, wp_spa_pod_new_object (
-        "Spa:Pod:Object:Param:Route", "Route",
-        "index", "i", info->route_index,
-        "device", "i", info->route_device,
-        "props", "P", props,
-        "save", "b", true,
-        NULL));
+    t = self->route_template;
+    wp_spa_pod_template_set_int (t, ROUTE_INDEX, info->route_index);
+    wp_spa_pod_template_set_int (t, ROUTE_DEVICE, info->route_device);
+    wp_spa_pod_template_set_pod (t, ROUTE_PROPS, props);
+    g_clear_pointer (&props, wp_spa_pod_unref);
+
+    wp_pipewire_object_set_param (device, "Route", 0,
+        wp_spa_pod_template_build (t));
   } else {
     g_autoptr (WpPipewireObject) node = wp_object_manager_lookup (self->om,
         WP_TYPE_NODE, WP_CONSTRAINT_TYPE_G_PROPERTY,
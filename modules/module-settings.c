@@ -22,6 +22,9 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("m-settings")
  * If persistent settings is enabled stores the settings in a state file
  * and retains the settings from there on subsequent reboots ignoring the
  * contents of .conf file.
+ *
+ * When the "wireplumber.settings" section changes on a configuration reload,
+ * the settings that are not overridden by persistent ones are updated.
  */
 
 struct _WpSettingsPlugin
@@ -38,6 +41,7 @@ struct _WpSettingsPlugin
   WpImplMetadata *persistent_impl_metadata;
   WpState *state;
   WpProperties *persistent_settings;
+  WpEventHook *conf_changed_hook;
 };
 
 enum {
@@ -135,38 +139,18 @@ load_configuration_settings (WpSettingsPlugin *self)
 }
 
 static void
-on_metadata_activated (WpMetadata * m, GAsyncResult * res,
-    gpointer user_data)
+apply_settings (WpSettingsPlugin *self, WpProperties *config_settings)
 {
-  WpTransition *transition = WP_TRANSITION (user_data);
-  WpSettingsPlugin *self = wp_transition_get_source_object (transition);
-  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (self));
-  g_autoptr (WpProperties) config_settings = NULL;
-  g_autoptr (GError) error = NULL;
+  WpMetadata *m = WP_METADATA (self->impl_metadata);
   g_autoptr (WpIterator) it = NULL;
   g_auto (GValue) item = G_VALUE_INIT;
 
-  if (!wp_object_activate_finish (WP_OBJECT (m), res, &error)) {
-    g_prefix_error (&error, "Failed to activate \"%s\": "
-        "Metadata object ", self->metadata_name);
-    wp_transition_return_error (transition, g_steal_pointer (&error));
-    return;
-  }
-
-  /* Load settings from configuration */
-  config_settings = load_configuration_settings (self);
-  if (!config_settings) {
-    wp_transition_return_error (transition, g_error_new (
-        WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_OPERATION_FAILED,
-        "failed to parse settings"));
-    return;
-  }
-
   /* Update the configuration properties with persistent settings */
   wp_properties_update (config_settings, self->persistent_settings);
 
   /* Populate settings metadata from schema using values from configuration if
    * they are present, otherwise use default values */
+  wp_metadata_begin (m);
   it = wp_metadata_new_iterator (WP_METADATA (self->schema_impl_metadata), 0);
   for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
     WpMetadataItem *mi = g_value_get_boxed (&item);
@@ -175,6 +159,7 @@ on_metadata_activated (WpMetadata * m, GAsyncResult * res,
     const gchar *value;
     g_autoptr (WpSpaJson) spec_json = NULL;
     g_autoptr (WpSpaJson) def_value = NULL;
+    g_autofree gchar *def_value_str = NULL;
 
     /* Use configuration value if found, otherwise use default value */
     value = wp_properties_get (config_settings, key);
@@ -195,14 +180,62 @@ on_metadata_activated (WpMetadata * m, GAsyncResult * res,
         continue;
       }
 
-      value = wp_spa_json_get_data (def_value);
+      /* the data of a child value is not NUL-terminated */
+      def_value_str = wp_spa_json_to_string (def_value);
+      value = def_value_str;
     }
 
-    /* Add setting in the metadata */
+    /* Add setting in the metadata, unless it is already set to this value */
+    if (!g_strcmp0 (wp_metadata_find (m, 0, key, NULL), value))
+      continue;
+
     wp_debug_object (self, "adding setting to %s metadata: %s = %s",
         self->metadata_name, key, value);
     wp_metadata_set (m, 0, key, "Spa:String:JSON", value);
   }
+  wp_metadata_commit (m);
+}
+
+static void
+on_conf_changed (WpEvent *event, WpSettingsPlugin *self)
+{
+  g_autoptr (WpProperties) config_settings =
+      load_configuration_settings (self);
+
+  if (!config_settings || !self->impl_metadata)
+    return;
+
+  wp_info_object (self, "configuration changed, updating settings");
+  apply_settings (self, config_settings);
+}
+
+static void
+on_metadata_activated (WpMetadata * m, GAsyncResult * res,
+    gpointer user_data)
+{
+  WpTransition *transition = WP_TRANSITION (user_data);
+  WpSettingsPlugin *self = wp_transition_get_source_object (transition);
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (self));
+  g_autoptr (WpProperties) config_settings = NULL;
+  g_autoptr (GError) error = NULL;
+
+  if (!wp_object_activate_finish (WP_OBJECT (m), res, &error)) {
+    g_prefix_error (&error, "Failed to activate \"%s\": "
+        "Metadata object ", self->metadata_name);
+    wp_transition_return_error (transition, g_steal_pointer (&error));
+    return;
+  }
+
+  /* Load settings from configuration */
+  config_settings = load_configuration_settings (self);
+  if (!config_settings) {
+    wp_transition_return_error (transition, g_error_new (
+        WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_OPERATION_FAILED,
+        "failed to parse settings"));
+    return;
+  }
+
+  apply_settings (self, config_settings);
 
   wp_object_update_features (WP_OBJECT (self), WP_PLUGIN_FEATURE_ENABLED, 0);
 }
@@ -230,6 +263,7 @@ on_persistent_metadata_activated (WpMetadata * m, GAsyncResult * res,
   self->persistent_settings = wp_state_load (self->state);
 
   /* Set persistent settings in persistent metadata */
+  wp_metadata_begin (m);
   for (it = wp_properties_new_iterator (self->persistent_settings);
       wp_iterator_next (it, &item);
       g_value_unset (&item)) {
@@ -241,6 +275,7 @@ on_persistent_metadata_activated (WpMetadata * m, GAsyncResult * res,
         self->metadata_persistent_name, key, value);
     wp_metadata_set (m, 0, key, "Spa:String:JSON", value);
   }
+  wp_metadata_commit (m);
 
   /* monitor changes in persistent metadata */
   g_signal_connect_object (m, "changed",
@@ -289,6 +324,7 @@ on_schema_metadata_activated (WpMetadata * m, GAsyncResult * res,
     }
 
     it = wp_spa_json_new_iterator (schema_json);
+    wp_metadata_begin (m);
     while (wp_iterator_next (it, &item)) {
       WpSpaJson *j = g_value_get_boxed (&item);
       g_autofree gchar *key = wp_spa_json_parse_string (j);
@@ -296,6 +332,7 @@ on_schema_metadata_activated (WpMetadata * m, GAsyncResult * res,
 
       g_value_unset (&item);
       if (!wp_iterator_next (it, &item)) {
+        wp_metadata_commit (m);
         wp_transition_return_error (transition, g_error_new (WP_DOMAIN_LIBRARY,
             WP_LIBRARY_ERROR_INVARIANT, "Malformed settings schema"));
         return;
@@ -308,6 +345,7 @@ on_schema_metadata_activated (WpMetadata * m, GAsyncResult * res,
           self->metadata_schema_name, key, value);
       wp_metadata_set (m, 0, key, "Spa:String:JSON", value);
     }
+    wp_metadata_commit (m);
   } else {
     wp_warning_object (self, "settings schema not found in configuration");
   }
@@ -327,6 +365,20 @@ wp_settings_plugin_enable (WpPlugin * plugin, WpTransition * transition)
 {
   WpSettingsPlugin * self = WP_SETTINGS_PLUGIN (plugin);
   g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (plugin));
+  g_autoptr (WpEventDispatcher) dispatcher =
+      wp_event_dispatcher_get_instance (core);
+
+  /* update the settings when the configuration is reloaded */
+  self->conf_changed_hook = wp_simple_event_hook_new (
+      "m-settings/conf-changed", NULL, NULL,
+      g_cclosure_new_object ((GCallback) on_conf_changed, G_OBJECT (self)));
+  wp_interest_event_hook_add_interest (
+      WP_INTEREST_EVENT_HOOK (self->conf_changed_hook),
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "conf-changed",
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.subject.section", "=s",
+          "wireplumber.settings",
+      NULL);
+  wp_event_dispatcher_register_hook (dispatcher, self->conf_changed_hook);
 
   /* create schema metadata object */
   self->schema_impl_metadata = wp_impl_metadata_new_full (core,
@@ -342,6 +394,13 @@ static void
 wp_settings_plugin_disable (WpPlugin * plugin)
 {
   WpSettingsPlugin * self = WP_SETTINGS_PLUGIN (plugin);
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (plugin));
+  g_autoptr (WpEventDispatcher) dispatcher = core ?
+      wp_event_dispatcher_get_instance (core) : NULL;
+
+  if (dispatcher && self->conf_changed_hook)
+    wp_event_dispatcher_unregister_hook (dispatcher, self->conf_changed_hook);
+  g_clear_object (&self->conf_changed_hook);
 
   g_clear_object (&self->impl_metadata);
   g_clear_object (&self->schema_impl_metadata);
@@ -35,6 +35,7 @@ struct _WpSiStandardLink
 
 enum {
   SIGNAL_LINK_ERROR,
+  SIGNAL_ACTIVATION_FAILED,
   LAST_SIGNAL,
 };
 
@@ -208,11 +209,14 @@ on_link_activated (WpObject * proxy, GAsyncResult * res,
 
   /* We only active feature if all links activated successfully */
   if (self->n_failed_links > 0) {
-    clear_node_links (&self->node_links);
-    wp_transition_return_error (transition, g_error_new (
+    g_autoptr (GError) error = g_error_new (
         WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_OPERATION_FAILED,
         "%d of %d PipeWire links failed to activate",
-        self->n_failed_links, len));
+        self->n_failed_links, len);
+
+    clear_node_links (&self->node_links);
+    g_signal_emit (self, signals[SIGNAL_ACTIVATION_FAILED], 0, error->message);
+    wp_transition_return_error (transition, g_steal_pointer (&error));
   } else {
     wp_object_update_features (WP_OBJECT (self),
         WP_SESSION_ITEM_FEATURE_ACTIVE, 0);
@@ -731,6 +735,12 @@ si_standard_link_class_init (WpSiStandardLinkClass * klass)
   signals[SIGNAL_LINK_ERROR] = g_signal_new (
       "link-error", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_FIRST,
       0, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  /* emitted when some of the PipeWire links could not be created; unlike
+     "link-error", this is followed by the failure of the activation */
+  signals[SIGNAL_ACTIVATION_FAILED] = g_signal_new (
+      "activation-failed", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_FIRST,
+      0, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_STRING);
 }
 
 static GVariant *
@@ -7,6 +7,7 @@
  */
 
 #include <wp/wp.h>
+#include <pipewire/keys.h>
 
 WP_DEFINE_LOCAL_LOG_TOPIC ("m-standard-event-source")
 
@@ -20,6 +21,7 @@ enum {
   ACTION_CREATE_EVENT,
   ACTION_PUSH_EVENT,
   ACTION_SCHEDULE_RESCAN,
+  ACTION_SCHEDULE_RESCAN_FOR_ITEM,
   N_SIGNALS
 };
 
@@ -66,6 +68,10 @@ struct _WpStandardEventSource
   WpObjectManager *oms[N_OBJECT_TYPES];
   WpEventHook *rescan_done_hook;
   gboolean rescan_scheduled[N_RESCAN_CONTEXTS];
+  /* a full rescan was requested since the last rescan event was dispatched */
+  gboolean rescan_full[N_RESCAN_CONTEXTS];
+  /* ids of the items that need to be rescanned, if it is not a full rescan */
+  GHashTable *rescan_items[N_RESCAN_CONTEXTS];
   gint n_oms_installed;
 };
 
@@ -78,6 +84,19 @@ G_DEFINE_TYPE (WpStandardEventSource, wp_standard_event_source, WP_TYPE_PLUGIN)
 static void
 wp_standard_event_source_init (WpStandardEventSource * self)
 {
+  for (gint i = 0; i < N_RESCAN_CONTEXTS; i++)
+    self->rescan_items[i] = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+static void
+wp_standard_event_source_finalize (GObject * object)
+{
+  WpStandardEventSource * self = WP_STANDARD_EVENT_SOURCE (object);
+
+  for (gint i = 0; i < N_RESCAN_CONTEXTS; i++)
+    g_clear_pointer (&self->rescan_items[i], g_hash_table_unref);
+
+  G_OBJECT_CLASS (wp_standard_event_source_parent_class)->finalize (object);
 }
 
 static GType
@@ -161,6 +180,9 @@ get_default_event_priority (const gchar *event_type)
     return -490;
   else if (!g_strcmp0 (event_type, "rescan-for-linking"))
     return -500;
+  else if (!g_strcmp0 (event_type, "conf-changed") ||
+      !g_strcmp0 (event_type, "conf-reloaded"))
+    return 300;
   else if (!g_strcmp0 (event_type, "node-state-changed"))
     return 50;
   else if (!g_strcmp0 (event_type, "metadata-changed"))
@@ -243,6 +265,16 @@ wp_standard_event_source_create_event (WpStandardEventSource *self,
   event = wp_event_new (event_type, priority, g_steal_pointer (&properties),
       G_OBJECT (self), G_OBJECT (subject));
 
+  /* hooks read the params from the subject, so a params-changed event that is
+     still queued already covers any further change of the same param */
+  if (subject && g_str_has_suffix (event_type, "-params-changed")) {
+    const gchar *param_id = misc_properties ?
+        wp_properties_get (misc_properties, "event.subject.param-id") : NULL;
+    g_autofree gchar *key = g_strdup_printf ("%s@%p@%s", event_type, subject,
+        param_id ? param_id : "");
+    wp_event_set_coalesce_key (event, key);
+  }
+
   /* watch for subject pw-proxy-destroyed and cancel event,
      unless this is a "removed" event, in which case we expect the proxy
      to be destroyed and the event should still go through */
@@ -290,7 +322,7 @@ wp_standard_event_source_push_event (WpStandardEventSource *self,
 }
 
 static void
-wp_standard_event_source_schedule_rescan (WpStandardEventSource *self,
+wp_standard_event_source_push_rescan (WpStandardEventSource *self,
     RescanContext context)
 {
   if (!self->rescan_scheduled[context]) {
@@ -303,6 +335,26 @@ wp_standard_event_source_schedule_rescan (WpStandardEventSource *self,
   }
 }
 
+static void
+wp_standard_event_source_schedule_rescan (WpStandardEventSource *self,
+    RescanContext context)
+{
+  self->rescan_full[context] = TRUE;
+  g_hash_table_remove_all (self->rescan_items[context]);
+  wp_standard_event_source_push_rescan (self, context);
+}
+
+static void
+wp_standard_event_source_schedule_rescan_for_item (
+    WpStandardEventSource *self, RescanContext context, guint item_id)
+{
+  /* there is no point in tracking items if everything is going to be
+     rescanned anyway */
+  if (!self->rescan_full[context])
+    g_hash_table_add (self->rescan_items[context], GUINT_TO_POINTER (item_id));
+  wp_standard_event_source_push_rescan (self, context);
+}
+
 static void
 on_metadata_changed (WpMetadata *obj, guint32 subject,
     const gchar *key, const gchar *spa_type, const gchar *value,
@@ -389,6 +441,29 @@ on_rescan_done (WpEvent * event, WpStandardEventSource * self)
 
   g_return_if_fail (value != NULL && value->value_nick != NULL);
   self->rescan_scheduled[value->value] = FALSE;
+
+  /* if only specific items were scheduled for rescanning, pass them on
+     to the rescan hooks; the absence of "dirty-items" means a full rescan */
+  if (!self->rescan_full[value->value] &&
+      g_hash_table_size (self->rescan_items[value->value]) > 0) {
+    g_autoptr (WpProperties) items = wp_properties_new_empty ();
+    g_auto (GValue) data = G_VALUE_INIT;
+    GHashTableIter iter;
+    gpointer id;
+
+    g_hash_table_iter_init (&iter, self->rescan_items[value->value]);
+    while (g_hash_table_iter_next (&iter, &id, NULL)) {
+      g_autofree gchar *key = g_strdup_printf ("%u", GPOINTER_TO_UINT (id));
+      wp_properties_set (items, key, "true");
+    }
+
+    g_value_init (&data, WP_TYPE_PROPERTIES);
+    g_value_set_boxed (&data, items);
+    wp_event_set_data (event, "dirty-items", &data);
+  }
+
+  self->rescan_full[value->value] = FALSE;
+  g_hash_table_remove_all (self->rescan_items[value->value]);
 }
 
 static void
@@ -407,6 +482,11 @@ wp_standard_event_source_enable (WpPlugin * plugin, WpTransition * transition)
     GType gtype = object_type_to_gtype (i);
     self->oms[i] = wp_object_manager_new ();
     wp_object_manager_add_interest (self->oms[i], gtype, NULL);
+    if (i == OBJECT_TYPE_NODE) {
+      /* used by scripts to resolve link targets */
+      wp_object_manager_add_index (self->oms[i], PW_KEY_NODE_NAME);
+      wp_object_manager_add_index (self->oms[i], PW_KEY_OBJECT_SERIAL);
+    }
     wp_object_manager_request_object_features (self->oms[i],
         gtype, WP_OBJECT_FEATURES_ALL);
     g_signal_connect_object (self->oms[i], "object-added",
@@ -448,8 +528,11 @@ wp_standard_event_source_disable (WpPlugin * plugin)
 static void
 wp_standard_event_source_class_init (WpStandardEventSourceClass * klass)
 {
+  GObjectClass *object_class = (GObjectClass *) klass;
   WpPluginClass *plugin_class = (WpPluginClass *) klass;
 
+  object_class->finalize = wp_standard_event_source_finalize;
+
   plugin_class->enable = wp_standard_event_source_enable;
   plugin_class->disable = wp_standard_event_source_disable;
 
@@ -478,6 +561,12 @@ wp_standard_event_source_class_init (WpStandardEventSourceClass * klass)
       G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
       (GCallback) wp_standard_event_source_schedule_rescan,
       NULL, NULL, NULL, G_TYPE_NONE, 1, TYPE_RESCAN_CONTEXT);
+
+  signals[ACTION_SCHEDULE_RESCAN_FOR_ITEM] = g_signal_new_class_handler (
+      "schedule-rescan-for-item", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_standard_event_source_schedule_rescan_for_item,
+      NULL, NULL, NULL, G_TYPE_NONE, 2, TYPE_RESCAN_CONTEXT, G_TYPE_UINT);
 }
 
 WP_PLUGIN_EXPORT GObject *
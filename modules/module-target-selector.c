@@ -0,0 +1,475 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <wp/wp.h>
+#include <spa/utils/defs.h>
+#include <spa/utils/string.h>
+#include <pipewire/keys.h>
+
+WP_DEFINE_LOCAL_LOG_TOPIC ("m-target-selector")
+
+/*
+ * This module keeps the session items that the linking scripts consider as
+ * targets in a few indexes, so that the find-*-target hooks do not need to
+ * iterate over all the session items and read their properties on every
+ * select-target event:
+ *  - (item.node.type, item.node.direction, media.type) -> items, ranked by
+ *    priority.session (highest first) and then item.plugged.usec (most
+ *    recently plugged first); this is the order of preference of
+ *    find-best-target
+ *  - node.name & object.path -> items
+ *  - node.id -> item, object.serial -> item
+ *
+ * The indexes are updated incrementally from the object-added /
+ * object-removed signals of an object manager that watches the linkables.
+ *
+ * The scripts keep control of the policy: the ranked list is only the order
+ * in which candidates are considered; checks like canLink() or the route
+ * availability remain in Lua and are applied on the candidates in order,
+ * stopping at the first one that passes.
+ */
+
+typedef struct _TargetEntry TargetEntry;
+struct _TargetEntry
+{
+  guint32 id;
+  /* borrowed; the entry is removed before the item is destroyed */
+  WpSessionItem *si;
+  gint priority;
+  gint64 plugged;
+  guint32 node_id;
+  gchar *serial;
+  gchar *name;
+  gchar *path;
+  gchar *direction;
+  gchar *media_type;
+  gchar *rank_key;
+  gboolean capture_sink;
+};
+
+struct _WpTargetSelector
+{
+  WpPlugin parent;
+  WpObjectManager *om;
+
+  /* si id -> TargetEntry */
+  GHashTable *items;
+  /* rank key -> GPtrArray of TargetEntry, in order of preference */
+  GHashTable *ranks;
+  /* node.name & object.path -> GPtrArray of TargetEntry */
+  GHashTable *names;
+  /* node.id -> TargetEntry */
+  GHashTable *node_ids;
+  /* object.serial -> TargetEntry */
+  GHashTable *serials;
+};
+
+enum {
+  ACTION_GET_TARGETS,
+  ACTION_GET_TARGET,
+  ACTION_FIND_TARGETS_BY_NAME,
+  ACTION_LOOKUP_TARGET,
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = {0};
+
+G_DECLARE_FINAL_TYPE (WpTargetSelector, wp_target_selector,
+                      WP, TARGET_SELECTOR, WpPlugin)
+G_DEFINE_TYPE (WpTargetSelector, wp_target_selector, WP_TYPE_PLUGIN)
+
+static void
+target_entry_free (TargetEntry * e)
+{
+  g_free (e->serial);
+  g_free (e->name);
+  g_free (e->path);
+  g_free (e->direction);
+  g_free (e->media_type);
+  g_free (e->rank_key);
+  g_slice_free (TargetEntry, e);
+}
+
+static gchar *
+make_rank_key (const gchar * node_type, const gchar * direction,
+    const gchar * media_type)
+{
+  return g_strdup_printf ("%s|%s|%s", node_type ? node_type : "",
+      direction ? direction : "", media_type ? media_type : "");
+}
+
+static guint32
+parse_id (const gchar * str)
+{
+  guint64 val;
+  if (!str || !g_ascii_string_to_unsigned (str, 10, 0, G_MAXUINT32, &val, NULL))
+    return SPA_ID_INVALID;
+  return val;
+}
+
+static gint
+parse_int (const gchar * str)
+{
+  gint64 val;
+  if (!str || !g_ascii_string_to_signed (str, 10, G_MININT, G_MAXINT, &val, NULL))
+    return 0;
+  return val;
+}
+
+static gint64
+parse_int64 (const gchar * str)
+{
+  gint64 val;
+  if (!str || !g_ascii_string_to_signed (str, 10, G_MININT64, G_MAXINT64, &val,
+          NULL))
+    return 0;
+  return val;
+}
+
+/* TRUE if a is preferred over b */
+static inline gboolean
+target_entry_ranks_before (const TargetEntry * a, const TargetEntry * b)
+{
+  return a->priority > b->priority ||
+      (a->priority == b->priority && a->plugged > b->plugged);
+}
+
+static void
+ranks_insert (WpTargetSelector * self, TargetEntry * e)
+{
+  GPtrArray *arr = g_hash_table_lookup (self->ranks, e->rank_key);
+  guint lo = 0, hi;
+
+  if (!arr) {
+    arr = g_ptr_array_new ();
+    g_hash_table_insert (self->ranks, g_strdup (e->rank_key), arr);
+  }
+
+  /* insert after all the entries that rank the same or better, so that
+     items that rank equally keep the order in which they appeared */
+  hi = arr->len;
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    if (target_entry_ranks_before (e, g_ptr_array_index (arr, mid)))
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  g_ptr_array_insert (arr, lo, e);
+}
+
+static void
+ranks_remove (WpTargetSelector * self, TargetEntry * e)
+{
+  GPtrArray *arr = g_hash_table_lookup (self->ranks, e->rank_key);
+  if (arr) {
+    g_ptr_array_remove (arr, e);
+    if (arr->len == 0)
+      g_hash_table_remove (self->ranks, e->rank_key);
+  }
+}
+
+static void
+names_add (WpTargetSelector * self, const gchar * name, TargetEntry * e)
+{
+  GPtrArray *arr = g_hash_table_lookup (self->names, name);
+  if (!arr) {
+    arr = g_ptr_array_new ();
+    g_hash_table_insert (self->names, g_strdup (name), arr);
+  }
+  g_ptr_array_add (arr, e);
+}
+
+static void
+names_remove (WpTargetSelector * self, const gchar * name, TargetEntry * e)
+{
+  GPtrArray *arr = g_hash_table_lookup (self->names, name);
+  if (arr) {
+    g_ptr_array_remove (arr, e);
+    if (arr->len == 0)
+      g_hash_table_remove (self->names, name);
+  }
+}
+
+static void
+on_object_added (WpObjectManager * om, WpSessionItem * si,
+    WpTargetSelector * self)
+{
+  TargetEntry *e = g_slice_new0 (TargetEntry);
+
+  e->id = wp_object_get_id (WP_OBJECT (si));
+  e->si = si;
+  e->priority =
+      parse_int (wp_session_item_get_property (si, PW_KEY_PRIORITY_SESSION));
+  e->plugged =
+      parse_int64 (wp_session_item_get_property (si, "item.plugged.usec"));
+  e->node_id = parse_id (wp_session_item_get_property (si, "node.id"));
+  e->serial = g_strdup (wp_session_item_get_property (si, PW_KEY_OBJECT_SERIAL));
+  e->name = g_strdup (wp_session_item_get_property (si, PW_KEY_NODE_NAME));
+  e->path = g_strdup (wp_session_item_get_property (si, PW_KEY_OBJECT_PATH));
+  e->direction =
+      g_strdup (wp_session_item_get_property (si, "item.node.direction"));
+  e->media_type = g_strdup (wp_session_item_get_property (si, PW_KEY_MEDIA_TYPE));
+  e->capture_sink = spa_atob (
+      wp_session_item_get_property (si, PW_KEY_STREAM_CAPTURE_SINK));
+  e->rank_key = make_rank_key (
+      wp_session_item_get_property (si, "item.node.type"),
+      e->direction, e->media_type);
+
+  g_hash_table_insert (self->items, GUINT_TO_POINTER (e->id), e);
+  ranks_insert (self, e);
+  if (e->name)
+    names_add (self, e->name, e);
+  if (e->path && g_strcmp0 (e->path, e->name) != 0)
+    names_add (self, e->path, e);
+  if (e->node_id != SPA_ID_INVALID)
+    g_hash_table_insert (self->node_ids, GUINT_TO_POINTER (e->node_id), e);
+  if (e->serial)
+    g_hash_table_insert (self->serials, e->serial, e);
+
+  wp_trace_object (self, "item %u (%s): rank '%s', priority %d",
+      e->id, e->name, e->rank_key, e->priority);
+}
+
+static void
+on_object_removed (WpObjectManager * om, WpSessionItem * si,
+    WpTargetSelector * self)
+{
+  gpointer id = GUINT_TO_POINTER (wp_object_get_id (WP_OBJECT (si)));
+  TargetEntry *e = g_hash_table_lookup (self->items, id);
+
+  if (!e)
+    return;
+
+  ranks_remove (self, e);
+  if (e->name)
+    names_remove (self, e->name, e);
+  if (e->path && g_strcmp0 (e->path, e->name) != 0)
+    names_remove (self, e->path, e);
+  if (e->node_id != SPA_ID_INVALID &&
+      g_hash_table_lookup (self->node_ids, GUINT_TO_POINTER (e->node_id)) == e)
+    g_hash_table_remove (self->node_ids, GUINT_TO_POINTER (e->node_id));
+  if (e->serial && g_hash_table_lookup (self->serials, e->serial) == e)
+    g_hash_table_remove (self->serials, e->serial);
+  g_hash_table_remove (self->items, id);
+}
+
+static void
+on_om_installed (WpObjectManager * om, WpTargetSelector * self)
+{
+  wp_object_update_features (WP_OBJECT (self), WP_PLUGIN_FEATURE_ENABLED, 0);
+}
+
+static void
+wp_target_selector_init (WpTargetSelector * self)
+{
+}
+
+static void
+wp_target_selector_enable (WpPlugin * plugin, WpTransition * transition)
+{
+  WpTargetSelector * self = WP_TARGET_SELECTOR (plugin);
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (plugin));
+  g_return_if_fail (core);
+
+  self->items = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) target_entry_free);
+  self->ranks = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) g_ptr_array_unref);
+  self->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) g_ptr_array_unref);
+  self->node_ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->serials = g_hash_table_new (g_str_hash, g_str_equal);
+
+  self->om = wp_object_manager_new ();
+  wp_object_manager_add_interest (self->om, WP_TYPE_SI_LINKABLE,
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "item.factory.name", "c(ss)",
+      "si-audio-adapter", "si-node", NULL);
+  g_signal_connect_object (self->om, "object-added",
+      G_CALLBACK (on_object_added), self, 0);
+  g_signal_connect_object (self->om, "object-removed",
+      G_CALLBACK (on_object_removed), self, 0);
+  g_signal_connect_object (self->om, "installed",
+      G_CALLBACK (on_om_installed), self, 0);
+  wp_core_install_object_manager (core, self->om);
+}
+
+static void
+wp_target_selector_disable (WpPlugin * plugin)
+{
+  WpTargetSelector * self = WP_TARGET_SELECTOR (plugin);
+
+  g_clear_object (&self->om);
+  g_clear_pointer (&self->serials, g_hash_table_unref);
+  g_clear_pointer (&self->node_ids, g_hash_table_unref);
+  g_clear_pointer (&self->names, g_hash_table_unref);
+  g_clear_pointer (&self->ranks, g_hash_table_unref);
+  g_clear_pointer (&self->items, g_hash_table_unref);
+}
+
+static const gchar *
+lookup_string_filter (GVariant * filters, const gchar * key)
+{
+  const gchar *str = NULL;
+  if (filters && g_variant_is_of_type (filters, G_VARIANT_TYPE_VARDICT))
+    g_variant_lookup (filters, key, "&s", &str);
+  return str;
+}
+
+/* returns the ids of the candidate targets for the item \a si_id, best
+   first; \a filters may override the direction ("item.node.direction"),
+   the media type ("media.type") and the node type ("item.node.type") of
+   the targets, which otherwise default to the ones that find-best-target
+   looks for: devices of the same media type, in the opposite direction;
+   "limit" limits the number of the returned candidates */
+static GVariant *
+wp_target_selector_get_targets (WpTargetSelector * self, guint si_id,
+    GVariant * filters)
+{
+  g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("au"));
+  TargetEntry *si = self->items ?
+      g_hash_table_lookup (self->items, GUINT_TO_POINTER (si_id)) : NULL;
+  const gchar *direction = lookup_string_filter (filters, "item.node.direction");
+  const gchar *media_type = lookup_string_filter (filters, "media.type");
+  const gchar *node_type = lookup_string_filter (filters, "item.node.type");
+  g_autofree gchar *rank_key = NULL;
+  GPtrArray *arr;
+  gint64 limit = G_MAXINT64;
+
+  if (filters && g_variant_is_of_type (filters, G_VARIANT_TYPE_VARDICT))
+    g_variant_lookup (filters, "limit", "x", &limit);
+
+  /* same as cutils.getTargetDirection() */
+  if (!direction && si) {
+    direction = (!g_strcmp0 (si->direction, "output") ||
+        (!g_strcmp0 (si->direction, "input") && si->capture_sink)) ?
+        "input" : "output";
+  }
+  if (!media_type && si)
+    media_type = si->media_type;
+  if (!node_type)
+    node_type = "device";
+
+  if (!direction || !media_type || !self->ranks)
+    return g_variant_builder_end (&b);
+
+  rank_key = make_rank_key (node_type, direction, media_type);
+  arr = g_hash_table_lookup (self->ranks, rank_key);
+
+  for (guint i = 0; arr && i < arr->len && limit > 0; i++) {
+    TargetEntry *e = g_ptr_array_index (arr, i);
+    if (e->id == si_id)
+      continue;
+    g_variant_builder_add (&b, "u", e->id);
+    limit--;
+  }
+
+  wp_trace_object (self, "item %u: %u candidates in '%s'", si_id,
+      arr ? arr->len : 0, rank_key);
+  return g_variant_builder_end (&b);
+}
+
+static WpSessionItem *
+wp_target_selector_get_target (WpTargetSelector * self, guint si_id)
+{
+  TargetEntry *e = self->items ?
+      g_hash_table_lookup (self->items, GUINT_TO_POINTER (si_id)) : NULL;
+  return e ? g_object_ref (e->si) : NULL;
+}
+
+/* returns the ids of the items whose node.name or object.path is \a name
+   and, if \a direction is not NULL, whose item.node.direction matches it */
+static GVariant *
+wp_target_selector_find_targets_by_name (WpTargetSelector * self,
+    const gchar * name, const gchar * direction)
+{
+  g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("au"));
+  GPtrArray *arr = (self->names && name) ?
+      g_hash_table_lookup (self->names, name) : NULL;
+
+  for (guint i = 0; arr && i < arr->len; i++) {
+    TargetEntry *e = g_ptr_array_index (arr, i);
+    if (!direction || !g_strcmp0 (e->direction, direction))
+      g_variant_builder_add (&b, "u", e->id);
+  }
+  return g_variant_builder_end (&b);
+}
+
+/* looks up an item by its "node.id" or "object.serial" */
+static WpSessionItem *
+wp_target_selector_lookup_target (WpTargetSelector * self, const gchar * key,
+    const gchar * value)
+{
+  TargetEntry *e = NULL;
+
+  g_return_val_if_fail (key, NULL);
+
+  if (!self->items || !value)
+    return NULL;
+
+  if (g_str_equal (key, "node.id")) {
+    guint32 id = parse_id (value);
+    if (id != SPA_ID_INVALID)
+      e = g_hash_table_lookup (self->node_ids, GUINT_TO_POINTER (id));
+  } else if (g_str_equal (key, PW_KEY_OBJECT_SERIAL)) {
+    e = g_hash_table_lookup (self->serials, value);
+  } else {
+    wp_warning_object (self, "cannot look up targets by '%s'", key);
+  }
+
+  return e ? g_object_ref (e->si) : NULL;
+}
+
+static void
+wp_target_selector_class_init (WpTargetSelectorClass * klass)
+{
+  WpPluginClass *plugin_class = (WpPluginClass *) klass;
+
+  plugin_class->enable = wp_target_selector_enable;
+  plugin_class->disable = wp_target_selector_disable;
+
+  /* ids of the candidate targets of an item, best first */
+  signals[ACTION_GET_TARGETS] = g_signal_new_class_handler (
+      "get-targets", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_target_selector_get_targets,
+      NULL, NULL, NULL,
+      G_TYPE_VARIANT, 2, G_TYPE_UINT, G_TYPE_VARIANT);
+
+  /* the session item of an id returned by the other actions */
+  signals[ACTION_GET_TARGET] = g_signal_new_class_handler (
+      "get-target", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_target_selector_get_target,
+      NULL, NULL, NULL,
+      WP_TYPE_SESSION_ITEM, 1, G_TYPE_UINT);
+
+  /* ids of the items with a node.name or object.path */
+  signals[ACTION_FIND_TARGETS_BY_NAME] = g_signal_new_class_handler (
+      "find-targets-by-name", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_target_selector_find_targets_by_name,
+      NULL, NULL, NULL,
+      G_TYPE_VARIANT, 2, G_TYPE_STRING, G_TYPE_STRING);
+
+  /* the session item with a node.id or object.serial */
+  signals[ACTION_LOOKUP_TARGET] = g_signal_new_class_handler (
+      "lookup-target", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      (GCallback) wp_target_selector_lookup_target,
+      NULL, NULL, NULL,
+      WP_TYPE_SESSION_ITEM, 2, G_TYPE_STRING, G_TYPE_STRING);
+}
+
+WP_PLUGIN_EXPORT GObject *
+wireplumber__module_init (WpCore * core, WpSpaJson * args, GError ** error)
+{
+  return G_OBJECT (g_object_new (wp_target_selector_get_type (),
+      "name", "target-selector",
+      "core", core,
+      NULL));
+}
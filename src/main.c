@@ -45,11 +45,16 @@ typedef struct
   WpCore *core;
   GMainLoop *loop;
   gint exit_code;
+  GHashTable *conf_sections; /* section name -> merged JSON string */
+  WpEventHook *conf_reloaded_hook;
+  guint n_pending_reloads;
 } WpDaemon;
 
 static void
 daemon_clear (WpDaemon * self)
 {
+  g_clear_object (&self->conf_reloaded_hook);
+  g_clear_pointer (&self->conf_sections, g_hash_table_unref);
   g_clear_pointer (&self->loop, g_main_loop_unref);
   g_clear_object (&self->core);
 }
@@ -87,10 +92,168 @@ signal_handler_int (gpointer data)
   return signal_handler (SIGINT, data);
 }
 
+static GHashTable *
+collect_conf_sections (WpConf * conf)
+{
+  GHashTable *sections =
+      g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  g_autoptr (WpIterator) it = wp_conf_new_section_names_iterator (conf);
+  g_auto (GValue) val = G_VALUE_INIT;
+
+  for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
+    const gchar *name = g_value_get_string (&val);
+    g_autoptr (WpSpaJson) json = wp_conf_get_section (conf, name);
+    if (json)
+      g_hash_table_insert (sections, g_strdup (name),
+          wp_spa_json_to_string (json));
+  }
+  return sections;
+}
+
+static gboolean
+conf_change_has_hooks (WpCore * core, WpProperties * props)
+{
+  g_autoptr (WpEventDispatcher) dispatcher =
+      wp_event_dispatcher_get_instance (core);
+  g_autoptr (WpEvent) event = NULL;
+  WpProperties *event_props = wp_properties_copy (props);
+
+  wp_properties_set (event_props, "event.type", "conf-changed");
+  event = wp_event_new ("conf-changed", 0, event_props, NULL, NULL);
+  return wp_event_collect_hooks (event, dispatcher);
+}
+
+static void
+publish_conf_change (WpDaemon * d, WpPlugin * event_source,
+    const gchar * section, const gchar * change)
+{
+  g_autoptr (WpProperties) props = wp_properties_new (
+      "event.subject.section", section,
+      "event.subject.change", change,
+      NULL);
+
+  wp_info ("configuration section '%s' %s", section, change);
+
+  /* these are only read while starting up */
+  if (g_str_has_prefix (section, "context.") ||
+      g_str_has_prefix (section, "wireplumber.components") ||
+      g_str_equal (section, "wireplumber.profiles") ||
+      g_str_equal (section, "wireplumber.settings.schema"))
+    wp_notice ("changes in '%s' require a restart to take effect", section);
+
+  /* the rest are applied by the hooks that watch them, if any */
+  else if (event_source && !conf_change_has_hooks (d->core, props))
+    wp_warning ("changes in '%s' are not applied on reload, "
+        "they require a restart to take effect", section);
+
+  if (event_source)
+    g_signal_emit_by_name (event_source, "push-event", "conf-changed", NULL,
+        props);
+}
+
+static void
+on_conf_reloaded (WpEvent * event, WpDaemon * d)
+{
+  g_autoptr (WpConf) conf = NULL;
+
+  /* another reload was requested before this one was dispatched */
+  if (--d->n_pending_reloads > 0)
+    return;
+
+  conf = wp_core_get_conf (d->core);
+  if (conf)
+    wp_conf_close (conf);
+}
+
+static void
+daemon_register_conf_reloaded_hook (WpDaemon * d)
+{
+  g_autoptr (WpEventDispatcher) dispatcher =
+      wp_event_dispatcher_get_instance (d->core);
+
+  d->conf_reloaded_hook = wp_simple_event_hook_new ("daemon/conf-reloaded",
+      NULL, NULL, g_cclosure_new ((GCallback) on_conf_reloaded, d, NULL));
+  wp_interest_event_hook_add_interest (
+      WP_INTEREST_EVENT_HOOK (d->conf_reloaded_hook),
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "conf-reloaded",
+      NULL);
+  wp_event_dispatcher_register_hook (dispatcher, d->conf_reloaded_hook);
+}
+
+static void
+daemon_reload_conf (WpDaemon * d)
+{
+  g_autoptr (WpConf) conf = wp_core_get_conf (d->core);
+  g_autoptr (WpPlugin) event_source = NULL;
+  g_autoptr (GHashTable) sections = NULL;
+  g_autoptr (GError) error = NULL;
+  GHashTableIter iter;
+  const gchar *name, *value, *old_value;
+
+  /* the configuration is still in use while loading components */
+  if (!conf || !wp_object_test_active_features (WP_OBJECT (d->core),
+          WP_CORE_FEATURE_COMPONENTS)) {
+    wp_notice ("ignoring reload request, the daemon is not fully started yet");
+    return;
+  }
+
+  wp_notice ("reloading configuration");
+
+  /* the conf is closed after loading components; on success it stays open
+     until the conf-changed events have been dispatched, so that hooks can
+     read the new sections */
+  wp_conf_close (conf);
+  if (!wp_conf_open (conf, &error)) {
+    wp_warning ("failed to reload configuration, keeping the current one: %s",
+        error->message);
+    wp_conf_close (conf);
+    return;
+  }
+
+  sections = collect_conf_sections (conf);
+  event_source = wp_plugin_find (d->core, "standard-event-source");
+  if (!event_source)
+    wp_warning ("standard-event-source is not loaded; "
+        "configuration changes will not be applied");
+
+  g_hash_table_iter_init (&iter, sections);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &name,
+             (gpointer *) &value)) {
+    old_value = g_hash_table_lookup (d->conf_sections, name);
+    if (!old_value)
+      publish_conf_change (d, event_source, name, "added");
+    else if (!g_str_equal (old_value, value))
+      publish_conf_change (d, event_source, name, "changed");
+  }
+
+  g_hash_table_iter_init (&iter, d->conf_sections);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &name, NULL)) {
+    if (!g_hash_table_contains (sections, name))
+      publish_conf_change (d, event_source, name, "removed");
+  }
+
+  g_clear_pointer (&d->conf_sections, g_hash_table_unref);
+  d->conf_sections = g_steal_pointer (&sections);
+
+  /* conf-reloaded has the same priority as conf-changed and events of the
+     same priority are dispatched in order, so it runs after all of them */
+  if (event_source) {
+    if (!d->conf_reloaded_hook)
+      daemon_register_conf_reloaded_hook (d);
+    d->n_pending_reloads++;
+    g_signal_emit_by_name (event_source, "push-event", "conf-reloaded", NULL,
+        NULL);
+  } else {
+    wp_conf_close (conf);
+  }
+}
+
 static gboolean
 signal_handler_hup (gpointer data)
 {
-  return signal_handler (SIGHUP, data);
+  WpDaemon *d = data;
+  daemon_reload_conf (d);
+  return G_SOURCE_CONTINUE;
 }
 
 static gboolean
@@ -201,6 +364,10 @@ main (gint argc, gchar **argv)
     return WP_EXIT_OK;
   }
 
+  /* the main loop runs for the lifetime of the daemon, so the monitors
+     that keep the lookup cache up to date can be relied upon */
+  wp_base_dirs_set_cache_enabled (TRUE);
+
   if (!config_file)
     config_file = "wireplumber.conf";
   if (!profile)
@@ -213,6 +380,9 @@ main (gint argc, gchar **argv)
     return WP_EXIT_CONFIG;
   }
 
+  /* remember the sections, to find out what changes on reload */
+  d.conf_sections = collect_conf_sections (conf);
+
   warn_about_deprecated_config ();
 
   /* prepare core properties */
@@ -243,6 +413,8 @@ main (gint argc, gchar **argv)
   /* watch for exit signals */
   g_unix_signal_add (SIGINT, signal_handler_int, &d);
   g_unix_signal_add (SIGTERM, signal_handler_term, &d);
+
+  /* reload the configuration on SIGHUP */
   g_unix_signal_add (SIGHUP, signal_handler_hup, &d);
 
   wp_object_activate (WP_OBJECT (d.core), WP_OBJECT_FEATURES_ALL, NULL,
@@ -5,10 +5,20 @@
 --
 -- SPDX-License-Identifier: MIT
 
+cutils = require ("common-utils")
 log = Log.open_topic ("s-client")
 
 config = {}
 config.rules = Conf.get_section_as_json ("access.rules")
+if config.rules then
+  config.rules = RuleSet (config.rules)
+end
+
+-- clients that are already connected keep their permissions
+cutils.watch_conf_section ("client/access-default-conf-changed", "access.rules",
+  function (rules)
+    config.rules = rules and RuleSet (rules)
+  end)
 
 function getAccess (properties)
   local access = properties["pipewire.access"]
@@ -127,13 +127,15 @@ metadata_added_hook = SimpleEventHook {
     local om = source:call ("get-object-manager", "metadata")
     local metadata = om:lookup { Constraint { "metadata.name", "=", "default" } }
 
-    for _, t in ipairs (types) do
-      local v = state_table ["default.configured." .. t]
-      if v then
-        metadata:set (0, "default.configured." .. t, "Spa:String:JSON",
-                      Json.Object { ["name"] = v }:to_string ())
+    metadata:batch (function (m)
+      for _, t in ipairs (types) do
+        local v = state_table ["default.configured." .. t]
+        if v then
+          m:set (0, "default.configured." .. t, "Spa:String:JSON",
+                 Json.Object { ["name"] = v }:to_string ())
+        end
       end
-    end
+    end)
   end
 }
 
@@ -84,20 +84,23 @@ function isSwitchedToHeadsetProfile (device)
 end
 
 function findProfile (device, index, name)
-  for p in device:iterate_params ("EnumProfile") do
-    local profile = cutils.parseParam (p, "EnumProfile")
-    if not profile then
-      goto skip_enum_profile
-    end
+  local filter = nil
+  if index ~= nil then
+    filter = { index = index }
+  elseif name ~= nil then
+    filter = { name = name }
+  else
+    return INVALID, INVALID, nil
+  end
 
-    Log.debug ("Profile name: " .. profile.name .. ", priority: "
-              .. tostring (profile.priority) .. ", index: " .. tostring (profile.index))
-    if (index ~= nil and profile.index == index) or
-       (name ~= nil and profile.name == name) then
-      return profile.priority, profile.index, profile.name
-    end
+  for p in device:iterate_params ("EnumProfile", filter) do
+    local priority = p:get_field ("priority")
+    local p_index = p:get_field ("index")
+    local p_name = p:get_field ("name")
 
-    ::skip_enum_profile::
+    Log.debug ("Profile name: " .. tostring (p_name) .. ", priority: "
+              .. tostring (priority) .. ", index: " .. tostring (p_index))
+    return priority, p_index, p_name
   end
 
   return INVALID, INVALID, nil
@@ -119,22 +122,14 @@ function highestPrioProfileWithInputRoute (device)
   local profile_index = INVALID
   local profile_name = nil
 
-  for p in device:iterate_params ("EnumRoute") do
-    local route = cutils.parseParam (p, "EnumRoute")
-    -- Parse pod
-    if not route then
-      goto skip_enum_route
-    end
-
-    if route.direction ~= "Input" then
-      goto skip_enum_route
-    end
+  for p in device:iterate_params ("EnumRoute", { direction = "Input" }) do
+    local profiles = p:get_field ("profiles")
 
-    Log.debug ("Route with index: " .. tostring (route.index) .. ", direction: "
-          .. route.direction .. ", name: " .. route.name .. ", description: "
-          .. route.description .. ", priority: " .. route.priority)
-    if route.profiles then
-      for _, v in pairs (route.profiles) do
+    Log.debug ("Route with index: " .. tostring (p:get_field ("index"))
+          .. ", direction: Input, name: " .. tostring (p:get_field ("name"))
+          .. ", priority: " .. tostring (p:get_field ("priority")))
+    if profiles then
+      for _, v in ipairs (profiles) do
         local priority, index, name = findProfile (device, v)
         if priority ~= INVALID then
           if profile_priority < priority then
@@ -145,18 +140,16 @@ function highestPrioProfileWithInputRoute (device)
         end
       end
     end
-
-    ::skip_enum_route::
   end
 
   return profile_priority, profile_index, profile_name
 end
 
 function hasProfileInputRoute (device, profile_index)
-  for p in device:iterate_params ("EnumRoute") do
-    local route = cutils.parseParam (p, "EnumRoute")
-    if route and route.direction == "Input" and route.profiles then
-      for _, v in pairs (route.profiles) do
+  for p in device:iterate_params ("EnumRoute", { direction = "Input" }) do
+    local profiles = p:get_field ("profiles")
+    if profiles then
+      for _, v in ipairs (profiles) do
         if v == profile_index then
           return true
         end
@@ -11,7 +11,12 @@ cutils = require ("common-utils")
 log = Log.open_topic ("s-device")
 
 config = {}
-config.rules = Conf.get_section_as_json ("device.profile.priority.rules", Json.Array {})
+config.rules = RuleSet (Conf.get_section_as_json ("device.profile.priority.rules", Json.Array {}))
+
+cutils.watch_conf_section ("device/find-preferred-profile-conf-changed",
+  "device.profile.priority.rules", function (rules)
+    config.rules = RuleSet (rules or Json.Array {})
+  end)
 
 SimpleEventHook {
   name = "device/find-preferred-profile",
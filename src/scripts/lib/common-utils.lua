@@ -87,6 +87,23 @@ function cutils.arrayContains (a, value)
   return false
 end
 
+-- Calls `callback` with the new value of a configuration section (as Json,
+-- or nil if it was removed) when it changes on a configuration reload
+function cutils.watch_conf_section (hook_name, section, callback)
+  SimpleEventHook {
+    name = hook_name,
+    interests = {
+      EventInterest {
+        Constraint { "event.type", "=", "conf-changed" },
+        Constraint { "event.subject.section", "=", section },
+      },
+    },
+    execute = function (event)
+      callback (Conf.get_section_as_json (section))
+    end
+  }:register ()
+end
+
 function cutils.get_application_name ()
   return Core.get_properties()["application.name"] or "WirePlumber"
 end
@@ -14,6 +14,26 @@ local lutils = {
   priority_media_role_link = {},
 }
 
+-- the graph-index plugin answers the link & link-group queries below from
+-- an incrementally maintained index; without it, we iterate the object
+-- managers instead
+local graph_index = nil
+
+local function get_graph_index ()
+  graph_index = graph_index or Plugin.find ("graph-index")
+  return graph_index
+end
+
+-- the target-selector plugin keeps the linkables that the find-*-target
+-- hooks look at in ranked and keyed indexes; without it, these hooks
+-- iterate the session items instead
+local target_selector = nil
+
+function lutils.get_target_selector ()
+  target_selector = target_selector or Plugin.find ("target-selector")
+  return target_selector
+end
+
 function lutils.get_flags (self, si_id)
   if not self.si_flags [si_id] then
     self.si_flags [si_id] = {}
@@ -196,6 +216,11 @@ function lutils.checkFollowDefault (si, si_target)
 end
 
 function lutils.lookupLink (si_id, si_target_id)
+  local gi = get_graph_index ()
+  if gi then
+    return gi:call ("lookup-link", si_id, si_target_id)
+  end
+
   local link = cutils.get_object_manager ("session-item"):lookup {
     type = "SiLink",
     Constraint { "out.item.id", "=", si_id },
@@ -216,6 +241,17 @@ function lutils.isLinked (si_target)
   local linked = false
   local exclusive = false
 
+  local gi = get_graph_index ()
+  if gi then
+    local l = gi:call ("get-link", target_id)
+    if l then
+      local p = l.properties
+      linked = true
+      exclusive = cutils.parseBool (p ["exclusive"]) or cutils.parseBool (p ["passthrough"])
+    end
+    return linked, exclusive
+  end
+
   for l in cutils.get_object_manager ("session-item"):iterate {
     type = "SiLink",
   } do
@@ -232,6 +268,12 @@ function lutils.isLinked (si_target)
 end
 
 function lutils.getNodePeerId (node_id)
+  local gi = get_graph_index ()
+  if gi then
+    local peer_id = gi:call ("get-node-peer", node_id)
+    return peer_id ~= Id.INVALID and peer_id or nil
+  end
+
   for l in cutils.get_object_manager ("link"):iterate() do
     local p = l.properties
     local in_id = tonumber(p["link.input.node"])
@@ -317,8 +359,54 @@ function lutils.canLink (properties, si_target)
     return true
   end
 
+  -- same as canLinkGroupCheck(), using the graph index; items are given by
+  -- their id and the info that the index has about them
+  local function canLinkGroupCheckIndexed (gi, link_group, id, info, hops)
+    local target_link_group = info ["link-group"]
+
+    if hops == 8 then
+      return false
+    end
+
+    if not target_link_group then
+      return true
+    end
+
+    if link_group == target_link_group then
+      return false
+    end
+
+    for _, n_id in ipairs (gi:call ("get-link-group-members",
+        target_link_group, info ["direction"])) do
+      if n_id ~= id then
+        for _, peer_id in ipairs (gi:call ("get-link-peers", n_id)) do
+          local peer_info = gi:call ("get-item-info", peer_id)
+          if peer_info and not canLinkGroupCheckIndexed (gi, link_group,
+                peer_id, peer_info, hops + 1) then
+            return false
+          end
+        end
+      end
+    end
+    return true
+  end
+
   local link_group = properties ["node.link-group"]
   if link_group then
+    local gi = get_graph_index ()
+    if gi then
+      -- memoized by the index, for targets that it knows about
+      local res = gi:call ("can-link-group", link_group, si_target.id)
+      if res ~= nil then
+        return res
+      end
+
+      local info = {
+        ["link-group"] = target_props ["node.link-group"],
+        ["direction"] = target_props ["item.node.direction"],
+      }
+      return canLinkGroupCheckIndexed (gi, link_group, si_target.id, info, 0)
+    end
     return canLinkGroupCheck (link_group, si_target, 0)
   end
   return true
@@ -328,6 +416,10 @@ function lutils.findDefaultLinkable (si)
   local si_props = si.properties
   local target_direction = cutils.getTargetDirection (si_props)
   local def_node_id = cutils.getDefaultNode (si_props, target_direction)
+  local ts = lutils.get_target_selector ()
+  if ts then
+    return ts:call ("lookup-target", "node.id", tostring (def_node_id))
+  end
   return cutils.get_object_manager ("session-item"):lookup {
     type = "SiLinkable",
     Constraint { "item.factory.name", "c", "si-audio-adapter", "si-node" },
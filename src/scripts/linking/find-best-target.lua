@@ -11,6 +11,44 @@ cutils = require ("common-utils")
 futils = require ("filter-utils")
 log = Log.open_topic ("s-linking")
 
+-- checks if target can be picked up as the best target of si;
+-- returns whether it can and whether the link can passthrough
+local function checkTarget (si, si_props, target, target_direction)
+  local target_props = target.properties
+  local si_target_node = target:get_associated_proxy ("node")
+  local si_target_link_group = si_target_node.properties ["node.link-group"]
+
+  log:debug (string.format ("Looking at: %s (%s)",
+    tostring (target_props ["node.name"]),
+    tostring (target_props ["node.id"])))
+
+  -- Skip smart filters as best target
+  if si_target_link_group ~= nil and
+      futils.is_filter_smart (target_direction, si_target_link_group) then
+    Log.debug ("... ignoring smart filter as best target")
+    return false
+  end
+
+  if not lutils.canLink (si_props, target) then
+    log:debug ("... cannot link, skip linkable")
+    return false
+  end
+
+  if not lutils.haveAvailableRoutes (target_props) then
+    log:debug ("... does not have routes, skip linkable")
+    return false
+  end
+
+  local passthrough_compatible, can_passthrough =
+  lutils.checkPassthroughCompatibility (si, target)
+  if not passthrough_compatible then
+    log:debug ("... passthrough is not compatible, skip linkable")
+    return false
+  end
+
+  return true, can_passthrough
+end
+
 SimpleEventHook {
   name = "linking/find-best-target",
   after = { "linking/find-defined-target",
@@ -37,10 +75,34 @@ SimpleEventHook {
     local target_can_passthrough = false
     local target_priority = 0
     local target_plugged = 0
+    local ts = lutils.get_target_selector ()
 
     log:info (si, string.format ("handling item: %s (%s)",
         tostring (si_props ["node.name"]), tostring (si_props ["node.id"])))
 
+    if ts then
+      -- candidates come ranked by priority and then by plugged time, exactly
+      -- like below, so the first one that passes the checks is the best
+      local candidates = ts:call ("get-targets", si.id, {
+        ["item.node.direction"] = target_direction,
+        ["media.type"] = si_props ["media.type"],
+      })
+      for _, id in ipairs (candidates) do
+        local candidate = ts:call ("get-target", id)
+        if candidate then
+          local ok, can_passthrough =
+              checkTarget (si, si_props, candidate, target_direction)
+          if ok then
+            log:debug ("... picked")
+            target_picked = candidate
+            target_can_passthrough = can_passthrough
+            break
+          end
+        end
+      end
+      goto done
+    end
+
     for target in om:iterate {
       type = "SiLinkable",
       Constraint { "item.node.type", "=", "device" },
@@ -48,36 +110,11 @@ SimpleEventHook {
       Constraint { "media.type", "=", si_props ["media.type"] },
     } do
       local target_props = target.properties
-      local target_node_id = target_props ["node.id"]
-      local si_target_node = target:get_associated_proxy ("node")
-      local si_target_link_group = si_target_node.properties ["node.link-group"]
       local priority = tonumber (target_props ["priority.session"]) or 0
 
-      log:debug (string.format ("Looking at: %s (%s)",
-        tostring (target_props ["node.name"]),
-        tostring (target_node_id)))
-
-      -- Skip smart filters as best target
-      if si_target_link_group ~= nil and
-          futils.is_filter_smart (target_direction, si_target_link_group) then
-        Log.debug ("... ignoring smart filter as best target")
-        goto skip_linkable
-      end
-
-      if not lutils.canLink (si_props, target) then
-        log:debug ("... cannot link, skip linkable")
-        goto skip_linkable
-      end
-
-      if not lutils.haveAvailableRoutes (target_props) then
-        log:debug ("... does not have routes, skip linkable")
-        goto skip_linkable
-      end
-
-      local passthrough_compatible, can_passthrough =
-      lutils.checkPassthroughCompatibility (si, target)
-      if not passthrough_compatible then
-        log:debug ("... passthrough is not compatible, skip linkable")
+      local ok, can_passthrough =
+          checkTarget (si, si_props, target, target_direction)
+      if not ok then
         goto skip_linkable
       end
 
@@ -102,6 +139,7 @@ SimpleEventHook {
       ::skip_linkable::
     end
 
+    ::done::
     if target_picked then
       log:info (si,
         string.format ("... best target picked: %s (%s), can_passthrough:%s",
@@ -41,6 +41,7 @@ SimpleEventHook {
     local target_value = nil
     local node_defined = false
     local target_picked = nil
+    local ts = lutils.get_target_selector ()
 
     if si_props ["target.object"] ~= nil then
       target_value = si_props ["target.object"]
@@ -72,13 +73,28 @@ SimpleEventHook {
       target_picked = false
       target = nil
     elseif target_value and tonumber (target_value) then
-      target = om:lookup {
-        type = "SiLinkable",
-        Constraint { target_key, "=", target_value },
-      }
+      if ts then
+        target = ts:call ("lookup-target", target_key, target_value)
+      else
+        target = om:lookup {
+          type = "SiLinkable",
+          Constraint { target_key, "=", target_value },
+        }
+      end
       if target and lutils.canLink (si_props, target) then
         target_picked = true
       end
+    elseif target_value and ts then
+      local target_direction = cutils.getTargetDirection (si_props)
+      for _, id in ipairs (ts:call ("find-targets-by-name", target_value,
+          target_direction)) do
+        local lnkbl = ts:call ("get-target", id)
+        if lnkbl and lutils.canLink (si_props, lnkbl) then
+          target_picked = true
+          target = lnkbl
+          break
+        end
+      end
     elseif target_value then
       for lnkbl in om:iterate { type = "SiLinkable" } do
         local target_props = lnkbl.properties
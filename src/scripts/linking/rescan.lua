@@ -113,10 +113,20 @@ SimpleEventHook {
   end
 }:register ()
 
-function handleLinkables (source)
+function handleLinkables (source, dirty_items)
   local om = source:call ("get-object-manager", "session-item")
 
   for si in om:iterate { type = "SiLinkable" } do
+    -- on partial rescans, only handle the items that were affected by the
+    -- changes and those that are not linked yet, as they may be waiting
+    -- for a target to appear
+    if dirty_items and not dirty_items [tostring (si.id)] then
+      local si_flags = lutils.si_flags [si.id]
+      if si_flags and si_flags.peer_id then
+        goto skip_linkable
+      end
+    end
+
     local valid, si_props = checkLinkable (si, om)
     if not valid then
       goto skip_linkable
@@ -146,8 +156,13 @@ SimpleEventHook {
   execute = function (event)
     local source = event:get_source ()
     local om = source:call ("get-object-manager", "session-item")
+    local dirty_items = event:get_data ("dirty-items")
 
-    log:info ("rescanning...")
+    if dirty_items then
+      log:info ("rescanning changed items...")
+    else
+      log:info ("rescanning...")
+    end
 
     -- always unlink all filters that are smart and disabled
     for si in om:iterate {
@@ -163,12 +178,51 @@ SimpleEventHook {
       end
     end
 
-    handleLinkables (source)
+    handleLinkables (source, dirty_items)
   end
 }:register ()
 
+-- A new stream does not affect how other linkables are linked, so only the
+-- stream itself needs to be handled. New targets and filters may change the
+-- target of any other linkable, so they need a full rescan.
+function scheduleRescanForAddedLinkable (source, si)
+  local si_props = si.properties
+
+  if si_props ["item.node.type"] == "stream" and
+      si_props ["node.link-group"] == nil then
+    source:call ("schedule-rescan-for-item", "linking", si.id)
+  else
+    source:call ("schedule-rescan", "linking")
+  end
+end
+
+-- When a linkable is removed, only its peers need to find a new target,
+-- unless it was a filter, in which case the whole filter chain may change
+function scheduleRescanForRemovedLinkable (source, si)
+  local om = source:call ("get-object-manager", "session-item")
+  local si_id = si.id
+
+  if si.properties ["node.link-group"] ~= nil then
+    source:call ("schedule-rescan", "linking")
+    return
+  end
+
+  for silink in om:iterate { type = "SiLink" } do
+    local out_id = tonumber (silink.properties ["out.item.id"])
+    local in_id = tonumber (silink.properties ["in.item.id"])
+
+    if out_id == si_id then
+      source:call ("schedule-rescan-for-item", "linking", in_id)
+    elseif in_id == si_id then
+      source:call ("schedule-rescan-for-item", "linking", out_id)
+    end
+  end
+end
+
 SimpleEventHook {
   name = "linking/rescan-trigger",
+  -- the links of the removed linkable must still be there to find its peers
+  before = "linking/linkable-removed",
   interests = {
     -- on linkable added or removed, where linkable is adapter or plain node
     EventInterest {
@@ -194,8 +248,18 @@ SimpleEventHook {
     },
   },
   execute = function (event)
-    if handles.rescan_enabled then
-      local source = event:get_source ()
+    if not handles.rescan_enabled then
+      return
+    end
+
+    local source = event:get_source ()
+    local event_type = event:get_properties () ["event.type"]
+
+    if event_type == "session-item-added" then
+      scheduleRescanForAddedLinkable (source, event:get_subject ())
+    elseif event_type == "session-item-removed" then
+      scheduleRescanForRemovedLinkable (source, event:get_subject ())
+    else
       source:call ("schedule-rescan", "linking")
     end
   end
@@ -269,7 +333,21 @@ function handleMoveSetting (enable)
       },
       execute = function (event)
         local source = event:get_source ()
-        source:call ("schedule-rescan", "linking")
+        local om = source:call ("get-object-manager", "session-item")
+        local node_id = event:get_properties () ["event.subject.id"]
+
+        -- only the stream that was moved needs to be handled, unless it is
+        -- a filter, which may change the whole chain, or it is not known
+        -- (yet), in which case we cannot tell what is affected
+        local si = om:lookup {
+          type = "SiLinkable",
+          Constraint { "node.id", "=", node_id },
+        }
+        if si and si.properties ["node.link-group"] == nil then
+          source:call ("schedule-rescan-for-item", "linking", si.id)
+        else
+          source:call ("schedule-rescan", "linking")
+        end
       end
     }
     handles.move_hook:register()
@@ -14,7 +14,12 @@ log = Log.open_topic ("s-monitors")
 config = {}
 config.reserve_device = Core.test_feature ("monitor.alsa.reserve-device")
 config.properties = Conf.get_section_as_properties ("monitor.alsa.properties")
-config.rules = Conf.get_section_as_json ("monitor.alsa.rules", Json.Array {})
+config.rules = RuleSet (Conf.get_section_as_json ("monitor.alsa.rules", Json.Array {}))
+
+cutils.watch_conf_section ("monitor/alsa/conf-changed",
+  "monitor.alsa.rules", function (rules)
+    config.rules = RuleSet (rules or Json.Array {})
+  end)
 
 -- unique device/node name tables
 device_names_table = nil
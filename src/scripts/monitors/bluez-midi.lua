@@ -15,7 +15,12 @@ config = {}
 config.seat_monitoring = Core.test_feature ("monitor.bluez.seat-monitoring")
 config.properties = Conf.get_section_as_properties ("monitor.bluez-midi.properties")
 config.servers = Conf.get_section_as_array ("monitor.bluez-midi.servers", defaults.servers)
-config.rules = Conf.get_section_as_json ("monitor.bluez-midi.rules", Json.Array {})
+config.rules = RuleSet (Conf.get_section_as_json ("monitor.bluez-midi.rules", Json.Array {}))
+
+cutils.watch_conf_section ("monitor/bluez-midi/conf-changed",
+  "monitor.bluez-midi.rules", function (rules)
+    config.rules = RuleSet (rules or Json.Array {})
+  end)
 
 -- unique device/node name tables
 node_names_table = nil
@@ -15,7 +15,12 @@ log = Log.open_topic ("s-monitors")
 config = {}
 config.seat_monitoring = Core.test_feature ("monitor.bluez.seat-monitoring")
 config.properties = Conf.get_section_as_properties ("monitor.bluez.properties")
-config.rules = Conf.get_section_as_json ("monitor.bluez.rules", Json.Array {})
+config.rules = RuleSet (Conf.get_section_as_json ("monitor.bluez.rules", Json.Array {}))
+
+cutils.watch_conf_section ("monitor/bluez/conf-changed",
+  "monitor.bluez.rules", function (rules)
+    config.rules = RuleSet (rules or Json.Array {})
+  end)
 
 -- This is not a setting, it must always be enabled
 config.properties["api.bluez5.connection-info"] = true
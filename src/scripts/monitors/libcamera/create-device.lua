@@ -11,7 +11,12 @@ mutils = require ("monitor-utils")
 log = Log.open_topic ("s-monitors-libcamera")
 
 config = {}
-config.rules = Conf.get_section_as_json ("monitor.libcamera.rules", Json.Array {})
+config.rules = RuleSet (Conf.get_section_as_json ("monitor.libcamera.rules", Json.Array {}))
+
+cutils.watch_conf_section ("monitor/libcamera/create-device-conf-changed",
+  "monitor.libcamera.rules", function (rules)
+    config.rules = RuleSet (rules or Json.Array {})
+  end)
 
 function createLibcamNode (parent, id, type, factory, properties)
   mutils:register_cam_node (parent, id, factory, properties)
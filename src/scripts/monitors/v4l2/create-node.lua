@@ -11,7 +11,12 @@ mutils = require ("monitor-utils")
 log = Log.open_topic ("s-monitors-v4l2")
 
 config = {}
-config.rules = Conf.get_section_as_json ("monitor.v4l2.rules", Json.Array {})
+config.rules = RuleSet (Conf.get_section_as_json ("monitor.v4l2.rules", Json.Array {}))
+
+cutils.watch_conf_section ("monitor/v4l2/create-node-conf-changed",
+  "monitor.v4l2.rules", function (rules)
+    config.rules = RuleSet (rules or Json.Array {})
+  end)
 
 SimpleEventHook {
   name = "monitor/v4l2/create-node",
@@ -5,10 +5,16 @@
 --
 -- SPDX-License-Identifier: MIT
 
+cutils = require ("common-utils")
 log = Log.open_topic("s-node")
 
 config = {}
-config.rules = Conf.get_section_as_json("node.software-dsp.rules", Json.Array{})
+config.rules = RuleSet (Conf.get_section_as_json ("node.software-dsp.rules", Json.Array{}))
+
+cutils.watch_conf_section ("node/dsp/conf-changed", "node.software-dsp.rules",
+  function (rules)
+    config.rules = RuleSet (rules or Json.Array {})
+  end)
 
 -- TODO: port from Obj Manager to Hooks
 clients_om = ObjectManager {
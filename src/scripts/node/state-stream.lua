@@ -12,7 +12,12 @@ cutils = require ("common-utils")
 log = Log.open_topic ("s-node")
 
 config = {}
-config.rules = Conf.get_section_as_json ("stream.rules", Json.Array {})
+config.rules = RuleSet (Conf.get_section_as_json ("stream.rules", Json.Array {}))
+
+cutils.watch_conf_section ("node/restore-stream-conf-changed", "stream.rules",
+  function (rules)
+    config.rules = RuleSet (rules or Json.Array {})
+  end)
 
 -- the state storage
 state = nil
@@ -23,6 +23,13 @@ static const gchar *DEFAULT_NODE_MEDIA_CLASSES[] = {
   "Video/Source",
 };
 
+/* the API plugins that a subcommand needs; all of them by default */
+enum {
+  WPCTL_PLUGIN_DEFAULT_NODES_API = (1 << 0),
+  WPCTL_PLUGIN_MIXER_API = (1 << 1),
+  WPCTL_PLUGINS_ALL = WPCTL_PLUGIN_DEFAULT_NODES_API | WPCTL_PLUGIN_MIXER_API,
+};
+
 typedef struct _WpCtl WpCtl;
 struct _WpCtl
 {
@@ -30,6 +37,7 @@ struct _WpCtl
   GMainLoop *loop;
   WpCore *core;
   WpObjectManager *om;
+  guint plugins;
   guint pending_plugins;
   gint exit_code;
 };
@@ -39,6 +47,7 @@ static struct {
     struct {
       gboolean display_nicknames;
       gboolean display_names;
+      gboolean snapshot;
     } status;
     struct {
       guint64 id;
@@ -92,14 +101,24 @@ static struct {
       guint64 id;
       const char *level;
     } set_log_level;
+
+    struct {
+      gchar **types;
+      gchar *media_class;
+      gint batch_ms;
+      gint batch_size;
+    } monitor;
   };
 } cmdline;
 
+static void monitor_clear (void);
+
 G_DEFINE_QUARK (wpctl-error, wpctl_error_domain)
 
 static void
 wp_ctl_clear (WpCtl * self)
 {
+  monitor_clear ();
   g_clear_object (&self->om);
   g_clear_object (&self->core);
   g_clear_pointer (&self->loop, g_main_loop_unref);
@@ -213,6 +232,20 @@ run_nodes_by_pid (WpObjectManager *om, guint32 pid,
 static gboolean
 status_prepare (WpCtl * self, GError ** error)
 {
+  /* the snapshot is published by the daemon in a single metadata object,
+     so there is no need to bind all the other objects, nor to load the
+     API plugins, which bind all the nodes and devices themselves */
+  if (cmdline.status.snapshot) {
+    self->plugins = 0;
+    wp_object_manager_add_interest (self->om, WP_TYPE_METADATA,
+        WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+        "metadata.name", "=s", "sm-snapshot",
+        NULL);
+    wp_object_manager_request_object_features (self->om, WP_TYPE_METADATA,
+        WP_OBJECT_FEATURES_ALL);
+    return TRUE;
+  }
+
   wp_object_manager_add_interest (self->om, WP_TYPE_CLIENT, NULL);
   wp_object_manager_add_interest (self->om, WP_TYPE_DEVICE, NULL);
   wp_object_manager_add_interest (self->om, WP_TYPE_NODE, NULL);
@@ -362,10 +395,18 @@ print_stream_node (const GValue *item, gpointer data)
   g_autoptr (WpIterator) it = wp_object_manager_new_filtered_iterator (self->om,
       WP_TYPE_PORT, WP_CONSTRAINT_TYPE_PW_PROPERTY, PW_KEY_NODE_ID, "=u", id,
       NULL);
-  g_auto (GValue) val = G_VALUE_INIT;
+  gpointer ports[16];
+  guint n_ports = 0, i = 0;
+
+  for (;; i++) {
+    if (i == n_ports) {
+      n_ports = wp_iterator_next_batch (it, ports, G_N_ELEMENTS (ports));
+      i = 0;
+      if (n_ports == 0)
+        break;
+    }
 
-  for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
-    WpPort *port = g_value_get_object (&val);
+    WpPort *port = ports[i];
     obj = WP_PIPEWIRE_OBJECT (port);
     id = wp_proxy_get_bound_id (WP_PROXY (obj));
     name = wp_pipewire_object_get_property (obj, PW_KEY_PORT_NAME);
@@ -399,6 +440,34 @@ print_stream_node (const GValue *item, gpointer data)
   }
 }
 
+static void
+status_snapshot_run (WpCtl * self)
+{
+  g_autoptr (WpMetadata) m = NULL;
+  const gchar *snapshot = NULL;
+
+  m = wp_object_manager_lookup (self->om, WP_TYPE_METADATA, NULL);
+  if (!m) {
+    fprintf (stderr, "No snapshot metadata found; enable the "
+        "metadata.sm-snapshot feature in a WirePlumber profile\n");
+    goto out;
+  }
+
+  snapshot = wp_metadata_find (m, 0, "snapshot", NULL);
+  if (!snapshot) {
+    fprintf (stderr, "Snapshot is not available\n");
+    goto out;
+  }
+
+  printf ("%s\n", snapshot);
+  g_main_loop_quit (self->loop);
+  return;
+
+out:
+  self->exit_code = 3;
+  g_main_loop_quit (self->loop);
+}
+
 static void
 status_run (WpCtl * self)
 {
@@ -407,6 +476,11 @@ status_run (WpCtl * self)
   g_autoptr (WpPlugin) def_nodes_api = NULL;
   struct print_context context = { .self = self };
 
+  if (cmdline.status.snapshot) {
+    status_snapshot_run (self);
+    return;
+  }
+
   def_nodes_api = wp_plugin_find (self->core, "default-nodes-api");
   context.mixer_api = wp_plugin_find (self->core, "mixer-api");
 
@@ -1671,7 +1745,457 @@ out:
   g_main_loop_quit (self->loop);
 }
 
-#define N_ENTRIES 4
+/* monitor */
+
+#define MONITOR_DEFAULT_BATCH_MS 100
+#define MONITOR_DEFAULT_BATCH_SIZE 64
+
+static const struct {
+  const gchar *name;
+  GType (*get_type) (void);
+} monitor_types[] = {
+  { "client", wp_client_get_type },
+  { "device", wp_device_get_type },
+  { "node", wp_node_get_type },
+  { "port", wp_port_get_type },
+  { "link", wp_link_get_type },
+};
+
+static struct {
+  /* JSON lines waiting to be written out */
+  GString *batch;
+  guint n_pending;
+  GSource *flush_source;
+  /* bound id -> WpProperties, as last reported */
+  GHashTable *props;
+  /* bound ids of the nodes that match --media-class */
+  GHashTable *nodes;
+  guint32 defaults[G_N_ELEMENTS (DEFAULT_NODE_MEDIA_CLASSES)];
+  WpPlugin *def_nodes_api;
+  WpPlugin *mixer_api;
+} monitor;
+
+static gboolean
+monitor_parse_positional (gint argc, gchar ** argv, GError **error)
+{
+  if (argc > 2) {
+    g_set_error (error, wpctl_error_domain_quark(), 0,
+        "monitor does not take positional arguments");
+    return FALSE;
+  }
+
+  for (gchar **t = cmdline.monitor.types; t && *t; t++) {
+    gboolean found = FALSE;
+    for (guint i = 0; i < G_N_ELEMENTS (monitor_types) && !found; i++)
+      found = !g_strcmp0 (*t, monitor_types[i].name);
+    if (!found) {
+      g_set_error (error, wpctl_error_domain_quark(), 0,
+          "'%s' is not a valid object type", *t);
+      return FALSE;
+    }
+  }
+
+  if (cmdline.monitor.batch_ms <= 0)
+    cmdline.monitor.batch_ms = MONITOR_DEFAULT_BATCH_MS;
+  if (cmdline.monitor.batch_size <= 0)
+    cmdline.monitor.batch_size = MONITOR_DEFAULT_BATCH_SIZE;
+
+  return TRUE;
+}
+
+static gboolean
+monitor_type_selected (const gchar *name)
+{
+  return !cmdline.monitor.types ||
+      g_strv_contains ((const gchar * const *) cmdline.monitor.types, name);
+}
+
+static gboolean
+monitor_prepare (WpCtl * self, GError ** error)
+{
+  const gchar *media_class = cmdline.monitor.media_class;
+
+  for (guint i = 0; i < G_N_ELEMENTS (monitor_types); i++) {
+    GType type = monitor_types[i].get_type ();
+
+    if (!monitor_type_selected (monitor_types[i].name))
+      continue;
+
+    /* clients are not related to any media class */
+    if (media_class && type == WP_TYPE_CLIENT)
+      continue;
+
+    /* ports & links are filtered by the media class of their nodes, later */
+    if (media_class && (type == WP_TYPE_NODE || type == WP_TYPE_DEVICE))
+      wp_object_manager_add_interest (self->om, type,
+          WP_CONSTRAINT_TYPE_PW_PROPERTY, PW_KEY_MEDIA_CLASS, "#s",
+          media_class,
+          NULL);
+    else
+      wp_object_manager_add_interest (self->om, type, NULL);
+  }
+
+  /* the matching nodes are needed to filter ports & links, even if they are
+     not reported themselves */
+  if (media_class && !monitor_type_selected ("node") &&
+      (monitor_type_selected ("port") || monitor_type_selected ("link")))
+    wp_object_manager_add_interest (self->om, WP_TYPE_NODE,
+        WP_CONSTRAINT_TYPE_PW_PROPERTY, PW_KEY_MEDIA_CLASS, "#s", media_class,
+        NULL);
+
+  wp_object_manager_request_object_features (self->om, WP_TYPE_GLOBAL_PROXY,
+      WP_PIPEWIRE_OBJECT_FEATURES_MINIMAL);
+
+  /* default nodes & volumes are only reported for nodes; the API plugins
+     bind all the (audio) nodes and devices, so avoid them if possible */
+  if (!monitor_type_selected ("node"))
+    self->plugins = 0;
+
+  return TRUE;
+}
+
+static void
+monitor_flush (void)
+{
+  if (monitor.flush_source) {
+    g_source_destroy (monitor.flush_source);
+    g_clear_pointer (&monitor.flush_source, g_source_unref);
+  }
+
+  if (monitor.batch && monitor.batch->len > 0) {
+    fwrite (monitor.batch->str, 1, monitor.batch->len, stdout);
+    fflush (stdout);
+    g_string_truncate (monitor.batch, 0);
+  }
+  monitor.n_pending = 0;
+}
+
+static gboolean
+monitor_flush_timeout (gpointer data)
+{
+  g_clear_pointer (&monitor.flush_source, g_source_unref);
+  monitor_flush ();
+  return G_SOURCE_REMOVE;
+}
+
+static void
+monitor_clear (void)
+{
+  monitor_flush ();
+  if (monitor.batch)
+    g_string_free (g_steal_pointer (&monitor.batch), TRUE);
+  g_clear_pointer (&monitor.props, g_hash_table_unref);
+  g_clear_pointer (&monitor.nodes, g_hash_table_unref);
+  g_clear_object (&monitor.def_nodes_api);
+  g_clear_object (&monitor.mixer_api);
+}
+
+static WpSpaJsonBuilder *
+monitor_record_new (const gchar *event, const gchar *type, guint32 id)
+{
+  WpSpaJsonBuilder *b = wp_spa_json_builder_new_object ();
+
+  wp_spa_json_builder_add_property (b, "event");
+  wp_spa_json_builder_add_string (b, event);
+  if (type) {
+    wp_spa_json_builder_add_property (b, "type");
+    wp_spa_json_builder_add_string (b, type);
+  }
+  wp_spa_json_builder_add_property (b, "id");
+  wp_spa_json_builder_add_int (b, id);
+  return b;
+}
+
+/* records are written out when the batch is full or after batch-ms,
+   whichever comes first */
+static void
+monitor_record_emit (WpCtl * self, WpSpaJsonBuilder *b)
+{
+  g_autoptr (WpSpaJson) json = wp_spa_json_builder_end (b);
+
+  g_string_append_len (monitor.batch, wp_spa_json_get_data (json),
+      wp_spa_json_get_size (json));
+  g_string_append_c (monitor.batch, '\n');
+
+  if (++monitor.n_pending >= (guint) cmdline.monitor.batch_size)
+    monitor_flush ();
+  else if (!monitor.flush_source)
+    wp_core_timeout_add (self->core, &monitor.flush_source,
+        cmdline.monitor.batch_ms, monitor_flush_timeout, NULL, NULL);
+}
+
+static const gchar *
+monitor_type_name (gpointer obj)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (monitor_types); i++) {
+    if (G_TYPE_CHECK_INSTANCE_TYPE (obj, monitor_types[i].get_type ()))
+      return monitor_types[i].name;
+  }
+  return "unknown";
+}
+
+/* adds the properties that differ from old_props, returns how many */
+static guint
+monitor_add_properties (WpSpaJsonBuilder *b, WpProperties *props,
+    WpProperties *old_props)
+{
+  guint n_changed = 0;
+  g_autoptr (WpSpaJsonBuilder) p = wp_spa_json_builder_new_object ();
+  g_autoptr (WpSpaJson) p_json = NULL;
+  g_autoptr (WpIterator) it = NULL;
+  g_auto (GValue) val = G_VALUE_INIT;
+
+  /* new & changed keys */
+  if (props) {
+    it = wp_properties_new_iterator (props);
+    for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
+      WpPropertiesItem *pi = g_value_get_boxed (&val);
+      const gchar *key = wp_properties_item_get_key (pi);
+      const gchar *value = wp_properties_item_get_value (pi);
+
+      if (old_props && !g_strcmp0 (value, wp_properties_get (old_props, key)))
+        continue;
+      wp_spa_json_builder_add_property (p, key);
+      wp_spa_json_builder_add_string (p, value);
+      n_changed++;
+    }
+    g_clear_pointer (&it, wp_iterator_unref);
+  }
+
+  /* removed keys */
+  if (old_props) {
+    it = wp_properties_new_iterator (old_props);
+    for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
+      WpPropertiesItem *pi = g_value_get_boxed (&val);
+      const gchar *key = wp_properties_item_get_key (pi);
+
+      if (props && wp_properties_get (props, key))
+        continue;
+      wp_spa_json_builder_add_property (p, key);
+      wp_spa_json_builder_add_null (p);
+      n_changed++;
+    }
+  }
+
+  p_json = wp_spa_json_builder_end (p);
+  wp_spa_json_builder_add_property (b, "properties");
+  wp_spa_json_builder_add_json (b, p_json);
+  return n_changed;
+}
+
+static void
+monitor_on_properties_changed (WpPipewireObject *obj, GParamSpec *spec,
+    WpCtl * self)
+{
+  guint32 id = wp_proxy_get_bound_id (WP_PROXY (obj));
+  g_autoptr (WpProperties) props = wp_pipewire_object_get_properties (obj);
+  WpProperties *old_props =
+      g_hash_table_lookup (monitor.props, GUINT_TO_POINTER (id));
+  g_autoptr (WpSpaJsonBuilder) b =
+      monitor_record_new ("changed", monitor_type_name (obj), id);
+
+  /* properties are usually re-sent unchanged with other info updates */
+  if (monitor_add_properties (b, props, old_props) == 0)
+    return;
+
+  monitor_record_emit (self, b);
+
+  g_hash_table_insert (monitor.props, GUINT_TO_POINTER (id),
+      g_steal_pointer (&props));
+}
+
+/* with --media-class, ports & links are only reported if they belong to
+   one of the nodes that match it */
+static gboolean
+monitor_object_matches (WpPipewireObject *obj)
+{
+  const gchar *keys[2] = { NULL, NULL };
+
+  if (!cmdline.monitor.media_class)
+    return TRUE;
+
+  if (WP_IS_PORT (obj)) {
+    keys[0] = PW_KEY_NODE_ID;
+  } else if (WP_IS_LINK (obj)) {
+    keys[0] = PW_KEY_LINK_OUTPUT_NODE;
+    keys[1] = PW_KEY_LINK_INPUT_NODE;
+  } else {
+    /* nodes & devices are filtered by the object manager */
+    return TRUE;
+  }
+
+  for (guint i = 0; i < G_N_ELEMENTS (keys) && keys[i]; i++) {
+    const gchar *str = wp_pipewire_object_get_property (obj, keys[i]);
+    guint32 node_id;
+
+    if (str && spa_atou32 (str, &node_id, 10) &&
+        g_hash_table_contains (monitor.nodes, GUINT_TO_POINTER (node_id)))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static void
+monitor_report_added (WpCtl * self, WpPipewireObject *obj)
+{
+  guint32 id = wp_proxy_get_bound_id (WP_PROXY (obj));
+  g_autoptr (WpProperties) props = NULL;
+  g_autoptr (WpSpaJsonBuilder) b = NULL;
+
+  if (g_hash_table_contains (monitor.props, GUINT_TO_POINTER (id)))
+    return;
+
+  props = wp_pipewire_object_get_properties (obj);
+  b = monitor_record_new ("added", monitor_type_name (obj), id);
+  monitor_add_properties (b, props, NULL);
+  monitor_record_emit (self, b);
+
+  g_hash_table_insert (monitor.props, GUINT_TO_POINTER (id),
+      g_steal_pointer (&props));
+  g_signal_connect (obj, "notify::properties",
+      G_CALLBACK (monitor_on_properties_changed), self);
+}
+
+static void
+monitor_on_object_added (WpObjectManager *om, WpPipewireObject *obj,
+    WpCtl * self)
+{
+  if (WP_IS_NODE (obj)) {
+    g_hash_table_add (monitor.nodes,
+        GUINT_TO_POINTER (wp_proxy_get_bound_id (WP_PROXY (obj))));
+
+    if (monitor_type_selected ("node"))
+      monitor_report_added (self, obj);
+
+    /* the ports & links of the node may have been added before it */
+    if (cmdline.monitor.media_class) {
+      GType types[] = { WP_TYPE_PORT, WP_TYPE_LINK };
+
+      for (guint i = 0; i < G_N_ELEMENTS (types); i++) {
+        g_autoptr (WpIterator) it =
+            wp_object_manager_new_filtered_iterator (om, types[i], NULL);
+        g_auto (GValue) val = G_VALUE_INIT;
+
+        for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
+          WpPipewireObject *o = g_value_get_object (&val);
+          if (monitor_object_matches (o))
+            monitor_report_added (self, o);
+        }
+      }
+    }
+  }
+  else if (monitor_object_matches (obj)) {
+    monitor_report_added (self, obj);
+  }
+}
+
+static void
+monitor_on_object_removed (WpObjectManager *om, WpPipewireObject *obj,
+    WpCtl * self)
+{
+  guint32 id = wp_proxy_get_bound_id (WP_PROXY (obj));
+  g_autoptr (WpSpaJsonBuilder) b = NULL;
+
+  g_hash_table_remove (monitor.nodes, GUINT_TO_POINTER (id));
+
+  /* objects that were filtered out were never reported */
+  if (!g_hash_table_remove (monitor.props, GUINT_TO_POINTER (id)))
+    return;
+
+  g_signal_handlers_disconnect_by_func (obj,
+      G_CALLBACK (monitor_on_properties_changed), self);
+  b = monitor_record_new ("removed", monitor_type_name (obj), id);
+  monitor_record_emit (self, b);
+}
+
+static void
+monitor_on_defaults_changed (WpPlugin *def_nodes_api, WpCtl * self)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (DEFAULT_NODE_MEDIA_CLASSES); i++) {
+    const gchar *media_class = DEFAULT_NODE_MEDIA_CLASSES[i];
+    g_autoptr (WpSpaJsonBuilder) b = NULL;
+    guint32 id = SPA_ID_INVALID;
+
+    if (cmdline.monitor.media_class &&
+        !g_pattern_match_simple (cmdline.monitor.media_class, media_class))
+      continue;
+
+    g_signal_emit_by_name (def_nodes_api, "get-default-node", media_class, &id);
+    if (id == monitor.defaults[i])
+      continue;
+    monitor.defaults[i] = id;
+
+    b = monitor_record_new ("default", NULL, id);
+    wp_spa_json_builder_add_property (b, "media.class");
+    wp_spa_json_builder_add_string (b, media_class);
+    monitor_record_emit (self, b);
+  }
+}
+
+static void
+monitor_on_volume_changed (WpPlugin *mixer_api, guint32 id, WpCtl * self)
+{
+  g_autoptr (GVariant) dict = NULL;
+  g_autoptr (WpSpaJsonBuilder) b = NULL;
+  gboolean mute = FALSE;
+  gdouble volume = 1.0;
+
+  /* only report volumes of the nodes that pass the filters */
+  if (!g_hash_table_contains (monitor.props, GUINT_TO_POINTER (id)))
+    return;
+
+  g_signal_emit_by_name (mixer_api, "get-volume", id, &dict);
+  if (!dict || !g_variant_lookup (dict, "volume", "d", &volume))
+    return;
+  g_variant_lookup (dict, "mute", "b", &mute);
+
+  b = monitor_record_new ("volume", "node", id);
+  wp_spa_json_builder_add_property (b, "volume");
+  wp_spa_json_builder_add_float (b, volume);
+  wp_spa_json_builder_add_property (b, "mute");
+  wp_spa_json_builder_add_boolean (b, mute);
+  monitor_record_emit (self, b);
+}
+
+static void
+monitor_run (WpCtl * self)
+{
+  g_autoptr (WpIterator) it = NULL;
+  g_auto (GValue) val = G_VALUE_INIT;
+
+  monitor.batch = g_string_new (NULL);
+  monitor.props = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) wp_properties_unref);
+  monitor.nodes = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (guint i = 0; i < G_N_ELEMENTS (monitor.defaults); i++)
+    monitor.defaults[i] = SPA_ID_INVALID;
+
+  /* report the initial state as "added" records */
+  it = wp_object_manager_new_iterator (self->om);
+  for (; wp_iterator_next (it, &val); g_value_unset (&val))
+    monitor_on_object_added (self->om, g_value_get_object (&val), self);
+
+  g_signal_connect (self->om, "object-added",
+      G_CALLBACK (monitor_on_object_added), self);
+  g_signal_connect (self->om, "object-removed",
+      G_CALLBACK (monitor_on_object_removed), self);
+
+  monitor.def_nodes_api = wp_plugin_find (self->core, "default-nodes-api");
+  if (monitor.def_nodes_api) {
+    monitor_on_defaults_changed (monitor.def_nodes_api, self);
+    g_signal_connect (monitor.def_nodes_api, "changed",
+        G_CALLBACK (monitor_on_defaults_changed), self);
+  }
+
+  monitor.mixer_api = wp_plugin_find (self->core, "mixer-api");
+  if (monitor.mixer_api)
+    g_signal_connect (monitor.mixer_api, "changed",
+        G_CALLBACK (monitor_on_volume_changed), self);
+
+  monitor_flush ();
+}
+
+#define N_ENTRIES 5
 
 static const struct subcommand {
   /* the name to match on the command line */
@@ -1703,6 +2227,10 @@ static const struct subcommand {
       { "name", 'n', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE,
         &cmdline.status.display_names,
         "Display device and node names instead of descriptions", NULL },
+      { "snapshot", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE,
+        &cmdline.status.snapshot,
+        "Print the JSON snapshot of the session state kept by WirePlumber "
+        "(needs the metadata.sm-snapshot feature)", NULL },
       { NULL }
     },
     .parse_positional = NULL,
@@ -1844,6 +2372,43 @@ static const struct subcommand {
     .parse_positional = set_log_level_parse_positional,
     .prepare = set_log_level_prepare,
     .run = set_log_level_run,
+  },
+  {
+    .name = "monitor",
+    .positional_args = "",
+    .summary = "Streams changes of objects in PipeWire as JSON lines",
+    .description =
+        "Each line is a JSON object with an \"event\" field, which is one of\n"
+        "\"added\", \"removed\", \"changed\" (only the properties that\n"
+        "changed; removed properties are null), \"default\" or \"volume\".\n"
+        "The objects that exist when monitoring starts are reported as \"added\".\n"
+        "With --media-class, ports and links are reported if they belong to a\n"
+        "matching node and clients are not reported. \"default\" and \"volume\"\n"
+        "records need helper plugins that bind all the nodes; they are only\n"
+        "loaded when nodes are monitored.",
+    .entries = {
+      { "type", 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING_ARRAY,
+        &cmdline.monitor.types,
+        "Only monitor objects of this type (client, device, node, port, link); "
+        "can be given multiple times", "TYPE" },
+      { "media-class", 'm', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING,
+        &cmdline.monitor.media_class,
+        "Only monitor nodes and devices whose media class matches this glob, "
+        "and the ports and links of these nodes",
+        "GLOB" },
+      { "batch-ms", 'b', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT,
+        &cmdline.monitor.batch_ms,
+        "Maximum time to hold back records before writing them out "
+        "(default: 100)", "MS" },
+      { "batch-size", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT,
+        &cmdline.monitor.batch_size,
+        "Maximum number of records to hold back (default: 64, 1 writes out "
+        "every record immediately)", "N" },
+      { NULL }
+    },
+    .parse_positional = monitor_parse_positional,
+    .prepare = monitor_prepare,
+    .run = monitor_run,
   }
 };
 
@@ -1876,7 +2441,8 @@ on_plugin_loaded (WpCore * core, GAsyncResult * res, WpCtl *ctl)
 
   if (--ctl->pending_plugins == 0) {
     g_autoptr (WpPlugin) mixer_api = wp_plugin_find (core, "mixer-api");
-    g_object_set (mixer_api, "scale", 1 /* cubic */, NULL);
+    if (mixer_api)
+      g_object_set (mixer_api, "scale", 1 /* cubic */, NULL);
     wp_core_install_object_manager (ctl->core, ctl->om);
   }
 }
@@ -1958,6 +2524,7 @@ main (gint argc, gchar **argv)
   }
 
   /* prepare the subcommand */
+  ctl.plugins = WPCTL_PLUGINS_ALL;
   if (!cmd->prepare (&ctl, &error)) {
     fprintf (stderr, "%s\n", error->message);
     return 1;
@@ -1972,12 +2539,16 @@ main (gint argc, gchar **argv)
       &ctl);
 
   /* load required API modules */
-  ctl.pending_plugins++;
-  wp_core_load_component (ctl.core, "libwireplumber-module-default-nodes-api",
-      "module", NULL, NULL, NULL, (GAsyncReadyCallback) on_plugin_loaded, &ctl);
-  ctl.pending_plugins++;
-  wp_core_load_component (ctl.core, "libwireplumber-module-mixer-api",
-      "module", NULL, NULL, NULL, (GAsyncReadyCallback) on_plugin_loaded, &ctl);
+  if (ctl.plugins & WPCTL_PLUGIN_DEFAULT_NODES_API) {
+    ctl.pending_plugins++;
+    wp_core_load_component (ctl.core, "libwireplumber-module-default-nodes-api",
+        "module", NULL, NULL, NULL, (GAsyncReadyCallback) on_plugin_loaded, &ctl);
+  }
+  if (ctl.plugins & WPCTL_PLUGIN_MIXER_API) {
+    ctl.pending_plugins++;
+    wp_core_load_component (ctl.core, "libwireplumber-module-mixer-api",
+        "module", NULL, NULL, NULL, (GAsyncReadyCallback) on_plugin_loaded, &ctl);
+  }
 
   /* connect */
   if (!wp_core_connect (ctl.core)) {
@@ -1991,6 +2562,10 @@ main (gint argc, gchar **argv)
   g_signal_connect_swapped (ctl.om, "installed",
       (GCallback) cmd->run, &ctl);
 
+  /* without plugins to wait for, the object manager can be installed now */
+  if (ctl.pending_plugins == 0)
+    wp_core_install_object_manager (ctl.core, ctl.om);
+
   g_main_loop_run (ctl.loop);
 
   return ctl.exit_code;
@@ -0,0 +1,459 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../common/base-test-fixture.h"
+
+/* the linkables of the test graph, a bit like two filter-chains:
+   A & B are the input & output side of link group "lg",
+   D & E are the output & input side of link group "lg2",
+   C is not in any link group */
+enum { ITEM_A, ITEM_B, ITEM_C, ITEM_D, ITEM_E, N_ITEMS };
+
+static const struct {
+  const gchar *direction;
+  const gchar *link_group;
+} items_info[N_ITEMS] = {
+  [ITEM_A] = { "input", "lg" },
+  [ITEM_B] = { "output", "lg" },
+  [ITEM_C] = { "input", NULL },
+  [ITEM_D] = { "output", "lg2" },
+  [ITEM_E] = { "input", "lg2" },
+};
+
+typedef struct {
+  WpBaseTestFixture base;
+  WpNode *node;
+  WpSessionItem *items[N_ITEMS];
+  WpPlugin *plugin;
+  WpObjectManager *om;
+} TestFixture;
+
+static void
+on_plugin_loaded (WpCore * core, GAsyncResult * res, TestFixture *f)
+{
+  gboolean loaded;
+  GError *error = NULL;
+
+  loaded = wp_core_load_component_finish (core, res, &error);
+  g_assert_no_error (error);
+  g_assert_true (loaded);
+
+  g_main_loop_quit (f->base.loop);
+}
+
+static WpSessionItem *
+create_item (TestFixture * f, guint i)
+{
+  g_autoptr (WpSessionItem) item = NULL;
+
+  item = wp_session_item_make (f->base.core, "si-node");
+  g_assert_nonnull (item);
+
+  /* the index only looks at the properties, so all the items can share
+     the same node */
+  {
+    WpProperties *props = wp_properties_new_empty ();
+    wp_properties_setf (props, "item.node", "%p", f->node);
+    wp_properties_set (props, "item.node.direction", items_info[i].direction);
+    if (items_info[i].link_group)
+      wp_properties_set (props, "node.link-group", items_info[i].link_group);
+    g_assert_true (wp_session_item_configure (item, props));
+  }
+
+  wp_object_activate (WP_OBJECT (item), WP_SESSION_ITEM_FEATURE_ACTIVE,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  wp_session_item_register (g_object_ref (item));
+  return g_steal_pointer (&item);
+}
+
+static WpSessionItem *
+add_link (TestFixture * f, guint out, guint in)
+{
+  g_autoptr (WpSessionItem) link = NULL;
+
+  link = wp_session_item_make (f->base.core, "si-standard-link");
+  g_assert_nonnull (link);
+
+  /* the link is only registered, not activated; this is enough for the index
+     and does not create any PipeWire links */
+  {
+    WpProperties *props = wp_properties_new_empty ();
+    wp_properties_setf (props, "out.item", "%p", f->items[out]);
+    wp_properties_setf (props, "in.item", "%p", f->items[in]);
+    g_assert_true (wp_session_item_configure (link, props));
+  }
+
+  wp_session_item_register (g_object_ref (link));
+  return g_steal_pointer (&link);
+}
+
+static guint32
+item_id (TestFixture * f, guint i)
+{
+  return wp_object_get_id (WP_OBJECT (f->items[i]));
+}
+
+static void
+test_graph_index_setup (TestFixture * f, gconstpointer user_data)
+{
+  wp_base_test_fixture_setup (&f->base, 0);
+
+  /* load modules */
+  {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-adapter", NULL, NULL));
+  }
+  if (!test_is_spa_lib_installed (&f->base, "support.null-audio-sink"))
+    return;
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-si-node", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-si-standard-link", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-graph-index", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  f->plugin = wp_plugin_find (f->base.core, "graph-index");
+  g_assert_nonnull (f->plugin);
+
+  f->node = wp_node_new_from_factory (f->base.core,
+      "adapter",
+      wp_properties_new (
+          "factory.name", "support.null-audio-sink",
+          "node.name", "null-sink",
+          "media.class", "Audio/Sink",
+          NULL));
+  g_assert_nonnull (f->node);
+  wp_object_activate (WP_OBJECT (f->node), WP_OBJECT_FEATURES_ALL,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  for (guint i = 0; i < N_ITEMS; i++)
+    f->items[i] = create_item (f, i);
+
+  /* for the reference implementation of the link group check */
+  f->om = wp_object_manager_new ();
+  wp_object_manager_add_interest (f->om, WP_TYPE_SI_LINK, NULL);
+  wp_object_manager_add_interest (f->om, WP_TYPE_SI_LINKABLE,
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "item.factory.name", "c(ss)",
+      "si-audio-adapter", "si-node", NULL);
+  test_ensure_object_manager_is_installed (f->om, f->base.core,
+      f->base.loop);
+}
+
+static void
+test_graph_index_teardown (TestFixture * f, gconstpointer user_data)
+{
+  g_clear_object (&f->om);
+  for (guint i = 0; i < N_ITEMS; i++) {
+    if (f->items[i])
+      wp_session_item_remove (f->items[i]);
+    g_clear_object (&f->items[i]);
+  }
+  g_clear_object (&f->node);
+  g_clear_object (&f->plugin);
+  wp_base_test_fixture_teardown (&f->base);
+}
+
+static gboolean
+skip_if_unavailable (TestFixture * f)
+{
+  if (!f->plugin) {
+    g_test_skip ("The pipewire null-audio-sink factory was not found");
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* returns -1 if the target is not indexed */
+static gint
+index_can_link_group (TestFixture * f, const gchar * link_group,
+    guint32 target_id)
+{
+  g_autoptr (GVariant) res = NULL;
+
+  g_signal_emit_by_name (f->plugin, "can-link-group", link_group, target_id,
+      &res);
+  return res ? g_variant_get_boolean (res) : -1;
+}
+
+/* the link group check of canLink() as it is done without the index, by
+   scanning all the linkables & links (see linking-utils.lua) */
+static gboolean
+scan_can_link_group (TestFixture * f, const gchar * link_group,
+    WpSessionItem * target, guint hops)
+{
+  const gchar *target_link_group =
+      wp_session_item_get_property (target, "node.link-group");
+  const gchar *target_direction =
+      wp_session_item_get_property (target, "item.node.direction");
+  g_autoptr (WpIterator) it = NULL;
+  g_auto (GValue) val = G_VALUE_INIT;
+
+  if (hops == 8)
+    return FALSE;
+  if (!target_link_group)
+    return TRUE;
+  if (g_str_equal (link_group, target_link_group))
+    return FALSE;
+
+  it = wp_object_manager_new_filtered_iterator (f->om, WP_TYPE_SI_LINKABLE,
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "id", "!u",
+      wp_object_get_id (WP_OBJECT (target)),
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "item.node.direction", "!s",
+      target_direction,
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "node.link-group", "=s",
+      target_link_group,
+      NULL);
+  for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
+    guint32 n_id = wp_object_get_id (g_value_get_object (&val));
+    g_autoptr (WpIterator) lit =
+        wp_object_manager_new_filtered_iterator (f->om, WP_TYPE_SI_LINK, NULL);
+    g_auto (GValue) lval = G_VALUE_INIT;
+
+    for (; wp_iterator_next (lit, &lval); g_value_unset (&lval)) {
+      WpSessionItem *link = g_value_get_object (&lval);
+      guint32 out_id = g_ascii_strtoull (
+          wp_session_item_get_property (link, "out.item.id"), NULL, 10);
+      guint32 in_id = g_ascii_strtoull (
+          wp_session_item_get_property (link, "in.item.id"), NULL, 10);
+      g_autoptr (WpSessionItem) peer = NULL;
+
+      if (out_id != n_id && in_id != n_id)
+        continue;
+
+      peer = wp_object_manager_lookup (f->om, WP_TYPE_SI_LINKABLE,
+          WP_CONSTRAINT_TYPE_G_PROPERTY, "id", "=u",
+          (out_id == n_id) ? in_id : out_id,
+          NULL);
+      if (peer && !scan_can_link_group (f, link_group, peer, hops + 1))
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static void
+assert_can_link_group_parity (TestFixture * f)
+{
+  static const gchar *link_groups[] = { "lg", "lg2", "other" };
+
+  for (guint g = 0; g < G_N_ELEMENTS (link_groups); g++) {
+    for (guint i = 0; i < N_ITEMS; i++) {
+      gboolean expected =
+          scan_can_link_group (f, link_groups[g], f->items[i], 0);
+      g_assert_cmpint (index_can_link_group (f, link_groups[g],
+          item_id (f, i)), ==, expected);
+    }
+  }
+}
+
+static void
+test_graph_index_lookup (TestFixture * f, gconstpointer user_data)
+{
+  g_autoptr (WpSessionItem) link = NULL;
+
+  if (skip_if_unavailable (f))
+    return;
+
+  link = add_link (f, ITEM_B, ITEM_E);
+
+  /* links are found from either side */
+  {
+    g_autoptr (WpSiLink) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-link",
+        item_id (f, ITEM_B), item_id (f, ITEM_E), &res);
+    g_assert_true (res == WP_SI_LINK (link));
+  }
+  {
+    g_autoptr (WpSiLink) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-link",
+        item_id (f, ITEM_E), item_id (f, ITEM_B), &res);
+    g_assert_true (res == WP_SI_LINK (link));
+  }
+  {
+    g_autoptr (WpSiLink) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-link",
+        item_id (f, ITEM_A), item_id (f, ITEM_E), &res);
+    g_assert_null (res);
+  }
+  {
+    g_autoptr (WpSiLink) res = NULL;
+    g_signal_emit_by_name (f->plugin, "get-link", item_id (f, ITEM_E), &res);
+    g_assert_true (res == WP_SI_LINK (link));
+  }
+
+  /* peers */
+  {
+    g_autoptr (GVariant) res = NULL;
+    guint32 id = 0;
+    g_signal_emit_by_name (f->plugin, "get-link-peers",
+        item_id (f, ITEM_B), &res);
+    g_assert_nonnull (res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 1);
+    g_variant_get_child (res, 0, "u", &id);
+    g_assert_cmpuint (id, ==, item_id (f, ITEM_E));
+  }
+  {
+    g_autoptr (GVariant) res = NULL;
+    g_signal_emit_by_name (f->plugin, "get-link-peers",
+        item_id (f, ITEM_C), &res);
+    g_assert_nonnull (res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 0);
+  }
+
+  /* item info */
+  {
+    g_autoptr (GVariant) res = NULL;
+    const gchar *str = NULL;
+
+    g_signal_emit_by_name (f->plugin, "get-item-info",
+        item_id (f, ITEM_A), &res);
+    g_assert_nonnull (res);
+    g_assert_true (g_variant_lookup (res, "direction", "&s", &str));
+    g_assert_cmpstr (str, ==, "input");
+    g_assert_true (g_variant_lookup (res, "link-group", "&s", &str));
+    g_assert_cmpstr (str, ==, "lg");
+  }
+  {
+    g_autoptr (GVariant) res = NULL;
+    g_signal_emit_by_name (f->plugin, "get-item-info",
+        wp_object_get_id (WP_OBJECT (link)), &res);
+    g_assert_null (res);
+  }
+
+  /* link group members */
+  {
+    g_autoptr (GVariant) res = NULL;
+    g_signal_emit_by_name (f->plugin, "get-link-group-members",
+        "lg", NULL, &res);
+    g_assert_nonnull (res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 2);
+  }
+  {
+    g_autoptr (GVariant) res = NULL;
+    guint32 id = 0;
+    g_signal_emit_by_name (f->plugin, "get-link-group-members",
+        "lg", "input", &res);
+    g_assert_nonnull (res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 1);
+    g_variant_get_child (res, 0, "u", &id);
+    g_assert_cmpuint (id, ==, item_id (f, ITEM_B));
+  }
+
+  /* removed links are forgotten */
+  wp_session_item_remove (link);
+  {
+    g_autoptr (WpSiLink) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-link",
+        item_id (f, ITEM_B), item_id (f, ITEM_E), &res);
+    g_assert_null (res);
+  }
+}
+
+static void
+test_graph_index_reach_cache (TestFixture * f, gconstpointer user_data)
+{
+  g_autoptr (WpSessionItem) link = NULL;
+
+  if (skip_if_unavailable (f))
+    return;
+
+  /* B is not linked, so "lg2" can link to the "lg" group; the result is
+     cached now */
+  g_assert_cmpint (index_can_link_group (f, "lg2", item_id (f, ITEM_A)), ==,
+      TRUE);
+  g_assert_cmpint (index_can_link_group (f, "lg2", item_id (f, ITEM_A)), ==,
+      TRUE);
+  g_assert_cmpint (index_can_link_group (f, "lg2", item_id (f, ITEM_E)), ==,
+      FALSE);
+  g_assert_cmpint (index_can_link_group (f, "lg2", item_id (f, ITEM_C)), ==,
+      TRUE);
+
+  /* B -> E: linking "lg2" to A would create a loop through B */
+  link = add_link (f, ITEM_B, ITEM_E);
+  g_assert_cmpint (index_can_link_group (f, "lg2", item_id (f, ITEM_A)), ==,
+      FALSE);
+  g_assert_cmpint (index_can_link_group (f, "other", item_id (f, ITEM_A)), ==,
+      TRUE);
+
+  /* and it is allowed again once the link is gone */
+  wp_session_item_remove (link);
+  g_assert_cmpint (index_can_link_group (f, "lg2", item_id (f, ITEM_A)), ==,
+      TRUE);
+
+  /* items that are not indexed are left to the caller */
+  g_assert_cmpint (index_can_link_group (f, "lg2", G_MAXUINT32 - 1), ==, -1);
+}
+
+static void
+test_graph_index_can_link_parity (TestFixture * f, gconstpointer user_data)
+{
+  g_autoptr (WpSessionItem) link1 = NULL;
+  g_autoptr (WpSessionItem) link2 = NULL;
+  g_autoptr (WpSessionItem) link3 = NULL;
+
+  if (skip_if_unavailable (f))
+    return;
+
+  assert_can_link_group_parity (f);
+
+  link1 = add_link (f, ITEM_B, ITEM_E);
+  assert_can_link_group_parity (f);
+
+  /* a loop between the two groups, which hits the hop limit */
+  link2 = add_link (f, ITEM_D, ITEM_A);
+  assert_can_link_group_parity (f);
+
+  link3 = add_link (f, ITEM_B, ITEM_C);
+  assert_can_link_group_parity (f);
+
+  wp_session_item_remove (link1);
+  assert_can_link_group_parity (f);
+
+  wp_session_item_remove (link2);
+  wp_session_item_remove (link3);
+  assert_can_link_group_parity (f);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  wp_init (WP_INIT_ALL);
+
+  g_test_add ("/modules/graph-index/lookup",
+      TestFixture, NULL,
+      test_graph_index_setup,
+      test_graph_index_lookup,
+      test_graph_index_teardown);
+  g_test_add ("/modules/graph-index/reach-cache",
+      TestFixture, NULL,
+      test_graph_index_setup,
+      test_graph_index_reach_cache,
+      test_graph_index_teardown);
+  g_test_add ("/modules/graph-index/can-link-parity",
+      TestFixture, NULL,
+      test_graph_index_setup,
+      test_graph_index_can_link_parity,
+      test_graph_index_teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,518 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../common/base-test-fixture.h"
+#include <spa/monitor/device.h>
+#include <spa/monitor/utils.h>
+
+/* a device without any params, enough to have a device global on the server
+   without depending on real hardware */
+struct fake_device {
+  struct spa_device device;
+  struct spa_hook_list hooks;
+};
+
+static int
+fake_device_add_listener (void *object, struct spa_hook *listener,
+    const struct spa_device_events *events, void *data)
+{
+  struct fake_device *d = object;
+  struct spa_hook_list save;
+  struct spa_device_info info = SPA_DEVICE_INFO_INIT ();
+
+  spa_hook_list_isolate (&d->hooks, &save, listener, events, data);
+  spa_device_emit_info (&d->hooks, &info);
+  spa_hook_list_join (&d->hooks, &save);
+  return 0;
+}
+
+static int
+fake_device_sync (void *object, int seq)
+{
+  struct fake_device *d = object;
+  spa_device_emit_result (&d->hooks, seq, 0, 0, NULL);
+  return 0;
+}
+
+static int
+fake_device_enum_params (void *object, int seq, uint32_t id, uint32_t start,
+    uint32_t max, const struct spa_pod *filter)
+{
+  return -ENOTSUP;
+}
+
+static int
+fake_device_set_param (void *object, uint32_t id, uint32_t flags,
+    const struct spa_pod *param)
+{
+  return -ENOTSUP;
+}
+
+static const struct spa_device_methods fake_device_methods = {
+  SPA_VERSION_DEVICE_METHODS,
+  .add_listener = fake_device_add_listener,
+  .sync = fake_device_sync,
+  .enum_params = fake_device_enum_params,
+  .set_param = fake_device_set_param,
+};
+
+typedef struct {
+  WpBaseTestFixture base;
+
+  struct fake_device fake_device;
+  struct pw_impl_device *device;
+
+  WpNode *src_node;
+  WpNode *sink_node;
+  WpSessionItem *src_item;
+  WpSessionItem *sink_item;
+  WpPlugin *mixer_api;
+
+  /* the snapshot, as it is seen by a client */
+  WpObjectManager *om;
+  WpSpaJson *snapshot;
+  gint generation;
+} TestFixture;
+
+static void
+on_plugin_loaded (WpCore * core, GAsyncResult * res, TestFixture *f)
+{
+  gboolean loaded;
+  GError *error = NULL;
+
+  loaded = wp_core_load_component_finish (core, res, &error);
+  g_assert_no_error (error);
+  g_assert_true (loaded);
+
+  g_main_loop_quit (f->base.loop);
+}
+
+static void
+update_snapshot (TestFixture * f, const gchar * value)
+{
+  gint generation = 0;
+
+  g_assert_nonnull (value);
+  g_clear_pointer (&f->snapshot, wp_spa_json_unref);
+  f->snapshot = wp_spa_json_new_from_string (value);
+  g_assert_true (wp_spa_json_is_object (f->snapshot));
+  g_assert_true (wp_spa_json_object_get (f->snapshot,
+      "generation", "i", &generation, NULL));
+
+  /* every publish bumps the generation */
+  g_assert_cmpint (generation, >, f->generation);
+  f->generation = generation;
+}
+
+static void
+on_snapshot_changed (WpMetadata * m, guint32 subject, const gchar * key,
+    const gchar * type, const gchar * value, TestFixture * f)
+{
+  if (subject != 0 || g_strcmp0 (key, "snapshot"))
+    return;
+
+  g_assert_cmpstr (type, ==, "Spa:String:JSON");
+  update_snapshot (f, value);
+  g_main_loop_quit (f->base.loop);
+}
+
+static void
+wait_for_snapshot (TestFixture * f)
+{
+  g_main_loop_run (f->base.loop);
+}
+
+/* returns the number of entries of the given section that have the given
+   integer value on the given key, and optionally the first of them */
+static guint
+find_entries (TestFixture * f, const gchar * section, const gchar * key,
+    gint value, WpSpaJson ** first)
+{
+  g_autoptr (WpSpaJson) array = NULL;
+  g_autoptr (WpIterator) it = NULL;
+  g_auto (GValue) item = G_VALUE_INIT;
+  guint n = 0;
+
+  g_assert_true (wp_spa_json_object_get (f->snapshot,
+      section, "J", &array, NULL));
+  g_assert_true (wp_spa_json_is_array (array));
+
+  it = wp_spa_json_new_iterator (array);
+  for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
+    WpSpaJson *entry = g_value_get_boxed (&item);
+    gint v = 0;
+
+    if (!wp_spa_json_object_get (entry, key, "i", &v, NULL) || v != value)
+      continue;
+    if (n++ == 0 && first)
+      *first = wp_spa_json_copy (entry);
+  }
+  return n;
+}
+
+static guint
+count_items (WpSpaJson * array)
+{
+  g_autoptr (WpIterator) it = wp_spa_json_new_iterator (array);
+  g_auto (GValue) item = G_VALUE_INIT;
+  guint n = 0;
+
+  for (; wp_iterator_next (it, &item); g_value_unset (&item))
+    n++;
+  return n;
+}
+
+static gchar *
+entry_get_string (WpSpaJson * entry, const gchar * key)
+{
+  gchar *str = NULL;
+  g_assert_true (wp_spa_json_object_get (entry, key, "s", &str, NULL));
+  return str;
+}
+
+static WpSessionItem *
+load_node (TestFixture * f, const gchar * factory, const gchar * media_class,
+    const gchar * type, WpNode ** node_out)
+{
+  g_autoptr (WpNode) node = NULL;
+  g_autoptr (WpSessionItem) adapter = NULL;
+
+  node = wp_node_new_from_factory (f->base.core,
+      "adapter",
+      wp_properties_new (
+          "factory.name", factory,
+          "node.name", factory,
+          "media.class", media_class,
+          "audio.channels", "2",
+          "audio.position", "[ FL, FR ]",
+          NULL));
+  g_assert_nonnull (node);
+  wp_object_activate (WP_OBJECT (node), WP_OBJECT_FEATURES_ALL,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  /* the adapter configures the ports, which are needed for linking */
+  adapter = wp_session_item_make (f->base.core, "si-audio-adapter");
+  g_assert_nonnull (adapter);
+  {
+    WpProperties *props = wp_properties_new_empty ();
+    wp_properties_setf (props, "item.node", "%p", node);
+    wp_properties_set (props, "media.class", media_class);
+    wp_properties_set (props, "item.node.type", type);
+    g_assert_true (wp_session_item_configure (adapter, props));
+  }
+  wp_object_activate (WP_OBJECT (adapter), WP_SESSION_ITEM_FEATURE_ACTIVE,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  *node_out = g_steal_pointer (&node);
+  return g_steal_pointer (&adapter);
+}
+
+static void
+test_graph_snapshot_setup (TestFixture * f, gconstpointer user_data)
+{
+  wp_base_test_fixture_setup (&f->base, WP_BASE_TEST_FLAG_CLIENT_CORE);
+
+  /* load modules */
+  {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+
+    g_assert_cmpint (pw_context_add_spa_lib (f->base.server.context,
+            "audiotestsrc", "audiotestsrc/libspa-audiotestsrc"), ==, 0);
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-adapter", NULL, NULL));
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-link-factory", NULL, NULL));
+  }
+  if (!test_is_spa_lib_installed (&f->base, "audiotestsrc") ||
+      !test_is_spa_lib_installed (&f->base, "support.null-audio-sink"))
+    return;
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-si-audio-adapter", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-si-standard-link", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-mixer-api", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  f->mixer_api = wp_plugin_find (f->base.core, "mixer-api");
+  g_assert_nonnull (f->mixer_api);
+
+  /* publish on idle, so that every change gets its own generation */
+  {
+    g_autoptr (WpSpaJson) args = wp_spa_json_new_from_string (
+        "{ metadata.name = sm-snapshot, update-delay-ms = 0 }");
+
+    wp_core_load_component (f->base.core,
+        "libwireplumber-module-graph-snapshot", "module", args, NULL, NULL,
+        (GAsyncReadyCallback) on_plugin_loaded, f);
+    g_main_loop_run (f->base.loop);
+  }
+
+  /* read the snapshot from another client, like wpctl does */
+  f->om = wp_object_manager_new ();
+  wp_object_manager_add_interest (f->om, WP_TYPE_METADATA,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "metadata.name", "=s",
+      "sm-snapshot", NULL);
+  wp_object_manager_request_object_features (f->om, WP_TYPE_METADATA,
+      WP_OBJECT_FEATURES_ALL);
+  test_ensure_object_manager_is_installed (f->om, f->base.client_core,
+      f->base.loop);
+
+  {
+    g_autoptr (WpMetadata) m = wp_object_manager_lookup (f->om,
+        WP_TYPE_METADATA, NULL);
+    const gchar *type = NULL;
+    const gchar *value = NULL;
+
+    g_assert_nonnull (m);
+    g_signal_connect (m, "changed", G_CALLBACK (on_snapshot_changed), f);
+
+    /* the initial state is published when the plugin is enabled */
+    value = wp_metadata_find (m, 0, "snapshot", &type);
+    g_assert_cmpstr (type, ==, "Spa:String:JSON");
+    update_snapshot (f, value);
+  }
+}
+
+static void
+test_graph_snapshot_teardown (TestFixture * f, gconstpointer user_data)
+{
+  if (f->device) {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+    g_clear_pointer (&f->device, pw_impl_device_destroy);
+  }
+  g_clear_pointer (&f->snapshot, wp_spa_json_unref);
+  g_clear_object (&f->om);
+  g_clear_object (&f->mixer_api);
+  g_clear_object (&f->sink_item);
+  g_clear_object (&f->src_item);
+  g_clear_object (&f->sink_node);
+  g_clear_object (&f->src_node);
+  wp_base_test_fixture_teardown (&f->base);
+}
+
+static gboolean
+skip_if_unavailable (TestFixture * f)
+{
+  if (!f->om) {
+    g_test_skip ("The pipewire audiotestsrc or null-audio-sink factory "
+        "was not found");
+    return TRUE;
+  }
+  return FALSE;
+}
+
+static void
+test_graph_snapshot_objects (TestFixture * f, gconstpointer user_data)
+{
+  g_autoptr (WpSessionItem) link = NULL;
+  guint32 device_id, src_id, sink_id;
+
+  if (skip_if_unavailable (f))
+    return;
+
+  /* the initial snapshot has all the sections */
+  {
+    g_autoptr (WpSpaJson) defaults = NULL;
+    g_autoptr (WpSpaJson) links = NULL;
+    g_assert_cmpint (f->generation, >=, 1);
+    g_assert_true (wp_spa_json_object_get (f->snapshot,
+        "defaults", "J", &defaults,
+        "links", "J", &links,
+        NULL));
+    g_assert_true (wp_spa_json_is_object (defaults));
+    g_assert_cmpuint (count_items (links), ==, 0);
+  }
+
+  /* device */
+  {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+
+    spa_hook_list_init (&f->fake_device.hooks);
+    f->fake_device.device.iface = SPA_INTERFACE_INIT (
+        SPA_TYPE_INTERFACE_Device, SPA_VERSION_DEVICE,
+        &fake_device_methods, &f->fake_device);
+
+    f->device = pw_context_create_device (f->base.server.context,
+        pw_properties_new (
+            "device.name", "test-device",
+            "device.description", "Test Device",
+            "device.api", "test",
+            NULL), 0);
+    g_assert_nonnull (f->device);
+    g_assert_cmpint (pw_impl_device_set_implementation (f->device,
+        &f->fake_device.device), ==, 0);
+    g_assert_cmpint (pw_impl_device_register (f->device, NULL), ==, 0);
+    device_id = pw_global_get_id (pw_impl_device_get_global (f->device));
+  }
+
+  while (find_entries (f, "devices", "id", device_id, NULL) == 0)
+    wait_for_snapshot (f);
+  {
+    g_autoptr (WpSpaJson) entry = NULL;
+    g_autofree gchar *name = NULL;
+    g_autofree gchar *api = NULL;
+
+    find_entries (f, "devices", "id", device_id, &entry);
+    name = entry_get_string (entry, "name");
+    api = entry_get_string (entry, "api");
+    g_assert_cmpstr (name, ==, "test-device");
+    g_assert_cmpstr (api, ==, "test");
+  }
+
+  /* nodes */
+  f->src_item = load_node (f, "audiotestsrc", "Stream/Output/Audio",
+      "stream", &f->src_node);
+  f->sink_item = load_node (f, "support.null-audio-sink", "Audio/Sink",
+      "device", &f->sink_node);
+  src_id = wp_proxy_get_bound_id (WP_PROXY (f->src_node));
+  sink_id = wp_proxy_get_bound_id (WP_PROXY (f->sink_node));
+
+  while (find_entries (f, "nodes", "id", src_id, NULL) == 0 ||
+         find_entries (f, "nodes", "id", sink_id, NULL) == 0)
+    wait_for_snapshot (f);
+  {
+    g_autoptr (WpSpaJson) entry = NULL;
+    g_autofree gchar *name = NULL;
+    g_autofree gchar *media_class = NULL;
+    gint serial = 0;
+
+    find_entries (f, "nodes", "id", sink_id, &entry);
+    name = entry_get_string (entry, "name");
+    media_class = entry_get_string (entry, "media.class");
+    g_assert_cmpstr (name, ==, "support.null-audio-sink");
+    g_assert_cmpstr (media_class, ==, "Audio/Sink");
+    g_assert_true (wp_spa_json_object_get (entry, "serial", "i", &serial,
+        NULL));
+    g_assert_cmpint (serial, >, 0);
+  }
+
+  /* links; one for each of the 2 channels */
+  link = wp_session_item_make (f->base.core, "si-standard-link");
+  g_assert_nonnull (link);
+  {
+    WpProperties *props = wp_properties_new_empty ();
+    wp_properties_setf (props, "out.item", "%p", f->src_item);
+    wp_properties_setf (props, "in.item", "%p", f->sink_item);
+    wp_properties_set (props, "out.item.port.context", "output");
+    wp_properties_set (props, "in.item.port.context", "input");
+    g_assert_true (wp_session_item_configure (link, props));
+  }
+  wp_object_activate (WP_OBJECT (link), WP_SESSION_ITEM_FEATURE_ACTIVE,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  while (find_entries (f, "links", "output.node", src_id, NULL) < 2)
+    wait_for_snapshot (f);
+  g_assert_cmpuint (find_entries (f, "links", "input.node", sink_id, NULL),
+      ==, 2);
+
+  /* removed objects are dropped from the snapshot */
+  wp_object_deactivate (WP_OBJECT (link), WP_SESSION_ITEM_FEATURE_ACTIVE);
+  while (find_entries (f, "links", "output.node", src_id, NULL) > 0)
+    wait_for_snapshot (f);
+
+  {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+    g_clear_pointer (&f->device, pw_impl_device_destroy);
+  }
+  while (find_entries (f, "devices", "id", device_id, NULL) > 0)
+    wait_for_snapshot (f);
+  g_assert_cmpuint (find_entries (f, "nodes", "id", sink_id, NULL), ==, 1);
+}
+
+static void
+test_graph_snapshot_volume (TestFixture * f, gconstpointer user_data)
+{
+  guint32 sink_id;
+  gint generation;
+  gboolean mute = FALSE;
+  float volume = 0.0f;
+
+  if (skip_if_unavailable (f))
+    return;
+
+  f->sink_item = load_node (f, "support.null-audio-sink", "Audio/Sink",
+      "device", &f->sink_node);
+  sink_id = wp_proxy_get_bound_id (WP_PROXY (f->sink_node));
+
+  /* wait until the mixer api knows about the channels */
+  for (;;) {
+    g_autoptr (WpSpaJson) entry = NULL;
+    g_autoptr (WpSpaJson) v = NULL;
+    g_autoptr (WpSpaJson) channels = NULL;
+
+    if (find_entries (f, "nodes", "id", sink_id, &entry) == 1 &&
+        wp_spa_json_object_get (entry, "volume", "J", &v, NULL) &&
+        wp_spa_json_object_get (v, "channels", "J", &channels, NULL) &&
+        count_items (channels) == 2)
+      break;
+    wait_for_snapshot (f);
+  }
+  generation = f->generation;
+
+  {
+    g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
+    gboolean res = FALSE;
+
+    g_variant_builder_add (&b, "{sv}", "volume", g_variant_new_double (0.5));
+    g_variant_builder_add (&b, "{sv}", "mute", g_variant_new_boolean (TRUE));
+    g_signal_emit_by_name (f->mixer_api, "set-volume", sink_id,
+        g_variant_builder_end (&b), &res);
+    g_assert_true (res);
+  }
+
+  /* the change is published with a new generation */
+  while (!mute) {
+    g_autoptr (WpSpaJson) entry = NULL;
+    g_autoptr (WpSpaJson) v = NULL;
+
+    wait_for_snapshot (f);
+    g_assert_cmpuint (find_entries (f, "nodes", "id", sink_id, &entry), ==, 1);
+    g_assert_true (wp_spa_json_object_get (entry, "volume", "J", &v, NULL));
+    g_assert_true (wp_spa_json_object_get (v,
+        "volume", "f", &volume,
+        "mute", "b", &mute,
+        NULL));
+  }
+  g_assert_cmpint (f->generation, >, generation);
+  g_assert_cmpfloat_with_epsilon (volume, 0.5, 0.001);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  wp_init (WP_INIT_ALL);
+
+  g_test_add ("/modules/graph-snapshot/objects",
+      TestFixture, NULL,
+      test_graph_snapshot_setup,
+      test_graph_snapshot_objects,
+      test_graph_snapshot_teardown);
+  g_test_add ("/modules/graph-snapshot/volume",
+      TestFixture, NULL,
+      test_graph_snapshot_setup,
+      test_graph_snapshot_volume,
+      test_graph_snapshot_teardown);
+
+  return g_test_run ();
+}
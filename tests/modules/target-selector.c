@@ -0,0 +1,410 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../common/base-test-fixture.h"
+
+typedef struct {
+  WpBaseTestFixture base;
+  WpNode *node;
+  WpPlugin *plugin;
+} TestFixture;
+
+static void
+on_plugin_loaded (WpCore * core, GAsyncResult * res, TestFixture *f)
+{
+  gboolean loaded;
+  GError *error = NULL;
+
+  loaded = wp_core_load_component_finish (core, res, &error);
+  g_assert_no_error (error);
+  g_assert_true (loaded);
+
+  g_main_loop_quit (f->base.loop);
+}
+
+/* the selector only looks at the properties, so all the items can share the
+   same node; the properties are given as a NULL-terminated list of
+   key/value pairs */
+static WpSessionItem *
+create_item (TestFixture * f, const gchar * first_key, ...)
+{
+  g_autoptr (WpSessionItem) item = NULL;
+  WpProperties *props = wp_properties_new_empty ();
+  const gchar *key;
+  va_list args;
+
+  wp_properties_setf (props, "item.node", "%p", f->node);
+  va_start (args, first_key);
+  for (key = first_key; key; key = va_arg (args, const gchar *))
+    wp_properties_set (props, key, va_arg (args, const gchar *));
+  va_end (args);
+
+  item = wp_session_item_make (f->base.core, "si-node");
+  g_assert_nonnull (item);
+  g_assert_true (wp_session_item_configure (item, props));
+
+  wp_object_activate (WP_OBJECT (item), WP_SESSION_ITEM_FEATURE_ACTIVE,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  wp_session_item_register (g_object_ref (item));
+  return g_steal_pointer (&item);
+}
+
+static WpSessionItem *
+create_sink (TestFixture * f, const gchar * name, const gchar * priority,
+    const gchar * plugged)
+{
+  return create_item (f,
+      "node.name", name,
+      "item.node.type", "device",
+      "item.node.direction", "input",
+      "media.type", "Audio",
+      "priority.session", priority,
+      "item.plugged.usec", plugged,
+      NULL);
+}
+
+static guint32
+item_id (WpSessionItem * item)
+{
+  return wp_object_get_id (WP_OBJECT (item));
+}
+
+static void
+test_target_selector_setup (TestFixture * f, gconstpointer user_data)
+{
+  wp_base_test_fixture_setup (&f->base, 0);
+
+  /* load modules */
+  {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-adapter", NULL, NULL));
+  }
+  if (!test_is_spa_lib_installed (&f->base, "support.null-audio-sink"))
+    return;
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-si-node", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-target-selector", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  f->plugin = wp_plugin_find (f->base.core, "target-selector");
+  g_assert_nonnull (f->plugin);
+
+  f->node = wp_node_new_from_factory (f->base.core,
+      "adapter",
+      wp_properties_new (
+          "factory.name", "support.null-audio-sink",
+          "node.name", "null-sink",
+          "media.class", "Audio/Sink",
+          NULL));
+  g_assert_nonnull (f->node);
+  wp_object_activate (WP_OBJECT (f->node), WP_OBJECT_FEATURES_ALL,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+}
+
+static void
+test_target_selector_teardown (TestFixture * f, gconstpointer user_data)
+{
+  g_clear_object (&f->node);
+  g_clear_object (&f->plugin);
+  wp_base_test_fixture_teardown (&f->base);
+}
+
+static gboolean
+skip_if_unavailable (TestFixture * f)
+{
+  if (!f->plugin) {
+    g_test_skip ("The pipewire null-audio-sink factory was not found");
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/* checks the candidates of the item against a list of expected items, in
+   order, terminated by NULL */
+static void
+assert_targets (TestFixture * f, WpSessionItem * si, GVariant * filters, ...)
+{
+  g_autoptr (GVariant) res = NULL;
+  WpSessionItem *expected;
+  guint i = 0;
+  va_list args;
+
+  g_signal_emit_by_name (f->plugin, "get-targets", item_id (si), filters,
+      &res);
+  g_assert_nonnull (res);
+
+  va_start (args, filters);
+  while ((expected = va_arg (args, WpSessionItem *))) {
+    guint32 id = 0;
+    g_assert_cmpuint (i, <, g_variant_n_children (res));
+    g_variant_get_child (res, i++, "u", &id);
+    g_assert_cmpuint (id, ==, item_id (expected));
+  }
+  va_end (args);
+
+  g_assert_cmpuint (g_variant_n_children (res), ==, i);
+}
+
+static void
+test_target_selector_ranked (TestFixture * f, gconstpointer user_data)
+{
+  g_autoptr (WpSessionItem) stream = NULL;
+  g_autoptr (WpSessionItem) low = NULL;
+  g_autoptr (WpSessionItem) old = NULL;
+  g_autoptr (WpSessionItem) recent = NULL;
+  g_autoptr (WpSessionItem) tie = NULL;
+  g_autoptr (WpSessionItem) high = NULL;
+  g_autoptr (WpSessionItem) video = NULL;
+  g_autoptr (WpSessionItem) source = NULL;
+
+  if (skip_if_unavailable (f))
+    return;
+
+  stream = create_item (f,
+      "node.name", "stream",
+      "item.node.type", "stream",
+      "item.node.direction", "output",
+      "media.type", "Audio",
+      NULL);
+  assert_targets (f, stream, NULL, NULL);
+
+  low = create_sink (f, "low", "500", "400");
+  old = create_sink (f, "old", "1000", "100");
+  recent = create_sink (f, "recent", "1000", "300");
+  /* ranks the same as "recent"; it is kept after it, in order of appearance */
+  tie = create_sink (f, "tie", "1000", "300");
+  high = create_sink (f, "high", "2000", "0");
+
+  /* not candidates by default: another media type and another direction */
+  video = create_item (f,
+      "node.name", "video",
+      "item.node.type", "device",
+      "item.node.direction", "input",
+      "media.type", "Video",
+      "priority.session", "3000",
+      NULL);
+  source = create_item (f,
+      "node.name", "source",
+      "item.node.type", "device",
+      "item.node.direction", "output",
+      "media.type", "Audio",
+      "priority.session", "3000",
+      NULL);
+
+  /* priority first, then the most recently plugged */
+  assert_targets (f, stream, NULL, high, recent, tie, old, low, NULL);
+
+  /* limit */
+  {
+    g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&b, "{sv}", "limit", g_variant_new_int64 (2));
+    assert_targets (f, stream, g_variant_builder_end (&b),
+        high, recent, NULL);
+  }
+
+  /* the filters override the defaults */
+  {
+    g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&b, "{sv}", "item.node.direction",
+        g_variant_new_string ("output"));
+    assert_targets (f, stream, g_variant_builder_end (&b), source, NULL);
+  }
+  {
+    g_auto (GVariantBuilder) b = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&b, "{sv}", "media.type",
+        g_variant_new_string ("Video"));
+    assert_targets (f, stream, g_variant_builder_end (&b), video, NULL);
+  }
+
+  /* removed items leave the ranking and the others keep their order */
+  wp_session_item_remove (high);
+  wp_session_item_remove (recent);
+  assert_targets (f, stream, NULL, tie, old, low, NULL);
+
+  /* an item that appears again is ranked by its new properties */
+  g_clear_object (&high);
+  high = create_sink (f, "high", "700", "500");
+  assert_targets (f, stream, NULL, tie, old, high, low, NULL);
+
+  wp_session_item_remove (tie);
+  wp_session_item_remove (old);
+  wp_session_item_remove (high);
+  wp_session_item_remove (low);
+  assert_targets (f, stream, NULL, NULL);
+
+  wp_session_item_remove (video);
+  wp_session_item_remove (source);
+  wp_session_item_remove (stream);
+}
+
+static void
+test_target_selector_keyed (TestFixture * f, gconstpointer user_data)
+{
+  g_autoptr (WpSessionItem) sink = NULL;
+  g_autoptr (WpSessionItem) source = NULL;
+  g_autoptr (WpSessionItem) sink2 = NULL;
+
+  if (skip_if_unavailable (f))
+    return;
+
+  sink = create_item (f,
+      "node.name", "dev",
+      "object.path", "dev-path",
+      "node.id", "100",
+      "object.serial", "1000",
+      "item.node.type", "device",
+      "item.node.direction", "input",
+      "media.type", "Audio",
+      NULL);
+  source = create_item (f,
+      "node.name", "dev",
+      "node.id", "101",
+      "object.serial", "1001",
+      "item.node.type", "device",
+      "item.node.direction", "output",
+      "media.type", "Audio",
+      NULL);
+
+  /* by name & path, optionally restricted to a direction */
+  {
+    g_autoptr (GVariant) res = NULL;
+    g_signal_emit_by_name (f->plugin, "find-targets-by-name", "dev", NULL,
+        &res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 2);
+  }
+  {
+    g_autoptr (GVariant) res = NULL;
+    guint32 id = 0;
+    g_signal_emit_by_name (f->plugin, "find-targets-by-name", "dev", "output",
+        &res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 1);
+    g_variant_get_child (res, 0, "u", &id);
+    g_assert_cmpuint (id, ==, item_id (source));
+  }
+  {
+    g_autoptr (GVariant) res = NULL;
+    guint32 id = 0;
+    g_signal_emit_by_name (f->plugin, "find-targets-by-name", "dev-path", NULL,
+        &res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 1);
+    g_variant_get_child (res, 0, "u", &id);
+    g_assert_cmpuint (id, ==, item_id (sink));
+  }
+
+  /* by id & serial */
+  {
+    g_autoptr (WpSessionItem) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-target", "node.id", "100", &res);
+    g_assert_true (res == sink);
+  }
+  {
+    g_autoptr (WpSessionItem) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-target", "object.serial", "1001",
+        &res);
+    g_assert_true (res == source);
+  }
+  {
+    g_autoptr (WpSessionItem) res = NULL;
+    g_signal_emit_by_name (f->plugin, "get-target", item_id (sink), &res);
+    g_assert_true (res == sink);
+  }
+
+  /* a node.id that is taken over by another item; removing the old item
+     must not drop the new one from the index */
+  sink2 = create_item (f,
+      "node.name", "dev2",
+      "node.id", "100",
+      "object.serial", "1002",
+      "item.node.type", "device",
+      "item.node.direction", "input",
+      "media.type", "Audio",
+      NULL);
+  {
+    g_autoptr (WpSessionItem) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-target", "node.id", "100", &res);
+    g_assert_true (res == sink2);
+  }
+
+  wp_session_item_remove (sink);
+  {
+    g_autoptr (WpSessionItem) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-target", "node.id", "100", &res);
+    g_assert_true (res == sink2);
+  }
+  {
+    g_autoptr (WpSessionItem) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-target", "object.serial", "1000",
+        &res);
+    g_assert_null (res);
+  }
+  {
+    g_autoptr (WpSessionItem) res = NULL;
+    g_signal_emit_by_name (f->plugin, "get-target", item_id (sink), &res);
+    g_assert_null (res);
+  }
+  {
+    g_autoptr (GVariant) res = NULL;
+    g_signal_emit_by_name (f->plugin, "find-targets-by-name", "dev-path", NULL,
+        &res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 0);
+  }
+  {
+    g_autoptr (GVariant) res = NULL;
+    guint32 id = 0;
+    g_signal_emit_by_name (f->plugin, "find-targets-by-name", "dev", NULL,
+        &res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 1);
+    g_variant_get_child (res, 0, "u", &id);
+    g_assert_cmpuint (id, ==, item_id (source));
+  }
+
+  wp_session_item_remove (sink2);
+  wp_session_item_remove (source);
+  {
+    g_autoptr (WpSessionItem) res = NULL;
+    g_signal_emit_by_name (f->plugin, "lookup-target", "node.id", "100", &res);
+    g_assert_null (res);
+  }
+  {
+    g_autoptr (GVariant) res = NULL;
+    g_signal_emit_by_name (f->plugin, "find-targets-by-name", "dev", NULL,
+        &res);
+    g_assert_cmpuint (g_variant_n_children (res), ==, 0);
+  }
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  wp_init (WP_INIT_ALL);
+
+  g_test_add ("/modules/target-selector/ranked",
+      TestFixture, NULL,
+      test_target_selector_setup,
+      test_target_selector_ranked,
+      test_target_selector_teardown);
+  g_test_add ("/modules/target-selector/keyed",
+      TestFixture, NULL,
+      test_target_selector_setup,
+      test_target_selector_keyed,
+      test_target_selector_teardown);
+
+  return g_test_run ();
+}
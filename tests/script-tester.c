@@ -229,6 +229,7 @@ load_components (ScriptRunnerFixture *f, gconstpointer argv)
 
     load_component (f, "libwireplumber-module-si-audio-adapter", "module");
     load_component (f, "libwireplumber-module-si-standard-link", "module");
+    load_component (f, "libwireplumber-module-target-selector", "module");
 
     load_component (f, "default-nodes/apply-default-node.lua", "script/lua");
     load_component (f, "default-nodes/state-default-nodes.lua", "script/lua");
@@ -249,20 +250,21 @@ load_components (ScriptRunnerFixture *f, gconstpointer argv)
     load_component (f, "linking/link-target.lua", "script/lua");
     load_component (f, "linking/prepare-link.lua", "script/lua");
     load_component (f, "linking/rescan.lua", "script/lua");
+  }
 
-    {
-      g_autoptr (WpTestServerLocker) lock =
-        wp_test_server_locker_new (&f->base.server);
+  /* lua-api-tests also create adapter nodes to check the proxy API */
+  {
+    g_autoptr (WpTestServerLocker) lock =
+      wp_test_server_locker_new (&f->base.server);
 
-      g_assert_nonnull (pw_context_load_module (f->base.server.context,
-          "libpipewire-module-adapter", NULL, NULL));
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+        "libpipewire-module-adapter", NULL, NULL));
 
-      g_assert_nonnull (pw_context_load_module (f->base.server.context,
-          "libpipewire-module-link-factory", NULL, NULL));
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+        "libpipewire-module-link-factory", NULL, NULL));
 
-      g_assert_cmpint (pw_context_add_spa_lib (f->base.server.context,
-          "audiotestsrc", "audiotestsrc/libspa-audiotestsrc"), == , 0);
-    }
+    g_assert_cmpint (pw_context_add_spa_lib (f->base.server.context,
+        "audiotestsrc", "audiotestsrc/libspa-audiotestsrc"), == , 0);
   }
 }
 
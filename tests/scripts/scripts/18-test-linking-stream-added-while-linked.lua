@@ -0,0 +1,104 @@
+-- Tests that adding a stream while other streams are already linked only
+-- rescans the new stream. Two device nodes are created, then a first stream
+-- that gets linked to the default device and then a second stream. The rescan
+-- for the second stream must only carry that stream as a dirty item and the
+-- first stream must not be handled again.
+
+local pu = require ("linking-utils")
+local tu = require ("test-utils")
+
+Script.async_activation = true
+
+tu.createDeviceNode ("nondefault-device-node", "Audio/Sink")
+tu.createDeviceNode ("default-device-node", "Audio/Sink")
+
+local second_stream_created = false
+local first_stream_rescanned = false
+
+-- hook to create the first stream node, after the device nodes are ready
+SimpleEventHook {
+  name = "linkable-added@test-linking",
+  after = "linkable-added@test-utils-linking",
+  interests = {
+    -- on linkable added or removed, where linkable is adapter or plain node
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-added" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "item.factory.name", "c", "si-audio-adapter", "si-node" },
+    },
+  },
+  execute = function (event)
+    local lnkbl = event:get_subject ()
+    local name = lnkbl.properties ["node.name"]
+
+    if tu.linkablesReady () and name:find ("device%-node$") then
+      tu.createStreamNode ("playback")
+    end
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "rescan@test-linking",
+  after = "m-standard-event-source/rescan-done",
+  before = "linking/rescan",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "rescan-for-linking" },
+    },
+  },
+  execute = function (event)
+    if not second_stream_created then
+      return
+    end
+
+    local dirty_items = event:get_data ("dirty-items")
+    local first = tu.lnkbls ["stream-node"]
+
+    -- only new streams are expected after the first stream is linked
+    assert (dirty_items ~= nil)
+    if dirty_items [tostring (first.id)] then
+      first_stream_rescanned = true
+    end
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linking/test-linking",
+  after = "linking/link-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    local source, om, si, si_props, si_flags, target =
+        pu:unwrap_select_target_event (event)
+    local name = si_props ["node.name"]
+
+    Log.info (si, string.format ("handling item: %s (%s) si id(%s)",
+        tostring (name), tostring (si_props ["node.id"]), si.id))
+
+    if second_stream_created then
+      -- the first stream is linked and was not touched, so it must be left
+      -- alone by the partial rescan
+      assert (name ~= "stream-node")
+    end
+
+    if not target then
+      return
+    end
+
+    local link = pu.lookupLink (si.id, si_flags.peer_id)
+    assert (link ~= nil)
+    assert (target.properties ["node.name"] == "default-device-node")
+    assert ((link:get_active_features () & Feature.SessionItem.ACTIVE) ~= 0)
+
+    if name == "stream-node" and not second_stream_created then
+      second_stream_created = true
+      tu.createStreamNode ("playback", { ["node.name"] = "second-stream-node" })
+    elseif name == "second-stream-node" then
+      assert (not first_stream_rescanned)
+      Script:finish_activation ()
+    end
+  end
+}:register ()
@@ -0,0 +1,120 @@
+-- Tests that a stream is relinked when its linked target is removed. Three
+-- device nodes are created and the stream is linked to the defined device
+-- (target.object). The defined device is then destroyed, which must schedule
+-- a rescan that handles the stream, so that it falls back to the default
+-- device.
+
+local pu = require ("linking-utils")
+local tu = require ("test-utils")
+
+Script.async_activation = true
+
+tu.createDeviceNode ("nondefault-device-node", "Audio/Sink")
+tu.createDeviceNode ("default-device-node", "Audio/Sink")
+tu.createDeviceNode ("defined-device-node", "Audio/Sink")
+
+local removing_target = false
+local target_removed = false
+local stream_rescanned = false
+
+-- hook to create stream node, stream is created after the device nodes are
+-- ready
+SimpleEventHook {
+  name = "linkable-added@test-linking",
+  after = "linkable-added@test-utils-linking",
+  interests = {
+    -- on linkable added or removed, where linkable is adapter or plain node
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-added" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "item.factory.name", "c", "si-audio-adapter", "si-node" },
+    },
+  },
+  execute = function (event)
+    local lnkbl = event:get_subject ()
+    local name = lnkbl.properties ["node.name"]
+    if tu.linkablesReady () and name ~= "stream-node" then
+      local props = {
+        ["target.object"] = tu.lnkbls ["defined-device-node"].properties ["object.serial"]
+      }
+      tu.createStreamNode ("playback", props)
+    end
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linkable-removed@test-linking",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-removed" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "node.name", "=", "defined-device-node" },
+    },
+  },
+  execute = function (event)
+    target_removed = true
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "rescan@test-linking",
+  after = "m-standard-event-source/rescan-done",
+  before = "linking/rescan",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "rescan-for-linking" },
+    },
+  },
+  execute = function (event)
+    if not target_removed then
+      return
+    end
+
+    -- removing a device may also change the default nodes, which requests
+    -- a full rescan; otherwise the stream must be among the dirty items
+    local dirty_items = event:get_data ("dirty-items")
+    local si = tu.lnkbls ["stream-node"]
+    if not dirty_items or dirty_items [tostring (si.id)] then
+      stream_rescanned = true
+    end
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linking/test-linking",
+  after = "linking/link-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    local source, om, si, si_props, si_flags, target =
+        pu:unwrap_select_target_event (event)
+
+    if not target then
+      return
+    end
+
+    Log.info (si, string.format ("handling item: %s (%s) si id(%s)",
+        tostring (si_props ["node.name"]),
+        tostring (si_props ["node.id"]), si.id))
+
+    local link = pu.lookupLink (si.id, si_flags.peer_id)
+    assert (link ~= nil)
+    assert (si_props ["node.name"] == "stream-node")
+    assert ((link:get_active_features () & Feature.SessionItem.ACTIVE) ~= 0)
+
+    if not removing_target then
+      assert (target.properties ["node.name"] == "defined-device-node")
+
+      removing_target = true
+      tu.destroyLinkable ("defined-device-node")
+    elseif target_removed then
+      assert (stream_rescanned)
+      assert (target.properties ["node.name"] == "default-device-node")
+
+      Script:finish_activation ()
+    end
+  end
+}:register ()
@@ -0,0 +1,122 @@
+-- Tests that removing a stream which is not linked does not trigger any
+-- rescan. A device node and a linked stream are created, followed by a stream
+-- that waits for a defined target which does not exist. Once the second stream
+-- has been handled, it is destroyed and no rescan must happen afterwards.
+
+local pu = require ("linking-utils")
+local tu = require ("test-utils")
+
+Script.async_activation = true
+
+tu.createDeviceNode ("default-device-node", "Audio/Sink")
+
+local unlinked_stream_created = false
+local unlinked_stream_removed = false
+
+-- hook to create stream node, stream is created after the device node is
+-- ready
+SimpleEventHook {
+  name = "linkable-added@test-linking",
+  after = "linkable-added@test-utils-linking",
+  interests = {
+    -- on linkable added or removed, where linkable is adapter or plain node
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-added" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "item.factory.name", "c", "si-audio-adapter", "si-node" },
+    },
+  },
+  execute = function (event)
+    local lnkbl = event:get_subject ()
+    local name = lnkbl.properties ["node.name"]
+
+    if tu.linkablesReady () and name == "default-device-node" then
+      tu.createStreamNode ("playback")
+    end
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "rescan@test-linking",
+  after = "linking/rescan",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "rescan-for-linking" },
+    },
+  },
+  execute = function (event)
+    -- nothing was linked to the removed stream, so there is nothing to rescan
+    assert (not unlinked_stream_removed)
+
+    -- destroy the unlinked stream once its own rescan has run
+    local dirty_items = event:get_data ("dirty-items")
+    local si = tu.lnkbls ["unlinked-stream-node"]
+    if si and dirty_items and dirty_items [tostring (si.id)] then
+      tu.destroyLinkable ("unlinked-stream-node")
+    end
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linkable-removed@test-linking",
+  after = "linking/linkable-removed",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-removed" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "node.name", "=", "unlinked-stream-node" },
+    },
+  },
+  execute = function (event)
+    unlinked_stream_removed = true
+
+    -- give a chance to any wrongly scheduled rescan to run
+    Core.timeout_add (500, function ()
+      local si = tu.lnkbls ["stream-node"]
+      local si_flags = pu:get_flags (si.id)
+      assert (si_flags.peer_id ~= nil)
+      assert (pu.lookupLink (si.id, si_flags.peer_id) ~= nil)
+
+      Script:finish_activation ()
+      return false
+    end)
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linking/test-linking",
+  after = "linking/link-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    local source, om, si, si_props, si_flags, target =
+        pu:unwrap_select_target_event (event)
+
+    if not target then
+      return
+    end
+
+    Log.info (si, string.format ("handling item: %s (%s) si id(%s)",
+        tostring (si_props ["node.name"]),
+        tostring (si_props ["node.id"]), si.id))
+
+    local link = pu.lookupLink (si.id, si_flags.peer_id)
+    assert (link ~= nil)
+    assert (si_props ["node.name"] == "stream-node")
+    assert (target.properties ["node.name"] == "default-device-node")
+    assert ((link:get_active_features () & Feature.SessionItem.ACTIVE) ~= 0)
+
+    if not unlinked_stream_created then
+      unlinked_stream_created = true
+      tu.createStreamNode ("playback", {
+        ["node.name"] = "unlinked-stream-node",
+        ["target.object"] = "missing-device-node",
+        ["node.dont-fallback"] = "true",
+        ["node.linger"] = "true",
+      })
+    end
+  end
+}:register ()
@@ -0,0 +1,98 @@
+-- Tests that adding a filter triggers a full rescan. A device node and a
+-- linked stream are created, followed by a node that is part of a link group.
+-- The rescan that follows must not be restricted to dirty items and must
+-- handle the already linked stream again, which keeps its link.
+
+local pu = require ("linking-utils")
+local tu = require ("test-utils")
+
+Script.async_activation = true
+
+tu.createDeviceNode ("default-device-node", "Audio/Sink")
+
+local filter_created = false
+local filter_added = false
+local full_rescan = false
+
+-- hook to create stream node, stream is created after the device node is
+-- ready
+SimpleEventHook {
+  name = "linkable-added@test-linking",
+  after = "linkable-added@test-utils-linking",
+  interests = {
+    -- on linkable added or removed, where linkable is adapter or plain node
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-added" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "item.factory.name", "c", "si-audio-adapter", "si-node" },
+    },
+  },
+  execute = function (event)
+    local lnkbl = event:get_subject ()
+    local name = lnkbl.properties ["node.name"]
+
+    if tu.linkablesReady () and name == "default-device-node" then
+      tu.createStreamNode ("playback")
+    elseif name == "filter-node" then
+      filter_added = true
+    end
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "rescan@test-linking",
+  after = "m-standard-event-source/rescan-done",
+  before = "linking/rescan",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "rescan-for-linking" },
+    },
+  },
+  execute = function (event)
+    if filter_added then
+      assert (event:get_data ("dirty-items") == nil)
+      full_rescan = true
+    end
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linking/test-linking",
+  after = "linking/link-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    local source, om, si, si_props, si_flags, target =
+        pu:unwrap_select_target_event (event)
+
+    if not target then
+      return
+    end
+
+    Log.info (si, string.format ("handling item: %s (%s) si id(%s)",
+        tostring (si_props ["node.name"]),
+        tostring (si_props ["node.id"]), si.id))
+
+    local link = pu.lookupLink (si.id, si_flags.peer_id)
+    assert (link ~= nil)
+    assert (si_props ["node.name"] == "stream-node")
+    assert (target.properties ["node.name"] == "default-device-node")
+    assert ((link:get_active_features () & Feature.SessionItem.ACTIVE) ~= 0)
+
+    if not filter_created then
+      filter_created = true
+      tu.createStreamNode ("capture", {
+        ["node.name"] = "filter-node",
+        ["node.link-group"] = "test-filter",
+        ["target.object"] = "missing-device-node",
+        ["node.dont-fallback"] = "true",
+        ["node.linger"] = "true",
+      })
+    elseif full_rescan then
+      Script:finish_activation ()
+    end
+  end
+}:register ()
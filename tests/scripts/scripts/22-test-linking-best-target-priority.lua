@@ -0,0 +1,97 @@
+-- Tests that the best target is the device with the highest priority.session,
+-- regardless of the order in which the devices appeared. The default target is
+-- dropped before find-best-target runs, so that the pick is made there and not
+-- by the default nodes logic, which prefers the same device.
+
+local pu = require ("linking-utils")
+local tu = require ("test-utils")
+
+Script.async_activation = true
+
+tu.createDeviceNode ("low-priority-device-node", "Audio/Sink",
+    { ["priority.session"] = "1000" })
+tu.createDeviceNode ("high-priority-device-node", "Audio/Sink",
+    { ["priority.session"] = "2000" })
+tu.createDeviceNode ("mid-priority-device-node", "Audio/Sink",
+    { ["priority.session"] = "1500" })
+
+-- hook to create stream node, stream is created after the device nodes are
+-- ready
+SimpleEventHook {
+  name = "linkable-added@test-linking",
+  after = "linkable-added@test-utils-linking",
+  interests = {
+    -- on linkable added or removed, where linkable is adapter or plain node
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-added" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "item.factory.name", "c", "si-audio-adapter", "si-node" },
+    },
+  },
+  execute = function (event)
+    local lnkbl = event:get_subject ()
+    local name = lnkbl.properties ["node.name"]
+
+    if tu.linkablesReady () and name ~= "stream-node" then
+      tu.createStreamNode ("playback")
+    end
+  end
+}:register ()
+
+-- leave the choice to find-best-target
+SimpleEventHook {
+  name = "linking/test-drop-default-target",
+  after = "linking/find-default-target",
+  before = "linking/find-best-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    event:set_data ("target", nil)
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linking/test-linking",
+  after = "linking/link-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    local source, om, si, si_props, si_flags, target =
+        pu:unwrap_select_target_event (event)
+
+    if not target then
+      return
+    end
+
+    Log.info (si, string.format ("handling item: %s (%s) si id(%s)",
+        tostring (si_props ["node.name"]),
+        tostring (si_props ["node.id"]), si.id))
+
+    local link = pu.lookupLink (si.id, si_flags.peer_id)
+    assert (link ~= nil)
+    assert (si_props ["node.name"] == "stream-node")
+    assert (target.properties ["node.name"] == "high-priority-device-node")
+    assert ((link:get_active_features () & Feature.SessionItem.ACTIVE) ~= 0)
+
+    -- the candidates are ranked by priority
+    local ts = pu.get_target_selector ()
+    local candidates = ts:call ("get-targets", si.id,
+        { ["media.type"] = "Audio" })
+    local names = {}
+    for _, id in ipairs (candidates) do
+      table.insert (names, ts:call ("get-target", id).properties ["node.name"])
+    end
+    assert (#names == 3)
+    assert (names [1] == "high-priority-device-node")
+    assert (names [2] == "mid-priority-device-node")
+    assert (names [3] == "low-priority-device-node")
+
+    Script:finish_activation ()
+  end
+}:register ()
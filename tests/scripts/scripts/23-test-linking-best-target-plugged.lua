@@ -0,0 +1,108 @@
+-- Tests that, among devices of the same priority.session, the best target is
+-- the one that was plugged last. The default target is dropped before
+-- find-best-target runs, since the default nodes logic prefers the first of
+-- the devices of equal priority instead.
+
+local pu = require ("linking-utils")
+local tu = require ("test-utils")
+
+Script.async_activation = true
+
+tu.createDeviceNode ("first-device-node", "Audio/Sink",
+    { ["priority.session"] = "1000" })
+tu.createDeviceNode ("second-device-node", "Audio/Sink",
+    { ["priority.session"] = "1000" })
+tu.createDeviceNode ("third-device-node", "Audio/Sink",
+    { ["priority.session"] = "1000" })
+
+-- hook to create stream node, stream is created after the device nodes are
+-- ready
+SimpleEventHook {
+  name = "linkable-added@test-linking",
+  after = "linkable-added@test-utils-linking",
+  interests = {
+    -- on linkable added or removed, where linkable is adapter or plain node
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-added" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "item.factory.name", "c", "si-audio-adapter", "si-node" },
+    },
+  },
+  execute = function (event)
+    local lnkbl = event:get_subject ()
+    local name = lnkbl.properties ["node.name"]
+
+    if tu.linkablesReady () and name ~= "stream-node" then
+      tu.createStreamNode ("playback")
+    end
+  end
+}:register ()
+
+-- leave the choice to find-best-target
+SimpleEventHook {
+  name = "linking/test-drop-default-target",
+  after = "linking/find-default-target",
+  before = "linking/find-best-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    event:set_data ("target", nil)
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linking/test-linking",
+  after = "linking/link-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    local source, om, si, si_props, si_flags, target =
+        pu:unwrap_select_target_event (event)
+
+    if not target then
+      return
+    end
+
+    Log.info (si, string.format ("handling item: %s (%s) si id(%s)",
+        tostring (si_props ["node.name"]),
+        tostring (si_props ["node.id"]), si.id))
+
+    local link = pu.lookupLink (si.id, si_flags.peer_id)
+    assert (link ~= nil)
+    assert (si_props ["node.name"] == "stream-node")
+    assert ((link:get_active_features () & Feature.SessionItem.ACTIVE) ~= 0)
+
+    -- the most recently plugged device wins
+    local latest = nil
+    for _, name in ipairs ({ "first-device-node", "second-device-node",
+        "third-device-node" }) do
+      local lnkbl = tu.lnkbls [name]
+      if not latest or tonumber (lnkbl.properties ["item.plugged.usec"]) >
+          tonumber (latest.properties ["item.plugged.usec"]) then
+        latest = lnkbl
+      end
+    end
+    assert (target.id == latest.id)
+
+    -- the candidates are ranked by plugged time
+    local ts = pu.get_target_selector ()
+    local candidates = ts:call ("get-targets", si.id,
+        { ["media.type"] = "Audio" })
+    assert (#candidates == 3)
+    assert (candidates [1] == latest.id)
+    local plugged = math.maxinteger
+    for _, id in ipairs (candidates) do
+      local p = tonumber (ts:call ("get-target", id).properties ["item.plugged.usec"])
+      assert (p <= plugged)
+      plugged = p
+    end
+
+    Script:finish_activation ()
+  end
+}:register ()
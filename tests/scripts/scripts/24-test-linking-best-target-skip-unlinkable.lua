@@ -0,0 +1,94 @@
+-- Tests that the best target is the first ranked candidate that passes the
+-- checks of find-best-target. The device with the highest priority.session is
+-- in the same link group as the stream, so canLink() rejects it and the next
+-- candidate must be picked. The default target is dropped before
+-- find-best-target runs, so that the pick is made there.
+
+local pu = require ("linking-utils")
+local tu = require ("test-utils")
+
+Script.async_activation = true
+
+tu.createDeviceNode ("grouped-device-node", "Audio/Sink", {
+  ["priority.session"] = "2000",
+  ["node.link-group"] = "test-group",
+})
+tu.createDeviceNode ("fallback-device-node", "Audio/Sink",
+    { ["priority.session"] = "1000" })
+
+-- hook to create stream node, stream is created after the device nodes are
+-- ready
+SimpleEventHook {
+  name = "linkable-added@test-linking",
+  after = "linkable-added@test-utils-linking",
+  interests = {
+    -- on linkable added or removed, where linkable is adapter or plain node
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-added" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "item.factory.name", "c", "si-audio-adapter", "si-node" },
+    },
+  },
+  execute = function (event)
+    local lnkbl = event:get_subject ()
+    local name = lnkbl.properties ["node.name"]
+
+    if tu.linkablesReady () and name ~= "stream-node" then
+      tu.createStreamNode ("playback", { ["node.link-group"] = "test-group" })
+    end
+  end
+}:register ()
+
+-- leave the choice to find-best-target
+SimpleEventHook {
+  name = "linking/test-drop-default-target",
+  after = "linking/find-default-target",
+  before = "linking/find-best-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    event:set_data ("target", nil)
+  end
+}:register ()
+
+SimpleEventHook {
+  name = "linking/test-linking",
+  after = "linking/link-target",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "select-target" },
+    },
+  },
+  execute = function (event)
+    local source, om, si, si_props, si_flags, target =
+        pu:unwrap_select_target_event (event)
+
+    if not target then
+      return
+    end
+
+    Log.info (si, string.format ("handling item: %s (%s) si id(%s)",
+        tostring (si_props ["node.name"]),
+        tostring (si_props ["node.id"]), si.id))
+
+    local link = pu.lookupLink (si.id, si_flags.peer_id)
+    assert (link ~= nil)
+    assert (si_props ["node.name"] == "stream-node")
+    assert (target.properties ["node.name"] == "fallback-device-node")
+    assert ((link:get_active_features () & Feature.SessionItem.ACTIVE) ~= 0)
+
+    -- the device that was skipped is the top candidate
+    local ts = pu.get_target_selector ()
+    local candidates = ts:call ("get-targets", si.id,
+        { ["media.type"] = "Audio" })
+    assert (#candidates == 2)
+    assert (candidates [1] == tu.lnkbls ["grouped-device-node"].id)
+    assert (candidates [2] == target.id)
+    assert (not pu.canLink (si_props, tu.lnkbls ["grouped-device-node"]))
+
+    Script:finish_activation ()
+  end
+}:register ()
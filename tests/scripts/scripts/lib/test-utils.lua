@@ -14,8 +14,11 @@ u.nodes = {}
 u.lnkbls = {}
 u.lnkbl_count = 0
 
-function u.createDeviceNode (name, media_class)
+function u.createDeviceNode (name, media_class, props)
   local properties = {}
+  for k, v in pairs (props or {}) do
+    properties [k] = v
+  end
   properties ["node.name"] = name
   properties ["media.class"] = media_class
   if media_class == "Audio/Sink" then
@@ -76,12 +79,23 @@ SimpleEventHook {
 u.script_tester_plugin = Plugin.find ("script-tester")
 
 function u.createStreamNode (stream_type, props)
+  local name = props and props ["node.name"] or "stream-node"
+
   u.script_tester_plugin:call ("create-stream", stream_type, props)
 
-  u.lnkbls ["stream-node"] = nil
+  u.lnkbls [name] = nil
   u.lnkbl_count = u.lnkbl_count + 1
 end
 
+-- destroy the node of a linkable, which makes its session item go away.
+function u.destroyLinkable (name)
+  local node = u.lnkbls [name]:get_associated_proxy ("node")
+  node:request_destroy ()
+
+  u.lnkbls [name] = nil
+  u.lnkbl_count = u.lnkbl_count - 1
+end
+
 function u.restartPlugin (name)
   u.script_tester_plugin:call ("restart-plugin", name)
 end
@@ -0,0 +1,94 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../common/test-log.h"
+
+#include <glib/gstdio.h>
+
+static guint
+count_files (const gchar *dir, const gchar *suffix)
+{
+  g_autoptr (WpIterator) it =
+      wp_base_dirs_new_files_iterator (WP_BASE_DIRS_CONFIGURATION, dir, suffix);
+  g_auto (GValue) item = G_VALUE_INIT;
+  guint count = 0;
+
+  for (; wp_iterator_next (it, &item); g_value_unset (&item))
+    count++;
+  return count;
+}
+
+static gboolean
+on_timeout (gpointer data)
+{
+  gboolean *timed_out = data;
+  *timed_out = TRUE;
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_base_dirs_cache (void)
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *dir = NULL;
+  g_autofree gchar *a = NULL;
+  g_autofree gchar *b = NULL;
+  g_autofree gchar *found = NULL;
+  gboolean timed_out = FALSE;
+  guint timeout_id;
+
+  tmpdir = g_dir_make_tmp ("wp-base-dirs-XXXXXX", &error);
+  g_assert_no_error (error);
+  dir = g_canonicalize_filename (tmpdir, NULL);
+  a = g_build_filename (dir, "a.conf", NULL);
+  b = g_build_filename (dir, "b.conf", NULL);
+  g_assert_true (g_file_set_contents (a, "", -1, NULL));
+
+  wp_base_dirs_set_cache_enabled (TRUE);
+
+  found = wp_base_dirs_find_file (WP_BASE_DIRS_CONFIGURATION, NULL, a);
+  g_assert_cmpstr (found, ==, a);
+  g_clear_pointer (&found, g_free);
+  found = wp_base_dirs_find_file (WP_BASE_DIRS_CONFIGURATION, NULL, b);
+  g_assert_null (found);
+  g_assert_cmpuint (count_files (dir, ".conf"), ==, 1);
+  g_assert_cmpuint (count_files (dir, ".lua"), ==, 0);
+
+  /* the directory is dropped from the cache once the monitor notices */
+  g_assert_true (g_file_set_contents (b, "", -1, NULL));
+  timeout_id = g_timeout_add_seconds (30, on_timeout, &timed_out);
+  while (!timed_out &&
+      !(found = wp_base_dirs_find_file (WP_BASE_DIRS_CONFIGURATION, NULL, b)))
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_false (timed_out);
+  g_source_remove (timeout_id);
+  g_assert_cmpstr (found, ==, b);
+  g_assert_cmpuint (count_files (dir, ".conf"), ==, 2);
+
+  /* disabling the cache goes back to testing the filesystem directly */
+  wp_base_dirs_set_cache_enabled (FALSE);
+  g_assert_cmpint (g_unlink (b), ==, 0);
+  g_clear_pointer (&found, g_free);
+  found = wp_base_dirs_find_file (WP_BASE_DIRS_CONFIGURATION, NULL, b);
+  g_assert_null (found);
+  g_assert_cmpuint (count_files (dir, ".conf"), ==, 1);
+
+  g_assert_cmpint (g_unlink (a), ==, 0);
+  g_assert_cmpint (g_rmdir (dir), ==, 0);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_log_set_writer_func (wp_log_writer_default, NULL, NULL);
+
+  g_test_add_func ("/wp/base-dirs/cache", test_base_dirs_cache);
+
+  return g_test_run ();
+}
@@ -340,6 +340,39 @@ test_conf_merge_nested (TestConfFixture *f, gconstpointer data)
   }
 }
 
+static void
+test_conf_merge_multi (TestConfFixture *f, gconstpointer data)
+{
+  g_assert_nonnull (f->conf);
+
+  g_autoptr (WpSpaJson) s = wp_conf_get_section (f->conf,
+      "wireplumber.section-merged-multi");
+  g_assert_nonnull (s);
+  g_assert_true (wp_spa_json_is_object (s));
+
+  /* the last fragment wins for plain values */
+  gint v1 = 0, v2 = 0;
+  g_assert_true (wp_spa_json_object_get (s, "key1", "i", &v1, NULL));
+  g_assert_cmpint (v1, ==, 3);
+  g_assert_true (wp_spa_json_object_get (s, "key2", "i", &v2, NULL));
+  g_assert_cmpint (v2, ==, 2);
+
+  /* arrays of all the fragments are concatenated in order */
+  g_autoptr (WpSpaJson) list = NULL;
+  g_assert_true (wp_spa_json_object_get (s, "list", "J", &list, NULL));
+  gint l1 = 0, l2 = 0, l3 = 0;
+  g_assert_true (wp_spa_json_parse_array (list, "i", &l1, "i", &l2, "i", &l3,
+      NULL));
+  g_assert_cmpint (l1, ==, 1);
+  g_assert_cmpint (l2, ==, 2);
+  g_assert_cmpint (l3, ==, 3);
+
+  /* the merged result is cached */
+  g_autoptr (WpSpaJson) s2 = wp_conf_get_section (f->conf,
+      "wireplumber.section-merged-multi");
+  g_assert_true (s == s2);
+}
+
 static void
 test_conf_override (TestConfFixture *f, gconstpointer data)
 {
@@ -410,6 +443,50 @@ test_conf_as_section (TestConfFixture *f, gconstpointer data)
   g_clear_object (&f->conf);
 }
 
+static void
+test_conf_section_names (TestConfFixture *f, gconstpointer data)
+{
+  g_autoptr (GHashTable) names = g_hash_table_new_full (g_str_hash,
+      g_str_equal, g_free, NULL);
+
+  g_assert_nonnull (f->conf);
+
+  /* merging a section must not add a duplicate name */
+  {
+    g_autoptr (WpSpaJson) s = wp_conf_get_section (f->conf,
+        "wireplumber.section-merged.object");
+    g_assert_nonnull (s);
+  }
+
+  {
+    g_autoptr (WpIterator) it = wp_conf_new_section_names_iterator (f->conf);
+    g_auto (GValue) val = G_VALUE_INIT;
+    for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
+      const gchar *name = g_value_get_string (&val);
+      g_assert_false (g_hash_table_contains (names, name));
+      g_hash_table_add (names, g_strdup (name));
+    }
+  }
+
+  g_assert_cmpuint (g_hash_table_size (names), ==, 18);
+  g_assert_true (g_hash_table_contains (names,
+      "wireplumber.section.array.boolean"));
+  g_assert_true (g_hash_table_contains (names,
+      "wireplumber.section-merged.object"));
+  g_assert_true (g_hash_table_contains (names,
+      "wireplumber.section-override"));
+  g_assert_false (g_hash_table_contains (names,
+      "override.wireplumber.section-override"));
+
+  /* nothing is listed after closing */
+  wp_conf_close (f->conf);
+  {
+    g_autoptr (WpIterator) it = wp_conf_new_section_names_iterator (f->conf);
+    g_auto (GValue) val = G_VALUE_INIT;
+    g_assert_false (wp_iterator_next (it, &val));
+  }
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -422,12 +499,16 @@ main (gint argc, gchar *argv[])
       test_conf_setup, test_conf_merge, test_conf_teardown);
   g_test_add ("/wp/conf/merge_nested", TestConfFixture, NULL,
       test_conf_setup, test_conf_merge_nested, test_conf_teardown);
+  g_test_add ("/wp/conf/merge_multi", TestConfFixture, NULL,
+      test_conf_setup, test_conf_merge_multi, test_conf_teardown);
   g_test_add ("/wp/conf/override", TestConfFixture, NULL,
       test_conf_setup, test_conf_override, test_conf_teardown);
   g_test_add ("/wp/conf/override_nested", TestConfFixture, NULL,
       test_conf_setup, test_conf_override_nested, test_conf_teardown);
   g_test_add ("/wp/conf/as_section", TestConfFixture, NULL,
       NULL, test_conf_as_section, NULL);
+  g_test_add ("/wp/conf/section_names", TestConfFixture, NULL,
+      test_conf_setup, test_conf_section_names, test_conf_teardown);
 
   return g_test_run ();
 }
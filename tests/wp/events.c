@@ -424,6 +424,238 @@ test_events_glob_deps (TestFixture *self, gconstpointer user_data)
   g_assert_true (hook_quit == self->hooks_executed->pdata [4]);
 }
 
+static void
+test_events_coalesce (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpEventHook) hook = NULL;
+  WpEvent *event1 = NULL, *event2 = NULL, *event3 = NULL, *event4;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+
+  hook = wp_simple_event_hook_new ("hook-a", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_a, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "type1", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  hook = wp_simple_event_hook_new ("hook-quit", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_quit, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "quit", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  event1 = wp_event_new ("type1", 20, NULL, NULL, NULL);
+  event2 = wp_event_new ("type1", 20, NULL, NULL, NULL);
+  event3 = wp_event_new ("type1", 20, NULL, NULL, NULL);
+  event4 = wp_event_new ("quit",  10, NULL, NULL, NULL);
+  wp_event_set_coalesce_key (event1, "type1@key1");
+  wp_event_set_coalesce_key (event2, "type1@key1");
+  wp_event_set_coalesce_key (event3, "type1@key2");
+  g_assert_cmpstr (wp_event_get_coalesce_key (event3), ==, "type1@key2");
+
+  wp_event_dispatcher_push_event (dispatcher, event1);
+  wp_event_dispatcher_push_event (dispatcher, event2);
+  wp_event_dispatcher_push_event (dispatcher, event3);
+  wp_event_dispatcher_push_event (dispatcher, event4);
+  g_assert_cmpuint (
+      wp_event_dispatcher_get_n_coalesced_events (dispatcher), ==, 1);
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 3);
+  g_assert_cmpint (self->events->len, == , 3);
+
+  g_assert_true (hook_a == self->hooks_executed->pdata [0]);
+  g_assert_true (event1 == self->events->pdata [0]);
+  g_assert_true (hook_a == self->hooks_executed->pdata [1]);
+  g_assert_true (event3 == self->events->pdata [1]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [2]);
+  g_assert_true (event4 == self->events->pdata [2]);
+
+  /* the key is released once the event has been dispatched */
+  g_ptr_array_set_size (self->hooks_executed, 0);
+  g_ptr_array_set_size (self->events, 0);
+
+  event1 = wp_event_new ("type1", 20, NULL, NULL, NULL);
+  event4 = wp_event_new ("quit",  10, NULL, NULL, NULL);
+  wp_event_set_coalesce_key (event1, "type1@key1");
+  wp_event_dispatcher_push_event (dispatcher, event1);
+  wp_event_dispatcher_push_event (dispatcher, event4);
+  g_assert_cmpuint (
+      wp_event_dispatcher_get_n_coalesced_events (dispatcher), ==, 1);
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 2);
+  g_assert_true (event1 == self->events->pdata [0]);
+  g_assert_true (event4 == self->events->pdata [1]);
+}
+
+static gboolean
+mark_interleaved (TestFixture *self)
+{
+  g_debug ("in mark_interleaved");
+  g_ptr_array_add (self->hooks_executed, mark_interleaved);
+  g_ptr_array_add (self->events, NULL);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+hook_interleave (WpEvent *event, TestFixture *self)
+{
+  g_debug ("in hook_interleave");
+
+  /* schedule a default priority source only once, on the first run */
+  if (self->hooks_executed->len == 0)
+    g_idle_add_full (G_PRIORITY_DEFAULT, (GSourceFunc) mark_interleaved,
+        self, NULL);
+
+  g_ptr_array_add (self->hooks_executed, hook_interleave);
+  g_ptr_array_add (self->events, event);
+}
+
+static void
+test_events_budget (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpEventHook) hook = NULL;
+  WpEvent *event1 = NULL, *event2 = NULL, *event3 = NULL, *event4;
+  guint64 n_events = 0;
+  gint64 max_wait = -1, total_wait = -1;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+  wp_event_dispatcher_set_dispatch_budget (dispatcher, 1, 0);
+
+  hook = wp_simple_event_hook_new ("hook-interleave", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_interleave, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "type1", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  hook = wp_simple_event_hook_new ("hook-quit", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_quit, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "quit", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  event1 = wp_event_new ("type1", 20, NULL, NULL, NULL);
+  event2 = wp_event_new ("type1", 20, NULL, NULL, NULL);
+  event3 = wp_event_new ("type1", 20, NULL, NULL, NULL);
+  event4 = wp_event_new ("quit",  10, NULL, NULL, NULL);
+  wp_event_dispatcher_push_event (dispatcher, event1);
+  wp_event_dispatcher_push_event (dispatcher, event2);
+  wp_event_dispatcher_push_event (dispatcher, event3);
+  wp_event_dispatcher_push_event (dispatcher, event4);
+
+  g_main_loop_run (self->base.loop);
+
+  /* the dispatcher yields after every hook, so the idle source that the
+     first hook added runs before the second event is dispatched */
+  g_assert_cmpint (self->hooks_executed->len, == , 5);
+  g_assert_true (hook_interleave == self->hooks_executed->pdata [0]);
+  g_assert_true (event1 == self->events->pdata [0]);
+  g_assert_true (mark_interleaved == self->hooks_executed->pdata [1]);
+  g_assert_true (hook_interleave == self->hooks_executed->pdata [2]);
+  g_assert_true (event2 == self->events->pdata [2]);
+  g_assert_true (hook_interleave == self->hooks_executed->pdata [3]);
+  g_assert_true (event3 == self->events->pdata [3]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [4]);
+  g_assert_true (event4 == self->events->pdata [4]);
+
+  g_assert_cmpuint (wp_event_dispatcher_get_n_yields (dispatcher), >=, 3);
+
+  wp_event_dispatcher_get_queue_wait_stats (dispatcher, &n_events,
+      &max_wait, &total_wait);
+  g_assert_cmpuint (n_events, ==, 4);
+  g_assert_cmpint (max_wait, >=, 0);
+  g_assert_cmpint (total_wait, >=, max_wait);
+}
+
+static void
+collect_event_stats (const gchar *event_type, guint64 n_pushed,
+    guint64 n_dispatched, GHashTable *stats)
+{
+  g_hash_table_insert (stats, g_strdup (event_type),
+      g_strdup_printf ("%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT,
+          n_pushed, n_dispatched));
+}
+
+static void
+collect_hook_stats (const gchar *hook_name, guint64 n_runs,
+    gint64 total_usec, gint64 max_usec, GHashTable *stats)
+{
+  g_assert_cmpint (max_usec, >=, 0);
+  g_assert_cmpint (total_usec, >=, max_usec);
+  g_hash_table_insert (stats, g_strdup (hook_name),
+      g_strdup_printf ("%" G_GUINT64_FORMAT, n_runs));
+}
+
+static void
+test_events_stats (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpEventHook) hook = NULL;
+  g_autoptr (GHashTable) event_stats = g_hash_table_new_full (g_str_hash,
+      g_str_equal, g_free, g_free);
+  g_autoptr (GHashTable) hook_stats = g_hash_table_new_full (g_str_hash,
+      g_str_equal, g_free, g_free);
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+  wp_event_dispatcher_set_stats_enabled (dispatcher, TRUE);
+
+  hook = wp_simple_event_hook_new ("hook-a", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_a, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "type1", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  hook = wp_simple_event_hook_new ("hook-quit", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_quit, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "quit", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  /* type2 has no hooks; it is counted as pushed, but never dispatched */
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type1", 20, NULL, NULL, NULL));
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type1", 20, NULL, NULL, NULL));
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type2", 20, NULL, NULL, NULL));
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("quit", 10, NULL, NULL, NULL));
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 3);
+
+  wp_event_dispatcher_foreach_event_stats (dispatcher,
+      (WpEventStatsFunc) collect_event_stats, event_stats);
+  g_assert_cmpuint (g_hash_table_size (event_stats), ==, 3);
+  g_assert_cmpstr (g_hash_table_lookup (event_stats, "type1"), ==, "2/2");
+  g_assert_cmpstr (g_hash_table_lookup (event_stats, "type2"), ==, "1/0");
+  g_assert_cmpstr (g_hash_table_lookup (event_stats, "quit"), ==, "1/1");
+
+  wp_event_dispatcher_foreach_hook_stats (dispatcher,
+      (WpHookStatsFunc) collect_hook_stats, hook_stats);
+  g_assert_cmpstr (g_hash_table_lookup (hook_stats, "hook-a"), ==, "2");
+  g_assert_cmpstr (g_hash_table_lookup (hook_stats, "hook-quit"), ==, "1");
+
+  /* disabling discards the statistics */
+  wp_event_dispatcher_set_stats_enabled (dispatcher, FALSE);
+  g_hash_table_remove_all (event_stats);
+  wp_event_dispatcher_foreach_event_stats (dispatcher,
+      (WpEventStatsFunc) collect_event_stats, event_stats);
+  g_assert_cmpuint (g_hash_table_size (event_stats), ==, 0);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -438,6 +670,12 @@ main (gint argc, gchar *argv[])
     test_events_setup, test_events_async_hook, test_events_teardown);
   g_test_add ("/wp/events/glob_deps", TestFixture, NULL,
     test_events_setup, test_events_glob_deps, test_events_teardown);
+  g_test_add ("/wp/events/coalesce", TestFixture, NULL,
+    test_events_setup, test_events_coalesce, test_events_teardown);
+  g_test_add ("/wp/events/budget", TestFixture, NULL,
+    test_events_setup, test_events_budget, test_events_teardown);
+  g_test_add ("/wp/events/stats", TestFixture, NULL,
+    test_events_setup, test_events_stats, test_events_teardown);
 
   return g_test_run ();
 }
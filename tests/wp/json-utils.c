@@ -333,6 +333,141 @@ test_match_rules (void)
   }
 }
 
+static void
+test_rule_set (void)
+{
+  static const gchar * const rules_json_string =
+      "["
+      "  {"
+      "    matches = ["
+      "      {"
+      "        node.name = \"!~alsa_.*\""
+      "        media.class = \"Audio/Sink\""
+      "      }"
+      "      {"
+      "        node.name = \"alsa_output.0\""
+      "        device.id = null"
+      "      }"
+      "    ]"
+      "    actions = {"
+      "      update-props = {"
+      "        node.matched = true"
+      "      }"
+      "    }"
+      "  }"
+      "  {"
+      "    matches = ["
+      "      {"
+      "        node.matched = true"
+      "        node.description = \"!null\""
+      "      }"
+      "    ]"
+      "    actions = {"
+      "      set-answer = { a = 4, b = 2 }"
+      "    }"
+      "  }"
+      "  {"
+      "    matches = ["
+      "      {"
+      "      }"
+      "    ]"
+      "    actions = {"
+      "      set-description = \"never\""
+      "    }"
+      "  }"
+      "]";
+  static const gchar * const test_props[][4] = {
+    { "node.name", "bluez_output.0", "media.class", "Audio/Sink" },
+    { "node.name", "alsa_output.1", "media.class", "Audio/Sink" },
+    { "node.name", "bluez_output.0", "media.class", "Audio/Source" },
+    { "node.name", "alsa_output.0", "media.class", "Audio/Sink" },
+    { "node.name", "alsa_output.0", "device.id", "42" },
+    { "node.name", "bluez_output.0", "node.description", "BT" },
+    { "media.class", "Audio/Sink", "node.description", "BT" },
+  };
+  static const gboolean expected_match[] = {
+    TRUE, FALSE, FALSE, TRUE, FALSE, FALSE, TRUE,
+  };
+
+  g_autoptr (GError) error = NULL;
+  g_autoptr (WpSpaJson) rules_json = wp_spa_json_new_wrap_stringn (
+      rules_json_string, strlen (rules_json_string));
+  g_autoptr (WpRuleSet) rules = wp_rule_set_new (rules_json, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (rules);
+
+  for (guint i = 0; i < G_N_ELEMENTS (test_props); i++) {
+    g_autoptr (WpProperties) props1 = wp_properties_new (
+        test_props[i][0], test_props[i][1],
+        test_props[i][2], test_props[i][3], NULL);
+    g_autoptr (WpProperties) props2 = wp_properties_copy (props1);
+
+    /* the result must be identical to the non-parsed variant */
+    g_assert_true (wp_json_utils_match_rules (rules_json, props1,
+        match_rules_cb, props1, &error));
+    g_assert_no_error (error);
+    g_assert_true (wp_rule_set_match (rules, props2,
+        match_rules_cb, props2, &error));
+    g_assert_no_error (error);
+
+    g_assert_cmpstr (wp_properties_get (props2, "node.matched"), ==,
+        expected_match[i] ? "true" : NULL);
+    g_assert_cmpstr (wp_properties_get (props2, "device.description"), ==,
+        NULL);
+    g_assert_cmpuint (wp_properties_get_count (props1), ==,
+        wp_properties_get_count (props2));
+    g_assert_cmpstr (wp_properties_get (props1, "node.matched"), ==,
+        wp_properties_get (props2, "node.matched"));
+    g_assert_cmpstr (wp_properties_get (props1, "answer.universe"), ==,
+        wp_properties_get (props2, "answer.universe"));
+
+    /* interned properties are compared by address, with the same result;
+       they are immutable, so the actions are applied on another set */
+    {
+      g_autoptr (WpProperties) interned = wp_properties_intern (
+          wp_properties_new (test_props[i][0], test_props[i][1],
+              test_props[i][2], test_props[i][3], NULL));
+      g_autoptr (WpProperties) result = wp_properties_new_empty ();
+
+      g_assert_true (wp_rule_set_match (rules, interned,
+          match_rules_cb, result, &error));
+      g_assert_no_error (error);
+      g_assert_cmpstr (wp_properties_get (result, "node.matched"), ==,
+          expected_match[i] ? "true" : NULL);
+    }
+  }
+
+  /* an invalid regex never matches, so the whole match object fails,
+     unless the condition is negated */
+  {
+    g_autoptr (WpSpaJson) json = wp_spa_json_new_wrap_string (
+        "[ { matches = [ { node.name = \"~(\", media.class = \"Audio/Sink\" } ]"
+        "    actions = { update-props = { node.matched = true } } }"
+        "  { matches = [ { node.name = \"!~(\" } ]"
+        "    actions = { update-props = { node.negated = true } } } ]");
+    g_autoptr (WpRuleSet) rs = wp_rule_set_new (json, &error);
+    g_autoptr (WpProperties) props = wp_properties_new (
+        "node.name", "(", "media.class", "Audio/Sink", NULL);
+    g_assert_no_error (error);
+    g_assert_nonnull (rs);
+
+    g_assert_true (wp_rule_set_match (rs, props, match_rules_cb, props,
+        &error));
+    g_assert_no_error (error);
+    g_assert_null (wp_properties_get (props, "node.matched"));
+    g_assert_cmpstr (wp_properties_get (props, "node.negated"), ==, "true");
+  }
+
+  /* a set constructed from something other than an array is an error */
+  {
+    g_autoptr (WpSpaJson) json = wp_spa_json_new_wrap_string ("{ a = b }");
+    g_autoptr (WpRuleSet) bad = wp_rule_set_new (json, &error);
+    g_assert_null (bad);
+    g_assert_error (error, WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_INVALID_ARGUMENT);
+    g_clear_error (&error);
+  }
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -342,6 +477,7 @@ main (gint argc, gchar *argv[])
   g_test_add_func ("/wp/json-utils/match_rules_update_props",
       test_match_rules_update_properties);
   g_test_add_func ("/wp/json-utils/match_rules", test_match_rules);
+  g_test_add_func ("/wp/json-utils/rule_set", test_rule_set);
 
   return g_test_run ();
 }
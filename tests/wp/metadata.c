@@ -546,6 +546,81 @@ test_metadata_basic (TestFixture *fixture, gconstpointer data)
   g_assert_null (fixture->proxy_metadata);
 }
 
+static void
+test_metadata_transaction_changed (WpMetadata *metadata, guint32 subject,
+    const gchar *key, const gchar *type, const gchar *value, GPtrArray *log)
+{
+  g_ptr_array_add (log, g_strdup_printf ("%u:%s=%s", subject, key,
+      value ? value : "NULL"));
+}
+
+static void
+test_metadata_transaction_changed_batch (WpMetadata *metadata,
+    GPtrArray *changes, GPtrArray *log)
+{
+  /* all the individual changes have been notified before */
+  g_assert_cmpuint (changes->len, ==, log->len);
+  for (guint i = 0; i < changes->len; i++) {
+    WpMetadataItem *mi = g_ptr_array_index (changes, i);
+    const gchar *value = wp_metadata_item_get_value (mi);
+    g_autofree gchar *str = g_strdup_printf ("%u:%s=%s",
+        wp_metadata_item_get_subject (mi), wp_metadata_item_get_key (mi),
+        value ? value : "NULL");
+    g_assert_cmpstr (str, ==, g_ptr_array_index (log, i));
+  }
+  g_ptr_array_add (log, g_strdup ("batch"));
+}
+
+static void
+test_metadata_transaction (TestFixture *fixture, gconstpointer data)
+{
+  g_autoptr (WpMetadata) metadata = NULL;
+  g_autoptr (GPtrArray) log = g_ptr_array_new_with_free_func (g_free);
+
+  metadata = WP_METADATA (wp_impl_metadata_new (fixture->base.core));
+  g_signal_connect (metadata, "changed",
+      (GCallback) test_metadata_transaction_changed, log);
+  g_signal_connect (metadata, "changed-batch",
+      (GCallback) test_metadata_transaction_changed_batch, log);
+
+  /* outside of a transaction, changes are notified immediately */
+  wp_metadata_set (metadata, 0, "a", NULL, "1");
+  g_assert_cmpuint (log->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (log, 0), ==, "0:a=1");
+  g_ptr_array_set_size (log, 0);
+
+  wp_metadata_begin (metadata);
+  wp_metadata_set (metadata, 0, "a", NULL, "2");
+  wp_metadata_set (metadata, 0, "b", NULL, "1");
+
+  /* nested transaction */
+  wp_metadata_begin (metadata);
+  wp_metadata_set (metadata, 0, "a", NULL, "3");
+  wp_metadata_set (metadata, 5, "c", NULL, "1");
+  wp_metadata_commit (metadata);
+  g_assert_cmpuint (log->len, ==, 0);
+
+  /* values are updated, even if not notified yet */
+  g_assert_cmpstr (wp_metadata_find (metadata, 0, "a", NULL), ==, "3");
+  wp_metadata_set (metadata, 0, "b", NULL, NULL);
+  g_assert_null (wp_metadata_find (metadata, 0, "b", NULL));
+  g_assert_cmpuint (log->len, ==, 0);
+
+  /* only the last change of each key is notified, followed by the batch */
+  wp_metadata_commit (metadata);
+  g_assert_cmpuint (log->len, ==, 4);
+  g_assert_cmpstr (g_ptr_array_index (log, 0), ==, "0:a=3");
+  g_assert_cmpstr (g_ptr_array_index (log, 1), ==, "5:c=1");
+  g_assert_cmpstr (g_ptr_array_index (log, 2), ==, "0:b=NULL");
+  g_assert_cmpstr (g_ptr_array_index (log, 3), ==, "batch");
+  g_ptr_array_set_size (log, 0);
+
+  /* a transaction without changes does not notify anything */
+  wp_metadata_begin (metadata);
+  wp_metadata_commit (metadata);
+  g_assert_cmpuint (log->len, ==, 0);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -554,6 +629,8 @@ main (gint argc, gchar *argv[])
 
   g_test_add ("/wp/metadata/basic", TestFixture, NULL,
       test_metadata_setup, test_metadata_basic, test_metadata_teardown);
+  g_test_add ("/wp/metadata/transaction", TestFixture, NULL,
+      test_metadata_setup, test_metadata_transaction, test_metadata_teardown);
 
   return g_test_run ();
 }
@@ -789,6 +789,35 @@ test_object_interest_pw_props (TestFixture * f, gconstpointer data)
       WP_CONSTRAINT_TYPE_PW_PROPERTY, "port.physical", "+",
       NULL);
   TEST_EXPECT_MATCH_WP_PROPS (i, props, global_props);
+
+  /* string values of interned properties are compared by address */
+  global_props = wp_properties_intern (g_steal_pointer (&global_props));
+
+  i = wp_object_interest_new (WP_TYPE_NODE,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "format.dsp", "=s",
+      "32 bit float mono audio", NULL);
+  TEST_EXPECT_MATCH_WP_PROPS (i, props, global_props);
+
+  i = wp_object_interest_new (WP_TYPE_NODE,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "format.dsp", "=s",
+      "8 bit raw midi", NULL);
+  TEST_EXPECT_NO_MATCH_WP_PROPS (i, props, global_props);
+
+  i = wp_object_interest_new (WP_TYPE_NODE,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "format.dsp", "!s",
+      "8 bit raw midi", NULL);
+  TEST_EXPECT_MATCH_WP_PROPS (i, props, global_props);
+
+  i = wp_object_interest_new (WP_TYPE_NODE,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "format.dsp", "!s",
+      "32 bit float mono audio", NULL);
+  TEST_EXPECT_NO_MATCH_WP_PROPS (i, props, global_props);
+
+  i = wp_object_interest_new (WP_TYPE_NODE,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "object.id", "=i", 10,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "port.name", "!s", "test",
+      NULL);
+  TEST_EXPECT_MATCH_WP_PROPS (i, props, global_props);
 }
 
 static void
@@ -36,6 +36,84 @@ si_dummy_class_init (TestSiDummyClass * klass)
   si_class->configure = si_dummy_configure;
 }
 
+/* a proxy for PipeWire modules with an extra feature, which the test
+   enables manually on the link-factory module, to simulate an object that
+   takes long to activate */
+#define TEST_MODULE_FEATURE_SLOW (WP_PROXY_FEATURE_CUSTOM_START << 0)
+#define TEST_SLOW_MODULE_NAME "libpipewire-module-link-factory"
+
+struct _TestModule
+{
+  WpGlobalProxy parent;
+};
+
+G_DECLARE_FINAL_TYPE (TestModule, test_module, TEST, MODULE, WpGlobalProxy)
+G_DEFINE_TYPE (TestModule, test_module, WP_TYPE_GLOBAL_PROXY)
+
+enum {
+  STEP_SLOW = WP_TRANSITION_STEP_CUSTOM_START + 16,
+};
+
+static WpObject *slow_module = NULL;
+
+static void
+test_module_init (TestModule * self)
+{
+}
+
+static WpObjectFeatures
+test_module_get_supported_features (WpObject * object)
+{
+  return WP_PROXY_FEATURE_BOUND | TEST_MODULE_FEATURE_SLOW;
+}
+
+static guint
+test_module_activate_get_next_step (WpObject * object,
+    WpFeatureActivationTransition * transition, guint step,
+    WpObjectFeatures missing)
+{
+  if (missing & WP_PROXY_FEATURE_BOUND)
+    return WP_OBJECT_CLASS (test_module_parent_class)->activate_get_next_step (
+        object, transition, step, WP_PROXY_FEATURE_BOUND);
+  return STEP_SLOW;
+}
+
+static void
+test_module_activate_execute_step (WpObject * object,
+    WpFeatureActivationTransition * transition, guint step,
+    WpObjectFeatures missing)
+{
+  if (step == STEP_SLOW) {
+    g_autoptr (WpProperties) props =
+        wp_global_proxy_get_global_properties (WP_GLOBAL_PROXY (object));
+
+    /* the test completes this one */
+    if (!g_strcmp0 (wp_properties_get (props, PW_KEY_MODULE_NAME),
+            TEST_SLOW_MODULE_NAME))
+      slow_module = object;
+    else
+      wp_object_update_features (object, TEST_MODULE_FEATURE_SLOW, 0);
+    return;
+  }
+
+  WP_OBJECT_CLASS (test_module_parent_class)->activate_execute_step (
+      object, transition, step, missing);
+}
+
+static void
+test_module_class_init (TestModuleClass * klass)
+{
+  WpObjectClass *wpobject_class = (WpObjectClass *) klass;
+  WpProxyClass *proxy_class = (WpProxyClass *) klass;
+
+  wpobject_class->get_supported_features = test_module_get_supported_features;
+  wpobject_class->activate_get_next_step = test_module_activate_get_next_step;
+  wpobject_class->activate_execute_step = test_module_activate_execute_step;
+
+  proxy_class->pw_iface_type = PW_TYPE_INTERFACE_Module;
+  proxy_class->pw_iface_version = PW_VERSION_MODULE;
+}
+
 typedef struct {
   WpBaseTestFixture base;
   WpObjectManager *om;
@@ -162,16 +240,167 @@ test_om_iterate_remove (TestFixture *f, gconstpointer user_data)
       WP_CONSTRAINT_TYPE_PW_PROPERTY, "property1", "=s", "1234", NULL));
 }
 
+static void
+test_om_lookup_index (TestFixture *f, gconstpointer user_data)
+{
+  g_autoptr (WpObjectManager) om = NULL;
+  g_autoptr (WpIterator) it = NULL;
+  g_auto (GValue) value = G_VALUE_INIT;
+  WpSessionItem *si = NULL;
+  guint n_clients = 0;
+
+  si = g_object_new (si_dummy_get_type (), "core", f->base.core, NULL);
+  g_assert_true (wp_session_item_configure (si,
+      wp_properties_new ("object.serial", "1234", NULL)));
+  wp_session_item_register (si);
+
+  om = wp_object_manager_new ();
+  wp_object_manager_add_interest (om, WP_TYPE_CLIENT, NULL);
+  wp_object_manager_add_interest (om, si_dummy_get_type (), NULL);
+  wp_object_manager_add_index (om, "object.serial");
+  wp_object_manager_request_object_features (om,
+      WP_TYPE_CLIENT, WP_OBJECT_FEATURES_ALL);
+  test_ensure_object_manager_is_installed (om, f->base.core, f->base.loop);
+
+  it = wp_object_manager_new_filtered_iterator (om, WP_TYPE_CLIENT, NULL);
+  for (; wp_iterator_next (it, &value); g_value_unset (&value)) {
+    WpProxy *client = g_value_get_object (&value);
+    guint32 bound_id = wp_proxy_get_bound_id (client);
+    g_autofree gchar *id_str = g_strdup_printf ("%u", bound_id);
+    g_autoptr (WpProperties) global_props =
+        wp_global_proxy_get_global_properties (WP_GLOBAL_PROXY (client));
+    const gchar *serial = wp_properties_get (global_props, "object.serial");
+    g_autoptr (WpProxy) found = NULL;
+
+    n_clients++;
+
+    /* bound-id index, with both numeric and string values */
+    found = wp_object_manager_lookup (om, WP_TYPE_CLIENT,
+        WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id", "=u", bound_id, NULL);
+    g_assert_true (found == client);
+    g_clear_object (&found);
+
+    found = wp_object_manager_lookup (om, WP_TYPE_CLIENT,
+        WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id", "=s", id_str, NULL);
+    g_assert_true (found == client);
+    g_clear_object (&found);
+
+    /* property index */
+    g_assert_nonnull (serial);
+    found = wp_object_manager_lookup (om, WP_TYPE_CLIENT,
+        WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "object.serial", "=s", serial,
+        NULL);
+    g_assert_true (found == client);
+  }
+  g_assert_cmpuint (n_clients, >, 0);
+
+  g_assert_null (wp_object_manager_lookup (om, WP_TYPE_CLIENT,
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id", "=u", 123456, NULL));
+  g_assert_null (wp_object_manager_lookup (om, WP_TYPE_CLIENT,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "object.serial", "=s", "123456",
+      NULL));
+
+  /* session item properties are not indexed, but must still be found */
+  {
+    g_autoptr (WpSessionItem) found = wp_object_manager_lookup (om,
+        si_dummy_get_type (),
+        WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "object.serial", "=s", "1234",
+        NULL);
+    g_assert_true (found == si);
+  }
+
+  wp_session_item_remove (si);
+  g_assert_null (wp_object_manager_lookup (om, si_dummy_get_type (),
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "object.serial", "=s", "1234",
+      NULL));
+}
+
+static gboolean
+om_has_module (WpObjectManager * om, const gchar * name)
+{
+  g_autoptr (WpObject) o = wp_object_manager_lookup (om, test_module_get_type (),
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, PW_KEY_MODULE_NAME, "=s", name,
+      NULL);
+  return o != NULL;
+}
+
+/* the watchdog of the fixture fails the test if this takes too long */
+static void
+wait_for_module (TestFixture * f, WpObjectManager * om, const gchar * name)
+{
+  while (!om_has_module (om, name) && !g_test_failed ())
+    g_main_context_iteration (f->base.context, TRUE);
+  g_assert_true (om_has_module (om, name));
+}
+
+static void
+test_om_batch_slow_activation (TestFixture *f, gconstpointer user_data)
+{
+  g_autoptr (WpObjectManager) om_min = NULL;
+  g_autoptr (WpObjectManager) om_slow = NULL;
+
+  om_min = wp_object_manager_new ();
+  wp_object_manager_add_interest (om_min, test_module_get_type (), NULL);
+  wp_object_manager_request_object_features (om_min, test_module_get_type (),
+      WP_PROXY_FEATURE_BOUND);
+  test_ensure_object_manager_is_installed (om_min, f->base.core,
+      f->base.loop);
+
+  om_slow = wp_object_manager_new ();
+  wp_object_manager_add_interest (om_slow, test_module_get_type (), NULL);
+  wp_object_manager_request_object_features (om_slow, test_module_get_type (),
+      WP_PROXY_FEATURE_BOUND | TEST_MODULE_FEATURE_SLOW);
+  test_ensure_object_manager_is_installed (om_slow, f->base.core,
+      f->base.loop);
+
+  /* load two modules at once, so that they appear in the same registry
+     flush; the link-factory one takes "forever" to activate on om_slow */
+  {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            TEST_SLOW_MODULE_NAME, NULL, NULL));
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-adapter", NULL, NULL));
+  }
+
+  /* om_min only wants BOUND, so it gets both modules without waiting for
+     the slow feature that om_slow requested on the same proxy */
+  wait_for_module (f, om_min, TEST_SLOW_MODULE_NAME);
+  wait_for_module (f, om_min, "libpipewire-module-adapter");
+
+  /* om_slow gets the fast one, without waiting for the slow one */
+  wait_for_module (f, om_slow, "libpipewire-module-adapter");
+  g_assert_nonnull (slow_module);
+  g_assert_false (om_has_module (om_slow, TEST_SLOW_MODULE_NAME));
+
+  /* complete the slow activation; om_slow now emits objects-changed */
+  g_signal_connect_swapped (om_slow, "objects-changed",
+      G_CALLBACK (g_main_loop_quit), f->base.loop);
+  wp_object_update_features (slow_module, TEST_MODULE_FEATURE_SLOW, 0);
+  slow_module = NULL;
+  g_main_loop_run (f->base.loop);
+  g_assert_true (om_has_module (om_slow, TEST_SLOW_MODULE_NAME));
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
   g_test_init (&argc, &argv, NULL);
   wp_init (WP_INIT_ALL);
 
+  /* handle the module globals with the test proxy type */
+  g_type_ensure (test_module_get_type ());
+
   g_test_add ("/wp/om/interest-on-pw-props", TestFixture, NULL,
       test_om_setup, test_om_interest_on_pw_props, test_om_teardown);
   g_test_add ("/wp/om/iterate_remove", TestFixture, NULL,
       test_om_setup, test_om_iterate_remove, test_om_teardown);
+  g_test_add ("/wp/om/lookup-index", TestFixture, NULL,
+      test_om_setup, test_om_lookup_index, test_om_teardown);
+  g_test_add ("/wp/om/batch-slow-activation", TestFixture, NULL,
+      test_om_setup, test_om_batch_slow_activation, test_om_teardown);
 
   return g_test_run ();
 }
@@ -8,6 +8,8 @@
 
 #include "../common/test-log.h"
 #include <pipewire/pipewire.h>
+#include <stdio.h>
+#include <unistd.h>
 
 static void
 test_properties_basic (void)
@@ -167,6 +169,253 @@ test_properties_iterate (void)
   g_assert_cmpint (i, ==, 5);
 }
 
+static void
+test_properties_iterate_batch (void)
+{
+  g_autoptr (WpProperties) p = wp_properties_new_empty ();
+  g_autoptr (WpIterator) it = NULL;
+  gpointer items[2];
+  guint n, i = 0;
+
+  for (gint j = 0; j < 5; j++) {
+    g_autofree gchar *key = g_strdup_printf ("key%d", j);
+    g_autofree gchar *value = g_strdup_printf ("value%d", j);
+    wp_properties_set (p, key, value);
+  }
+
+  it = wp_properties_new_iterator (p);
+  while ((n = wp_iterator_next_batch (it, items, G_N_ELEMENTS (items))) > 0) {
+    for (guint j = 0; j < n; j++, i++) {
+      g_autofree gchar *expected_key = g_strdup_printf ("key%u", i);
+      g_autofree gchar *expected_value = g_strdup_printf ("value%u", i);
+      g_assert_cmpstr (expected_key, ==, wp_properties_item_get_key (items[j]));
+      g_assert_cmpstr (expected_value, ==,
+          wp_properties_item_get_value (items[j]));
+    }
+  }
+  g_assert_cmpuint (i, ==, 5);
+
+  /* reset and read everything at once */
+  wp_iterator_reset (it);
+  g_assert_cmpuint (wp_iterator_next_batch (it, items, 2), ==, 2);
+  g_assert_cmpstr (wp_properties_item_get_key (items[1]), ==, "key1");
+
+  /* pointer array iterators return the array items, skipping NULL ones */
+  {
+    g_autoptr (GPtrArray) arr = g_ptr_array_new_with_free_func (g_free);
+    g_autoptr (WpIterator) sit = NULL;
+    gpointer strs[4];
+
+    g_ptr_array_add (arr, g_strdup ("a"));
+    g_ptr_array_add (arr, NULL);
+    g_ptr_array_add (arr, g_strdup ("b"));
+    sit = wp_iterator_new_ptr_array (g_steal_pointer (&arr), G_TYPE_STRING);
+
+    g_assert_cmpuint (wp_iterator_next_batch (sit, strs, 4), ==, 2);
+    g_assert_cmpstr (strs[0], ==, "a");
+    g_assert_cmpstr (strs[1], ==, "b");
+    g_assert_cmpuint (wp_iterator_next_batch (sit, strs, 4), ==, 0);
+  }
+}
+
+static void
+test_properties_index (void)
+{
+  g_autoptr (WpProperties) p = wp_properties_new_empty ();
+  g_autoptr (WpProperties) w = NULL;
+  const struct spa_dict *dict;
+
+  /* large enough to be looked up through the hash index */
+  for (gint i = 0; i < 64; i++) {
+    g_autofree gchar *key = g_strdup_printf ("key%d", i);
+    g_autofree gchar *value = g_strdup_printf ("value%d", i);
+    g_assert_cmpint (wp_properties_set (p, key, value), ==, 1);
+  }
+
+  g_assert_cmpstr (wp_properties_get (p, "key0"), ==, "value0");
+  g_assert_cmpstr (wp_properties_get (p, "key63"), ==, "value63");
+  g_assert_null (wp_properties_get (p, "key64"));
+
+  /* modifications are visible to subsequent lookups */
+  g_assert_cmpint (wp_properties_set (p, "key10", "other"), ==, 1);
+  g_assert_cmpstr (wp_properties_get (p, "key10"), ==, "other");
+  g_assert_cmpint (wp_properties_set (p, "key20", NULL), ==, 1);
+  g_assert_cmpint (wp_properties_set (p, "key64", "value64"), ==, 1);
+  g_assert_null (wp_properties_get (p, "key20"));
+  g_assert_cmpstr (wp_properties_get (p, "key63"), ==, "value63");
+  g_assert_cmpstr (wp_properties_get (p, "key64"), ==, "value64");
+
+  wp_properties_sort (p);
+  g_assert_cmpstr (wp_properties_get (p, "key5"), ==, "value5");
+  g_assert_cmpint (wp_properties_set (p, "key65", "value65"), ==, 1);
+  g_assert_cmpstr (wp_properties_get (p, "key65"), ==, "value65");
+  g_assert_cmpstr (wp_properties_get (p, "key5"), ==, "value5");
+
+  /* wrapped dicts are looked up correctly */
+  dict = wp_properties_peek_dict (p);
+  w = wp_properties_new_wrap_dict (dict);
+  for (guint i = 0; i < dict->n_items; i++) {
+    const struct spa_dict_item *item = &dict->items[i];
+    g_assert_cmpstr (wp_properties_get (w, item->key), ==, item->value);
+  }
+  g_assert_null (wp_properties_get (w, "key20"));
+}
+
+static void
+test_properties_index_wrap (void)
+{
+  struct pw_properties *props = pw_properties_new (NULL, NULL);
+  g_autoptr (WpProperties) w = NULL;
+
+  for (gint i = 0; i < 64; i++) {
+    g_autofree gchar *key = g_strdup_printf ("key%d", i);
+    pw_properties_set (props, key, "value");
+  }
+
+  w = wp_properties_new_wrap (props);
+  g_assert_cmpstr (wp_properties_get (w, "key10"), ==, "value");
+
+  /* modify the wrapped structure in place, keeping its size; lookups
+     through the wrapper must see the change */
+  pw_properties_set (props, "key10", NULL);
+  pw_properties_set (props, "other", "value");
+  g_assert_null (wp_properties_get (w, "key10"));
+  g_assert_cmpstr (wp_properties_get (w, "other"), ==, "value");
+  g_assert_cmpstr (wp_properties_get (w, "key63"), ==, "value");
+
+  g_clear_pointer (&w, wp_properties_unref);
+  pw_properties_free (props);
+}
+
+static void
+test_properties_intern (void)
+{
+  g_autoptr (WpProperties) p1 = NULL;
+  g_autoptr (WpProperties) p2 = NULL;
+
+  p1 = wp_properties_intern (wp_properties_new (
+      "media.class", "Audio/Sink", "node.name", "sink1", NULL));
+  p2 = wp_properties_intern (wp_properties_new (
+      "media.class", "Audio/Sink", "node.name", "sink2", NULL));
+
+  g_assert_true (wp_properties_is_interned (p1));
+  g_assert_cmpuint (wp_properties_get_count (p1), ==, 2);
+  g_assert_cmpstr (wp_properties_get (p1, "node.name"), ==, "sink1");
+  g_assert_cmpstr (wp_properties_get (p2, "node.name"), ==, "sink2");
+
+  /* identical strings are shared */
+  g_assert_true (wp_properties_get (p1, "media.class") ==
+      wp_properties_get (p2, "media.class"));
+
+  /* interning again is a no-op */
+  {
+    WpProperties *p = wp_properties_ref (p1);
+    p = wp_properties_intern (p);
+    g_assert_true (p == p1);
+    wp_properties_unref (p);
+  }
+
+  /* interned properties are copied when made modifiable */
+  p1 = wp_properties_ensure_unique_owner (p1);
+  g_assert_false (wp_properties_is_interned (p1));
+  g_assert_cmpint (wp_properties_set (p1, "node.name", "other"), ==, 1);
+  g_assert_cmpstr (wp_properties_get (p1, "node.name"), ==, "other");
+  g_assert_cmpstr (wp_properties_get (p1, "media.class"), ==, "Audio/Sink");
+  g_assert_cmpstr (wp_properties_get (p2, "media.class"), ==, "Audio/Sink");
+}
+
+/* 250 cards with 20 channels, each with a playback and a monitor port */
+#define N_CARDS 250
+#define N_CHANNELS 20
+
+static gsize
+get_rss (void)
+{
+  g_autofree gchar *contents = NULL;
+  gsize resident = 0;
+
+  if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL) ||
+      sscanf (contents, "%*u %" G_GSIZE_FORMAT, &resident) != 1)
+    return 0;
+
+  return resident * sysconf (_SC_PAGESIZE);
+}
+
+/* the global properties that PipeWire announces for ALSA ports */
+static GPtrArray *
+make_port_properties (gboolean intern)
+{
+  GPtrArray *ports = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) wp_properties_unref);
+  guint serial = 1000;
+
+  for (guint card = 0; card < N_CARDS; card++) {
+    for (guint ch = 0; ch < N_CHANNELS; ch++) {
+      for (guint monitor = 0; monitor < 2; monitor++) {
+        const gchar *type = monitor ? "monitor" : "playback";
+        WpProperties *p = wp_properties_new_empty ();
+
+        wp_properties_setf (p, "object.serial", "%u", serial++);
+        wp_properties_setf (p, "object.path",
+            "alsa:pcm:%u:hw:%u:playback:%s_%u", card, card, type, ch);
+        wp_properties_setf (p, "port.name", "%s_AUX%u", type, ch);
+        wp_properties_setf (p, "port.alias", "Audio Card %u:%s_AUX%u",
+            card, type, ch);
+        wp_properties_set (p, "port.direction", monitor ? "out" : "in");
+        wp_properties_setf (p, "port.id", "%u", ch);
+        wp_properties_setf (p, "node.id", "%u", 100 + card);
+        wp_properties_set (p, "format.dsp", "32 bit float mono audio");
+        wp_properties_setf (p, "audio.channel", "AUX%u", ch);
+        wp_properties_set (p, "port.physical", "true");
+        wp_properties_set (p, "port.terminal", "true");
+        wp_properties_set (p, "port.monitor", monitor ? "true" : "false");
+
+        if (intern)
+          p = wp_properties_intern (p);
+        g_ptr_array_add (ports, p);
+      }
+    }
+  }
+  return ports;
+}
+
+static void
+test_properties_intern_rss (void)
+{
+  g_autoptr (GPtrArray) plain = NULL;
+  g_autoptr (GPtrArray) interned = NULL;
+  gsize base, plain_rss, interned_rss;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("this is a performance test; run with -m perf");
+    return;
+  }
+
+  base = get_rss ();
+  if (!base) {
+    g_test_skip ("the RSS of the process is not available");
+    return;
+  }
+
+  /* both sets are kept alive, so that the second one does not reuse
+     the memory that was freed by the first one */
+  plain = make_port_properties (FALSE);
+  plain_rss = get_rss () - base;
+
+  base = get_rss ();
+  interned = make_port_properties (TRUE);
+  interned_rss = get_rss () - base;
+
+  g_test_message ("%u ports: %" G_GSIZE_FORMAT " KiB plain, %"
+      G_GSIZE_FORMAT " KiB interned", plain->len, plain_rss / 1024,
+      interned_rss / 1024);
+  g_test_minimized_result ((gdouble) interned_rss / 1024,
+      "RSS of %u interned port properties: %" G_GSIZE_FORMAT " KiB",
+      interned->len, interned_rss / 1024);
+
+  g_assert_cmpuint (interned_rss, <, plain_rss);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -180,6 +429,12 @@ main (int argc, char *argv[])
   g_test_add_func ("/wp/properties/take", test_properties_take);
   g_test_add_func ("/wp/properties/to_pw_props", test_properties_to_pw_props);
   g_test_add_func ("/wp/properties/iterate", test_properties_iterate);
+  g_test_add_func ("/wp/properties/iterate_batch",
+      test_properties_iterate_batch);
+  g_test_add_func ("/wp/properties/index", test_properties_index);
+  g_test_add_func ("/wp/properties/index_wrap", test_properties_index_wrap);
+  g_test_add_func ("/wp/properties/intern", test_properties_intern);
+  g_test_add_func ("/wp/properties/intern-rss", test_properties_intern_rss);
 
   return g_test_run ();
 }
@@ -1073,6 +1073,155 @@ test_spa_pod_port_config (void)
   g_assert_nonnull (pod);
 }
 
+static void
+test_spa_pod_template (void)
+{
+  static const gchar * const keys[] = {
+    "mute", "channelVolumes", "device", NULL
+  };
+  g_autoptr (WpSpaPodTemplate) t =
+      wp_spa_pod_template_new ("Spa:Pod:Object:Param:Props", "Props", keys);
+  g_assert_nonnull (t);
+  g_assert_cmpuint (wp_spa_pod_template_get_n_fields (t), ==, 3);
+  g_assert_cmpint (wp_spa_pod_template_find_field (t, "channelVolumes"), ==, 1);
+  g_assert_cmpint (wp_spa_pod_template_find_field (t, "volume"), ==, -1);
+  g_assert_cmpuint (wp_spa_pod_template_get_field_type (t, 0), ==,
+      SPA_TYPE_Bool);
+  g_assert_cmpuint (wp_spa_pod_template_get_field_type (t, 1), ==,
+      SPA_TYPE_Array);
+
+  /* nothing set; an empty object */
+  {
+    g_autoptr (WpSpaPod) pod = wp_spa_pod_template_build (t);
+    g_autoptr (WpIterator) it = wp_spa_pod_new_iterator (pod);
+    g_auto (GValue) item = G_VALUE_INIT;
+    const gchar *id_name = NULL;
+    g_assert_true (wp_spa_pod_is_object (pod));
+    g_assert_true (wp_spa_pod_get_object (pod, &id_name, NULL));
+    g_assert_cmpstr (id_name, ==, "Props");
+    g_assert_false (wp_iterator_next (it, &item));
+  }
+
+  /* set all fields; the buffer of the previous pod is reused */
+  const float volumes[] = { 0.5f, 0.25f };
+  WpSpaPod *first = NULL;
+  g_assert_true (wp_spa_pod_template_set_boolean (t, 0, TRUE));
+  g_assert_true (wp_spa_pod_template_set_array (t, 1, 2, volumes));
+  g_assert_true (wp_spa_pod_template_set_string (t, 2, "hw:0"));
+  {
+    g_autoptr (WpSpaPod) pod = wp_spa_pod_template_build (t);
+    g_autoptr (WpSpaPod) channel_volumes = NULL;
+    g_autoptr (WpIterator) it = NULL;
+    g_auto (GValue) item = G_VALUE_INIT;
+    gboolean mute = FALSE;
+    const gchar *device = NULL;
+    guint i = 0;
+
+    g_assert_true (wp_spa_pod_get_object (pod, NULL,
+        "mute", "b", &mute,
+        "channelVolumes", "P", &channel_volumes,
+        "device", "s", &device,
+        NULL));
+    g_assert_true (mute);
+    g_assert_cmpstr (device, ==, "hw:0");
+    g_assert_true (wp_spa_pod_is_array (channel_volumes));
+
+    it = wp_spa_pod_new_iterator (channel_volumes);
+    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
+      g_assert_cmpuint (i, <, G_N_ELEMENTS (volumes));
+      g_assert_cmpfloat_with_epsilon (
+          *(float *) g_value_get_pointer (&item), volumes[i], 0.001);
+      i++;
+    }
+    g_assert_cmpuint (i, ==, G_N_ELEMENTS (volumes));
+
+    first = pod;
+  }
+
+  /* the previous pod was released, so its buffer is reused */
+  wp_spa_pod_template_unset (t, 1);
+  {
+    g_autoptr (WpSpaPod) pod = wp_spa_pod_template_build (t);
+    g_autoptr (WpIterator) it = wp_spa_pod_new_iterator (pod);
+    g_auto (GValue) item = G_VALUE_INIT;
+    gboolean mute = FALSE;
+    guint n_props = 0;
+    g_assert_true (pod == first);
+    g_assert_true (wp_spa_pod_get_object (pod, NULL,
+        "mute", "b", &mute,
+        NULL));
+    g_assert_true (mute);
+
+    /* the unset channelVolumes is omitted */
+    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
+      const gchar *key = NULL;
+      g_assert_true (wp_spa_pod_get_property (g_value_get_boxed (&item), &key,
+          NULL));
+      g_assert_cmpstr (key, !=, "channelVolumes");
+      n_props++;
+    }
+    g_assert_cmpuint (n_props, ==, 2);
+
+    /* while the pod is held, a new one is built */
+    wp_spa_pod_template_set_boolean (t, 0, FALSE);
+    {
+      g_autoptr (WpSpaPod) pod2 = wp_spa_pod_template_build (t);
+      g_assert_true (pod2 != pod);
+      g_assert_true (wp_spa_pod_get_object (pod2, NULL,
+          "mute", "b", &mute,
+          NULL));
+      g_assert_false (mute);
+    }
+    g_assert_true (wp_spa_pod_get_object (pod, NULL,
+        "mute", "b", &mute,
+        NULL));
+    g_assert_true (mute);
+  }
+
+  /* pods can be nested */
+  {
+    static const gchar * const route_keys[] = { "index", "props", NULL };
+    g_autoptr (WpSpaPodTemplate) rt =
+        wp_spa_pod_template_new ("Spa:Pod:Object:Param:Route", "Route",
+            route_keys);
+    g_autoptr (WpSpaPod) props = NULL;
+    g_autoptr (WpSpaPod) route = NULL;
+    g_autoptr (WpSpaPod) value = NULL;
+    gint index = 0;
+    gboolean mute = TRUE;
+
+    wp_spa_pod_template_clear (t);
+    wp_spa_pod_template_set_boolean (t, 0, FALSE);
+    props = wp_spa_pod_template_build (t);
+
+    g_assert_nonnull (rt);
+    g_assert_true (wp_spa_pod_template_set_int (rt, 0, 3));
+    g_assert_true (wp_spa_pod_template_set_pod (rt, 1, props));
+    route = wp_spa_pod_template_build (rt);
+
+    g_assert_true (wp_spa_pod_get_object (route, NULL,
+        "index", "i", &index,
+        "props", "P", &value,
+        NULL));
+    g_assert_cmpint (index, ==, 3);
+    g_assert_true (wp_spa_pod_get_object (value, NULL,
+        "mute", "b", &mute,
+        NULL));
+    g_assert_false (mute);
+  }
+
+  /* unknown names are not fatal */
+  {
+    static const gchar * const bad_keys[] = { "mute", "no-such-key", NULL };
+    g_assert_null (wp_spa_pod_template_new ("Spa:Pod:Object:Param:Props",
+        "Props", bad_keys));
+    g_assert_null (wp_spa_pod_template_new ("Spa:Pod:Object:Param:Props",
+        "NoSuchId", keys));
+    g_assert_null (wp_spa_pod_template_new ("Spa:Int", "Props", keys));
+    g_assert_null (wp_spa_pod_template_new ("No:Such:Type", "Props", keys));
+  }
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -1088,6 +1237,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/wp/spa-pod/iterator", test_spa_pod_iterator);
   g_test_add_func ("/wp/spa-pod/unique-owner", test_spa_pod_unique_owner);
   g_test_add_func ("/wp/spa-pod/port-config", test_spa_pod_port_config);
+  g_test_add_func ("/wp/spa-pod/template", test_spa_pod_template);
 
   return g_test_run ();
 }
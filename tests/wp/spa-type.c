@@ -374,6 +374,46 @@ test_spa_type_register (void)
     g_assert_false (wp_iterator_next (it, &value));
   }
 
+  /* lookups by name, short name and number resolve to the same values */
+  {
+    WpSpaIdTable table = wp_spa_type_get_values_table (obj_type);
+    WpSpaIdValue id = wp_spa_id_table_find_value (table, 3);
+
+    g_assert_nonnull (id);
+    g_assert_true (id ==
+        wp_spa_id_table_find_value_from_short_name (table, "volume"));
+    g_assert_true (id == wp_spa_id_table_find_value_from_name (table,
+            "Spa:Pod:Object:CustomObj:volume"));
+    g_assert_true (id ==
+        wp_spa_id_value_from_name ("Spa:Pod:Object:CustomObj:volume"));
+    g_assert_null (wp_spa_id_table_find_value (table, 6));
+    g_assert_null (
+        wp_spa_id_table_find_value_from_short_name (table, "missing"));
+  }
+
+  /* types registered after the first lookups are found too */
+  {
+    static const struct spa_type_info custom_enum2_info[] = {
+      { 7, SPA_TYPE_Int, "Spa:Enum:CustomEnum2:Seven", NULL  },
+      { 0, 0, NULL, NULL }
+    };
+    WpSpaIdTable enum2_table = wp_spa_dynamic_id_table_register (
+        "Spa:Enum:CustomEnum2", custom_enum2_info);
+    WpSpaType obj2_type = wp_spa_dynamic_type_register (
+        "Spa:Pod:Object:CustomObj2", SPA_TYPE_Object, custom_obj_info);
+
+    g_assert_true (enum2_table ==
+        wp_spa_id_table_from_name ("Spa:Enum:CustomEnum2"));
+    g_assert_true (wp_spa_id_value_from_short_name ("Spa:Enum:CustomEnum2",
+            "Seven") == &custom_enum2_info[0]);
+    g_assert_cmpuint (obj2_type, ==,
+        wp_spa_type_from_name ("Spa:Pod:Object:CustomObj2"));
+    g_assert_cmpuint (obj_type, ==,
+        wp_spa_type_from_name ("Spa:Pod:Object:CustomObj"));
+    g_assert_cmpstr (wp_spa_type_name (obj_type), ==,
+        "Spa:Pod:Object:CustomObj");
+  }
+
   wp_spa_dynamic_type_deinit ();
 }
 
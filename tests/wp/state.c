@@ -202,6 +202,59 @@ test_state_escaped (void)
   wp_state_clear (state);
 }
 
+static void
+on_state_saved (WpState * state, GAsyncResult * res, GMainLoop * loop)
+{
+  g_autoptr (GError) error = NULL;
+  g_assert_true (wp_state_save_finish (state, res, &error));
+  g_assert_no_error (error);
+  g_main_loop_quit (loop);
+}
+
+static void
+test_state_async (void)
+{
+  g_autoptr (GMainLoop) loop = g_main_loop_new (NULL, FALSE);
+  g_autoptr (WpState) state = wp_state_new ("async");
+  guint n_saves = 0;
+  gsize size = 0;
+  gint64 duration = -1, max_duration = -1;
+  g_assert_nonnull (state);
+
+  wp_state_get_save_stats (state, &n_saves, &size, NULL, NULL);
+  g_assert_cmpuint (n_saves, ==, 0);
+  g_assert_cmpuint (size, ==, 0);
+
+  /* Save */
+  {
+    g_autoptr (WpProperties) props = wp_properties_new_empty ();
+    wp_properties_set (props, "key1", "value1");
+    wp_properties_set (props, "key2", "value2");
+    wp_state_save_async (state, props, NULL,
+        (GAsyncReadyCallback) on_state_saved, loop);
+
+    /* the properties are copied, changing them must not affect the save */
+    wp_properties_set (props, "key1", "changed");
+    g_main_loop_run (loop);
+  }
+
+  /* Load */
+  {
+    g_autoptr (WpProperties) props = wp_state_load (state);
+    g_assert_nonnull (props);
+    g_assert_cmpstr (wp_properties_get (props, "key1"), ==, "value1");
+    g_assert_cmpstr (wp_properties_get (props, "key2"), ==, "value2");
+  }
+
+  wp_state_get_save_stats (state, &n_saves, &size, &duration, &max_duration);
+  g_assert_cmpuint (n_saves, ==, 1);
+  g_assert_cmpuint (size, >, 0);
+  g_assert_cmpint (duration, >=, 0);
+  g_assert_cmpint (max_duration, >=, duration);
+
+  wp_state_clear (state);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -212,6 +265,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/wp/state/empty", test_state_empty);
   g_test_add_func ("/wp/state/spaces", test_state_spaces);
   g_test_add_func ("/wp/state/escaped", test_state_escaped);
+  g_test_add_func ("/wp/state/async", test_state_async);
 
   return g_test_run ();
 }
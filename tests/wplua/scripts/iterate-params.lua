@@ -0,0 +1,78 @@
+-- Tests the filter table of PipewireObject.iterate_params(). The params of an
+-- audiotestsrc adapter node are iterated without a filter first and the
+-- results are then compared against filtered iterations.
+
+Script.async_activation = true
+
+local function count (it)
+  local n = 0
+  for _ in it do
+    n = n + 1
+  end
+  return n
+end
+
+local node = Node ("adapter", {
+  ["factory.name"] = "audiotestsrc",
+  ["node.name"] = "iterate-params-node",
+})
+
+node:activate (Features.ALL, function (n, e)
+  assert (e == nil)
+
+  -- find a scalar field of the first Props param to filter on
+  local total = 0
+  local key, value = nil, nil
+  for p in n:iterate_params ("Props") do
+    total = total + 1
+    if not key then
+      for k, v in pairs (p:parse ().properties) do
+        if type (v) ~= "table" then
+          key, value = k, v
+          break
+        end
+      end
+    end
+  end
+  assert (total > 0)
+  assert (key ~= nil)
+
+  -- matching filter, only params with an equal field are returned
+  local expected = 0
+  for p in n:iterate_params ("Props") do
+    if p:parse ().properties [key] == value then
+      expected = expected + 1
+    end
+  end
+  assert (expected > 0)
+  assert (count (n:iterate_params ("Props", { [key] = value })) == expected)
+
+  -- empty filter, everything matches
+  assert (count (n:iterate_params ("Props", {})) == total)
+
+  -- non-matching filter
+  local other = "no-such-value"
+  if type (value) == "boolean" then
+    other = not value
+  elseif type (value) == "number" then
+    other = value + 1
+  end
+  local mismatched = 0
+  for p in n:iterate_params ("Props") do
+    if p:parse ().properties [key] == other then
+      mismatched = mismatched + 1
+    end
+  end
+  assert (count (n:iterate_params ("Props", { [key] = other })) == mismatched)
+  assert (count (n:iterate_params ("Props", { [key] = "no-such-value" })) == 0)
+
+  -- missing field
+  assert (count (n:iterate_params ("Props", { ["no-such-field"] = 1 })) == 0)
+  assert (count (n:iterate_params ("Props",
+      { [key] = value, ["no-such-field"] = 1 })) == 0)
+
+  -- non-string keys never match
+  assert (count (n:iterate_params ("Props", { value })) == 0)
+
+  Script:finish_activation ()
+end)
@@ -144,3 +144,65 @@ assert (match_props["device.name"] == "alsa_card.1")
 assert (match_props["api.acp.auto-port"] == "false")
 assert (match_props["answer.universe"] == "42")
 assert (match_props["device.description"] == nil)
+
+-- pre-parsed rules must behave the same
+rules = RuleSet (Json.Raw (rules_json_str))
+
+match_props = {
+  ["device.name"] = "alsa_card.1",
+  ["test.error"] = "false",
+}
+ret, err = rules:match (match_props, match_rules_callback)
+assert (ret == true)
+assert (err == nil)
+assert (match_props["api.acp.auto-port"] == "false")
+assert (match_props["answer.universe"] == "42")
+assert (match_props["device.description"] == "My ALSA Device")
+
+match_props = {
+  ["device.name"] = "alsa_card.1",
+  ["test.error"] = "true",
+}
+ret, err = JsonUtils.match_rules (rules, match_props, match_rules_callback)
+assert (ret == false)
+assert (err == "test.error is true")
+assert (match_props["device.description"] == nil)
+
+rules = RuleSet (Json.Raw [[
+[
+  {
+    matches = [
+      {
+        node.name = "!~alsa_.*"
+        media.class = "Audio/Sink"
+      }
+      {
+        node.name = "alsa_output.0"
+        device.id = null
+      }
+    ]
+    actions = {
+      update-props = {
+        node.matched = true
+      }
+    }
+  }
+]
+]])
+
+ret_props, ret = rules:update_properties ({
+  ["node.name"] = "bluez_output.0", ["media.class"] = "Audio/Sink" })
+assert (ret == 1)
+assert (ret_props["node.matched"] == "true")
+
+ret_props, ret = rules:update_properties ({
+  ["node.name"] = "alsa_output.1", ["media.class"] = "Audio/Sink" })
+assert (ret == 0)
+
+ret_props, ret = JsonUtils.match_rules_update_properties (rules, {
+  ["node.name"] = "alsa_output.0" })
+assert (ret == 1)
+
+ret_props, ret = rules:update_properties ({
+  ["node.name"] = "alsa_output.0", ["device.id"] = "42" })
+assert (ret == 0)
@@ -93,6 +93,14 @@ assert (val.properties.direction == "Input")
 assert (val.properties.mode == "dsp")
 assert (val.properties.monitor)
 assert (pod:get_type_name() == "Spa:Pod:Object:Param:PortConfig")
+assert (pod:get_object_id () == "PortConfig")
+assert (pod:get_field ("direction") == "Input")
+assert (pod:get_field ("mode") == "dsp")
+assert (pod:get_field ("monitor") == true)
+assert (pod:get_field ("format") == nil)
+assert (pod:get_field ("invalid-field") == nil)
+assert (Pod.Int (42):get_field ("direction") == nil)
+assert (Pod.Int (42):get_object_id () == nil)
 pod = Pod.Object {
   "Spa:Pod:Object:Param:Props", "Props",
   device = "hw:Generic",
@@ -249,3 +257,44 @@ assert (val.properties["id-02000000"].properties.device == "my-sub-device")
 assert (val.properties["id-02000000"].properties["id-03000000"] == true)
 assert (val.properties["id-02000000"].properties["id-04000000"] == "string")
 assert (pod:get_type_name() == "Spa:Pod:Object:Param:Props")
+
+-- Template
+local template = Pod.Template ("Spa:Pod:Object:Param:Props", "Props",
+    { "mute", "channelVolumes", "channelMap" })
+template:set ("mute", true)
+template:set (2, { 0.5, 0.25 })
+template:set ("channelMap", { "FL", "FR" })
+pod = template:build ()
+val = pod:parse()
+assert (val.pod_type == "Object")
+assert (val.object_id == "Props")
+assert (val.properties.mute == true)
+assert (val.properties.channelVolumes.value_type == "Spa:Float")
+assert (val.properties.channelVolumes[1] == 0.5)
+assert (val.properties.channelVolumes[2] == 0.25)
+assert (val.properties.channelMap[1] == "FL")
+assert (val.properties.channelMap[2] == "FR")
+assert (pod:get_type_name() == "Spa:Pod:Object:Param:Props")
+
+template:set ("channelVolumes", nil)
+template:set ("mute", false)
+pod = template:build ()
+val = pod:parse()
+assert (val.properties.mute == false)
+assert (val.properties.channelVolumes == nil)
+assert (val.properties.channelMap[1] == "FL")
+
+template:clear ()
+template:set ("mute", Pod.Boolean (true))
+val = template:build ():parse()
+assert (val.properties.mute == true)
+assert (val.properties.channelMap == nil)
+
+-- invalid templates raise an error
+assert (not pcall (Pod.Template, "Spa:Pod:Object:Param:Props", "Props",
+    { "mute", "no-such-key" }))
+assert (not pcall (Pod.Template, "Spa:Pod:Object:Param:Props", "NoSuchId",
+    { "mute" }))
+assert (not pcall (Pod.Template, "No:Such:Type", "Props", { "mute" }))
+assert (not pcall (Pod.Template, "Spa:Pod:Object:Param:Props", "Props",
+    { "mute", 2 }))
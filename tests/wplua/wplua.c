@@ -701,6 +701,76 @@ test_wplua_script_arguments ()
   wplua_unref (L);
 }
 
+static void
+count_memory_owner (const gchar * name, guint64 allocated, guint64 n_allocs,
+    gpointer data)
+{
+  guint64 *test_allocated = data;
+  if (g_str_equal (name, "test"))
+    *test_allocated = allocated;
+}
+
+static void
+test_wplua_memory ()
+{
+  g_autoptr (GError) error = NULL;
+  WpLuaMemoryStats stats;
+  WpLuaGcConfig config = {
+    .mode = WP_LUA_GC_MODE_INCREMENTAL,
+    .full_collect_after_callback = FALSE,
+  };
+  guint64 allocated = 0;
+  gpointer prev_owner;
+  GClosure *closure;
+  lua_State *L = wplua_new ();
+
+  wplua_get_memory_stats (L, &stats);
+  g_assert_cmpuint (stats.heap_size, >, 0);
+  g_assert_cmpuint (stats.heap_peak, >=, stats.heap_size);
+  g_assert_cmpuint (stats.n_allocs, >, 0);
+  g_assert_cmpuint (stats.n_pool_allocs, >, 0);
+  g_assert_cmpuint (stats.n_pool_allocs, <=, stats.n_allocs);
+  g_assert_cmpuint (stats.gc_collections, ==, 0);
+
+  /* allocations are accounted to the current owner */
+  prev_owner = wplua_memory_owner_enter (L, "test");
+  g_assert_null (prev_owner);
+  {
+    const gchar code[] =
+      "t = {}\n"
+      "for i = 1, 100 do t[i] = { i = i, s = 'string ' .. i } end\n"
+      "f = function () local x = { 1, 2, 3 } return #x end\n"
+      "collectgarbage()\n";
+    test_load_and_call (L, code, sizeof (code) - 1, 0, 0, &error);
+    g_assert_no_error (error);
+  }
+  wplua_memory_owner_leave (L, prev_owner);
+
+  wplua_foreach_memory_owner (L, count_memory_owner, &allocated);
+  g_assert_cmpuint (allocated, >, 1000);
+
+  wplua_get_memory_stats (L, &stats);
+  g_assert_cmpuint (stats.gc_cycles, >, 0);
+
+  /* calling into Lua through a closure runs the collector afterwards */
+  g_assert_true (wplua_configure_gc (L, &config));
+  g_assert_cmpint (lua_getglobal (L, "f"), ==, LUA_TFUNCTION);
+  closure = wplua_function_to_closure (L, -1);
+  g_closure_sink (g_closure_ref (closure));
+  lua_pop (L, 1);
+
+  g_closure_invoke (closure, NULL, 0, NULL, NULL);
+  g_closure_invoke (closure, NULL, 0, NULL, NULL);
+
+  wplua_get_memory_stats (L, &stats);
+  g_assert_cmpuint (stats.gc_collections, ==, 2);
+  g_assert_cmpint (stats.gc_pause_max, >=, stats.gc_pause_last);
+  g_assert_cmpint (stats.gc_pause_total, >=, stats.gc_pause_max);
+
+  wplua_unref (L);
+  g_closure_unref (closure);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -720,6 +790,7 @@ main (gint argc, gchar *argv[])
   g_test_add_func ("/wplua/convert/wp_properties",
       test_wplua_convert_wp_properties);
   g_test_add_func ("/wplua/script_arguments", test_wplua_script_arguments);
+  g_test_add_func ("/wplua/memory", test_wplua_memory);
 
   return g_test_run ();
 }